@@ -0,0 +1,15 @@
+/***************************************************************************//**
+ * @file bsp.h
+ * @brief Host stand-in for the starter kit LED support.
+ ******************************************************************************/
+
+#ifndef BSP_H
+#define BSP_H
+
+#include <stdint.h>
+
+int BSP_LedsInit(void);
+int BSP_LedsSet(uint32_t leds);
+uint32_t BSP_LedsGet(void);
+
+#endif /* BSP_H */
@@ -0,0 +1,11 @@
+/***************************************************************************//**
+ * @file em_chip.h
+ * @brief Host stand-in for the emlib chip errata setup.
+ ******************************************************************************/
+
+#ifndef EM_CHIP_H
+#define EM_CHIP_H
+
+void CHIP_Init(void);
+
+#endif /* EM_CHIP_H */
@@ -0,0 +1,46 @@
+/***************************************************************************//**
+ * @file em_cmu.h
+ * @brief Host stand-in for the emlib clock management unit. Only the HFRCO
+ *        band has an effect, it scales EM0 time and current.
+ ******************************************************************************/
+
+#ifndef EM_CMU_H
+#define EM_CMU_H
+
+#include "em_device.h"
+
+typedef enum {
+  cmuClock_HF, cmuClock_CORE, cmuClock_HFPER, cmuClock_HFLE, cmuClock_CORELE,
+  cmuClock_LFA, cmuClock_LFB, cmuClock_GPIO, cmuClock_I2C0, cmuClock_RTC,
+  cmuClock_DMA, cmuClock_LETIMER0, cmuClock_LEUART0,
+} CMU_Clock_TypeDef;
+
+typedef enum {
+  cmuOsc_LFXO, cmuOsc_LFRCO, cmuOsc_HFXO, cmuOsc_HFRCO, cmuOsc_ULFRCO,
+} CMU_Osc_TypeDef;
+
+typedef enum {
+  cmuSelect_LFXO, cmuSelect_LFRCO, cmuSelect_ULFRCO, cmuSelect_HFRCO,
+  cmuSelect_HFXO, cmuSelect_CORELEDIV2,
+} CMU_Select_TypeDef;
+
+typedef uint32_t CMU_ClkDiv_TypeDef;
+
+typedef enum {
+  cmuHFRCOBand_1MHz, cmuHFRCOBand_7MHz, cmuHFRCOBand_11MHz,
+  cmuHFRCOBand_14MHz, cmuHFRCOBand_21MHz,
+} CMU_HFRCOBand_TypeDef;
+
+#define cmuClkDiv_1    1
+#define cmuClkDiv_2    2
+#define cmuClkDiv_4    4
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable);
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref);
+void CMU_ClockDivSet(CMU_Clock_TypeDef clock, CMU_ClkDiv_TypeDef div);
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock);
+void CMU_OscillatorEnable(CMU_Osc_TypeDef osc, bool enable, bool wait);
+void CMU_HFRCOBandSet(CMU_HFRCOBand_TypeDef band);
+CMU_HFRCOBand_TypeDef CMU_HFRCOBandGet(void);
+
+#endif /* EM_CMU_H */
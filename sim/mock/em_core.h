@@ -0,0 +1,30 @@
+/***************************************************************************//**
+ * @file em_core.h
+ * @brief Host stand-in for the emlib CORE interrupt masking.
+ *
+ * @details
+ *   There is a single priority level, so critical and atomic sections are
+ *   the same. Pending interrupts are dispatched when the mask is lifted.
+ ******************************************************************************/
+
+#ifndef EM_CORE_H
+#define EM_CORE_H
+
+#include "em_device.h"
+
+typedef uint32_t CORE_irqState_t;
+
+#define CORE_DECLARE_IRQ_STATE     CORE_irqState_t irqState
+#define CORE_ENTER_CRITICAL()      irqState = CORE_EnterCritical()
+#define CORE_EXIT_CRITICAL()       CORE_ExitCritical(irqState)
+#define CORE_YIELD_CRITICAL()      CORE_YieldCritical()
+#define CORE_ENTER_ATOMIC()        irqState = CORE_EnterAtomic()
+#define CORE_EXIT_ATOMIC()         CORE_ExitAtomic(irqState)
+
+CORE_irqState_t CORE_EnterCritical(void);
+void CORE_ExitCritical(CORE_irqState_t irqState);
+void CORE_YieldCritical(void);
+CORE_irqState_t CORE_EnterAtomic(void);
+void CORE_ExitAtomic(CORE_irqState_t irqState);
+
+#endif /* EM_CORE_H */
@@ -0,0 +1,127 @@
+/***************************************************************************//**
+ * @file em_device.h
+ * @brief Host stand-in for the EFM32HG322 device header.
+ *
+ * @details
+ *   Only the registers, bits and core functions the application touches are
+ *   provided. Register blocks are plain structs in host memory, the
+ *   simulator gives them their behavior through the emlib calls.
+ ******************************************************************************/
+
+#ifndef EM_DEVICE_H
+#define EM_DEVICE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define __IOM                      volatile
+#define __IM                       volatile const
+#define __STATIC_INLINE            static inline
+
+/** Interrupt numbers, only the ones in use. */
+typedef enum {
+  DMA_IRQn       = 0,
+  GPIO_EVEN_IRQn = 1,
+  I2C0_IRQn      = 9,
+  GPIO_ODD_IRQn  = 11,
+  LEUART0_IRQn   = 13,
+  RTC_IRQn       = 14,
+  LETIMER0_IRQn  = 15,
+  MSC_IRQn       = 20,
+} IRQn_Type;
+
+typedef struct {
+  __IOM uint32_t CTRL, CMD, STATE, STATUS, CLKDIV, SADDR, SADDRMASK, RXDATA,
+                 RXDATAP, TXDATA, TXDOUBLE, IF, IFS, IFC, IEN, ROUTE;
+} I2C_TypeDef;
+
+typedef struct {
+  __IOM uint32_t CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+
+/* Only a handle, the state lives in the simulator. */
+typedef struct {
+  __IOM uint32_t CTRL;
+} LETIMER_TypeDef;
+
+typedef struct {
+  __IOM uint32_t CTRL, TXDATA, ROUTE;
+} LEUART_TypeDef;
+
+extern I2C_TypeDef  simI2C0;
+extern LETIMER_TypeDef simLETIMER0;
+extern LEUART_TypeDef simLEUART0;
+extern SysTick_Type simSysTick;
+extern uint8_t      simFlash[];
+
+#define I2C0                       (&simI2C0)
+#define SysTick                    (&simSysTick)
+#define LETIMER0                   (&simLETIMER0)
+#define LEUART0                    (&simLEUART0)
+
+#define I2C_ROUTE_SDAPEN           0x0001
+#define I2C_ROUTE_SCLPEN           0x0002
+#define _I2C_ROUTE_LOCATION_SHIFT  8
+#define _I2C_ROUTE_LOCATION_MASK   0x0700
+
+#define I2C_CMD_START              0x0001
+#define I2C_CMD_STOP               0x0002
+#define I2C_CMD_ACK                0x0004
+#define I2C_CMD_NACK               0x0008
+#define I2C_CMD_ABORT              0x0020
+#define I2C_CMD_CLEARTX            0x0040
+#define I2C_CMD_CLEARPC            0x0080
+#define I2C_CTRL_EN                0x0001
+#define I2C_CTRL_AUTOACK           0x0004
+
+#define I2C_IF_ACK                 0x0001
+#define I2C_IF_NACK                0x0002
+#define I2C_IF_MSTOP               0x0004
+#define I2C_IF_RXDATAV             0x0008
+#define I2C_IF_TXC                 0x0010
+#define I2C_IF_BUSERR              0x0020
+#define I2C_IF_ARBLOST             0x0040
+#define _I2C_IF_MASK               0xFFFF
+#define I2C_IEN_ACK                I2C_IF_ACK
+#define I2C_IEN_NACK               I2C_IF_NACK
+#define I2C_IEN_MSTOP              I2C_IF_MSTOP
+#define I2C_IEN_RXDATAV            I2C_IF_RXDATAV
+#define I2C_IEN_TXC                I2C_IF_TXC
+#define I2C_IEN_BUSERR             I2C_IF_BUSERR
+#define I2C_IEN_ARBLOST            I2C_IF_ARBLOST
+
+#define RTC_IF_OF                  0x0001
+#define RTC_IF_COMP0               0x0002
+#define RTC_IEN_OF                 RTC_IF_OF
+#define RTC_IEN_COMP0              RTC_IF_COMP0
+
+#define LETIMER_IF_COMP0           0x0001
+#define LETIMER_IF_COMP1           0x0002
+#define LETIMER_IF_UF              0x0004
+#define LETIMER_IEN_COMP0          LETIMER_IF_COMP0
+#define LETIMER_IEN_COMP1          LETIMER_IF_COMP1
+#define LETIMER_IEN_UF             LETIMER_IF_UF
+
+#define LEUART_ROUTE_TXPEN         0x0002
+#define LEUART_ROUTE_LOCATION_LOC0 0x0000
+#define LEUART_IF_TXC              0x0001
+#define LEUART_IEN_TXC             LEUART_IF_TXC
+
+#define SysTick_CTRL_ENABLE_Msk    0x0001
+#define SysTick_CTRL_CLKSOURCE_Msk 0x0004
+
+/* The flash is a host array, the top pages hold the baseline log. */
+#define FLASH_BASE                 ((uintptr_t)simFlash)
+#define FLASH_SIZE                 0x10000
+#define FLASH_PAGE_SIZE            1024
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+
+#define __DMB()                    __sync_synchronize()
+#define __NOP()                    ((void)0)
+
+#endif /* EM_DEVICE_H */
@@ -0,0 +1,67 @@
+/***************************************************************************//**
+ * @file em_dma.h
+ * @brief Host stand-in for the emlib DMA driver.
+ *
+ * @details
+ *   Only basic transfers to the LEUART are simulated. The simulator builds
+ *   the I2C driver without its DMA path, the payload timing on the bus is
+ *   the same either way.
+ ******************************************************************************/
+
+#ifndef EM_DMA_H
+#define EM_DMA_H
+
+#include "em_device.h"
+
+#define DMA_CHAN_COUNT             6
+#define DMAREQ_I2C0_RXDATAV        1
+#define DMAREQ_I2C0_TXBL           2
+#define DMAREQ_LEUART0_TXBL        3
+
+typedef void (*DMA_FuncPtr_TypeDef)(unsigned int channel, bool primary, void *user);
+
+typedef struct {
+  DMA_FuncPtr_TypeDef cbFunc;
+  void                *userPtr;
+  uint8_t             primary;
+} DMA_CB_TypeDef;
+
+typedef struct {
+  bool           highPri;
+  bool           enableInt;
+  uint32_t       select;
+  DMA_CB_TypeDef *cb;
+} DMA_CfgChannel_TypeDef;
+
+typedef enum { dmaDataInc1, dmaDataInc2, dmaDataInc4, dmaDataIncNone } DMA_DataInc_TypeDef;
+typedef enum { dmaDataSize1, dmaDataSize2, dmaDataSize4 } DMA_DataSize_TypeDef;
+typedef enum { dmaArbitrate1, dmaArbitrate2, dmaArbitrate4 } DMA_ArbiterConfig_TypeDef;
+
+typedef struct {
+  DMA_DataInc_TypeDef       dstInc;
+  DMA_DataInc_TypeDef       srcInc;
+  DMA_DataSize_TypeDef      size;
+  DMA_ArbiterConfig_TypeDef arbRate;
+  uint8_t                   hprot;
+} DMA_CfgDescr_TypeDef;
+
+typedef struct {
+  volatile void     *SRCEND;
+  volatile void     *DSTEND;
+  volatile uint32_t CTRL;
+  volatile uint32_t USER;
+} DMA_DESCRIPTOR_TypeDef;
+
+typedef struct {
+  uint8_t                hprot;
+  DMA_DESCRIPTOR_TypeDef *controlBlock;
+} DMA_Init_TypeDef;
+
+void DMA_Init(DMA_Init_TypeDef *init);
+void DMA_CfgChannel(unsigned int channel, DMA_CfgChannel_TypeDef *cfg);
+void DMA_CfgDescr(unsigned int channel, bool primary, DMA_CfgDescr_TypeDef *cfg);
+void DMA_ActivateBasic(unsigned int channel, bool primary, bool useBurst,
+                       void *dst, const void *src, unsigned int nMinus1);
+void DMA_ChannelEnable(unsigned int channel, bool enable);
+
+#endif /* EM_DMA_H */
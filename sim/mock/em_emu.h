@@ -0,0 +1,16 @@
+/***************************************************************************//**
+ * @file em_emu.h
+ * @brief Host stand-in for the emlib energy management unit. Entering a
+ *        sleep mode advances simulated time to the next event.
+ ******************************************************************************/
+
+#ifndef EM_EMU_H
+#define EM_EMU_H
+
+#include "em_device.h"
+
+void EMU_EnterEM1(void);
+void EMU_EnterEM2(bool restore);
+void EMU_EnterEM3(bool restore);
+
+#endif /* EM_EMU_H */
@@ -0,0 +1,35 @@
+/***************************************************************************//**
+ * @file em_gpio.h
+ * @brief Host stand-in for the emlib GPIO driver.
+ ******************************************************************************/
+
+#ifndef EM_GPIO_H
+#define EM_GPIO_H
+
+#include "em_device.h"
+
+typedef enum {
+  gpioPortA, gpioPortB, gpioPortC, gpioPortD, gpioPortE, gpioPortF,
+} GPIO_Port_TypeDef;
+
+typedef enum {
+  gpioModeDisabled, gpioModeInput, gpioModeInputPull, gpioModePushPull,
+  gpioModeWiredAnd, gpioModeWiredAndPullUp, gpioModeWiredAndPullUpFilter,
+} GPIO_Mode_TypeDef;
+
+void GPIO_PinModeSet(GPIO_Port_TypeDef port, unsigned int pin,
+                     GPIO_Mode_TypeDef mode, unsigned int out);
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin);
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin);
+void GPIO_PinOutToggle(GPIO_Port_TypeDef port, unsigned int pin);
+unsigned int GPIO_PinInGet(GPIO_Port_TypeDef port, unsigned int pin);
+unsigned int GPIO_PinOutGet(GPIO_Port_TypeDef port, unsigned int pin);
+void GPIO_IntConfig(GPIO_Port_TypeDef port, unsigned int pin,
+                    bool risingEdge, bool fallingEdge, bool enable);
+uint32_t GPIO_IntGet(void);
+uint32_t GPIO_IntGetEnabled(void);
+void GPIO_IntClear(uint32_t flags);
+void GPIO_IntEnable(uint32_t flags);
+void GPIO_IntDisable(uint32_t flags);
+
+#endif /* EM_GPIO_H */
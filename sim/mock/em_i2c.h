@@ -0,0 +1,87 @@
+/***************************************************************************//**
+ * @file em_i2c.h
+ * @brief Host stand-in for the emlib I2C driver.
+ *
+ * @details
+ *   I2C_TransferInit() runs the whole transfer against the simulated bus
+ *   at once and raises the interrupt after the time the bytes would take
+ *   on the wire. I2C_Transfer() then reports the result.
+ ******************************************************************************/
+
+#ifndef EM_I2C_H
+#define EM_I2C_H
+
+#include "em_device.h"
+
+#define I2C_FLAG_WRITE             0x0001
+#define I2C_FLAG_READ              0x0002
+#define I2C_FLAG_WRITE_READ        0x0004
+#define I2C_FLAG_WRITE_WRITE       0x0008
+
+#define I2C_FREQ_STANDARD_MAX      92000
+#define I2C_FREQ_FAST_MAX          392157
+
+typedef enum {
+  i2cTransferInProgress = 1,
+  i2cTransferDone       = 0,
+  i2cTransferNack       = -1,
+  i2cTransferBusErr     = -2,
+  i2cTransferArbLost    = -3,
+  i2cTransferUsageFault = -4,
+  i2cTransferSwFault    = -5,
+} I2C_TransferReturn_TypeDef;
+
+typedef enum {
+  i2cClockHLRStandard, i2cClockHLRAsymetric, i2cClockHLRFast,
+} I2C_ClockHLR_TypeDef;
+
+typedef struct {
+  bool                 enable;
+  bool                 master;
+  uint32_t             refFreq;
+  uint32_t             freq;
+  I2C_ClockHLR_TypeDef clhr;
+} I2C_Init_TypeDef;
+
+typedef struct {
+  uint16_t addr;
+  uint16_t flags;
+  struct {
+    uint8_t  *data;
+    uint16_t len;
+  } buf[2];
+} I2C_TransferSeq_TypeDef;
+
+void I2C_Init(I2C_TypeDef *i2c, const I2C_Init_TypeDef *init);
+void I2C_BusFreqSet(I2C_TypeDef *i2c, uint32_t freqRef, uint32_t freqScl,
+                    I2C_ClockHLR_TypeDef i2cMode);
+I2C_TransferReturn_TypeDef I2C_TransferInit(I2C_TypeDef *i2c,
+                                            I2C_TransferSeq_TypeDef *seq);
+I2C_TransferReturn_TypeDef I2C_Transfer(I2C_TypeDef *i2c);
+
+__STATIC_INLINE void I2C_IntClear(I2C_TypeDef *i2c, uint32_t flags)
+{
+  i2c->IF &= ~flags;
+}
+
+__STATIC_INLINE void I2C_IntEnable(I2C_TypeDef *i2c, uint32_t flags)
+{
+  i2c->IEN |= flags;
+}
+
+__STATIC_INLINE void I2C_IntDisable(I2C_TypeDef *i2c, uint32_t flags)
+{
+  i2c->IEN &= ~flags;
+}
+
+__STATIC_INLINE uint32_t I2C_IntGet(I2C_TypeDef *i2c)
+{
+  return i2c->IF;
+}
+
+__STATIC_INLINE uint32_t I2C_IntGetEnabled(I2C_TypeDef *i2c)
+{
+  return i2c->IEN;
+}
+
+#endif /* EM_I2C_H */
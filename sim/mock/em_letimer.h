@@ -0,0 +1,48 @@
+/***************************************************************************//**
+ * @file em_letimer.h
+ * @brief Host stand-in for the emlib LETIMER driver, counting simulated time.
+ ******************************************************************************/
+
+#ifndef EM_LETIMER_H
+#define EM_LETIMER_H
+
+#include "em_device.h"
+
+typedef enum {
+  letimerRepeatFree, letimerRepeatOneshot, letimerRepeatBuffered,
+  letimerRepeatDouble,
+} LETIMER_RepeatMode_TypeDef;
+
+typedef enum {
+  letimerUFOANone, letimerUFOAToggle, letimerUFOAPulse, letimerUFOAPwm,
+} LETIMER_UFOA_TypeDef;
+
+typedef struct {
+  bool                       enable;
+  bool                       debugRun;
+  bool                       rtcComp0Enable;
+  bool                       rtcComp1Enable;
+  bool                       comp0Top;
+  bool                       bufTop;
+  uint8_t                    out0Pol;
+  uint8_t                    out1Pol;
+  LETIMER_UFOA_TypeDef       ufoa0;
+  LETIMER_UFOA_TypeDef       ufoa1;
+  LETIMER_RepeatMode_TypeDef repMode;
+} LETIMER_Init_TypeDef;
+
+#define LETIMER_INIT_DEFAULT                                        \
+  { true, false, false, false, false, false, 0, 0, letimerUFOANone, \
+    letimerUFOANone, letimerRepeatFree }
+
+void LETIMER_Init(LETIMER_TypeDef *letimer, const LETIMER_Init_TypeDef *init);
+void LETIMER_Reset(LETIMER_TypeDef *letimer);
+void LETIMER_Enable(LETIMER_TypeDef *letimer, bool enable);
+void LETIMER_CompareSet(LETIMER_TypeDef *letimer, unsigned int comp, uint32_t value);
+uint32_t LETIMER_CounterGet(LETIMER_TypeDef *letimer);
+uint32_t LETIMER_IntGet(LETIMER_TypeDef *letimer);
+void LETIMER_IntClear(LETIMER_TypeDef *letimer, uint32_t flags);
+void LETIMER_IntEnable(LETIMER_TypeDef *letimer, uint32_t flags);
+void LETIMER_IntDisable(LETIMER_TypeDef *letimer, uint32_t flags);
+
+#endif /* EM_LETIMER_H */
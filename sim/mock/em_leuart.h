@@ -0,0 +1,38 @@
+/***************************************************************************//**
+ * @file em_leuart.h
+ * @brief Host stand-in for the emlib LEUART driver, transmit only.
+ ******************************************************************************/
+
+#ifndef EM_LEUART_H
+#define EM_LEUART_H
+
+#include "em_device.h"
+
+typedef enum {
+  leuartDisable = 0, leuartEnableRx = 1, leuartEnableTx = 2, leuartEnable = 3,
+} LEUART_Enable_TypeDef;
+
+typedef enum { leuartDatabits8, leuartDatabits9 } LEUART_Databits_TypeDef;
+typedef enum { leuartNoParity, leuartEvenParity, leuartOddParity } LEUART_Parity_TypeDef;
+typedef enum { leuartStopbits1, leuartStopbits2 } LEUART_Stopbits_TypeDef;
+
+typedef struct {
+  LEUART_Enable_TypeDef   enable;
+  uint32_t                refFreq;
+  uint32_t                baudrate;
+  LEUART_Databits_TypeDef databits;
+  LEUART_Parity_TypeDef   parity;
+  LEUART_Stopbits_TypeDef stopbits;
+} LEUART_Init_TypeDef;
+
+#define LEUART_INIT_DEFAULT \
+  { leuartEnable, 0, 9600, leuartDatabits8, leuartNoParity, leuartStopbits1 }
+
+void LEUART_Init(LEUART_TypeDef *leuart, const LEUART_Init_TypeDef *init);
+void LEUART_TxDmaInEM2Enable(LEUART_TypeDef *leuart, bool enable);
+uint32_t LEUART_IntGet(LEUART_TypeDef *leuart);
+void LEUART_IntClear(LEUART_TypeDef *leuart, uint32_t flags);
+void LEUART_IntEnable(LEUART_TypeDef *leuart, uint32_t flags);
+void LEUART_IntDisable(LEUART_TypeDef *leuart, uint32_t flags);
+
+#endif /* EM_LEUART_H */
@@ -0,0 +1,28 @@
+/***************************************************************************//**
+ * @file em_rtc.h
+ * @brief Host stand-in for the emlib RTC driver, counting simulated time.
+ ******************************************************************************/
+
+#ifndef EM_RTC_H
+#define EM_RTC_H
+
+#include "em_device.h"
+
+typedef struct {
+  bool enable;
+  bool debugRun;
+  bool comp0Top;
+} RTC_Init_TypeDef;
+
+#define RTC_INIT_DEFAULT  { true, false, true }
+
+void RTC_Init(const RTC_Init_TypeDef *init);
+uint32_t RTC_CounterGet(void);
+void RTC_CompareSet(unsigned int comp, uint32_t value);
+uint32_t RTC_CompareGet(unsigned int comp);
+uint32_t RTC_IntGet(void);
+void RTC_IntClear(uint32_t flags);
+void RTC_IntEnable(uint32_t flags);
+void RTC_IntDisable(uint32_t flags);
+
+#endif /* EM_RTC_H */
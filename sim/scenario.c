@@ -0,0 +1,170 @@
+/***************************************************************************//**
+ * @file scenario.c
+ * @brief Scripted room conditions the simulated sensors measure.
+ *
+ * @details
+ *   Profiles repeat every 24 hours and are deterministic, so two runs of
+ *   the same scenario differ only by the firmware policy. The noise is a
+ *   hash of the second and the sensor, a few ppm like a settled CCS811.
+ ******************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include "scenario.h"
+
+/***************************************************************************//**
+ * @addtogroup SCENARIO
+ * @{
+ ******************************************************************************/
+
+#ifndef M_PI
+#define M_PI             3.14159265358979323846
+#endif
+
+#define DAY_S            86400
+#define HOUR_S           3600
+#define OUTDOOR_PPM      430.0
+#define NOISE_PPM        8
+#define SENSOR_SPREAD    15       /* Offset of the second sensor [ppm] */
+
+/** Constant level of a stretch of the day. */
+typedef struct {
+  uint32_t start;                 /* Seconds since midnight */
+  double   target;                /* Level the room settles at [ppm] */
+} Phase_TypeDef;
+
+/* Occupied 08:30-12:00 and 13:00-17:30 with a meeting 14:00-15:00. */
+static const Phase_TypeDef officeDay[] = {
+  {     0, OUTDOOR_PPM },
+  { 30600, 1150.0 },
+  { 43200, OUTDOOR_PPM },
+  { 46800, 1150.0 },
+  { 50400, 1650.0 },
+  { 54000, 1150.0 },
+  { 63000, OUTDOOR_PPM },
+};
+
+/***************************************************************************//**
+ * @brief
+ *   Deterministic noise in -NOISE_PPM..NOISE_PPM.
+ ******************************************************************************/
+static int noise(int sensor, uint32_t t)
+{
+  uint32_t h = t * 2654435761u ^ (uint32_t)(sensor + 1) * 40503u;
+
+  h ^= h >> 15;
+  h *= 2246822519u;
+  h ^= h >> 13;
+  return (int)(h % (2 * NOISE_PPM + 1)) - NOISE_PPM;
+}
+
+static uint16_t finish(int sensor, uint32_t t, double ppm)
+{
+  ppm += noise(sensor, t) + sensor * SENSOR_SPREAD;
+  if (ppm < 400.0) {
+    ppm = 400.0;
+  }
+  return (uint16_t)ppm;
+}
+
+/* Empty room, outdoor air. */
+static uint16_t steadyEco2(int sensor, uint32_t t)
+{
+  return finish(sensor, t, OUTDOOR_PPM);
+}
+
+/* Filling with people raises the level with a 40 min time constant,
+   ventilation brings it back down with 60 min. */
+static uint16_t officeEco2(int sensor, uint32_t t)
+{
+  uint32_t tod = t % DAY_S;
+  double level = OUTDOOR_PPM;
+  size_t i;
+
+  for (i = 0; i < sizeof(officeDay) / sizeof(officeDay[0]); i++) {
+    uint32_t from = officeDay[i].start;
+    uint32_t to = (i + 1 < sizeof(officeDay) / sizeof(officeDay[0]))
+                  ? officeDay[i + 1].start : DAY_S;
+    double target = officeDay[i].target;
+    double tau = (target > level) ? 2400.0 : 3600.0;
+
+    if (tod < from) {
+      break;
+    }
+    if (tod < to) {
+      to = tod;
+    }
+    level = target + (level - target) * exp(-(double)(to - from) / tau);
+  }
+  return finish(sensor, t, level);
+}
+
+/* Quiet room with a 10 minute burst every 3 hours, e.g. a kitchen. */
+static uint16_t spikesEco2(int sensor, uint32_t t)
+{
+  return finish(sensor, t, ((t % (3 * HOUR_S)) < 600) ? 1500.0 : 480.0);
+}
+
+static const SCENARIO_TypeDef scenarios[] = {
+  { "steady", "empty room at outdoor level",                 24, steadyEco2 },
+  { "office", "workday occupancy with a meeting peak",       24, officeEco2 },
+  { "spikes", "quiet room, 10 min bursts every 3 h",         24, spikesEco2 },
+};
+
+/***************************************************************************//**
+ * @brief
+ *   Look up a scenario by name, NULL when there is none.
+ ******************************************************************************/
+const SCENARIO_TypeDef *SCENARIO_Find(const char *name)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++) {
+    if (strcmp(scenarios[i].name, name) == 0) {
+      return &scenarios[i];
+    }
+  }
+  return NULL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Scenario by position, NULL past the last one.
+ ******************************************************************************/
+const SCENARIO_TypeDef *SCENARIO_Get(int index)
+{
+  if ((index < 0) || (index >= (int)(sizeof(scenarios) / sizeof(scenarios[0])))) {
+    return NULL;
+  }
+  return &scenarios[index];
+}
+
+/***************************************************************************//**
+ * @brief
+ *   TVOC that goes with an eCO2 value, the CCS811 derives both from the
+ *   same resistance.
+ ******************************************************************************/
+uint16_t SCENARIO_Tvoc(uint16_t eco2)
+{
+  return (eco2 > 400) ? (uint16_t)((eco2 - 400) * 3 / 10) : 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Relative humidity [%RH], 45 % with a slow daily swing.
+ ******************************************************************************/
+double SCENARIO_Humidity(uint32_t t)
+{
+  return 45.0 + 5.0 * sin(2.0 * M_PI * (double)(t % DAY_S) / DAY_S);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Temperature [degC], 21 degC with a slow daily swing.
+ ******************************************************************************/
+double SCENARIO_Temperature(uint32_t t)
+{
+  return 21.0 - 1.5 * cos(2.0 * M_PI * (double)(t % DAY_S) / DAY_S);
+}
+
+/** @} (end group SCENARIO) */
@@ -0,0 +1,33 @@
+/***************************************************************************//**
+ * @file scenario.h
+ * @brief Scripted room conditions the simulated sensors measure.
+ ******************************************************************************/
+
+#ifndef SCENARIO_H
+#define SCENARIO_H
+
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup SCENARIO
+ * @brief Air quality profiles over simulated time
+ * @{
+ ******************************************************************************/
+
+/** One scenario, all functions take the time in seconds since midnight. */
+typedef struct SCENARIO_TypeDef {
+  const char *name;
+  const char *description;
+  uint32_t   defaultHours;                        /**< Run length without -t  */
+  uint16_t   (*eco2)(int sensor, uint32_t t);     /**< eCO2 [ppm]             */
+} SCENARIO_TypeDef;
+
+const SCENARIO_TypeDef *SCENARIO_Find(const char *name);
+const SCENARIO_TypeDef *SCENARIO_Get(int index);
+uint16_t SCENARIO_Tvoc(uint16_t eco2);
+double SCENARIO_Humidity(uint32_t t);
+double SCENARIO_Temperature(uint32_t t);
+
+/** @} (end group SCENARIO) */
+
+#endif /* SCENARIO_H */
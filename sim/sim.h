@@ -0,0 +1,126 @@
+/***************************************************************************//**
+ * @file sim.h
+ * @brief Host simulation of the board: time, interrupts, energy and devices.
+ *
+ * @details
+ *   The application sources are compiled unchanged against the headers in
+ *   mock/. Simulated time only moves when the application executes a HAL
+ *   call (a fixed number of EM0 cycles each) or sleeps, in which case it
+ *   jumps straight to the next event of one of the sources below. Every time step is
+ *   charged to the energy budget of the MCU mode it was spent in and of the
+ *   sensors in the state they were in.
+ ******************************************************************************/
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_device.h"
+#include "em_i2c.h"
+#include "scenario.h"
+
+/***************************************************************************//**
+ * @addtogroup SIM
+ * @brief Board simulation for host builds
+ * @{
+ ******************************************************************************/
+
+#define SIM_NS_PER_S        1000000000ULL
+#define SIM_NS_PER_MS       1000000ULL
+#define SIM_NS_PER_US       1000ULL
+#define SIM_NEVER           UINT64_MAX
+
+/** Estimated cost of one HAL call, including the code around it [cycles]. */
+#define SIM_HAL_CALL_CYCLES 42
+
+/** MCU energy modes, EM0 is running code. */
+typedef enum {
+  simModeEM0,
+  simModeEM1,
+  simModeEM2,
+  simModeEM3,
+  simModeCount
+} SIM_Mode_TypeDef;
+
+/** Something that produces events in simulated time. */
+typedef struct {
+  uint64_t (*next)(void);               /**< Time of the next event, or SIM_NEVER */
+  void     (*sync)(uint64_t now);       /**< Apply all events up to now, idempotent */
+  void     (*account)(uint64_t dt);     /**< Charge dt ns in the current state, may be NULL */
+} SIM_Source_TypeDef;
+
+/** Counters collected over a run. */
+typedef struct {
+  uint32_t i2cTransfers;                /**< Transfers started on the bus       */
+  uint32_t i2cBytes;                    /**< Bytes on the bus incl. addresses   */
+  uint32_t i2cNacks;                    /**< Transfers NACKed by the slave      */
+  uint32_t wakeups;                     /**< Exits from EM2 or EM3              */
+  uint32_t em1Sleeps;                   /**< Exits from EM1                     */
+  uint32_t irqs[32];                    /**< Handler invocations per IRQ        */
+  uint32_t ledChanges;                  /**< LED pattern updates                */
+  uint32_t flashErases;                 /**< Flash page erases                  */
+  uint32_t flashWords;                  /**< Flash words written                */
+  uint32_t wakeViolations;              /**< CCS811 addressed before tAWAKE     */
+  uint32_t i2cOverclocked;              /**< Transfers with SCL above fast mode */
+  uint32_t bandSwitches;                /**< HFRCO band changes                 */
+  uint32_t uartBytes;                   /**< Bytes sent on the LEUART           */
+  uint32_t telemFrames;                 /**< Telemetry frames received intact   */
+  uint32_t telemRecords;                /**< Sample records in those frames     */
+  uint32_t telemAggregates;             /**< Period aggregates in those frames  */
+  uint32_t telemBadFrames;              /**< Frames failing COBS or CRC checks  */
+  uint32_t telemSequenceGaps;           /**< Jumps in the frame sequence number */
+  uint32_t benchRecords;                /**< Benchmark records in those frames  */
+  uint32_t logRecords;                  /**< Replayed flash log records         */
+  uint32_t logDisorder;                 /**< Replayed out of order              */
+  uint32_t fwChunks;                    /**< FW_PROGRAM chunks accepted         */
+  uint32_t fwBusyNacks;                 /**< Transfers NACKed while programming */
+  uint32_t fwDroppedChunks;             /**< FW_PROGRAM chunks ACKed but lost   */
+  uint32_t fwUpdates;                   /**< CCS811 images that verified        */
+  uint64_t fwUpdateNs;                  /**< Erase to verified, all updates     */
+  uint32_t faultsInjected;              /**< CCS811 faults injected             */
+  uint32_t faultsCleared;               /**< Faults followed by a sample again  */
+  uint64_t faultRecoveryNs;             /**< Fault to next sample, all faults   */
+  uint64_t modeNs[simModeCount];        /**< Time spent per MCU mode            */
+  double   mcuCharge;                   /**< MCU charge [mA ns]                 */
+  double   sensorCharge;                /**< CCS811 charge [mA ns]              */
+  double   envCharge;                   /**< Si7021 charge [mA ns]              */
+  double   ledCharge;                   /**< LED charge [mA ns]                 */
+} SIM_Stats_TypeDef;
+
+extern SIM_Stats_TypeDef simStats;
+
+/* simcore.c */
+void     SIM_Init(uint64_t endNs);
+void     SIM_AddSource(const SIM_Source_TypeDef *source);
+uint64_t SIM_Now(void);
+void     SIM_Execute(uint64_t ns);
+void     SIM_ExecuteCycles(uint32_t cycles);
+void     SIM_Sleep(SIM_Mode_TypeDef mode);
+void     SIM_Pend(IRQn_Type irq);
+bool     SIM_InIrq(void);
+
+/* simhal.c */
+void     SIMHAL_Init(void);
+void     SIMHAL_DriveInput(int port, unsigned int pin, unsigned int level);
+bool     SIMHAL_PinIsOutput(int port, unsigned int pin);
+unsigned int SIMHAL_PinOut(int port, unsigned int pin);
+uint32_t SIMHAL_CoreHz(void);
+void     SIMHAL_SysTickRun(uint64_t ns);
+
+/* simuart.c */
+extern bool simBenchCsv;
+void     SIMUART_Init(void);
+
+/* simdev.c */
+void     SIMDEV_Init(const SCENARIO_TypeDef *scenario);
+void     SIMDEV_PinChanged(int port, unsigned int pin);
+I2C_TransferReturn_TypeDef SIMDEV_Transfer(const I2C_TransferSeq_TypeDef *seq,
+                                           uint32_t *bytes);
+
+/* simmain.c */
+void     SIM_End(const char *reason);
+
+/** @} (end group SIM) */
+
+#endif /* SIM_H */
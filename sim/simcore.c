@@ -0,0 +1,371 @@
+/***************************************************************************//**
+ * @file simcore.c
+ * @brief Simulated time, interrupt dispatch and MCU energy accounting.
+ *
+ * @details
+ *   There is one interrupt priority, like in the application. Handlers run
+ *   when a source pends them and the core is neither masked nor already in
+ *   a handler, or at the next unmask. A sleep returns at once when an
+ *   enabled interrupt is pending, masked or not, exactly like WFI.
+ *
+ *   The currents below are typical datasheet figures for the EFM32HG at
+ *   3.3 V, EM0 and EM1 scale with the HFRCO band. EM0 time is not measured
+ *   but estimated, every HAL call costs SIM_HAL_CALL_CYCLES and every
+ *   handler SIM_IRQ_ENTRY_CYCLES, which stands in for the application code
+ *   around them.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "em_core.h"
+#include "em_emu.h"
+#include "sim.h"
+
+/***************************************************************************//**
+ * @addtogroup SIM
+ * @{
+ ******************************************************************************/
+
+#define SIM_SOURCE_MAX      6
+
+/* Estimated cost of an interrupt entry and exit [cycles]. */
+#define SIM_IRQ_ENTRY_CYCLES 140
+
+/* MCU supply current per mode, a fixed part plus a part per MHz of the
+   core clock, about 2.1 mA in EM0 and 0.8 mA in EM1 at 14 MHz [mA]. */
+static const double modeCurrent[simModeCount] = {
+  0.28,       /* EM0, from flash             */
+  0.15,       /* EM1, peripherals clocked    */
+  0.0012,     /* EM2, RTC on the LFXO        */
+  0.0009,     /* EM3                         */
+};
+static const double modeCurrentPerMHz[simModeCount] = {
+  0.130,
+  0.046,
+  0,
+  0,
+};
+
+SIM_Stats_TypeDef simStats;
+
+static const SIM_Source_TypeDef *sources[SIM_SOURCE_MAX];
+static int sourceCount;
+static uint64_t now;
+static uint64_t end;
+static bool masked;
+static bool inIrq;
+static uint32_t irqEnabled;
+static uint32_t irqPending;
+
+/* Weak, so variants that compile a driver out still link. */
+extern void GPIO_EVEN_IRQHandler(void) __attribute__ ((weak));
+extern void GPIO_ODD_IRQHandler(void) __attribute__ ((weak));
+extern void I2C0_IRQHandler(void) __attribute__ ((weak));
+extern void RTC_IRQHandler(void) __attribute__ ((weak));
+extern void LETIMER0_IRQHandler(void) __attribute__ ((weak));
+extern void LEUART0_IRQHandler(void) __attribute__ ((weak));
+extern void DMA_IRQHandler(void) __attribute__ ((weak));
+
+/***************************************************************************//**
+ * @brief
+ *   Handler for an interrupt number, NULL for the ones nobody uses.
+ ******************************************************************************/
+static void (*irqHandler(int irq))(void)
+{
+  switch (irq) {
+    case GPIO_EVEN_IRQn:
+      return GPIO_EVEN_IRQHandler;
+    case GPIO_ODD_IRQn:
+      return GPIO_ODD_IRQHandler;
+    case I2C0_IRQn:
+      return I2C0_IRQHandler;
+    case RTC_IRQn:
+      return RTC_IRQHandler;
+    case LETIMER0_IRQn:
+      return LETIMER0_IRQHandler;
+    case LEUART0_IRQn:
+      return LEUART0_IRQHandler;
+    case DMA_IRQn:
+      return DMA_IRQHandler;
+    default:
+      return NULL;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reset the simulation, the run stops once time passes endNs.
+ ******************************************************************************/
+void SIM_Init(uint64_t endNs)
+{
+  now = 0;
+  end = endNs;
+  masked = false;
+  inIrq = false;
+  irqEnabled = 0;
+  irqPending = 0;
+  sourceCount = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Register an event source, sources are synced in registration order.
+ ******************************************************************************/
+void SIM_AddSource(const SIM_Source_TypeDef *source)
+{
+  if (sourceCount >= SIM_SOURCE_MAX) {
+    SIM_End("too many event sources");
+  }
+  sources[sourceCount++] = source;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Current simulated time [ns].
+ ******************************************************************************/
+uint64_t SIM_Now(void)
+{
+  return now;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Earliest pending event of all sources.
+ ******************************************************************************/
+static uint64_t nextEvent(void)
+{
+  uint64_t t = SIM_NEVER;
+  int i;
+
+  for (i = 0; i < sourceCount; i++) {
+    uint64_t n = sources[i]->next();
+    if (n < t) {
+      t = n;
+    }
+  }
+  return t;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Move time forward to target, stepping through the events on the way.
+ ******************************************************************************/
+static void advanceTo(uint64_t target, SIM_Mode_TypeDef mode)
+{
+  int i;
+
+  while (now < target) {
+    uint64_t step = nextEvent();
+    uint64_t dt;
+
+    if ((step <= now) || (step > target)) {
+      step = target;
+    }
+    dt = step - now;
+    for (i = 0; i < sourceCount; i++) {
+      if (sources[i]->account != NULL) {
+        sources[i]->account(dt);
+      }
+    }
+    simStats.modeNs[mode] += dt;
+    if (mode <= simModeEM1) {
+      SIMHAL_SysTickRun(dt);
+    }
+    simStats.mcuCharge += (modeCurrent[mode]
+                           + modeCurrentPerMHz[mode] * SIMHAL_CoreHz() / 1e6)
+                          * (double)dt;
+    now = step;
+    for (i = 0; i < sourceCount; i++) {
+      sources[i]->sync(now);
+    }
+  }
+  if (now >= end) {
+    SIM_End(NULL);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check for an interrupt that would wake the core.
+ ******************************************************************************/
+static bool wakePending(void)
+{
+  return (irqPending & irqEnabled) != 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run pending handlers, lowest number first, while the core may take them.
+ ******************************************************************************/
+static void dispatch(void)
+{
+  while (!masked && !inIrq && wakePending()) {
+    uint32_t ready = irqPending & irqEnabled;
+    int irq = __builtin_ctz(ready);
+    void (*handler)(void) = irqHandler(irq);
+
+    irqPending &= ~(1UL << irq);
+    if (handler == NULL) {
+      continue;
+    }
+    inIrq = true;
+    simStats.irqs[irq]++;
+    advanceTo(now + (uint64_t)SIM_IRQ_ENTRY_CYCLES * SIM_NS_PER_S / SIMHAL_CoreHz(),
+              simModeEM0);
+    handler();
+    inIrq = false;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Spend ns of EM0 time, taking any interrupt that becomes due.
+ ******************************************************************************/
+void SIM_Execute(uint64_t ns)
+{
+  advanceTo(now + ns, simModeEM0);
+  dispatch();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Spend a number of core cycles at the current clock.
+ ******************************************************************************/
+void SIM_ExecuteCycles(uint32_t cycles)
+{
+  SIM_Execute((uint64_t)cycles * SIM_NS_PER_S / SIMHAL_CoreHz());
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Sleep in mode until an enabled interrupt is pending.
+ ******************************************************************************/
+void SIM_Sleep(SIM_Mode_TypeDef mode)
+{
+  uint64_t start = now;
+
+  while (!wakePending()) {
+    uint64_t t = nextEvent();
+    if (t == SIM_NEVER) {
+      SIM_End("no wakeup source left, the application sleeps forever");
+    }
+    if (t <= now) {
+      t = now + 1;
+    }
+    advanceTo(t, mode);
+  }
+  if (now != start) {
+    if (mode >= simModeEM2) {
+      simStats.wakeups++;
+    } else {
+      simStats.em1Sleeps++;
+    }
+  }
+  dispatch();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Latch an interrupt request. Disabled interrupts stay latched, the
+ *   handler runs after the current HAL call or sleep.
+ ******************************************************************************/
+void SIM_Pend(IRQn_Type irq)
+{
+  irqPending |= 1UL << irq;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether an interrupt handler is running.
+ ******************************************************************************/
+bool SIM_InIrq(void)
+{
+  return inIrq;
+}
+
+/** Stand-in for the emlib assert handler. */
+void assertEFM(const char *file, int line)
+{
+  char reason[128];
+
+  snprintf(reason, sizeof(reason), "assert failed at %s:%d", file, line);
+  SIM_End(reason);
+}
+
+/* --- Cortex-M core ------------------------------------------------------- */
+
+void NVIC_EnableIRQ(IRQn_Type irq)
+{
+  irqEnabled |= 1UL << irq;
+  dispatch();
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq)
+{
+  irqEnabled &= ~(1UL << irq);
+}
+
+void NVIC_SetPendingIRQ(IRQn_Type irq)
+{
+  SIM_Pend(irq);
+  dispatch();
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq)
+{
+  irqPending &= ~(1UL << irq);
+}
+
+CORE_irqState_t CORE_EnterCritical(void)
+{
+  CORE_irqState_t state = masked;
+
+  masked = true;
+  return state;
+}
+
+void CORE_ExitCritical(CORE_irqState_t irqState)
+{
+  masked = (irqState != 0);
+  dispatch();
+}
+
+void CORE_YieldCritical(void)
+{
+  if (masked) {
+    masked = false;
+    dispatch();
+    masked = true;
+  }
+}
+
+CORE_irqState_t CORE_EnterAtomic(void)
+{
+  return CORE_EnterCritical();
+}
+
+void CORE_ExitAtomic(CORE_irqState_t irqState)
+{
+  CORE_ExitCritical(irqState);
+}
+
+/* --- Energy management unit ---------------------------------------------- */
+
+void EMU_EnterEM1(void)
+{
+  SIM_Sleep(simModeEM1);
+}
+
+void EMU_EnterEM2(bool restore)
+{
+  (void)restore;
+  SIM_Sleep(simModeEM2);
+}
+
+void EMU_EnterEM3(bool restore)
+{
+  (void)restore;
+  SIM_Sleep(simModeEM3);
+}
+
+/** @} (end group SIM) */
@@ -0,0 +1,774 @@
+/***************************************************************************//**
+ * @file simdev.c
+ * @brief Register models of the two CCS811 and the Si7021 on the bus.
+ *
+ * @details
+ *   The wiring is the one main.c expects: nINT of both CCS811 on PC10,
+ *   nWAKE on PC0 (0xB6) and PC1 (0xB4), the optional load switch on PC13.
+ *   A CCS811 only answers while it is powered, booted and its nWAKE has
+ *   been low for tAWAKE. In application mode it samples the scenario at
+ *   the cadence of its drive mode, sets DATA_READY and pulls nINT low when
+ *   interrupts are enabled, in threshold mode only on a band change. nINT
+ *   is released when the result is read.
+ *
+ *   Both parts start with application version CCS_APP_VERSION_OLD. A
+ *   packaged image of CCS_APP_VERSION_NEW is placed at
+ *   FLASHMAP_SENSORFW_BASE, as the programming tool would. In boot mode the
+ *   parts take FW_ERASE, FW_PROGRAM and FW_VERIFY and NACK every transfer
+ *   while they erase, program a chunk or verify. Those times are not in the
+ *   datasheet, the ones below are estimates. FW_VERIFY only passes if the
+ *   programmed bytes are exactly the packaged image.
+ *
+ *   Built with SIM_FW_DROP_MS, the parts are slower than that and do not
+ *   say so: a FW_PROGRAM chunk that starts less than SIM_FW_DROP_MS after
+ *   the previous one is acknowledged but not programmed, so only FW_VERIFY
+ *   shows it.
+ *
+ *   Built with SIM_FAULTS, the first part loses its drive mode and holds
+ *   nINT low after SIM_FAULT_GLITCH_S, until MEASURE_MODE is written. The
+ *   second reports a heater fault and stops sampling after
+ *   SIM_FAULT_HEATER_S, until it is reset.
+ *
+ *   The supply currents are averages at 3.3 V taken from the datasheets
+ *   where they give one and estimated where not. They are meant for
+ *   comparing policies, not for predicting battery life.
+ ******************************************************************************/
+
+#include <string.h>
+#include "em_gpio.h"
+#include "ccs811.h"
+#include "crc16.h"
+#include "flashmap.h"
+#include "fwupdate.h"
+#include "si7021.h"
+#include "sim.h"
+
+/***************************************************************************//**
+ * @addtogroup SIM
+ * @{
+ ******************************************************************************/
+
+#define CCS_COUNT           2
+#define NINT_PORT           gpioPortC
+#define NINT_PIN            10
+#define POWER_PORT          gpioPortC
+#define POWER_PIN           13
+
+#define CCS_BOOT_NS         (20 * SIM_NS_PER_MS)
+#define CCS_AWAKE_NS        (50 * SIM_NS_PER_US)
+#define CCS_BASELINE_RESET  0x8000
+
+#define CCS_APP_VERSION_OLD 0x1100
+#define CCS_APP_VERSION_NEW 0x2000
+#define CCS_IMAGE_LENGTH    5120
+#define CCS_ERASE_NS        (250 * SIM_NS_PER_MS)
+#define CCS_PROGRAM_NS      (1500 * SIM_NS_PER_US)
+#define CCS_VERIFY_NS       (70 * SIM_NS_PER_MS)
+
+#ifndef SIM_FW_DROP_MS
+#define SIM_FW_DROP_MS      0
+#endif
+
+#ifndef SIM_FAULTS
+#define SIM_FAULTS          0
+#endif
+#define SIM_FAULT_GLITCH_S  (6 * 3600)
+#define SIM_FAULT_HEATER_S  (12 * 3600)
+
+/* Injected faults. */
+enum {
+  faultNone,
+  faultGlitch,              /* Drive mode lost, nINT held low */
+  faultHeater,              /* Heater fault, no samples       */
+};
+
+/* CCS811 supply per drive mode, heater duty cycle included [mA]. */
+static const double driveCurrent[5] = {
+  0.019,      /* Idle, measurements stopped     */
+  14.0,       /* Mode 1, heater always on       */
+  2.1,        /* Mode 2, 10 s pulses            */
+  0.36,       /* Mode 3, 60 s pulses            */
+  14.0,       /* Mode 4, raw data every 250 ms  */
+};
+
+/* Extra CCS811 supply while nWAKE is low and the interface runs [mA]. */
+#define CCS_AWAKE_MA        0.6
+
+/* Si7021 supply while converting and in standby [mA], and the time an
+   RH plus temperature conversion takes. */
+#define SI_CONVERT_MA       0.15
+#define SI_STANDBY_MA       0.00006
+#define SI_CONVERT_NS       (19 * SIM_NS_PER_MS)
+
+/** State of one CCS811. */
+typedef struct {
+  uint8_t  addr;
+  uint8_t  wakePin;
+  bool     powered;
+  uint64_t bootDoneAt;
+  uint64_t wokeAt;
+  bool     appValid;
+  bool     app;
+  uint16_t appVersion;
+  uint64_t busyUntil;       /* Erasing, programming or verifying until */
+  bool     erased;          /* Application erased since the last verify */
+  uint32_t programmed;      /* Bytes programmed since the erase */
+  uint64_t programStart;    /* Last FW_PROGRAM chunk taken */
+  uint16_t programmedCrc;
+  uint64_t updateStart;
+  uint8_t  fault;           /* Pending fault, injected at faultAt */
+  uint64_t faultAt;
+  bool     nintHeld;
+  bool     heaterFault;
+  uint64_t faultSince;      /* Injection of the fault not yet recovered from */
+  uint8_t  status;
+  uint8_t  errorId;
+  uint8_t  mode;
+  uint64_t nextSample;
+  uint16_t eco2;
+  uint16_t tvoc;
+  uint8_t  current;
+  uint16_t rawAdc;
+  uint8_t  band;
+  uint16_t lowToMed;
+  uint16_t medToHigh;
+  uint8_t  hysteresis;
+  uint16_t baseline;
+  uint16_t envHumidity;
+  uint16_t envTemperature;
+  bool     nint;
+} Ccs_TypeDef;
+
+/** State of the Si7021. */
+typedef struct {
+  uint64_t readyAt;
+  bool     converting;
+  uint16_t rhCode;
+  uint16_t tempCode;
+} Si_TypeDef;
+
+static const SCENARIO_TypeDef *scenario;
+static Ccs_TypeDef ccs[CCS_COUNT];
+static Si_TypeDef si;
+static const uint8_t *fwImage;
+
+/***************************************************************************//**
+ * @brief
+ *   Sample period of a drive mode, 0 when it does not sample.
+ ******************************************************************************/
+static uint64_t drivePeriod(uint8_t mode)
+{
+  switch (mode & 0x70) {
+    case CCS811_MEASURE_MODE_DRIVE_MODE_1SEC:
+      return SIM_NS_PER_S;
+    case CCS811_MEASURE_MODE_DRIVE_MODE_10SEC:
+      return 10 * SIM_NS_PER_S;
+    case CCS811_MEASURE_MODE_DRIVE_MODE_60SEC:
+      return 60 * SIM_NS_PER_S;
+    case CCS811_MEASURE_MODE_DRIVE_MODE_RAW:
+      return 250 * SIM_NS_PER_MS;
+    default:
+      return 0;
+  }
+}
+
+static bool supplyOn(void)
+{
+  return !SIMHAL_PinIsOutput(POWER_PORT, POWER_PIN)
+         || SIMHAL_PinOut(POWER_PORT, POWER_PIN);
+}
+
+static bool awake(const Ccs_TypeDef *dev)
+{
+  return !SIMHAL_PinIsOutput(gpioPortC, dev->wakePin)
+         || !SIMHAL_PinOut(gpioPortC, dev->wakePin);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Put a CCS811 into its power-on state, in boot mode. The application
+ *   flash is kept.
+ ******************************************************************************/
+static void ccsReset(Ccs_TypeDef *dev)
+{
+  dev->bootDoneAt = SIM_Now() + CCS_BOOT_NS;
+  dev->app = false;
+  dev->busyUntil = 0;
+  dev->status = 0;
+  dev->errorId = 0;
+  dev->mode = 0;
+  dev->nextSample = SIM_NEVER;
+  dev->band = 0;
+  dev->lowToMed = CCS811_THRESHOLD_LOW_TO_MED_DEFAULT;
+  dev->medToHigh = CCS811_THRESHOLD_MED_TO_HIGH_DEFAULT;
+  dev->hysteresis = CCS811_THRESHOLD_HYSTERESIS_DEFAULT;
+  dev->baseline = CCS_BASELINE_RESET;
+  dev->nint = false;
+  dev->nintHeld = false;
+  dev->heaterFault = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Drive the shared nINT line, low while any sensor asserts it.
+ ******************************************************************************/
+static void updateNint(void)
+{
+  unsigned int level = 1;
+  int i;
+
+  for (i = 0; i < CCS_COUNT; i++) {
+    if (ccs[i].powered && ccs[i].nint) {
+      level = 0;
+    }
+  }
+  SIMHAL_DriveInput(NINT_PORT, NINT_PIN, level);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Band of an eCO2 value, moving off the current band only past the
+ *   hysteresis.
+ ******************************************************************************/
+static uint8_t ccsBand(const Ccs_TypeDef *dev, uint16_t eco2)
+{
+  uint8_t band = dev->band;
+
+  if ((band < 2) && (eco2 > dev->medToHigh + dev->hysteresis)) {
+    return 2;
+  }
+  if ((band < 1) && (eco2 > dev->lowToMed + dev->hysteresis)) {
+    return 1;
+  }
+  if ((band > 0) && (eco2 + dev->hysteresis < dev->lowToMed)) {
+    return 0;
+  }
+  if ((band > 1) && (eco2 + dev->hysteresis < dev->medToHigh)) {
+    return 1;
+  }
+  return band;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Take one sample from the scenario.
+ ******************************************************************************/
+static void ccsSample(Ccs_TypeDef *dev, int index, uint64_t at)
+{
+  uint32_t ohms;
+  uint8_t band;
+
+  dev->eco2 = scenario->eco2(index, (uint32_t)(at / SIM_NS_PER_S));
+  dev->tvoc = SCENARIO_Tvoc(dev->eco2);
+  /* Resistance drops with the gas level, 40 kOhm in clean air, read with
+     a 32 uA drive current on the 1.65 V / 1023 ADC. */
+  ohms = 40000UL * 400 / dev->eco2;
+  dev->current = 32;
+  dev->rawAdc = (uint16_t)((uint64_t)ohms * dev->current * 1023 / 1650000);
+  dev->status |= CCS811_STATUS_DATA_READY;
+  if (dev->faultSince != 0) {
+    simStats.faultsCleared++;
+    simStats.faultRecoveryNs += at - dev->faultSince;
+    dev->faultSince = 0;
+  }
+
+  band = ccsBand(dev, dev->eco2);
+  if (dev->mode & CCS811_MEASURE_MODE_INTERRUPT) {
+    if (!(dev->mode & CCS811_MEASURE_MODE_THRESH) || (band != dev->band)) {
+      dev->nint = true;
+    }
+  }
+  dev->band = band;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Follow the load switch, a sensor that loses its supply forgets all.
+ ******************************************************************************/
+static void updatePower(void)
+{
+  bool on = supplyOn();
+  int i;
+
+  for (i = 0; i < CCS_COUNT; i++) {
+    if (on && !ccs[i].powered) {
+      ccsReset(&ccs[i]);
+    }
+    ccs[i].powered = on;
+  }
+  updateNint();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Inject the pending fault of a CCS811.
+ ******************************************************************************/
+static void ccsFault(Ccs_TypeDef *dev)
+{
+  if (dev->fault == faultGlitch) {
+    dev->mode = 0;
+    dev->nextSample = SIM_NEVER;
+    dev->nint = true;
+    dev->nintHeld = true;
+  } else {
+    dev->errorId |= CCS811_ERR_ID_HEATER_FAULT;
+    dev->nextSample = SIM_NEVER;
+    dev->heaterFault = true;
+  }
+  dev->fault = faultNone;
+  dev->faultAt = SIM_NEVER;
+  dev->faultSince = SIM_Now();
+  simStats.faultsInjected++;
+}
+
+static uint64_t devNext(void)
+{
+  uint64_t t = SIM_NEVER;
+  int i;
+
+  for (i = 0; i < CCS_COUNT; i++) {
+    if (ccs[i].powered && (ccs[i].nextSample < t)) {
+      t = ccs[i].nextSample;
+    }
+    if (ccs[i].powered && ccs[i].app && (ccs[i].faultAt < t)) {
+      t = ccs[i].faultAt;
+    }
+  }
+  return t;
+}
+
+static void devSync(uint64_t now)
+{
+  bool changed = false;
+  int i;
+
+  for (i = 0; i < CCS_COUNT; i++) {
+    Ccs_TypeDef *dev = &ccs[i];
+    if (dev->powered && dev->app && (dev->faultAt <= now)) {
+      ccsFault(dev);
+      changed = true;
+    }
+    while (dev->powered && (dev->nextSample <= now)) {
+      ccsSample(dev, i, dev->nextSample);
+      dev->nextSample += drivePeriod(dev->mode);
+      changed = true;
+    }
+  }
+  if (changed) {
+    updateNint();
+  }
+  if (si.converting && (now >= si.readyAt)) {
+    si.converting = false;
+  }
+}
+
+static void devAccount(uint64_t dt)
+{
+  int i;
+
+  for (i = 0; i < CCS_COUNT; i++) {
+    double ma;
+    if (!ccs[i].powered) {
+      continue;
+    }
+    ma = driveCurrent[(ccs[i].mode >> CCS811_MEASURE_MODE_DRIVE_MODE_SHIFT) % 5];
+    if (awake(&ccs[i])) {
+      ma += CCS_AWAKE_MA;
+    }
+    simStats.sensorCharge += ma * (double)dt;
+  }
+  simStats.envCharge += (si.converting ? SI_CONVERT_MA : SI_STANDBY_MA) * (double)dt;
+}
+
+static const SIM_Source_TypeDef devSource = { devNext, devSync, devAccount };
+
+/***************************************************************************//**
+ * @brief
+ *   Handle a register write or command.
+ ******************************************************************************/
+static void ccsWrite(Ccs_TypeDef *dev, const uint8_t *w, uint32_t n)
+{
+  const uint8_t *p = w + 1;
+  uint32_t len = n - 1;
+
+  switch (w[0]) {
+    case CCS811_ADDR_MEASURE_MODE:
+      if ((len < 1) || !dev->app) {
+        dev->errorId |= CCS811_ERR_ID_WRITE_REG_INVALID;
+        break;
+      }
+      if (((p[0] & 0x70) != (dev->mode & 0x70)) && !dev->heaterFault) {
+        uint64_t period = drivePeriod(p[0]);
+        dev->nextSample = (period != 0) ? SIM_Now() + period : SIM_NEVER;
+      }
+      if (dev->nintHeld) {
+        dev->nintHeld = false;
+        dev->nint = false;
+        updateNint();
+      }
+      dev->mode = p[0] & 0x7C;
+      break;
+    case CCS811_ADDR_THRESHOLDS:
+      if (len >= CCS811_THRESHOLDS_LENGTH) {
+        dev->lowToMed = ((uint16_t)p[0] << 8) | p[1];
+        dev->medToHigh = ((uint16_t)p[2] << 8) | p[3];
+        dev->hysteresis = p[4];
+      }
+      break;
+    case CCS811_ADDR_ENV_DATA:
+      if (len >= CCS811_ENV_DATA_LENGTH) {
+        dev->envHumidity = ((uint16_t)p[0] << 8) | p[1];
+        dev->envTemperature = ((uint16_t)p[2] << 8) | p[3];
+      }
+      break;
+    case CCS811_ADDR_BASELINE:
+      if (len >= 2) {
+        dev->baseline = ((uint16_t)p[0] << 8) | p[1];
+      }
+      break;
+    case CCS811_ADDR_FW_ERASE:
+      if (!dev->app && (len == 4) && (p[0] == 0xE7) && (p[1] == 0xA7)
+          && (p[2] == 0xE6) && (p[3] == 0x09)) {
+        dev->appValid = false;
+        dev->erased = true;
+        dev->programmed = 0;
+        dev->programmedCrc = CRC16_INIT;
+        dev->updateStart = SIM_Now();
+        dev->busyUntil = SIM_Now() + CCS_ERASE_NS;
+        dev->status |= CCS811_STATUS_APP_ERASE;
+      }
+      break;
+    case CCS811_ADDR_FW_PROGRAM:
+      if (dev->app || !dev->erased || (len != CCS811_FW_CHUNK_SIZE)) {
+        dev->errorId |= CCS811_ERR_ID_WRITE_REG_INVALID;
+        break;
+      }
+#if SIM_FW_DROP_MS
+      if ((dev->programmed > 0)
+          && (SIM_Now() - dev->programStart < SIM_FW_DROP_MS * SIM_NS_PER_MS)) {
+        simStats.fwDroppedChunks++;
+        break;
+      }
+#else
+      dev->busyUntil = SIM_Now() + CCS_PROGRAM_NS;
+#endif
+      dev->programmedCrc = CRC16_Update(dev->programmedCrc, p, len);
+      dev->programmed += len;
+      dev->programStart = SIM_Now();
+      simStats.fwChunks++;
+      break;
+    case CCS811_ADDR_FW_VERIFY:
+      if (dev->app) {
+        break;
+      }
+      if (dev->erased) {
+        dev->appValid = (dev->programmed == CCS_IMAGE_LENGTH)
+                        && (dev->programmedCrc == CRC16_Update(CRC16_INIT, fwImage,
+                                                               CCS_IMAGE_LENGTH));
+        dev->erased = false;
+        dev->busyUntil = SIM_Now() + CCS_VERIFY_NS;
+        if (dev->appValid) {
+          dev->appVersion = CCS_APP_VERSION_NEW;
+          simStats.fwUpdates++;
+          simStats.fwUpdateNs += dev->busyUntil - dev->updateStart;
+        }
+      }
+      dev->status |= CCS811_STATUS_APP_VERIFY;
+      break;
+    case CCS811_ADDR_APP_START:
+      if (dev->appValid) {
+        dev->app = true;
+        dev->status &= ~(CCS811_STATUS_APP_ERASE | CCS811_STATUS_APP_VERIFY);
+      }
+      break;
+    case CCS811_ADDR_SW_RESET:
+      if ((len == 4) && (p[0] == 0x11) && (p[1] == 0xE5)
+          && (p[2] == 0x72) && (p[3] == 0x8A)) {
+        ccsReset(dev);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Handle a register read, reading a result releases nINT.
+ ******************************************************************************/
+static void ccsRead(Ccs_TypeDef *dev, uint8_t reg, uint8_t *r, uint32_t n)
+{
+  uint8_t data[8];
+  uint8_t status = dev->status
+                   | (dev->appValid ? CCS811_STATUS_APP_VALID : 0)
+                   | (dev->app ? CCS811_STATUS_FW_MODE : 0)
+                   | (dev->errorId ? CCS811_STATUS_ERROR : 0);
+
+  memset(data, 0, sizeof(data));
+  switch (reg) {
+    case CCS811_ADDR_STATUS:
+      data[0] = status;
+      break;
+    case CCS811_ADDR_MEASURE_MODE:
+      data[0] = dev->mode;
+      break;
+    case CCS811_ADDR_ALG_RESULT_DATA:
+    case CCS811_ADDR_RAW_DATA:
+      if (reg == CCS811_ADDR_ALG_RESULT_DATA) {
+        data[0] = dev->eco2 >> 8;
+        data[1] = dev->eco2 & 0xFF;
+        data[2] = dev->tvoc >> 8;
+        data[3] = dev->tvoc & 0xFF;
+        data[4] = status;
+        data[5] = dev->errorId;
+        data[6] = (uint8_t)(dev->current << 2) | (dev->rawAdc >> 8);
+        data[7] = dev->rawAdc & 0xFF;
+      } else {
+        data[0] = (uint8_t)(dev->current << 2) | (dev->rawAdc >> 8);
+        data[1] = dev->rawAdc & 0xFF;
+      }
+      dev->status &= ~CCS811_STATUS_DATA_READY;
+      if (dev->nint && !dev->nintHeld) {
+        dev->nint = false;
+        updateNint();
+      }
+      break;
+    case CCS811_ADDR_BASELINE:
+      data[0] = dev->baseline >> 8;
+      data[1] = dev->baseline & 0xFF;
+      break;
+    case CCS811_ADDR_HW_ID:
+      data[0] = CCS811_HW_ID;
+      break;
+    case CCS811_ADDR_FW_APP_VERSION:
+      data[0] = dev->appVersion >> 8;
+      data[1] = dev->appVersion & 0xFF;
+      break;
+    case CCS811_ADDR_ERR_ID:
+      data[0] = dev->errorId;
+      dev->errorId = 0;
+      break;
+    default:
+      break;
+  }
+  memcpy(r, data, (n < sizeof(data)) ? n : sizeof(data));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run a transfer addressed to a CCS811.
+ ******************************************************************************/
+static I2C_TransferReturn_TypeDef ccsTransfer(Ccs_TypeDef *dev,
+                                              const uint8_t *w, uint32_t wLen,
+                                              uint8_t *r, uint32_t rLen)
+{
+  if (!dev->powered || (SIM_Now() < dev->bootDoneAt) || !awake(dev)) {
+    return i2cTransferNack;
+  }
+  if (SIM_Now() < dev->busyUntil) {
+    simStats.fwBusyNacks++;
+    return i2cTransferNack;
+  }
+  if (SIMHAL_PinIsOutput(gpioPortC, dev->wakePin)
+      && (SIM_Now() - dev->wokeAt < CCS_AWAKE_NS)) {
+    simStats.wakeViolations++;
+    return i2cTransferNack;
+  }
+  // The register address of a read is no write of its own
+  if ((wLen > 1) || ((wLen == 1) && (rLen == 0))) {
+    ccsWrite(dev, w, wLen);
+  }
+  if (rLen > 0) {
+    ccsRead(dev, w[0], r, rLen);
+  }
+  return i2cTransferDone;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run a transfer addressed to the Si7021. A read while it converts is
+ *   NACKed, like the part does in no hold master mode.
+ ******************************************************************************/
+static I2C_TransferReturn_TypeDef siTransfer(const uint8_t *w, uint32_t wLen,
+                                             uint8_t *r, uint32_t rLen)
+{
+  uint32_t t = (uint32_t)(SIM_Now() / SIM_NS_PER_S);
+
+  if (wLen == 0) {
+    if (SIM_Now() < si.readyAt) {
+      return i2cTransferNack;
+    }
+    r[0] = si.rhCode >> 8;
+    if (rLen > 1) {
+      r[1] = si.rhCode & 0xFF;
+    }
+    return i2cTransferDone;
+  }
+
+  switch (w[0]) {
+    case SI7021_CMD_MEASURE_RH_NO_HOLD:
+      si.rhCode = (uint16_t)((SCENARIO_Humidity(t) + 6.0) * 65536.0 / 125.0);
+      si.tempCode = (uint16_t)((SCENARIO_Temperature(t) + 46.85) * 65536.0 / 175.72);
+      si.converting = true;
+      si.readyAt = SIM_Now() + SI_CONVERT_NS;
+      break;
+    case SI7021_CMD_READ_TEMP_FROM_RH:
+      if (rLen >= 2) {
+        r[0] = si.tempCode >> 8;
+        r[1] = si.tempCode & 0xFF;
+      }
+      break;
+    case SI7021_CMD_READ_ID2_1:
+      if (rLen >= 1) {
+        memset(r, 0, rLen);
+        r[0] = 0x15;      /* Electronic ID: Si7021 */
+      }
+      break;
+    default:
+      break;
+  }
+  return i2cTransferDone;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Route a transfer to the addressed device.
+ *
+ * @param[in] seq
+ *   Transfer as prepared for I2C_TransferInit()
+ *
+ * @param[out] bytes
+ *   Bytes clocked on the bus, address bytes included
+ ******************************************************************************/
+I2C_TransferReturn_TypeDef SIMDEV_Transfer(const I2C_TransferSeq_TypeDef *seq,
+                                           uint32_t *bytes)
+{
+  uint8_t w[32];
+  uint32_t wLen = 0;
+  uint8_t *r = NULL;
+  uint32_t rLen = 0;
+  I2C_TransferReturn_TypeDef ret = i2cTransferNack;
+  int i;
+
+  switch (seq->flags) {
+    case I2C_FLAG_WRITE:
+    case I2C_FLAG_WRITE_WRITE:
+      wLen = seq->buf[0].len;
+      memcpy(w, seq->buf[0].data, wLen);
+      if (seq->flags == I2C_FLAG_WRITE_WRITE) {
+        memcpy(w + wLen, seq->buf[1].data, seq->buf[1].len);
+        wLen += seq->buf[1].len;
+      }
+      break;
+    case I2C_FLAG_WRITE_READ:
+      wLen = seq->buf[0].len;
+      memcpy(w, seq->buf[0].data, wLen);
+      r = seq->buf[1].data;
+      rLen = seq->buf[1].len;
+      break;
+    case I2C_FLAG_READ:
+      r = seq->buf[0].data;
+      rLen = seq->buf[0].len;
+      break;
+    default:
+      return i2cTransferUsageFault;
+  }
+
+  for (i = 0; i < CCS_COUNT; i++) {
+    if (seq->addr == ccs[i].addr) {
+      ret = ccsTransfer(&ccs[i], w, wLen, r, rLen);
+    }
+  }
+  if (seq->addr == SI7021_I2C_ADDR) {
+    ret = siTransfer(w, wLen, r, rLen);
+  }
+
+  if (ret == i2cTransferNack) {
+    *bytes = 1;
+  } else {
+    *bytes = 1 + wLen + ((wLen > 0) && (rLen > 0) ? 1 : 0) + rLen;
+  }
+  return ret;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Note when the application moves a pin one of the devices listens to.
+ ******************************************************************************/
+void SIMDEV_PinChanged(int port, unsigned int pin)
+{
+  int i;
+
+  if (port != gpioPortC) {
+    return;
+  }
+  if (pin == POWER_PIN) {
+    updatePower();
+    return;
+  }
+  for (i = 0; i < CCS_COUNT; i++) {
+    if ((pin == ccs[i].wakePin) && !SIMHAL_PinOut(port, pin)) {
+      ccs[i].wokeAt = SIM_Now();
+    }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Store a packaged CCS811 image in the reserved flash pages, with
+ *   arbitrary but repeatable contents.
+ ******************************************************************************/
+static void packageImage(void)
+{
+  FWUPDATE_Header_TypeDef header;
+  uint8_t *base = (uint8_t *)FLASHMAP_SENSORFW_BASE;
+  uint8_t *image = base + sizeof(header);
+  uint32_t x = 0x2545F491UL;
+  uint32_t i;
+
+  for (i = 0; i < CCS_IMAGE_LENGTH; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    image[i] = (uint8_t)x;
+  }
+  header.magic = FWUPDATE_MAGIC;
+  header.version = CCS_APP_VERSION_NEW;
+  header.check = CRC16_Update(CRC16_INIT, image, CCS_IMAGE_LENGTH);
+  header.length = CCS_IMAGE_LENGTH;
+  memcpy(base, &header, sizeof(header));
+  fwImage = image;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Power up all devices and register the event source.
+ ******************************************************************************/
+void SIMDEV_Init(const SCENARIO_TypeDef *scene)
+{
+  int i;
+
+  scenario = scene;
+  memset(ccs, 0, sizeof(ccs));
+  memset(&si, 0, sizeof(si));
+  ccs[0].addr = CCS811_I2C_ADDR_HIGH;
+  ccs[0].wakePin = 0;
+  ccs[1].addr = CCS811_I2C_ADDR_LOW;
+  ccs[1].wakePin = 1;
+  for (i = 0; i < CCS_COUNT; i++) {
+    ccs[i].appValid = true;
+    ccs[i].appVersion = CCS_APP_VERSION_OLD;
+    ccs[i].faultAt = SIM_NEVER;
+  }
+  if (SIM_FAULTS) {
+    ccs[0].fault = faultGlitch;
+    ccs[0].faultAt = (uint64_t)SIM_FAULT_GLITCH_S * SIM_NS_PER_S;
+    ccs[1].fault = faultHeater;
+    ccs[1].faultAt = (uint64_t)SIM_FAULT_HEATER_S * SIM_NS_PER_S;
+  }
+  packageImage();
+  SIM_AddSource(&devSource);
+  updatePower();
+}
+
+/** @} (end group SIM) */
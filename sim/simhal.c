@@ -0,0 +1,805 @@
+/***************************************************************************//**
+ * @file simhal.c
+ * @brief emlib and BSP functions used by the application, on simulated
+ *        peripherals.
+ *
+ * @details
+ *   - GPIO keeps the mode and output of every pin and raises the pin
+ *     interrupts on edges of the inputs driven by the device models.
+ *   - I2C runs every transfer against the device models when it starts and
+ *     signals completion after the time its bits take on the bus. SCL
+ *     follows the core clock relative to the one the divider was set for.
+ *   - RTC counts simulated time at 32768 Hz with overflow and COMP0 flags.
+ *   - LETIMER counts down at the LFXO rate over its prescaler with COMP1
+ *     and underflow flags, reloading from COMP0 or 0xFFFF.
+ *   - MSC backs the flash with a host array that can only clear bits.
+ *   - CMU only models the HFRCO band and the LETIMER prescaler, the core
+ *     clock follows the band.
+ *   - BSP LEDs draw SIM_LED_MA each while lit.
+ *   - SysTick counts down at the core clock in EM0 and EM1, so the cycle
+ *     figures of PERF are the estimated EM0 time plus the EM1 waits.
+ *
+ *   Every call spends SIM_HAL_CALL_CYCLES of EM0 time, so busy loops on the
+ *   RTC counter terminate like they do on the target.
+ ******************************************************************************/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_chip.h"
+#include "em_cmu.h"
+#include "em_gpio.h"
+#include "em_i2c.h"
+#include "em_rtc.h"
+#include "em_letimer.h"
+#include "em_msc.h"
+#include "bsp.h"
+#include "sim.h"
+
+/***************************************************************************//**
+ * @addtogroup SIM
+ * @{
+ ******************************************************************************/
+
+#define HAL_CALL()          SIM_ExecuteCycles(SIM_HAL_CALL_CYCLES)
+
+#define PORT_COUNT          6
+#define PIN_COUNT           16
+
+#define RTC_FREQ            32768ULL
+#define RTC_CNT_BITS        24
+#define RTC_CNT_MASK        ((1ULL << RTC_CNT_BITS) - 1)
+
+#define LETIMER_TOP         0xFFFFU
+
+/* Current of one lit LED, a typical indicator drive [mA]. */
+#define SIM_LED_MA          2.0
+
+/* Flash timing from the EFM32HG datasheet. */
+#define FLASH_ERASE_NS      (20 * SIM_NS_PER_MS)
+#define FLASH_WORD_NS       (20 * SIM_NS_PER_US)
+
+/* Bus overhead per transfer, START, repeated START and STOP [bit times]. */
+#define I2C_FRAMING_BITS    4
+
+I2C_TypeDef  simI2C0;
+LETIMER_TypeDef simLETIMER0;
+SysTick_Type simSysTick;
+uint8_t      simFlash[FLASH_SIZE] __attribute__ ((aligned(FLASH_PAGE_SIZE)));
+
+static struct {
+  uint8_t  mode[PORT_COUNT][PIN_COUNT];
+  uint8_t  out[PORT_COUNT][PIN_COUNT];
+  uint8_t  in[PORT_COUNT][PIN_COUNT];
+  uint8_t  intPort[PIN_COUNT];       /* Port routed to each pin interrupt */
+  uint32_t rise;
+  uint32_t fall;
+  uint32_t flags;
+  uint32_t enabled;
+} gpio;
+
+static struct {
+  uint32_t                   freq;
+  uint32_t                   refHz;      /* Clock the divider was set for */
+  bool                       pending;
+  uint64_t                   doneAt;
+  I2C_TransferReturn_TypeDef result;
+} i2c;
+
+static struct {
+  bool     enabled;
+  uint64_t startNs;
+  uint64_t lastTick;                 /* Ticks since RTC_Init(), not wrapped */
+  uint32_t flags;
+  uint32_t enabledFlags;
+  uint32_t comp[2];
+} rtc;
+
+static struct {
+  bool     enabled;
+  bool     comp0Top;
+  uint32_t div;
+  uint64_t startNs;
+  uint64_t lastTick;                 /* Ticks since the last enable */
+  uint32_t cnt;
+  uint32_t comp[2];
+  uint32_t flags;
+  uint32_t enabledFlags;
+} letimer;
+
+static uint32_t leds;
+static CMU_HFRCOBand_TypeDef band;
+static uint64_t sysTickRest;          /* Part SysTick cycle [cycles ns/s] */
+
+static const uint32_t bandHz[] = { 1200000, 6600000, 11000000, 14000000, 21000000 };
+
+/* --- GPIO ---------------------------------------------------------------- */
+
+/***************************************************************************//**
+ * @brief
+ *   Pend the GPIO interrupts for the enabled flags that are set.
+ ******************************************************************************/
+static void gpioRaise(void)
+{
+  uint32_t active = gpio.flags & gpio.enabled;
+
+  if (active & 0x5555) {
+    SIM_Pend(GPIO_EVEN_IRQn);
+  }
+  if (active & 0xAAAA) {
+    SIM_Pend(GPIO_ODD_IRQn);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set the level an external device drives onto an input pin.
+ ******************************************************************************/
+void SIMHAL_DriveInput(int port, unsigned int pin, unsigned int level)
+{
+  unsigned int old = gpio.in[port][pin];
+
+  gpio.in[port][pin] = level ? 1 : 0;
+  if ((gpio.intPort[pin] != port) || (old == gpio.in[port][pin])) {
+    return;
+  }
+  if ((level && (gpio.rise & (1UL << pin)))
+      || (!level && (gpio.fall & (1UL << pin)))) {
+    gpio.flags |= 1UL << pin;
+    gpioRaise();
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether the application drives a pin.
+ ******************************************************************************/
+bool SIMHAL_PinIsOutput(int port, unsigned int pin)
+{
+  return gpio.mode[port][pin] == gpioModePushPull;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Output latch of a pin.
+ ******************************************************************************/
+unsigned int SIMHAL_PinOut(int port, unsigned int pin)
+{
+  return gpio.out[port][pin];
+}
+
+static void pinSet(GPIO_Port_TypeDef port, unsigned int pin, unsigned int out)
+{
+  gpio.out[port][pin] = out ? 1 : 0;
+  SIMDEV_PinChanged(port, pin);
+}
+
+void GPIO_PinModeSet(GPIO_Port_TypeDef port, unsigned int pin,
+                     GPIO_Mode_TypeDef mode, unsigned int out)
+{
+  HAL_CALL();
+  gpio.mode[port][pin] = mode;
+  pinSet(port, pin, out);
+}
+
+void GPIO_PinOutSet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+  HAL_CALL();
+  pinSet(port, pin, 1);
+}
+
+void GPIO_PinOutClear(GPIO_Port_TypeDef port, unsigned int pin)
+{
+  HAL_CALL();
+  pinSet(port, pin, 0);
+}
+
+void GPIO_PinOutToggle(GPIO_Port_TypeDef port, unsigned int pin)
+{
+  HAL_CALL();
+  pinSet(port, pin, !gpio.out[port][pin]);
+}
+
+unsigned int GPIO_PinOutGet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+  HAL_CALL();
+  return gpio.out[port][pin];
+}
+
+unsigned int GPIO_PinInGet(GPIO_Port_TypeDef port, unsigned int pin)
+{
+  HAL_CALL();
+  return SIMHAL_PinIsOutput(port, pin) ? gpio.out[port][pin] : gpio.in[port][pin];
+}
+
+void GPIO_IntConfig(GPIO_Port_TypeDef port, unsigned int pin,
+                    bool risingEdge, bool fallingEdge, bool enable)
+{
+  uint32_t mask = 1UL << pin;
+
+  HAL_CALL();
+  gpio.intPort[pin] = port;
+  gpio.rise = risingEdge ? (gpio.rise | mask) : (gpio.rise & ~mask);
+  gpio.fall = fallingEdge ? (gpio.fall | mask) : (gpio.fall & ~mask);
+  gpio.flags &= ~mask;
+  gpio.enabled = enable ? (gpio.enabled | mask) : (gpio.enabled & ~mask);
+}
+
+uint32_t GPIO_IntGet(void)
+{
+  HAL_CALL();
+  return gpio.flags;
+}
+
+uint32_t GPIO_IntGetEnabled(void)
+{
+  HAL_CALL();
+  return gpio.flags & gpio.enabled;
+}
+
+void GPIO_IntClear(uint32_t flags)
+{
+  HAL_CALL();
+  gpio.flags &= ~flags;
+}
+
+void GPIO_IntEnable(uint32_t flags)
+{
+  HAL_CALL();
+  gpio.enabled |= flags;
+  gpioRaise();
+}
+
+void GPIO_IntDisable(uint32_t flags)
+{
+  HAL_CALL();
+  gpio.enabled &= ~flags;
+}
+
+/* --- I2C ----------------------------------------------------------------- */
+
+static uint64_t i2cNext(void)
+{
+  return i2c.pending ? i2c.doneAt : SIM_NEVER;
+}
+
+static void i2cSync(uint64_t now)
+{
+  if (!i2c.pending || (now < i2c.doneAt)) {
+    return;
+  }
+  i2c.pending = false;
+  I2C0->IF |= I2C_IF_MSTOP;
+  if (I2C0->IEN & I2C_IEN_MSTOP) {
+    SIM_Pend(I2C0_IRQn);
+  }
+}
+
+static const SIM_Source_TypeDef i2cSource = { i2cNext, i2cSync, NULL };
+
+void I2C_Init(I2C_TypeDef *port, const I2C_Init_TypeDef *init)
+{
+  HAL_CALL();
+  port->CTRL = init->enable ? I2C_CTRL_EN : 0;
+  i2c.freq = (init->freq != 0) ? init->freq : I2C_FREQ_STANDARD_MAX;
+  i2c.refHz = (init->refFreq != 0) ? init->refFreq : SIMHAL_CoreHz();
+}
+
+void I2C_BusFreqSet(I2C_TypeDef *port, uint32_t freqRef, uint32_t freqScl,
+                    I2C_ClockHLR_TypeDef i2cMode)
+{
+  (void)port;
+  (void)i2cMode;
+  HAL_CALL();
+  i2c.freq = freqScl;
+  i2c.refHz = (freqRef != 0) ? freqRef : SIMHAL_CoreHz();
+}
+
+I2C_TransferReturn_TypeDef I2C_TransferInit(I2C_TypeDef *port,
+                                            I2C_TransferSeq_TypeDef *seq)
+{
+  uint32_t bytes = 0;
+  uint64_t bits;
+  uint64_t scl = (uint64_t)i2c.freq * SIMHAL_CoreHz() / i2c.refHz;
+
+  HAL_CALL();
+  i2c.result = SIMDEV_Transfer(seq, &bytes);
+  simStats.i2cTransfers++;
+  simStats.i2cBytes += bytes;
+  if (i2c.result == i2cTransferNack) {
+    simStats.i2cNacks++;
+  }
+
+  if (scl > I2C_FREQ_FAST_MAX + I2C_FREQ_FAST_MAX / 100) {
+    simStats.i2cOverclocked++;
+  }
+
+  bits = (uint64_t)bytes * 9 + I2C_FRAMING_BITS;
+  i2c.doneAt = SIM_Now() + bits * SIM_NS_PER_S / scl;
+  i2c.pending = true;
+  port->IF = 0;
+  port->IEN = I2C_IEN_MSTOP | I2C_IEN_NACK | I2C_IEN_ARBLOST | I2C_IEN_BUSERR;
+  return i2cTransferInProgress;
+}
+
+I2C_TransferReturn_TypeDef I2C_Transfer(I2C_TypeDef *port)
+{
+  HAL_CALL();
+  if (!(port->IF & I2C_IF_MSTOP)) {
+    return i2cTransferInProgress;
+  }
+  port->IF = 0;
+  port->IEN = 0;
+  return i2c.result;
+}
+
+/* --- RTC ----------------------------------------------------------------- */
+
+static uint64_t rtcTicksAt(uint64_t ns)
+{
+  ns -= rtc.startNs;
+  return (ns / SIM_NS_PER_S) * RTC_FREQ + (ns % SIM_NS_PER_S) * RTC_FREQ / SIM_NS_PER_S;
+}
+
+static uint64_t rtcTimeOfTick(uint64_t tick)
+{
+  return rtc.startNs + (tick / RTC_FREQ) * SIM_NS_PER_S
+         + ((tick % RTC_FREQ) * SIM_NS_PER_S + RTC_FREQ - 1) / RTC_FREQ;
+}
+
+static uint64_t rtcNext(void)
+{
+  uint64_t t = rtc.lastTick;
+  uint64_t overflow;
+  uint64_t match;
+
+  if (!rtc.enabled) {
+    return SIM_NEVER;
+  }
+  overflow = ((t >> RTC_CNT_BITS) + 1) << RTC_CNT_BITS;
+  match = t + 1 + ((rtc.comp[0] - (t + 1)) & RTC_CNT_MASK);
+  return rtcTimeOfTick((match < overflow) ? match : overflow);
+}
+
+static void rtcSync(uint64_t now)
+{
+  uint64_t t;
+  uint64_t span;
+
+  if (!rtc.enabled) {
+    return;
+  }
+  t = rtcTicksAt(now);
+  if (t <= rtc.lastTick) {
+    return;
+  }
+  span = t - rtc.lastTick;
+  if ((t >> RTC_CNT_BITS) != (rtc.lastTick >> RTC_CNT_BITS)) {
+    rtc.flags |= RTC_IF_OF;
+  }
+  if ((span > RTC_CNT_MASK)
+      || (((rtc.comp[0] - (rtc.lastTick + 1)) & RTC_CNT_MASK) < span)) {
+    rtc.flags |= RTC_IF_COMP0;
+  }
+  rtc.lastTick = t;
+  if (rtc.flags & rtc.enabledFlags) {
+    SIM_Pend(RTC_IRQn);
+  }
+}
+
+static const SIM_Source_TypeDef rtcSource = { rtcNext, rtcSync, NULL };
+
+void RTC_Init(const RTC_Init_TypeDef *init)
+{
+  HAL_CALL();
+  rtc.enabled = init->enable;
+  rtc.startNs = SIM_Now();
+  rtc.lastTick = 0;
+  rtc.flags = 0;
+}
+
+uint32_t RTC_CounterGet(void)
+{
+  HAL_CALL();
+  return rtc.enabled ? (uint32_t)(rtcTicksAt(SIM_Now()) & RTC_CNT_MASK) : 0;
+}
+
+void RTC_CompareSet(unsigned int comp, uint32_t value)
+{
+  HAL_CALL();
+  rtc.comp[comp & 1] = value & RTC_CNT_MASK;
+}
+
+uint32_t RTC_CompareGet(unsigned int comp)
+{
+  HAL_CALL();
+  return rtc.comp[comp & 1];
+}
+
+uint32_t RTC_IntGet(void)
+{
+  HAL_CALL();
+  return rtc.flags;
+}
+
+void RTC_IntClear(uint32_t flags)
+{
+  HAL_CALL();
+  rtc.flags &= ~flags;
+}
+
+void RTC_IntEnable(uint32_t flags)
+{
+  HAL_CALL();
+  rtc.enabledFlags |= flags;
+  if (rtc.flags & rtc.enabledFlags) {
+    SIM_Pend(RTC_IRQn);
+  }
+}
+
+void RTC_IntDisable(uint32_t flags)
+{
+  HAL_CALL();
+  rtc.enabledFlags &= ~flags;
+}
+
+/* --- LETIMER ------------------------------------------------------------- */
+
+static uint64_t letimerTicksAt(uint64_t ns)
+{
+  uint64_t freq = RTC_FREQ / letimer.div;
+
+  ns -= letimer.startNs;
+  return (ns / SIM_NS_PER_S) * freq + (ns % SIM_NS_PER_S) * freq / SIM_NS_PER_S;
+}
+
+static uint64_t letimerTimeOfTick(uint64_t tick)
+{
+  uint64_t freq = RTC_FREQ / letimer.div;
+
+  return letimer.startNs + (tick / freq) * SIM_NS_PER_S
+         + ((tick % freq) * SIM_NS_PER_S + freq - 1) / freq;
+}
+
+/* Ticks from the current count to the next COMP1 match or underflow. */
+static uint64_t letimerTicksToEvent(bool *underflow)
+{
+  *underflow = (letimer.comp[1] >= letimer.cnt);
+  return *underflow ? (uint64_t)letimer.cnt + 1 : letimer.cnt - letimer.comp[1];
+}
+
+static uint64_t letimerNext(void)
+{
+  bool underflow;
+
+  if (!letimer.enabled) {
+    return SIM_NEVER;
+  }
+  return letimerTimeOfTick(letimer.lastTick + letimerTicksToEvent(&underflow));
+}
+
+static void letimerSync(uint64_t now)
+{
+  uint64_t t;
+
+  if (!letimer.enabled) {
+    return;
+  }
+  t = letimerTicksAt(now);
+  while (t > letimer.lastTick) {
+    bool underflow;
+    uint64_t k = letimerTicksToEvent(&underflow);
+
+    if (k > t - letimer.lastTick) {
+      letimer.cnt -= (uint32_t)(t - letimer.lastTick);
+      letimer.lastTick = t;
+      break;
+    }
+    letimer.lastTick += k;
+    if (underflow) {
+      letimer.cnt = letimer.comp0Top ? letimer.comp[0] : LETIMER_TOP;
+      letimer.flags |= LETIMER_IF_UF;
+    } else {
+      letimer.cnt = letimer.comp[1];
+      letimer.flags |= LETIMER_IF_COMP1;
+    }
+  }
+  if (letimer.flags & letimer.enabledFlags) {
+    SIM_Pend(LETIMER0_IRQn);
+  }
+}
+
+static const SIM_Source_TypeDef letimerSource = { letimerNext, letimerSync, NULL };
+
+void LETIMER_Init(LETIMER_TypeDef *port, const LETIMER_Init_TypeDef *init)
+{
+  letimer.comp0Top = init->comp0Top;
+  LETIMER_Enable(port, init->enable);
+}
+
+void LETIMER_Reset(LETIMER_TypeDef *port)
+{
+  (void)port;
+  HAL_CALL();
+  letimer.enabled = false;
+  letimer.comp0Top = false;
+  letimer.cnt = 0;
+  letimer.comp[0] = 0;
+  letimer.comp[1] = 0;
+  letimer.flags = 0;
+  letimer.enabledFlags = 0;
+}
+
+void LETIMER_Enable(LETIMER_TypeDef *port, bool enable)
+{
+  (void)port;
+  HAL_CALL();
+  if (enable && !letimer.enabled) {
+    letimer.startNs = SIM_Now();
+    letimer.lastTick = 0;
+  }
+  letimer.enabled = enable;
+}
+
+void LETIMER_CompareSet(LETIMER_TypeDef *port, unsigned int comp, uint32_t value)
+{
+  (void)port;
+  HAL_CALL();
+  letimer.comp[comp & 1] = value & LETIMER_TOP;
+}
+
+uint32_t LETIMER_CounterGet(LETIMER_TypeDef *port)
+{
+  (void)port;
+  HAL_CALL();
+  return letimer.cnt;
+}
+
+uint32_t LETIMER_IntGet(LETIMER_TypeDef *port)
+{
+  (void)port;
+  HAL_CALL();
+  return letimer.flags;
+}
+
+void LETIMER_IntClear(LETIMER_TypeDef *port, uint32_t flags)
+{
+  (void)port;
+  HAL_CALL();
+  letimer.flags &= ~flags;
+}
+
+void LETIMER_IntEnable(LETIMER_TypeDef *port, uint32_t flags)
+{
+  (void)port;
+  HAL_CALL();
+  letimer.enabledFlags |= flags;
+  if (letimer.flags & letimer.enabledFlags) {
+    SIM_Pend(LETIMER0_IRQn);
+  }
+}
+
+void LETIMER_IntDisable(LETIMER_TypeDef *port, uint32_t flags)
+{
+  (void)port;
+  HAL_CALL();
+  letimer.enabledFlags &= ~flags;
+}
+
+/* --- MSC ----------------------------------------------------------------- */
+
+static bool inFlash(const void *address, uint32_t size)
+{
+  const uint8_t *p = address;
+
+  return (p >= simFlash) && (p + size <= simFlash + FLASH_SIZE);
+}
+
+void MSC_Init(void)
+{
+  HAL_CALL();
+}
+
+void MSC_Deinit(void)
+{
+  HAL_CALL();
+}
+
+MSC_Status_TypeDef MSC_ErasePage(uint32_t *startAddress)
+{
+  HAL_CALL();
+  if (!inFlash(startAddress, FLASH_PAGE_SIZE)) {
+    return mscReturnInvalidAddr;
+  }
+  if (((uintptr_t)startAddress - FLASH_BASE) % FLASH_PAGE_SIZE) {
+    return mscReturnUnaligned;
+  }
+  memset(startAddress, 0xFF, FLASH_PAGE_SIZE);
+  simStats.flashErases++;
+  SIM_Execute(FLASH_ERASE_NS);
+  return mscReturnOk;
+}
+
+MSC_Status_TypeDef MSC_WriteWord(uint32_t *address, void const *data,
+                                 uint32_t numBytes)
+{
+  const uint32_t *src = data;
+  uint32_t i;
+
+  HAL_CALL();
+  if (((uintptr_t)address & 3) || (numBytes & 3)) {
+    return mscReturnUnaligned;
+  }
+  if (!inFlash(address, numBytes)) {
+    return mscReturnInvalidAddr;
+  }
+  for (i = 0; i < numBytes / 4; i++) {
+    address[i] &= src[i];
+    simStats.flashWords++;
+    SIM_Execute(FLASH_WORD_NS);
+  }
+  return mscReturnOk;
+}
+
+/* --- CHIP, CMU and BSP --------------------------------------------------- */
+
+void CHIP_Init(void)
+{
+  HAL_CALL();
+}
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable)
+{
+  (void)clock;
+  (void)enable;
+  HAL_CALL();
+}
+
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref)
+{
+  (void)clock;
+  (void)ref;
+  HAL_CALL();
+}
+
+void CMU_ClockDivSet(CMU_Clock_TypeDef clock, CMU_ClkDiv_TypeDef div)
+{
+  HAL_CALL();
+  if (clock == cmuClock_LETIMER0) {
+    letimer.div = div;
+  }
+}
+
+uint32_t CMU_ClockFreqGet(CMU_Clock_TypeDef clock)
+{
+  HAL_CALL();
+  switch (clock) {
+    case cmuClock_LFA:
+    case cmuClock_LFB:
+    case cmuClock_RTC:
+    case cmuClock_LEUART0:
+      return (uint32_t)RTC_FREQ;
+    case cmuClock_LETIMER0:
+      return (uint32_t)(RTC_FREQ / letimer.div);
+    default:
+      return SIMHAL_CoreHz();
+  }
+}
+
+void CMU_OscillatorEnable(CMU_Osc_TypeDef osc, bool enable, bool wait)
+{
+  (void)osc;
+  (void)enable;
+  (void)wait;
+  HAL_CALL();
+}
+
+void CMU_HFRCOBandSet(CMU_HFRCOBand_TypeDef value)
+{
+  HAL_CALL();
+  if (value != band) {
+    simStats.bandSwitches++;
+  }
+  band = value;
+}
+
+CMU_HFRCOBand_TypeDef CMU_HFRCOBandGet(void)
+{
+  HAL_CALL();
+  return band;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Core clock from the current HFRCO band.
+ ******************************************************************************/
+uint32_t SIMHAL_CoreHz(void)
+{
+  return bandHz[band];
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Count SysTick down for ns of core clock, EM2 and EM3 stop it.
+ ******************************************************************************/
+void SIMHAL_SysTickRun(uint64_t ns)
+{
+  uint64_t reload = (uint64_t)simSysTick.LOAD + 1;
+  uint64_t cycles;
+
+  if (!(simSysTick.CTRL & SysTick_CTRL_ENABLE_Msk)) {
+    return;
+  }
+  sysTickRest += (ns % SIM_NS_PER_S) * SIMHAL_CoreHz();
+  cycles = ns / SIM_NS_PER_S * SIMHAL_CoreHz() + sysTickRest / SIM_NS_PER_S;
+  sysTickRest %= SIM_NS_PER_S;
+  simSysTick.VAL = (uint32_t)(((uint64_t)simSysTick.VAL + reload - cycles % reload) % reload);
+}
+
+int BSP_LedsInit(void)
+{
+  HAL_CALL();
+  leds = 0;
+  return 0;
+}
+
+int BSP_LedsSet(uint32_t value)
+{
+  HAL_CALL();
+  if (value != leds) {
+    simStats.ledChanges++;
+  }
+  leds = value;
+  return 0;
+}
+
+uint32_t BSP_LedsGet(void)
+{
+  HAL_CALL();
+  return leds;
+}
+
+static uint64_t ledNext(void)
+{
+  return SIM_NEVER;
+}
+
+static void ledSync(uint64_t now)
+{
+  (void)now;
+}
+
+static void ledAccount(uint64_t dt)
+{
+  simStats.ledCharge += __builtin_popcount(leds) * SIM_LED_MA * (double)dt;
+}
+
+static const SIM_Source_TypeDef ledSource = { ledNext, ledSync, ledAccount };
+
+/***************************************************************************//**
+ * @brief
+ *   Reset all peripherals, erase the flash and register the event sources.
+ ******************************************************************************/
+void SIMHAL_Init(void)
+{
+  memset(&gpio, 0, sizeof(gpio));
+  memset(&i2c, 0, sizeof(i2c));
+  memset(&rtc, 0, sizeof(rtc));
+  memset(&letimer, 0, sizeof(letimer));
+  letimer.div = 1;
+  memset(&simI2C0, 0, sizeof(simI2C0));
+  memset(simFlash, 0xFF, sizeof(simFlash));
+  /* Open-drain lines idle high on their pull-ups. */
+  memset(gpio.in, 1, sizeof(gpio.in));
+  memset(gpio.intPort, 0xFF, sizeof(gpio.intPort));
+  i2c.freq = I2C_FREQ_STANDARD_MAX;
+  i2c.refHz = bandHz[cmuHFRCOBand_14MHz];
+  /* Reset value, 14 MHz. */
+  band = cmuHFRCOBand_14MHz;
+
+  SIM_AddSource(&rtcSource);
+  SIM_AddSource(&i2cSource);
+  SIM_AddSource(&letimerSource);
+  SIM_AddSource(&ledSource);
+}
+
+/** @} (end group SIM) */
@@ -0,0 +1,224 @@
+/***************************************************************************//**
+ * @file simmain.c
+ * @brief Host entry point, runs the application on one scenario and prints
+ *        the bus, wakeup and energy figures.
+ *
+ * @details
+ *   Usage: sim-<variant> [-s scenario] [-t hours] [-r records] [-c] [-b] [-l]
+ *
+ *   -s  scenario to run, see -l, default office
+ *   -t  simulated hours, default from the scenario
+ *   -r  boot with this many records of an earlier run in the flash log
+ *   -c  print a single CSV line instead of the report
+ *   -b  print the benchmark records received as CSV instead of the report
+ *   -l  list the scenarios
+ *
+ *   The application's main() is built as app_main() and never returns, the
+ *   run ends from SIM_End() once simulated time is up. The records for -r
+ *   are written through FLASHLOG before it starts, their flash writes count
+ *   towards the run.
+ ******************************************************************************/
+
+#undef main
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "flashlog.h"
+#include "perf.h"
+#include "sim.h"
+#include "scenario.h"
+
+/***************************************************************************//**
+ * @addtogroup SIM
+ * @{
+ ******************************************************************************/
+
+#ifndef SIM_VARIANT
+#define SIM_VARIANT       "default"
+#endif
+
+/* Supply voltage for the energy figures [V]. */
+#define SIM_SUPPLY_V      3.3
+
+/* Interval of the records logged for -r [s]. */
+#define SIM_LOG_INTERVAL  30
+
+int app_main(void);
+
+static const SCENARIO_TypeDef *scenario;
+static uint32_t hours;
+static uint32_t logged;
+static bool csv;
+
+/***************************************************************************//**
+ * @brief
+ *   Per hour figure of a counter.
+ ******************************************************************************/
+static double perHour(double value)
+{
+  return value / (double)hours;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Print the results and leave.
+ *
+ * @param[in] reason
+ *   NULL when simulated time is up, otherwise why the run was stopped.
+ ******************************************************************************/
+void SIM_End(const char *reason)
+{
+  const SIM_Stats_TypeDef *s = &simStats;
+  double seconds = (double)SIM_Now() / SIM_NS_PER_S;
+  /* mA ns to mAh */
+  double mcu = s->mcuCharge / 3.6e12;
+  double sensors = s->sensorCharge / 3.6e12;
+  double env = s->envCharge / 3.6e12;
+  double led = s->ledCharge / 3.6e12;
+  double total = mcu + sensors + env + led;
+  double avgUa = (seconds > 0) ? total * 3600.0 / seconds * 1000.0 : 0;
+
+  if (reason != NULL) {
+    fprintf(stderr, "sim: stopped after %.1f s: %s\n", seconds, reason);
+  }
+
+  if (simBenchCsv) {
+    /* The records were printed as they arrived */
+  } else if (csv) {
+    printf("%s,%s,%u,%u,%u,%u,%u,%u,%.4f,%.4f,%.4f,%.4f,%.1f,%.3f\n",
+           SIM_VARIANT, scenario->name, (unsigned)hours,
+           (unsigned)s->i2cTransfers, (unsigned)s->i2cBytes, (unsigned)s->wakeups,
+           (unsigned)s->irqs[GPIO_EVEN_IRQn], (unsigned)s->irqs[RTC_IRQn],
+           perHour(mcu), perHour(sensors), perHour(env), perHour(led), avgUa,
+           perHour(total * SIM_SUPPLY_V));
+  } else {
+    printf("variant          %s\n", SIM_VARIANT);
+    printf("scenario         %s (%s)\n", scenario->name, scenario->description);
+    printf("simulated        %.2f h\n", seconds / 3600.0);
+    printf("i2c transfers    %u (%.1f/h), %u NACKed\n", (unsigned)s->i2cTransfers,
+           perHour(s->i2cTransfers), (unsigned)s->i2cNacks);
+    printf("i2c bytes        %u (%.1f/h)\n", (unsigned)s->i2cBytes, perHour(s->i2cBytes));
+    printf("wakeups          %u (%.1f/h) from EM2/EM3, %u EM1 sleeps\n",
+           (unsigned)s->wakeups, perHour(s->wakeups), (unsigned)s->em1Sleeps);
+    printf("interrupts       gpio %u, rtc %u, i2c %u, letimer %u\n",
+           (unsigned)(s->irqs[GPIO_EVEN_IRQn] + s->irqs[GPIO_ODD_IRQn]),
+           (unsigned)s->irqs[RTC_IRQn], (unsigned)s->irqs[I2C0_IRQn],
+           (unsigned)s->irqs[LETIMER0_IRQn]);
+    printf("mcu time         EM0 %.3f s, EM1 %.3f s, EM2 %.1f s, EM3 %.1f s\n",
+           (double)s->modeNs[simModeEM0] / SIM_NS_PER_S,
+           (double)s->modeNs[simModeEM1] / SIM_NS_PER_S,
+           (double)s->modeNs[simModeEM2] / SIM_NS_PER_S,
+           (double)s->modeNs[simModeEM3] / SIM_NS_PER_S);
+    printf("flash            %u erases, %u words\n",
+           (unsigned)s->flashErases, (unsigned)s->flashWords);
+    printf("flash log        %u records from before the boot, %u replayed, "
+           "%u out of order\n", (unsigned)logged, (unsigned)s->logRecords,
+           (unsigned)s->logDisorder);
+    printf("led updates      %u\n", (unsigned)s->ledChanges);
+    printf("wake violations  %u\n", (unsigned)s->wakeViolations);
+    printf("telemetry        %u frames, %u records, %u aggregates, %u bad, %u gaps, "
+           "%u bytes\n", (unsigned)s->telemFrames, (unsigned)s->telemRecords,
+           (unsigned)s->telemAggregates,
+           (unsigned)s->telemBadFrames, (unsigned)s->telemSequenceGaps,
+           (unsigned)s->uartBytes);
+    printf("sensor firmware  %u updates in %.2f s, %u chunks, %u busy NACKs, "
+           "%u dropped\n", (unsigned)s->fwUpdates, (double)s->fwUpdateNs / SIM_NS_PER_S,
+           (unsigned)s->fwChunks, (unsigned)s->fwBusyNacks, (unsigned)s->fwDroppedChunks);
+    printf("sensor faults    %u injected, %u cleared in %.1f s, %u handled: "
+           "%u rewrites, %u resets, %u bus recoveries\n",
+           (unsigned)s->faultsInjected, (unsigned)s->faultsCleared,
+           (double)s->faultRecoveryNs / SIM_NS_PER_S, (unsigned)PERF_Stats.healthFaults,
+           (unsigned)PERF_Stats.healthRewrites, (unsigned)PERF_Stats.healthResets,
+           (unsigned)PERF_Stats.healthBusRecoveries);
+    printf("clock            %u band switches, %u transfers above fast mode\n",
+           (unsigned)s->bandSwitches, (unsigned)s->i2cOverclocked);
+    printf("charge per hour  mcu %.4f mAh, ccs811 %.4f mAh, si7021 %.4f mAh, "
+           "leds %.4f mAh\n", perHour(mcu), perHour(sensors), perHour(env),
+           perHour(led));
+    printf("energy per hour  %.3f mWh at %.1f V, %.1f uA average\n",
+           perHour(total * SIM_SUPPLY_V), SIM_SUPPLY_V, avgUa);
+  }
+  exit(reason == NULL ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+static void usage(const char *prog)
+{
+  fprintf(stderr, "usage: %s [-s scenario] [-t hours] [-r records] [-c] [-b] [-l]\n",
+          prog);
+  exit(EXIT_FAILURE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Log records the way an earlier run of the application would have, so
+ *   the application boots with them in flash.
+ ******************************************************************************/
+static void logEarlierRun(uint32_t count)
+{
+  SAMPLEBUF_Record_TypeDef record;
+  uint32_t i;
+
+  memset(&record, 0, sizeof(record));
+  FLASHLOG_Init();
+  for (i = 0; i < count; i++) {
+    record.timestamp = (i / 2) * SIM_LOG_INTERVAL;
+    record.sensor = (uint8_t)(i % 2);
+    record.eco2 = (uint16_t)(400 + (i * 7) % 600);
+    record.tvoc = (uint16_t)((i * 3) % 120);
+    record.status = 0x98;
+    (void)FLASHLOG_Append(&record);
+  }
+  (void)FLASHLOG_Sync();
+}
+
+int main(int argc, char **argv)
+{
+  const char *name = "office";
+  int i;
+
+  hours = 0;
+  for (i = 1; i < argc; i++) {
+    if ((strcmp(argv[i], "-s") == 0) && (i + 1 < argc)) {
+      name = argv[++i];
+    } else if ((strcmp(argv[i], "-t") == 0) && (i + 1 < argc)) {
+      hours = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if ((strcmp(argv[i], "-r") == 0) && (i + 1 < argc)) {
+      logged = (uint32_t)strtoul(argv[++i], NULL, 10);
+    } else if (strcmp(argv[i], "-c") == 0) {
+      csv = true;
+    } else if (strcmp(argv[i], "-b") == 0) {
+      simBenchCsv = true;
+    } else if (strcmp(argv[i], "-l") == 0) {
+      const SCENARIO_TypeDef *s;
+      int n;
+      for (n = 0; (s = SCENARIO_Get(n)) != NULL; n++) {
+        printf("%-10s %s\n", s->name, s->description);
+      }
+      return EXIT_SUCCESS;
+    } else {
+      usage(argv[0]);
+    }
+  }
+
+  scenario = SCENARIO_Find(name);
+  if (scenario == NULL) {
+    fprintf(stderr, "%s: unknown scenario '%s'\n", argv[0], name);
+    return EXIT_FAILURE;
+  }
+  if (hours == 0) {
+    hours = scenario->defaultHours;
+  }
+
+  SIM_Init((uint64_t)hours * 3600 * SIM_NS_PER_S);
+  SIMHAL_Init();
+  SIMUART_Init();
+  SIMDEV_Init(scenario);
+  if (logged > 0) {
+    logEarlierRun(logged);
+  }
+  app_main();
+  return EXIT_FAILURE;
+}
+
+/** @} (end group SIM) */
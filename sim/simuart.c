@@ -0,0 +1,453 @@
+/***************************************************************************//**
+ * @file simuart.c
+ * @brief Simulated LEUART transmitter, its DMA channel and a frame receiver.
+ *
+ * @details
+ *   A DMA span to LEUART0 TXDATA is put on the line right after the bytes
+ *   already queued, one start, eight data and one stop bit each. The DMA
+ *   completes when the last byte of the span moves into the transmit
+ *   buffer, one byte time before the line goes idle, and TX complete is
+ *   flagged when it does.
+ *
+ *   In EM2 the LEUART wakes the DMA controller for every byte. That short
+ *   HF clock burst is charged to the MCU as SIM_DMA_BYTE_CHARGE per byte.
+ *
+ *   The receiver on the other end decodes every zero terminated COBS frame
+ *   and checks its CRC and sequence number, so the report shows what a
+ *   host would actually have received. With simBenchCsv the records of
+ *   benchmark frames are printed as CSV lines as they arrive.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <string.h>
+#include "em_device.h"
+#include "em_dma.h"
+#include "em_leuart.h"
+#include "crc16.h"
+#include "telem.h"
+#include "bench.h"
+#include "sim.h"
+
+/***************************************************************************//**
+ * @addtogroup SIM
+ * @{
+ ******************************************************************************/
+
+#define HAL_CALL()          SIM_ExecuteCycles(SIM_HAL_CALL_CYCLES)
+
+/* Start, eight data and one stop bit. */
+#define UART_FRAME_BITS     10
+
+/* HF clock wakeup of the DMA controller per byte in EM2, about 3 us at the
+   EM1 current [mA ns]. */
+#define SIM_DMA_BYTE_CHARGE (0.8 * 3000)
+
+#define RX_FRAME_MAX        (TELEM_PAYLOAD_MAX + 8)
+
+#ifndef SIM_VARIANT
+#define SIM_VARIANT         "default"
+#endif
+
+/* Log payload header: boot, first timestamp and count, see telem.c. */
+#define LOG_HEADER_SIZE     9
+#define LOG_ENTRY_SIZE      9
+
+/* Bench payload header and record, see bench.c. */
+#define BENCH_HEADER_SIZE   4
+#define BENCH_RECORD_SIZE   6
+
+bool simBenchCsv;
+
+static const char * const benchMetricName[benchMetricCount] = {
+  [benchMetricEnd]             = "end",
+  [benchMetricWindowMs]        = "window_ms",
+  [benchMetricBootMs]          = "boot_ms",
+  [benchMetricResults]         = "results",
+  [benchMetricLatencyMeanUs]   = "latency_mean_us",
+  [benchMetricLatencyMaxUs]    = "latency_max_us",
+  [benchMetricWakeups]         = "wakeups",
+  [benchMetricModeMs]          = "mode_ms",
+  [benchMetricPhaseCount]      = "phase_count",
+  [benchMetricPhaseMeanCycles] = "phase_mean_cycles",
+  [benchMetricPhaseMaxCycles]  = "phase_max_cycles",
+  [benchMetricI2CRate]         = "i2c_per_s",
+  [benchMetricI2CCycles]       = "i2c_cycles",
+  [benchMetricI2CErrors]       = "i2c_errors",
+  [benchMetricI2CCoreHz]       = "i2c_core_hz",
+};
+
+LEUART_TypeDef simLEUART0;
+
+static struct {
+  uint32_t       select;
+  DMA_CB_TypeDef *cb;
+  bool           active;
+  bool           done;
+  uint64_t       doneAt;
+} dma[DMA_CHAN_COUNT];
+
+static struct {
+  uint32_t baudrate;
+  bool     busy;                     /* Bytes on the line */
+  uint64_t idleAt;                   /* End of the last queued byte */
+  uint32_t flags;
+  uint32_t enabledFlags;
+} uart;
+
+static struct {
+  uint8_t  encoded[RX_FRAME_MAX + RX_FRAME_MAX / 254 + 2];
+  uint16_t length;
+  bool     overrun;
+  bool     synced;
+  uint8_t  lastSequence;
+  uint32_t logBoot;          /* Boot and time of the last replayed record */
+  uint32_t logTime;
+} rx;
+
+/* --- Receiver ------------------------------------------------------------ */
+
+/***************************************************************************//**
+ * @brief
+ *   Count the records of a log payload and check they come oldest first.
+ ******************************************************************************/
+static void rxLog(const uint8_t *payload, uint16_t len)
+{
+  uint32_t boot;
+  uint32_t base;
+  uint32_t time;
+  uint16_t count;
+  uint16_t i;
+
+  if (len < LOG_HEADER_SIZE) {
+    simStats.telemBadFrames++;
+    return;
+  }
+  boot = payload[0] | ((uint32_t)payload[1] << 8) | ((uint32_t)payload[2] << 16)
+         | ((uint32_t)payload[3] << 24);
+  base = payload[4] | ((uint32_t)payload[5] << 8) | ((uint32_t)payload[6] << 16)
+         | ((uint32_t)payload[7] << 24);
+  count = payload[8];
+  if (len < LOG_HEADER_SIZE + count * LOG_ENTRY_SIZE) {
+    simStats.telemBadFrames++;
+    return;
+  }
+  for (i = 0; i < count; i++) {
+    const uint8_t *r = payload + LOG_HEADER_SIZE + i * LOG_ENTRY_SIZE;
+
+    time = base + (r[0] | ((uint32_t)r[1] << 8));
+    if ((boot < rx.logBoot) || ((boot == rx.logBoot) && (time < rx.logTime))) {
+      simStats.logDisorder++;
+    }
+    rx.logBoot = boot;
+    rx.logTime = time;
+  }
+  simStats.logRecords += count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Count the records of a benchmark payload and print them if asked to.
+ ******************************************************************************/
+static void rxBench(const uint8_t *payload, uint16_t len)
+{
+  uint16_t count;
+  uint16_t i;
+
+  if ((len < BENCH_HEADER_SIZE) || (payload[0] != BENCH_FORMAT_VERSION)) {
+    simStats.telemBadFrames++;
+    return;
+  }
+  count = payload[3];
+  if (len < BENCH_HEADER_SIZE + count * BENCH_RECORD_SIZE) {
+    simStats.telemBadFrames++;
+    return;
+  }
+  simStats.benchRecords += count;
+  if (!simBenchCsv) {
+    return;
+  }
+  for (i = 0; i < count; i++) {
+    const uint8_t *r = payload + BENCH_HEADER_SIZE + i * BENCH_RECORD_SIZE;
+    uint32_t value = r[2] | ((uint32_t)r[3] << 8) | ((uint32_t)r[4] << 16)
+                     | ((uint32_t)r[5] << 24);
+
+    if ((r[0] < benchMetricCount) && (benchMetricName[r[0]] != NULL)) {
+      printf("%s,%u,%u,%s,%u,%u\n", SIM_VARIANT, payload[1], payload[2],
+             benchMetricName[r[0]], r[1], (unsigned)value);
+    } else {
+      printf("%s,%u,%u,%u,%u,%u\n", SIM_VARIANT, payload[1], payload[2],
+             r[0], r[1], (unsigned)value);
+    }
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Decode and check one received frame.
+ ******************************************************************************/
+static void rxFrame(void)
+{
+  uint8_t frame[RX_FRAME_MAX];
+  uint16_t in = 0;
+  uint16_t out = 0;
+  uint16_t crc;
+
+  while (in < rx.length) {
+    uint8_t code = rx.encoded[in++];
+    uint8_t i;
+
+    if (code == 0) {
+      simStats.telemBadFrames++;
+      return;
+    }
+    for (i = 1; i < code; i++) {
+      if ((in >= rx.length) || (out >= sizeof(frame))) {
+        simStats.telemBadFrames++;
+        return;
+      }
+      frame[out++] = rx.encoded[in++];
+    }
+    if ((code < 0xFF) && (in < rx.length)) {
+      if (out >= sizeof(frame)) {
+        simStats.telemBadFrames++;
+        return;
+      }
+      frame[out++] = 0;
+    }
+  }
+
+  if (out < 4) {
+    simStats.telemBadFrames++;
+    return;
+  }
+  crc = CRC16_Update(CRC16_INIT, frame, out - 2);
+  if ((frame[out - 2] != (uint8_t)crc) || (frame[out - 1] != (uint8_t)(crc >> 8))) {
+    simStats.telemBadFrames++;
+    return;
+  }
+
+  if (rx.synced && (frame[1] != (uint8_t)(rx.lastSequence + 1))) {
+    simStats.telemSequenceGaps++;
+  }
+  rx.synced = true;
+  rx.lastSequence = frame[1];
+  simStats.telemFrames++;
+  if ((frame[0] == telemFrameSamples) && (out >= 2 + 5 + 2)) {
+    simStats.telemRecords += frame[2 + 4];
+  } else if (frame[0] == telemFrameAggregate) {
+    simStats.telemAggregates++;
+  } else if (frame[0] == telemFrameBench) {
+    rxBench(frame + 2, out - 4);
+  } else if (frame[0] == telemFrameLog) {
+    rxLog(frame + 2, out - 4);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   One byte from the line.
+ ******************************************************************************/
+static void rxByte(uint8_t byte)
+{
+  if (byte != 0) {
+    if (rx.length < sizeof(rx.encoded)) {
+      rx.encoded[rx.length++] = byte;
+    } else {
+      rx.overrun = true;
+    }
+    return;
+  }
+  if (rx.overrun) {
+    simStats.telemBadFrames++;
+  } else if (rx.length > 0) {
+    rxFrame();
+  }
+  rx.length = 0;
+  rx.overrun = false;
+}
+
+/* --- Event source -------------------------------------------------------- */
+
+static uint64_t uartNext(void)
+{
+  uint64_t t = SIM_NEVER;
+  int i;
+
+  for (i = 0; i < DMA_CHAN_COUNT; i++) {
+    if (dma[i].active && (dma[i].doneAt < t)) {
+      t = dma[i].doneAt;
+    }
+  }
+  if (uart.busy && (uart.idleAt < t)) {
+    t = uart.idleAt;
+  }
+  return t;
+}
+
+static void uartSync(uint64_t now)
+{
+  bool pend = false;
+  int i;
+
+  for (i = 0; i < DMA_CHAN_COUNT; i++) {
+    if (dma[i].active && (now >= dma[i].doneAt)) {
+      dma[i].active = false;
+      dma[i].done = true;
+      pend = true;
+    }
+  }
+  if (pend) {
+    SIM_Pend(DMA_IRQn);
+  }
+  if (uart.busy && (now >= uart.idleAt)) {
+    uart.busy = false;
+    uart.flags |= LEUART_IF_TXC;
+  }
+  if (uart.flags & uart.enabledFlags) {
+    SIM_Pend(LEUART0_IRQn);
+  }
+}
+
+static const SIM_Source_TypeDef uartSource = { uartNext, uartSync, NULL };
+
+/* --- DMA ----------------------------------------------------------------- */
+
+void DMA_Init(DMA_Init_TypeDef *init)
+{
+  (void)init;
+  HAL_CALL();
+  /* Like emlib, which owns the handler. */
+  NVIC_ClearPendingIRQ(DMA_IRQn);
+  NVIC_EnableIRQ(DMA_IRQn);
+}
+
+void DMA_CfgChannel(unsigned int channel, DMA_CfgChannel_TypeDef *cfg)
+{
+  HAL_CALL();
+  dma[channel].select = cfg->select;
+  dma[channel].cb = cfg->cb;
+}
+
+void DMA_CfgDescr(unsigned int channel, bool primary, DMA_CfgDescr_TypeDef *cfg)
+{
+  (void)channel;
+  (void)primary;
+  (void)cfg;
+  HAL_CALL();
+}
+
+void DMA_ActivateBasic(unsigned int channel, bool primary, bool useBurst,
+                       void *dst, const void *src, unsigned int nMinus1)
+{
+  const uint8_t *p = src;
+  uint64_t byteNs;
+  uint64_t start;
+  unsigned int i;
+
+  (void)primary;
+  (void)useBurst;
+  HAL_CALL();
+  if ((dma[channel].select != DMAREQ_LEUART0_TXBL) || (dst != &LEUART0->TXDATA)
+      || (uart.baudrate == 0)) {
+    SIM_End("DMA transfer to a peripheral that is not simulated");
+  }
+
+  for (i = 0; i <= nMinus1; i++) {
+    rxByte(p[i]);
+  }
+  simStats.uartBytes += nMinus1 + 1;
+  simStats.mcuCharge += (nMinus1 + 1) * SIM_DMA_BYTE_CHARGE;
+
+  byteNs = UART_FRAME_BITS * SIM_NS_PER_S / uart.baudrate;
+  start = uart.busy ? uart.idleAt : SIM_Now();
+  uart.busy = true;
+  uart.idleAt = start + (nMinus1 + 1) * byteNs;
+  dma[channel].active = true;
+  dma[channel].done = false;
+  dma[channel].doneAt = uart.idleAt - byteNs;
+}
+
+void DMA_ChannelEnable(unsigned int channel, bool enable)
+{
+  HAL_CALL();
+  if (!enable) {
+    dma[channel].active = false;
+  }
+}
+
+/** Stand-in for the emlib handler, runs the completion callbacks. */
+void DMA_IRQHandler(void)
+{
+  int i;
+
+  for (i = 0; i < DMA_CHAN_COUNT; i++) {
+    if (dma[i].done) {
+      dma[i].done = false;
+      if ((dma[i].cb != NULL) && (dma[i].cb->cbFunc != NULL)) {
+        dma[i].cb->cbFunc(i, true, dma[i].cb->userPtr);
+      }
+    }
+  }
+}
+
+/* --- LEUART -------------------------------------------------------------- */
+
+void LEUART_Init(LEUART_TypeDef *port, const LEUART_Init_TypeDef *init)
+{
+  (void)port;
+  HAL_CALL();
+  uart.baudrate = (init->enable & leuartEnableTx) ? init->baudrate : 0;
+}
+
+void LEUART_TxDmaInEM2Enable(LEUART_TypeDef *port, bool enable)
+{
+  (void)port;
+  (void)enable;
+  HAL_CALL();
+}
+
+uint32_t LEUART_IntGet(LEUART_TypeDef *port)
+{
+  (void)port;
+  HAL_CALL();
+  return uart.flags;
+}
+
+void LEUART_IntClear(LEUART_TypeDef *port, uint32_t flags)
+{
+  (void)port;
+  HAL_CALL();
+  uart.flags &= ~flags;
+}
+
+void LEUART_IntEnable(LEUART_TypeDef *port, uint32_t flags)
+{
+  (void)port;
+  HAL_CALL();
+  uart.enabledFlags |= flags;
+  if (uart.flags & uart.enabledFlags) {
+    SIM_Pend(LEUART0_IRQn);
+  }
+}
+
+void LEUART_IntDisable(LEUART_TypeDef *port, uint32_t flags)
+{
+  (void)port;
+  HAL_CALL();
+  uart.enabledFlags &= ~flags;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reset the transmitter and the receiver and register the event source.
+ ******************************************************************************/
+void SIMUART_Init(void)
+{
+  memset(dma, 0, sizeof(dma));
+  memset(&uart, 0, sizeof(uart));
+  memset(&rx, 0, sizeof(rx));
+  memset(&simLEUART0, 0, sizeof(simLEUART0));
+  SIM_AddSource(&uartSource);
+}
+
+/** @} (end group SIM) */
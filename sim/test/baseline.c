@@ -0,0 +1,159 @@
+/***************************************************************************//**
+ * @file baseline.c
+ * @brief Test of the baseline store: page switches cut short by a reset.
+ *
+ * @details
+ *   Both sensors store a new baseline in turn until the pages have been
+ *   switched a few times, and every store must be found again. Then every
+ *   flash operation of a page switch in turn is the one power is lost on,
+ *   starting from the same full page each time. After the reset both
+ *   sensors must still find a baseline, the new one or the one before it.
+ *
+ *   The flash here is plain RAM behind the MSC calls. Writes can only clear
+ *   bits. A write that loses power programs nothing, an erase that loses
+ *   power only erases the first half of the page.
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "em_device.h"
+#include "em_msc.h"
+#include "flashmap.h"
+#include "baseline.h"
+#include "test.h"
+
+#define STORES         600    /* Enough for four page switches            */
+#define SWITCH_OPS     5      /* Erase, two slots, header, erase           */
+
+uint8_t simFlash[FLASH_SIZE] __attribute__ ((aligned(FLASH_PAGE_SIZE)));
+
+static uint32_t operations;    /* Erases and writes since the last reset    */
+static uint32_t cutAt;         /* Operation that loses power, 0 for none    */
+static bool     powerLost;     /* Nothing reaches the flash until the reset */
+
+uint32_t CCS811_GetBaseline(CCS811_Handle_TypeDef *dev, uint16_t *baseline)
+{
+  (void)dev;
+  (void)baseline;
+  return CCS811_OK;
+}
+
+uint32_t CCS811_SetBaseline(CCS811_Handle_TypeDef *dev, uint16_t baseline)
+{
+  (void)dev;
+  (void)baseline;
+  return CCS811_OK;
+}
+
+void MSC_Init(void)
+{
+}
+
+void MSC_Deinit(void)
+{
+}
+
+/* True when the operation still reaches the flash. */
+static bool powered(void)
+{
+  operations++;
+  if ((cutAt != 0) && (operations == cutAt)) {
+    powerLost = true;
+  }
+  return !powerLost;
+}
+
+MSC_Status_TypeDef MSC_ErasePage(uint32_t *startAddress)
+{
+  bool wasLost = powerLost;
+
+  if (powered()) {
+    memset(startAddress, 0xFF, FLASH_PAGE_SIZE);
+  } else if (!wasLost) {
+    memset(startAddress, 0xFF, FLASH_PAGE_SIZE / 2);
+  }
+  return mscReturnOk;
+}
+
+MSC_Status_TypeDef MSC_WriteWord(uint32_t *address, void const *data,
+                                 uint32_t numBytes)
+{
+  const uint32_t *src = data;
+  uint32_t i;
+
+  if (powered()) {
+    for (i = 0; i < numBytes / 4; i++) {
+      address[i] &= src[i];
+    }
+  }
+  return mscReturnOk;
+}
+
+/* Baseline of a sensor for store i, never the same twice in a row. */
+static uint16_t valueAt(uint32_t i)
+{
+  return (uint16_t)(0x4000 + i * 7);
+}
+
+static uint8_t sensorAt(uint32_t i)
+{
+  return (i % 2) ? CCS811_I2C_ADDR_HIGH : CCS811_I2C_ADDR_LOW;
+}
+
+int main(void)
+{
+  static uint8_t full[FLASH_SIZE];
+  uint16_t value;
+  uint16_t other;
+  uint32_t before;
+  uint32_t bad;
+  uint32_t i;
+  uint32_t k;
+
+  memset(simFlash, 0xFF, sizeof(simFlash));
+  TEST_CHECK(!BASELINE_Load(CCS811_I2C_ADDR_LOW, &value));
+
+  // Every store is found again, across the page switches
+  bad = 0;
+  for (i = 0; i < STORES; i++) {
+    bad += !BASELINE_Store(sensorAt(i), valueAt(i));
+    bad += !BASELINE_Load(sensorAt(i), &value) || (value != valueAt(i));
+    if (i > 0) {
+      bad += !BASELINE_Load(sensorAt(i - 1), &value) || (value != valueAt(i - 1));
+    }
+  }
+  TEST_CHECK(bad == 0);
+
+  // Find the store that switches pages, it is more than one write
+  do {
+    memcpy(full, simFlash, sizeof(full));
+    operations = 0;
+    (void)BASELINE_Store(sensorAt(i), valueAt(i));
+    i++;
+  } while (operations == 1);
+  i--;
+  before = operations;
+  TEST_CHECK((before > 1) && (before <= SWITCH_OPS));
+
+  // Reset on each operation of the switch in turn
+  for (k = 1; k <= before; k++) {
+    memcpy(simFlash, full, sizeof(simFlash));
+    operations = 0;
+    cutAt = k;
+    powerLost = false;
+    (void)BASELINE_Store(sensorAt(i), valueAt(i));
+
+    cutAt = 0;
+    powerLost = false;
+    TEST_CHECK(BASELINE_Load(sensorAt(i), &value)
+               && ((value == valueAt(i)) || (value == valueAt(i - 2))));
+    TEST_CHECK(BASELINE_Load(sensorAt(i - 1), &other) && (other == valueAt(i - 1)));
+
+    // The store after the reset goes through
+    TEST_CHECK(BASELINE_Store(sensorAt(i), valueAt(i + 2)));
+    TEST_CHECK(BASELINE_Load(sensorAt(i), &value) && (value == valueAt(i + 2)));
+    TEST_CHECK(BASELINE_Load(sensorAt(i - 1), &other) && (other == valueAt(i - 1)));
+  }
+
+  return TEST_End("baseline");
+}
@@ -0,0 +1,210 @@
+/***************************************************************************//**
+ * @file flashlog.c
+ * @brief Test of the flash log recovery: torn writes across boots.
+ *
+ * @details
+ *   Five boots log records, each ending with a power failure at a different
+ *   point of a write or with a clean sync. After every boot the reader must
+ *   return each record at most once, oldest first and unchanged, and every
+ *   record synced before the failure. At the end the log wraps under an
+ *   open reader, which must skip the erased pages rather than decode them.
+ *
+ *   The flash here is plain RAM behind the MSC calls. Writes can only clear
+ *   bits, and a torn write programs the first words and then loses power:
+ *   nothing reaches the flash until the next boot.
+ ******************************************************************************/
+
+#include <stdint.h>
+#include <string.h>
+#include "em_device.h"
+#include "em_msc.h"
+#include "flashmap.h"
+#include "flashlog.h"
+#include "test.h"
+
+#define BOOTS          5
+#define RECORDS        300    /* Appended per boot, the log holds them all */
+#define SYNC_EVERY     50     /* Records between FLASHLOG_Sync() calls     */
+#define BLOCK_BYTES    HISTCODEC_BLOCK_SIZE
+#define HEADER_BYTES   16
+
+uint8_t simFlash[FLASH_SIZE] __attribute__ ((aligned(FLASH_PAGE_SIZE)));
+
+static uint32_t tearBytes;     /* Size of the write that tears, 0 for none  */
+static uint32_t tearWords;     /* Words it still programs                   */
+static uint32_t tearSkip;      /* Writes of that size to let through first  */
+static bool     powerLost;     /* Nothing reaches the flash until the boot  */
+
+/** How a boot ends. */
+typedef struct {
+  uint32_t bytes;              /* Write that tears: block, header, 0 clean  */
+  uint32_t words;              /* Words of it that are programmed           */
+  uint32_t skip;               /* Writes of that size before it             */
+} Ending_TypeDef;
+
+static const Ending_TypeDef endings[BOOTS] = {
+  { 0, 0, 0 },                 /* Clean, the last records are synced        */
+  { BLOCK_BYTES, 5, 3 },       /* Torn in the block header                  */
+  { HEADER_BYTES, 2, 1 },      /* Torn page header, the page is unused      */
+  { BLOCK_BYTES, 31, 2 },      /* All but the last word of a block          */
+  { BLOCK_BYTES, 0, 4 },       /* Power lost just before a write            */
+};
+
+void MSC_Init(void)
+{
+}
+
+void MSC_Deinit(void)
+{
+}
+
+MSC_Status_TypeDef MSC_ErasePage(uint32_t *startAddress)
+{
+  if (!powerLost) {
+    memset(startAddress, 0xFF, FLASH_PAGE_SIZE);
+  }
+  return mscReturnOk;
+}
+
+MSC_Status_TypeDef MSC_WriteWord(uint32_t *address, void const *data,
+                                 uint32_t numBytes)
+{
+  const uint32_t *src = data;
+  uint32_t words = numBytes / 4;
+  uint32_t i;
+
+  if (powerLost) {
+    return mscReturnOk;
+  }
+  if ((tearBytes != 0) && (numBytes == tearBytes)) {
+    if (tearSkip > 0) {
+      tearSkip--;
+    } else {
+      words = tearWords;
+      powerLost = true;
+    }
+  }
+  for (i = 0; i < words; i++) {
+    address[i] &= src[i];
+  }
+  return mscReturnOk;
+}
+
+/* Record i of a boot, every field depends on both. */
+static void makeRecord(SAMPLEBUF_Record_TypeDef *record, uint32_t boot, uint32_t i)
+{
+  memset(record, 0, sizeof(*record));
+  record->timestamp = i * 10;
+  record->sensor = (uint8_t)(i % 2);
+  record->eco2 = (uint16_t)(400 + boot * 37 + (i * 11) % 500);
+  record->tvoc = (uint16_t)((boot * 13 + i * 5) % 200);
+  record->status = 0x98;
+  record->errorId = (uint8_t)(i % 7 == 0);
+}
+
+/*
+ * Read the whole log. Checks each record against its pattern and the order,
+ * and counts per boot the records of that boot below its synced count.
+ */
+static void readLog(const uint32_t *synced, uint32_t boots)
+{
+  FLASHLOG_Reader_TypeDef reader;
+  SAMPLEBUF_Record_TypeDef record;
+  SAMPLEBUF_Record_TypeDef expected;
+  uint32_t found[BOOTS + 1] = { 0 };
+  uint32_t lastBoot = 0;
+  uint32_t lastIndex = 0;
+  bool first = true;
+  bool intact = true;
+  bool ordered = true;
+  uint32_t boot;
+  uint32_t i;
+
+  FLASHLOG_ReaderInit(&reader);
+  while (FLASHLOG_Next(&reader, &record, &boot)) {
+    i = record.timestamp / 10;
+    makeRecord(&expected, boot, i);
+    if ((boot == 0) || (boot > boots) || (memcmp(&record, &expected, sizeof(record)) != 0)) {
+      intact = false;
+      continue;
+    }
+    if (!first && ((boot < lastBoot) || ((boot == lastBoot) && (i <= lastIndex)))) {
+      ordered = false;
+    }
+    first = false;
+    lastBoot = boot;
+    lastIndex = i;
+    if (i < synced[boot]) {
+      found[boot]++;
+    }
+  }
+
+  TEST_CHECK(intact);
+  TEST_CHECK(ordered);
+  for (boot = 1; boot <= boots; boot++) {
+    TEST_CHECK(found[boot] == synced[boot]);
+  }
+}
+
+int main(void)
+{
+  uint32_t synced[BOOTS + 1] = { 0 };
+  SAMPLEBUF_Record_TypeDef record;
+  SAMPLEBUF_Record_TypeDef expected;
+  FLASHLOG_Reader_TypeDef reader;
+  uint32_t boot;
+  uint32_t before;
+  uint32_t bad;
+  uint32_t i;
+
+  memset(simFlash, 0xFF, sizeof(simFlash));
+
+  for (boot = 1; boot <= BOOTS; boot++) {
+    powerLost = false;
+    tearBytes = endings[boot - 1].bytes;
+    tearWords = endings[boot - 1].words;
+    tearSkip = endings[boot - 1].skip;
+
+    FLASHLOG_Init();
+    TEST_CHECK(FLASHLOG_Boot() == boot);
+    for (i = 0; (i < RECORDS) && !powerLost; i++) {
+      makeRecord(&record, boot, i);
+      (void)FLASHLOG_Append(&record);
+      if (((i + 1) % SYNC_EVERY == 0) && !powerLost) {
+        (void)FLASHLOG_Sync();
+        if (!powerLost) {
+          synced[boot] = i + 1;
+        }
+      }
+    }
+    TEST_CHECK(powerLost == (tearBytes != 0));
+
+    /* Read back as the next boot would, before it writes anything */
+    powerLost = false;
+    tearBytes = 0;
+    FLASHLOG_Init();
+    readLog(synced, boot);
+  }
+
+  /* Wrap the log under an open reader, the erased pages are skipped */
+  FLASHLOG_Init();
+  FLASHLOG_ReaderInit(&reader);
+  before = 0;
+  for (i = 0; i < 100; i++) {
+    before += FLASHLOG_Next(&reader, &record, NULL);
+  }
+  TEST_CHECK(before == 100);
+  bad = 0;
+  for (i = 0; i < FLASHMAP_LOG_PAGES * 400; i++) {
+    makeRecord(&record, BOOTS + 1, i);
+    bad += !FLASHLOG_Append(&record);
+  }
+  TEST_CHECK(bad == 0);
+  while (FLASHLOG_Next(&reader, &record, &boot)) {
+    makeRecord(&expected, boot, record.timestamp / 10);
+    bad += (memcmp(&record, &expected, sizeof(record)) != 0);
+  }
+  TEST_CHECK(bad == 0);
+
+  return TEST_End("flashlog");
+}
@@ -0,0 +1,57 @@
+/***************************************************************************//**
+ * @file rawiaq.c
+ * @brief Test of the raw data air quality index: baseline tracking.
+ *
+ * @details
+ *   A lasting drop in resistance by less than an octave, say a room that
+ *   settles at a new normal, must be taken as the new clean air level
+ *   within a few decay time constants, and a rise must be followed at once.
+ ******************************************************************************/
+
+#include <stdint.h>
+#include "rawiaq.h"
+#include "test.h"
+
+#define SAMPLES_PER_HOUR  (4 * 3600)   /* One sample every 250 ms */
+#define CURRENT           20           /* Drive current [uA]      */
+#define ADC_CLEAN         800
+#define ADC_STEP          560          /* 0.7 of the clean level, half an octave */
+
+static uint16_t feed(RAWIAQ_State_TypeDef *state, uint16_t rawAdc, uint32_t samples)
+{
+  uint16_t index = 0;
+  uint32_t i;
+
+  for (i = 0; i < samples; i++) {
+    index = RAWIAQ_Process(state, CURRENT, rawAdc);
+  }
+  return index;
+}
+
+int main(void)
+{
+  RAWIAQ_State_TypeDef state;
+  uint16_t index;
+
+  RAWIAQ_Init(&state);
+  TEST_CHECK(feed(&state, ADC_CLEAN, SAMPLES_PER_HOUR) == 0);
+  TEST_CHECK(RAWIAQ_IsSettled(&state));
+
+  /* The step shows up once the fast filter has caught up */
+  index = feed(&state, ADC_STEP, 4 * 30);
+  TEST_CHECK(index > 90);
+  TEST_CHECK(index < 120);
+
+  /* One time constant in, the baseline is on its way down */
+  TEST_CHECK(feed(&state, ADC_STEP, 4 * 1024) < index / 2);
+
+  /* Within six time constants it has reached the new level */
+  TEST_CHECK(feed(&state, ADC_STEP, 5 * 4 * 1024) == 0);
+  TEST_CHECK(state.baseline - state.filtered < (1 << 12));
+
+  /* Cleaner air again, the baseline follows the rise right away */
+  TEST_CHECK(feed(&state, ADC_CLEAN, 4 * 30) == 0);
+  TEST_CHECK(feed(&state, ADC_STEP, 4 * 30) >= index - 2);
+
+  return TEST_End("rawiaq");
+}
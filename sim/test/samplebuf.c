@@ -0,0 +1,84 @@
+/***************************************************************************//**
+ * @file samplebuf.c
+ * @brief Test of the sample buffer flush: refused chunks lose no records.
+ *
+ * @details
+ *   A callback that refuses a chunk leaves the records in the buffer, and
+ *   records pushed while the flush waits must come out after them, in
+ *   order, or be counted as dropped.
+ ******************************************************************************/
+
+#include <stdint.h>
+#include "samplebuf.h"
+#include "test.h"
+
+#define WATERMARK  8
+#define PUSHED     12
+
+static uint16_t refusals;         /* Chunks still to be refused   */
+static uint32_t delivered;        /* Records the callback took    */
+static bool     ordered = true;   /* Every record was the next one */
+
+static bool take(const SAMPLEBUF_Record_TypeDef *records, uint16_t count)
+{
+  uint16_t i;
+
+  if (refusals > 0) {
+    refusals--;
+    return false;
+  }
+  for (i = 0; i < count; i++) {
+    if ((records[i].timestamp != delivered) || (records[i].eco2 != 400 + delivered)) {
+      ordered = false;
+    }
+    delivered++;
+  }
+  return true;
+}
+
+static void push(uint32_t n)
+{
+  SAMPLEBUF_Record_TypeDef record = { 0 };
+
+  record.timestamp = n;
+  record.eco2 = (uint16_t)(400 + n);
+  record.tvoc = 10;
+  SAMPLEBUF_Push(&record);
+}
+
+int main(void)
+{
+  uint32_t i;
+
+  /* Refused once at the watermark, taken on the next push */
+  SAMPLEBUF_Init(WATERMARK, take);
+  refusals = 1;
+  for (i = 0; i < PUSHED; i++) {
+    push(i);
+    if (i == WATERMARK - 1) {
+      TEST_CHECK(SAMPLEBUF_FlushPending());
+      TEST_CHECK(SAMPLEBUF_Count() == WATERMARK);
+    }
+  }
+  SAMPLEBUF_Flush();
+  TEST_CHECK(delivered + SAMPLEBUF_Dropped() == PUSHED);
+  TEST_CHECK(delivered == PUSHED);
+  TEST_CHECK(SAMPLEBUF_Count() == 0);
+  TEST_CHECK(ordered);
+
+  /* Refused for a whole batch, then taken at once by an explicit flush */
+  SAMPLEBUF_Init(WATERMARK, take);
+  delivered = 0;
+  refusals = PUSHED - WATERMARK + 1;
+  for (i = 0; i < PUSHED; i++) {
+    push(i);
+  }
+  TEST_CHECK(delivered == 0);
+  TEST_CHECK(SAMPLEBUF_Count() == PUSHED);
+  SAMPLEBUF_Flush();
+  TEST_CHECK(delivered == PUSHED);
+  TEST_CHECK(!SAMPLEBUF_FlushPending());
+  TEST_CHECK(ordered);
+
+  return TEST_End("samplebuf");
+}
@@ -0,0 +1,59 @@
+/***************************************************************************//**
+ * @file test.c
+ * @brief Host unit tests of single application modules.
+ ******************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "em_assert.h"
+#include "test.h"
+
+/***************************************************************************//**
+ * @addtogroup TEST
+ * @{
+ ******************************************************************************/
+
+static unsigned int checks;
+static unsigned int failures;
+
+/***************************************************************************//**
+ * @brief
+ *   Count one check and report it if it failed.
+ *
+ * @return
+ *   The result of the check.
+ ******************************************************************************/
+bool TEST_Check(bool pass, const char *file, int line, const char *expr)
+{
+  checks++;
+  if (!pass) {
+    failures++;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expr);
+  }
+  return pass;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Print the summary line of a test program.
+ *
+ * @return
+ *   Exit status, 0 when every check passed.
+ ******************************************************************************/
+int TEST_End(const char *name)
+{
+  printf("%s: %u checks, %u failed\n", name, checks, failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   A failed EFM_ASSERT in a module under test ends the program.
+ ******************************************************************************/
+void assertEFM(const char *file, int line)
+{
+  fprintf(stderr, "%s:%d: assert failed\n", file, line);
+  exit(EXIT_FAILURE);
+}
+
+/** @} (end group TEST) */
@@ -0,0 +1,31 @@
+/***************************************************************************//**
+ * @file test.h
+ * @brief Host unit tests of single application modules.
+ *
+ * @details
+ *   Each test is its own program, built from one file in this directory and
+ *   the modules it exercises, see the test target in the sim Makefile. A
+ *   failed check is reported and the program exits non zero at the end, a
+ *   failed EFM_ASSERT stops it at once.
+ ******************************************************************************/
+
+#ifndef TEST_H
+#define TEST_H
+
+#include <stdbool.h>
+
+/***************************************************************************//**
+ * @addtogroup TEST
+ * @brief Checks for the host unit tests
+ * @{
+ ******************************************************************************/
+
+/** Report a failed check with its expression, the test carries on. */
+#define TEST_CHECK(expr)  TEST_Check((expr), __FILE__, __LINE__, #expr)
+
+bool TEST_Check(bool pass, const char *file, int line, const char *expr);
+int TEST_End(const char *name);
+
+/** @} (end group TEST) */
+
+#endif /* TEST_H */
@@ -0,0 +1,345 @@
+/***************************************************************************//**
+ * @file baseline.c
+ * @brief Persistence of the CCS811 baseline in internal flash.
+ *
+ * @details
+ *   Two pages are used in turn, each as an append-only log of 8-byte slots.
+ *   Each slot holds a tag, the sensor address and the baseline, followed by
+ *   the inverse of that word so a slot torn by a power failure is ignored.
+ *   The newest valid slot for an address wins.
+ *
+ *   The first slot of a page is its header with a sequence number, the
+ *   page with the higher one is in use. When it is full the newest value
+ *   of every sensor is written to the other page, then that page's header,
+ *   and only then is the full page erased. A reset at any point leaves one
+ *   page with a valid header and every baseline on it. Each erase covers
+ *   about 125 saves.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_device.h"
+#include "em_msc.h"
+#include "flashmap.h"
+#include "baseline.h"
+
+/***************************************************************************//**
+ * @addtogroup BASELINE
+ * @{
+ ******************************************************************************/
+
+#define PAGE_TAG          0xB6UL
+#define SLOT_TAG          0xB5UL
+#define SLOT_ERASED       0xFFFFFFFFUL
+#define SLOT_WORDS        2
+#define SLOT_COUNT        (FLASH_PAGE_SIZE / (SLOT_WORDS * sizeof(uint32_t)))
+#define PAGE_WORDS        (FLASH_PAGE_SIZE / sizeof(uint32_t))
+#define SEQUENCE_MASK     0xFFFFFFUL
+#define SENSOR_SLOTS      2     /* One per CCS811 address */
+
+static uint32_t * const pages = (uint32_t *)FLASHMAP_BASELINE_BASE;
+static uint32_t nextSave[SENSOR_SLOTS];
+
+/***************************************************************************//**
+ * @brief
+ *   Map a sensor address to its index in the per sensor tables.
+ ******************************************************************************/
+static unsigned int sensorIndex(uint8_t addr)
+{
+  return (addr == CCS811_I2C_ADDR_HIGH) ? 1 : 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   First word of one of the baseline pages.
+ ******************************************************************************/
+static uint32_t *pageAt(unsigned int index)
+{
+  return &pages[index * PAGE_WORDS];
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check a slot and extract its contents.
+ ******************************************************************************/
+static bool slotValid(const uint32_t *slot, uint8_t *addr, uint16_t *baseline)
+{
+  if ((slot[0] >> 24) != SLOT_TAG || slot[1] != ~slot[0]) {
+    return false;
+  }
+  *addr = (slot[0] >> 16) & 0xFF;
+  *baseline = slot[0] & 0xFFFF;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check a page header and extract its sequence number.
+ ******************************************************************************/
+static bool headerValid(const uint32_t *page, uint32_t *sequence)
+{
+  if ((page[0] >> 24) != PAGE_TAG || page[1] != ~page[0]) {
+    return false;
+  }
+  *sequence = page[0] & SEQUENCE_MASK;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Find the page in use.
+ *
+ * @param[out] sequence
+ *   Its sequence number, 0 when there is none
+ *
+ * @return
+ *   Index of the page, FLASHMAP_BASELINE_PAGES when neither has a header.
+ ******************************************************************************/
+static unsigned int activePage(uint32_t *sequence)
+{
+  uint32_t seq[2];
+  bool valid[2];
+
+  valid[0] = headerValid(pageAt(0), &seq[0]);
+  valid[1] = headerValid(pageAt(1), &seq[1]);
+  if (valid[0] && valid[1]) {
+    // Only while a switch was cut short, the newer page is complete
+    valid[0] = ((seq[0] - seq[1]) & SEQUENCE_MASK) < (SEQUENCE_MASK / 2);
+    valid[1] = !valid[0];
+  }
+  if (valid[0] || valid[1]) {
+    *sequence = valid[0] ? seq[0] : seq[1];
+    return valid[0] ? 0 : 1;
+  }
+  *sequence = 0;
+  return FLASHMAP_BASELINE_PAGES;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Index of the first erased slot after the header, SLOT_COUNT when the
+ *   page is full.
+ ******************************************************************************/
+static unsigned int firstFreeSlot(const uint32_t *page)
+{
+  unsigned int i;
+
+  for (i = 1; i < SLOT_COUNT; i++) {
+    if (page[i * SLOT_WORDS] == SLOT_ERASED) {
+      break;
+    }
+  }
+  return i;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check that a page is fully erased.
+ ******************************************************************************/
+static bool pageErased(const uint32_t *page)
+{
+  unsigned int i;
+
+  for (i = 0; i < PAGE_WORDS; i++) {
+    if (page[i] != SLOT_ERASED) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Program one slot with a word and its inverse. MSC must be initialized.
+ ******************************************************************************/
+static bool writeSlot(uint32_t *page, unsigned int index, uint32_t word)
+{
+  uint32_t slot[SLOT_WORDS];
+
+  slot[0] = word;
+  slot[1] = ~word;
+  return MSC_WriteWord(&page[index * SLOT_WORDS], slot, sizeof(slot)) == mscReturnOk;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Slot contents for the baseline of a sensor.
+ ******************************************************************************/
+static uint32_t slotWord(uint8_t addr, uint16_t baseline)
+{
+  return (SLOT_TAG << 24) | ((uint32_t)addr << 16) | baseline;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set up the save schedule. Saving starts after the warm-up period.
+ ******************************************************************************/
+void BASELINE_Init(uint32_t now)
+{
+  unsigned int i;
+
+  for (i = 0; i < SENSOR_SLOTS; i++) {
+    nextSave[i] = now + BASELINE_WARMUP_S;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Find the newest stored baseline of a sensor.
+ *
+ * @return
+ *   True when a baseline was found.
+ ******************************************************************************/
+bool BASELINE_Load(uint8_t addr, uint16_t *baseline)
+{
+  const uint32_t *page;
+  unsigned int i;
+  uint32_t sequence;
+  uint8_t slotAddr;
+  uint16_t value;
+  bool found = false;
+
+  i = activePage(&sequence);
+  if (i == FLASHMAP_BASELINE_PAGES) {
+    return false;
+  }
+  page = pageAt(i);
+  for (i = 1; i < SLOT_COUNT; i++) {
+    if (page[i * SLOT_WORDS] == SLOT_ERASED) {
+      break;
+    }
+    if (slotValid(&page[i * SLOT_WORDS], &slotAddr, &value) && (slotAddr == addr)) {
+      *baseline = value;
+      found = true;
+    }
+  }
+  return found;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Store a baseline unless it equals the newest stored value.
+ *
+ * @return
+ *   False when programming the flash failed.
+ ******************************************************************************/
+bool BASELINE_Store(uint8_t addr, uint16_t baseline)
+{
+  uint16_t latest[SENSOR_SLOTS];
+  bool have[SENSOR_SLOTS];
+  uint32_t *page;
+  uint32_t sequence;
+  uint16_t stored;
+  unsigned int active;
+  unsigned int slot;
+  unsigned int i;
+  bool ok = true;
+
+  if (BASELINE_Load(addr, &stored) && (stored == baseline)) {
+    return true;
+  }
+
+  MSC_Init();
+  active = activePage(&sequence);
+  slot = (active < FLASHMAP_BASELINE_PAGES) ? firstFreeSlot(pageAt(active)) : SLOT_COUNT;
+  if (slot < SLOT_COUNT) {
+    ok = writeSlot(pageAt(active), slot, slotWord(addr, baseline));
+  } else {
+    // Page full or none yet. The other page gets the newest value of every
+    // sensor and then its header, the full page stays until that is done.
+    have[0] = BASELINE_Load(CCS811_I2C_ADDR_LOW, &latest[0]);
+    have[1] = BASELINE_Load(CCS811_I2C_ADDR_HIGH, &latest[1]);
+    have[sensorIndex(addr)] = true;
+    latest[sensorIndex(addr)] = baseline;
+
+    page = pageAt((active == 0) ? 1 : 0);
+    if (!pageErased(page)) {
+      ok = (MSC_ErasePage(page) == mscReturnOk);
+    }
+    slot = 1;
+    for (i = 0; ok && (i < SENSOR_SLOTS); i++) {
+      if (have[i]) {
+        ok = writeSlot(page, slot++,
+                       slotWord(i ? CCS811_I2C_ADDR_HIGH : CCS811_I2C_ADDR_LOW, latest[i]));
+      }
+    }
+    if (ok) {
+      ok = writeSlot(page, 0, (PAGE_TAG << 24) | ((sequence + 1) & SEQUENCE_MASK));
+    }
+    if (ok && (active < FLASHMAP_BASELINE_PAGES)) {
+      ok = (MSC_ErasePage(pageAt(active)) == mscReturnOk);
+    }
+  }
+  MSC_Deinit();
+
+  return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write the stored baseline back into a freshly started sensor.
+ *
+ * @details
+ *   Skipped on a warm start, the sensor then still holds its own baseline.
+ *
+ * @return
+ *   True when the sensor now runs with a restored baseline.
+ ******************************************************************************/
+bool BASELINE_Restore(CCS811_Handle_TypeDef *dev)
+{
+  uint16_t baseline;
+
+  if (dev->warmStart) {
+    return true;
+  }
+  if (!BASELINE_Load(dev->addr, &baseline)) {
+    return false;
+  }
+  return CCS811_SetBaseline(dev, baseline) == CCS811_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Save the baseline of a sensor when its save interval has passed.
+ *
+ * @details
+ *   Costs a single comparison until a save is due, then one I2C read and a
+ *   flash write only when the baseline has changed.
+ ******************************************************************************/
+void BASELINE_Service(CCS811_Handle_TypeDef *dev, uint32_t now)
+{
+  unsigned int index = sensorIndex(dev->addr);
+  uint16_t baseline;
+
+  if ((int32_t)(now - nextSave[index]) < 0) {
+    return;
+  }
+  // Stays on the grid of the first save, a caller that runs late does not
+  // push the next one out
+  do {
+    nextSave[index] += BASELINE_SAVE_INTERVAL_S;
+  } while ((int32_t)(now - nextSave[index]) >= 0);
+
+  if (CCS811_GetBaseline(dev, &baseline) == CCS811_OK) {
+    BASELINE_Store(dev->addr, baseline);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Save the baseline of a sensor right away, e.g. before its supply is
+ *   removed.
+ *
+ * @return
+ *   True when the current baseline is in flash.
+ ******************************************************************************/
+bool BASELINE_Save(CCS811_Handle_TypeDef *dev)
+{
+  uint16_t baseline;
+
+  if (CCS811_GetBaseline(dev, &baseline) != CCS811_OK) {
+    return false;
+  }
+  return BASELINE_Store(dev->addr, baseline);
+}
+
+/** @} (end group BASELINE) */
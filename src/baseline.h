@@ -0,0 +1,40 @@
+/***************************************************************************//**
+ * @file baseline.h
+ * @brief Persistence of the CCS811 baseline in internal flash.
+ ******************************************************************************/
+
+#ifndef BASELINE_H
+#define BASELINE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ccs811.h"
+
+/***************************************************************************//**
+ * @addtogroup BASELINE
+ * @brief Wear leveled baseline store, restored after APP_START
+ * @{
+ ******************************************************************************/
+
+#ifndef BASELINE_WARMUP_S
+#define BASELINE_WARMUP_S         1200   /**< Run time before the first save [s] */
+#endif
+
+#ifndef BASELINE_SAVE_INTERVAL_S
+#define BASELINE_SAVE_INTERVAL_S  3600   /**< Time between saves [s]             */
+#endif
+
+#ifndef BASELINE_SAVE_SLACK_S
+#define BASELINE_SAVE_SLACK_S     300    /**< How late a save may be to share a wakeup [s] */
+#endif
+
+void BASELINE_Init(uint32_t now);
+bool BASELINE_Load(uint8_t addr, uint16_t *baseline);
+bool BASELINE_Store(uint8_t addr, uint16_t baseline);
+bool BASELINE_Restore(CCS811_Handle_TypeDef *dev);
+void BASELINE_Service(CCS811_Handle_TypeDef *dev, uint32_t now);
+bool BASELINE_Save(CCS811_Handle_TypeDef *dev);
+
+/** @} (end group BASELINE) */
+
+#endif /* BASELINE_H */
@@ -0,0 +1,351 @@
+/***************************************************************************//**
+ * @file bench.c
+ * @brief Scripted on-target benchmark with machine readable results.
+ *
+ * @details
+ *   The script is a const table of scenarios, each a drive mode for every
+ *   sensor and a window length. A scenario sets its mode through the fixed
+ *   cadence policy, clears the PERF statistics and leaves the application
+ *   running undisturbed for the window. At the end of the window its PERF
+ *   figures are taken. Then the I2C throughput test runs
+ *   BENCH_I2C_TRANSFERS transfers of each BENCH_Transfer_TypeDef back to
+ *   back on the first sensor, boosted like the result reads. The next
+ *   scenario starts once the report is queued. After the last one the
+ *   application keeps running in that mode.
+ *
+ *   Reports go out as telemFrameBench frames. A payload holds
+ *   BENCH_FORMAT_VERSION, the scenario index, its drive mode and the record
+ *   count (u8 each). Each record follows as the BENCH_Metric_TypeDef and an
+ *   index (u8 each) and a value (u32), little endian. A report takes as
+ *   many frames as it needs. Every record is keyed by scenario, metric and
+ *   index, so a host needs no state across frames. While the telemetry
+ *   buffer is full the rest of a report waits BENCH_RETRY_MS at a time.
+ *
+ *   Latencies and throughput are timed on the RTC, cycles on SysTick, see
+ *   PERF. The sensors keep sampling during the throughput test, a result
+ *   that becomes ready then is consumed by its ALG_RESULT_DATA reads. The
+ *   next window only starts after the test.
+ ******************************************************************************/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "em_cmu.h"
+#include "clockmgr.h"
+#include "perf.h"
+#include "rtctimer.h"
+#include "telem.h"
+#include "bench.h"
+
+#if BENCH_ENABLE
+
+/***************************************************************************//**
+ * @addtogroup BENCH
+ * @{
+ ******************************************************************************/
+
+#if !PERF_ENABLE
+#error "The benchmark reports the PERF statistics, PERF_ENABLE must be set"
+#endif
+
+/* Version, scenario, drive mode and record count. */
+#define HEADER_SIZE       4
+/* Metric, index and a u32 value. */
+#define RECORD_SIZE       6
+/* 50 %RH and 25 degC, the power-on value of ENV_DATA. */
+#define ENV_DATA_DEFAULT  0x6400
+
+#if HEADER_SIZE + BENCH_RECORDS_PER_FRAME * RECORD_SIZE > TELEM_PAYLOAD_MAX
+#error "BENCH_RECORDS_PER_FRAME records do not fit in TELEM_PAYLOAD_MAX"
+#endif
+
+typedef struct {
+  uint8_t  metric;
+  uint8_t  index;
+  uint32_t value;
+} Record_TypeDef;
+
+static const BENCH_Scenario_TypeDef *script;
+static CCS811_Handle_TypeDef *devs;
+static DRIVEMODE_Handle_TypeDef *cadence;
+static uint8_t devCount;
+static SCHED_Task_TypeDef *policy;
+static SCHED_Task_TypeDef task;
+static uint8_t scenario;        /* Script index of the running scenario    */
+static uint32_t windowStart;    /* RTC ticks when its window started       */
+static bool reporting;          /* Records of the window wait to be sent   */
+static Record_TypeDef records[BENCH_RECORDS_MAX];
+static uint8_t recordCount;
+static uint8_t recordsSent;
+
+/***************************************************************************//**
+ * @brief
+ *   Add a record to the report, records beyond BENCH_RECORDS_MAX are lost.
+ ******************************************************************************/
+static void add(BENCH_Metric_TypeDef metric, uint8_t index, uint32_t value)
+{
+  if (recordCount < BENCH_RECORDS_MAX) {
+    records[recordCount].metric = (uint8_t)metric;
+    records[recordCount].index = index;
+    records[recordCount].value = value;
+    recordCount++;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Convert RTC ticks to microseconds.
+ ******************************************************************************/
+static uint32_t ticksToUs(uint64_t ticks)
+{
+  return (uint32_t)(ticks * 1000000U / RTCTIMER_FREQ);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add the PERF figures of the window that just ended.
+ ******************************************************************************/
+static void reportWindow(void)
+{
+  PERF_Stats_TypeDef stats;
+  unsigned int i;
+
+  PERF_Snapshot(&stats);
+  add(benchMetricWindowMs, 0, RTCTIMER_TicksToMs(RTCTIMER_GetTicks() - windowStart));
+  add(benchMetricBootMs, 0, RTCTIMER_TicksToMs(stats.bootTicks));
+  add(benchMetricResults, 0, stats.results);
+  add(benchMetricLatencyMeanUs, 0,
+      (stats.results != 0) ? ticksToUs(stats.resultLatencyTotal) / stats.results : 0);
+  add(benchMetricLatencyMaxUs, 0, ticksToUs(stats.resultLatencyMax));
+  add(benchMetricWakeups, 0, stats.wakeups);
+  for (i = 0; i < perfModeCount; i++) {
+    add(benchMetricModeMs, (uint8_t)i, RTCTIMER_TicksToMs(stats.modeTicks[i]));
+  }
+  for (i = 0; i < perfPhaseCount; i++) {
+    const PERF_Phase_Stats_TypeDef *phase = &stats.phase[i];
+
+    add(benchMetricPhaseCount, (uint8_t)i, phase->count);
+    add(benchMetricPhaseMeanCycles, (uint8_t)i,
+        (phase->count != 0) ? phase->totalCycles / phase->count : 0);
+    add(benchMetricPhaseMaxCycles, (uint8_t)i, phase->maxCycles);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run one transfer of a type through the driver.
+ ******************************************************************************/
+static uint32_t transfer(CCS811_Handle_TypeDef *dev, BENCH_Transfer_TypeDef type)
+{
+  uint8_t buf[CCS811_ALG_RESULT_DATA_LENGTH];
+  uint16_t humidity = dev->envDataValid ? dev->humidity : ENV_DATA_DEFAULT;
+  uint16_t temperature = dev->envDataValid ? dev->temperature : ENV_DATA_DEFAULT;
+
+  switch (type) {
+    case benchTransferStatus:
+      return CCS811_ReadMailbox(dev, CCS811_ADDR_STATUS, 1, buf);
+    case benchTransferAlgResult:
+      return CCS811_ReadMailbox(dev, CCS811_ADDR_ALG_RESULT_DATA,
+                                CCS811_ALG_RESULT_DATA_LENGTH, buf);
+    case benchTransferRawData:
+      return CCS811_ReadMailbox(dev, CCS811_ADDR_RAW_DATA, CCS811_RAW_DATA_LENGTH, buf);
+    default:
+      // The values the part already holds, the write changes nothing
+      buf[0] = (uint8_t)(humidity >> 8);
+      buf[1] = (uint8_t)humidity;
+      buf[2] = (uint8_t)(temperature >> 8);
+      buf[3] = (uint8_t)temperature;
+      return CCS811_WriteMailbox(dev, CCS811_ADDR_ENV_DATA, CCS811_ENV_DATA_LENGTH, buf);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time BENCH_I2C_TRANSFERS transfers of each type on the first running
+ *   sensor and add their rates.
+ ******************************************************************************/
+static void reportI2C(void)
+{
+  CCS811_Handle_TypeDef *dev = NULL;
+  unsigned int i;
+  unsigned int n;
+
+  for (i = 0; (i < devCount) && (dev == NULL); i++) {
+    if (devs[i].appMode) {
+      dev = &devs[i];
+    }
+  }
+  if (dev == NULL) {
+    return;
+  }
+
+  CLOCKMGR_Boost();
+  add(benchMetricI2CCoreHz, 0, CMU_ClockFreqGet(cmuClock_CORE));
+  for (i = 0; i < benchTransferCount; i++) {
+    uint32_t cycles = PERF_Stats.phase[perfPhaseI2C].totalCycles;
+    uint32_t start = RTCTIMER_GetTicks();
+    uint32_t errors = 0;
+    uint32_t ticks;
+
+    for (n = 0; n < BENCH_I2C_TRANSFERS; n++) {
+      if (transfer(dev, (BENCH_Transfer_TypeDef)i) != CCS811_OK) {
+        errors++;
+      }
+    }
+    ticks = RTCTIMER_GetTicks() - start;
+    cycles = PERF_Stats.phase[perfPhaseI2C].totalCycles - cycles;
+
+    add(benchMetricI2CRate, (uint8_t)i,
+        (ticks != 0) ? (uint32_t)BENCH_I2C_TRANSFERS * RTCTIMER_FREQ / ticks : 0);
+    add(benchMetricI2CCycles, (uint8_t)i, cycles / BENCH_I2C_TRANSFERS);
+    add(benchMetricI2CErrors, (uint8_t)i, errors);
+  }
+  CLOCKMGR_Unboost();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Queue the records not sent yet, as many frames as the buffer takes.
+ *
+ * @return
+ *   True once the whole report is queued.
+ ******************************************************************************/
+static bool send(void)
+{
+  uint8_t payload[HEADER_SIZE + BENCH_RECORDS_PER_FRAME * RECORD_SIZE];
+
+  while (recordsSent < recordCount) {
+    uint8_t n = recordCount - recordsSent;
+    uint8_t *p = payload;
+    uint8_t i;
+
+    if (!TELEM_HasRoom(1)) {
+      return false;
+    }
+    if (n > BENCH_RECORDS_PER_FRAME) {
+      n = BENCH_RECORDS_PER_FRAME;
+    }
+    *p++ = BENCH_FORMAT_VERSION;
+    *p++ = scenario;
+    *p++ = script[scenario].driveMode;
+    *p++ = n;
+    for (i = 0; i < n; i++) {
+      const Record_TypeDef *r = &records[recordsSent + i];
+
+      *p++ = r->metric;
+      *p++ = r->index;
+      *p++ = (uint8_t)r->value;
+      *p++ = (uint8_t)(r->value >> 8);
+      *p++ = (uint8_t)(r->value >> 16);
+      *p++ = (uint8_t)(r->value >> 24);
+    }
+    if (TELEM_SendFrame(telemFrameBench, payload, (uint16_t)(p - payload)) != TELEM_OK) {
+      return false;
+    }
+    recordsSent += n;
+  }
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the window of the current scenario.
+ ******************************************************************************/
+static void begin(void)
+{
+  const BENCH_Scenario_TypeDef *s = &script[scenario];
+  uint32_t now = RTCTIMER_GetSeconds();
+  unsigned int i;
+
+  // The policy task writes the mode, unchanged modes cost no bus traffic
+  for (i = 0; i < devCount; i++) {
+    DRIVEMODE_Init(&cadence[i], drivemodePolicyFixed, s->driveMode, now);
+  }
+  SCHED_Signal(policy, RTCTIMER_GetTicks());
+
+  PERF_Restart();
+  windowStart = RTCTIMER_GetTicks();
+  SCHED_Start(&task, (uint32_t)s->seconds * 1000, 0, 0);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Benchmark task, runs at the end of each window and while its report
+ *   waits for the telemetry buffer.
+ ******************************************************************************/
+static void run(SCHED_Task_TypeDef *t)
+{
+  bool last = (script[scenario + 1].seconds == 0);
+
+  if (!reporting) {
+    recordCount = 0;
+    recordsSent = 0;
+    reportWindow();
+    reportI2C();
+    if (last) {
+      add(benchMetricEnd, 0, scenario + 1U);
+    }
+    reporting = true;
+  }
+  if (!send()) {
+    SCHED_Start(t, BENCH_RETRY_MS, 0, 0);
+    return;
+  }
+  reporting = false;
+
+  if (last) {
+    return;
+  }
+  scenario++;
+  begin();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Prepare the benchmark and add its task behind the existing ones, call
+ *   after SCHED_Init(). The reports need TELEM initialized.
+ *
+ * @param[in] steps
+ *   Script, ended by BENCH_SCENARIO_END and kept by reference
+ *
+ * @param[in] sensors
+ *   Sensors benchmarked, the first running one takes the I2C test
+ *
+ * @param[in] policies
+ *   Cadence policy of each sensor, set to the fixed mode of each scenario
+ *
+ * @param[in] count
+ *   Number of sensors
+ *
+ * @param[in] policyTask
+ *   Task that applies the policies to the sensors
+ ******************************************************************************/
+void BENCH_Init(const BENCH_Scenario_TypeDef *steps, CCS811_Handle_TypeDef *sensors,
+                DRIVEMODE_Handle_TypeDef *policies, uint8_t count,
+                SCHED_Task_TypeDef *policyTask)
+{
+  script = steps;
+  devs = sensors;
+  cadence = policies;
+  devCount = count;
+  policy = policyTask;
+  scenario = 0;
+  reporting = false;
+  SCHED_Add(&task, run, NULL);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the first scenario, once the sensors have been started.
+ ******************************************************************************/
+void BENCH_Start(void)
+{
+  scenario = 0;
+  reporting = false;
+  if (script[0].seconds != 0) {
+    begin();
+  }
+}
+
+/** @} (end group BENCH) */
+
+#endif /* BENCH_ENABLE */
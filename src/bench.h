@@ -0,0 +1,84 @@
+/***************************************************************************//**
+ * @file bench.h
+ * @brief Scripted on-target benchmark with machine readable results.
+ ******************************************************************************/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include "ccs811.h"
+#include "drivemode.h"
+#include "sched.h"
+
+/***************************************************************************//**
+ * @addtogroup BENCH
+ * @brief Run the sensors through a script of drive modes and report PERF
+ *        figures of every step as telemetry frames
+ * @{
+ ******************************************************************************/
+
+#ifndef BENCH_ENABLE
+#define BENCH_ENABLE            0     /**< Benchmark profile, 1 in the bench configuration */
+#endif
+
+#ifndef BENCH_I2C_TRANSFERS
+#define BENCH_I2C_TRANSFERS     200   /**< Transfers of each type timed per scenario      */
+#endif
+
+#ifndef BENCH_RETRY_MS
+#define BENCH_RETRY_MS          250   /**< Wait for room in the telemetry buffer [ms]    */
+#endif
+
+#define BENCH_FORMAT_VERSION    1     /**< First payload byte, bumped on layout changes  */
+#define BENCH_RECORDS_PER_FRAME 16    /**< Records in one bench frame                    */
+#define BENCH_RECORDS_MAX       48    /**< Records one scenario reports                  */
+
+/** One step of the script, ended by BENCH_SCENARIO_END. */
+typedef struct {
+  uint8_t  driveMode;       /**< CCS811_MEASURE_MODE_DRIVE_MODE_* of every sensor */
+  uint16_t seconds;         /**< Length of the measurement window [s]            */
+} BENCH_Scenario_TypeDef;
+
+/** Script step running every sensor in a drive mode for a number of seconds. */
+#define BENCH_SCENARIO(mode, s)   { (mode), (s) }
+/** End of a script. */
+#define BENCH_SCENARIO_END        { 0, 0 }
+
+/** Metric ids, the first byte of every record. Values are u32. */
+typedef enum {
+  benchMetricEnd,             /**< Last record of the script, value: scenarios run     */
+  benchMetricWindowMs,        /**< Length of the measurement window [ms]               */
+  benchMetricBootMs,          /**< Reset to the first sample [ms]                      */
+  benchMetricResults,         /**< nINT wakeups that produced a result                 */
+  benchMetricLatencyMeanUs,   /**< nINT edge to result available, mean [us]            */
+  benchMetricLatencyMaxUs,    /**< nINT edge to result available, longest [us]         */
+  benchMetricWakeups,         /**< Wakeups from EM2 and EM3                            */
+  benchMetricModeMs,          /**< Residency, index: PERF_Mode_TypeDef [ms]            */
+  benchMetricPhaseCount,      /**< Runs of a phase, index: PERF_Phase_TypeDef          */
+  benchMetricPhaseMeanCycles, /**< Mean core cycles of a phase                         */
+  benchMetricPhaseMaxCycles,  /**< Longest run of a phase [cycles]                     */
+  benchMetricI2CRate,         /**< Transfers per second, index: BENCH_Transfer_TypeDef */
+  benchMetricI2CCycles,       /**< Mean core cycles per transfer                       */
+  benchMetricI2CErrors,       /**< Failed transfers                                    */
+  benchMetricI2CCoreHz,       /**< Core clock while the transfers ran [Hz]             */
+  benchMetricCount
+} BENCH_Metric_TypeDef;
+
+/** Transfer types of the I2C throughput test, as the driver issues them. */
+typedef enum {
+  benchTransferStatus,      /**< STATUS, write address then read 1 byte          */
+  benchTransferAlgResult,   /**< ALG_RESULT_DATA, write address then read 8 bytes */
+  benchTransferRawData,     /**< RAW_DATA, write address then read 2 bytes       */
+  benchTransferEnvData,     /**< ENV_DATA, write address and 4 bytes             */
+  benchTransferCount
+} BENCH_Transfer_TypeDef;
+
+void BENCH_Init(const BENCH_Scenario_TypeDef *steps, CCS811_Handle_TypeDef *sensors,
+                DRIVEMODE_Handle_TypeDef *policies, uint8_t count,
+                SCHED_Task_TypeDef *policyTask);
+void BENCH_Start(void);
+
+/** @} (end group BENCH) */
+
+#endif /* BENCH_H */
@@ -0,0 +1,810 @@
+/***************************************************************************//**
+ * @file ccs811.c
+ * @brief Driver for the CCS811 air quality sensor.
+ *
+ * @details
+ *   All state lives in a caller allocated CCS811_Handle_TypeDef, so several
+ *   sensors can share a bus. Register writes that would not change the
+ *   cached device configuration are skipped.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include <string.h>
+#include "em_assert.h"
+#include "i2cint.h"
+#include "rtctimer.h"
+#include "ccs811.h"
+
+/***************************************************************************//**
+ * @addtogroup CCS811
+ * @{
+ ******************************************************************************/
+
+/* FW_PROGRAM start to start gap of the next update [RTC ticks]. */
+static uint32_t fwChunkGap = CCS811_FW_CHUNK_GAP_TICKS;
+
+/***************************************************************************//**
+ * @brief
+ *   Prepare a device handle. Does not touch the bus.
+ *
+ * @param[out] dev
+ *   Handle to initialize
+ *
+ * @param[in] i2c
+ *   Bus the sensor is attached to
+ *
+ * @param[in] addr
+ *   CCS811_I2C_ADDR_LOW or CCS811_I2C_ADDR_HIGH
+ ******************************************************************************/
+void CCS811_Init(CCS811_Handle_TypeDef *dev, I2C_TypeDef *i2c, uint8_t addr)
+{
+  EFM_ASSERT(dev != NULL);
+
+  dev->i2c = i2c;
+  dev->addr = addr;
+  dev->appMode = false;
+  dev->warmStart = false;
+  dev->measureModeValid = false;
+  dev->measureMode = CCS811_MEASURE_MODE_DRIVE_MODE_IDLE;
+  dev->status = 0;
+  dev->errorId = 0;
+  dev->thresholdsValid = false;
+  dev->envDataValid = false;
+  dev->wakeUsed = false;
+  dev->wakeDepth = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Hand the nWAKE line of the sensor to the driver.
+ *
+ * @details
+ *   From then on the I2C interface of the part is only awake during driver
+ *   transactions. Without this call nWAKE must be tied low on the board.
+ ******************************************************************************/
+void CCS811_SetWakePin(CCS811_Handle_TypeDef *dev, GPIO_Port_TypeDef port, uint8_t pin)
+{
+  dev->wakePort = port;
+  dev->wakePin = pin;
+  dev->wakeUsed = true;
+  dev->wakeDepth = 0;
+  dev->wakeReleased = RTCTIMER_GetTicks() - CCS811_WAKE_RELEASE_TICKS;
+  GPIO_PinModeSet(port, pin, gpioModePushPull, 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wait until at least ticks RTC ticks have passed since start.
+ *
+ * @details
+ *   Busy waits, the setup times are far below the cost of arming a timer.
+ *   A tick may already be partly over at start, hence the extra tick, so
+ *   one tick guarantees 30.5 us.
+ ******************************************************************************/
+static void waitTicks(uint32_t start, uint32_t ticks)
+{
+  while (RTCTIMER_GetTicks() - start < ticks + 1) {
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Assert nWAKE and wait the setup time. Calls nest, so a sequence of
+ *   transactions can keep the interface awake in between.
+ ******************************************************************************/
+void CCS811_WakeBegin(CCS811_Handle_TypeDef *dev)
+{
+  if (!dev->wakeUsed || (dev->wakeDepth++ > 0)) {
+    return;
+  }
+  waitTicks(dev->wakeReleased, CCS811_WAKE_RELEASE_TICKS);
+  GPIO_PinOutClear(dev->wakePort, dev->wakePin);
+  waitTicks(RTCTIMER_GetTicks(), CCS811_WAKE_SETUP_TICKS);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Release nWAKE once the outermost CCS811_WakeBegin() has ended.
+ ******************************************************************************/
+void CCS811_WakeEnd(CCS811_Handle_TypeDef *dev)
+{
+  if (!dev->wakeUsed || (dev->wakeDepth == 0) || (--dev->wakeDepth > 0)) {
+    return;
+  }
+  GPIO_PinOutSet(dev->wakePort, dev->wakePin);
+  dev->wakeReleased = RTCTIMER_GetTicks();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Drop the cached register values, the part is restarting.
+ ******************************************************************************/
+static void forget(CCS811_Handle_TypeDef *dev)
+{
+  dev->appMode = false;
+  dev->warmStart = false;
+  dev->measureModeValid = false;
+  dev->thresholdsValid = false;
+  dev->envDataValid = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Forget all device state before the supply of the part is removed.
+ *
+ * @details
+ *   nWAKE is parked low so the unpowered part is not fed through its
+ *   input. CCS811_Start() boots the part again once it is powered.
+ ******************************************************************************/
+void CCS811_PowerOff(CCS811_Handle_TypeDef *dev)
+{
+  forget(dev);
+  if (dev->wakeUsed) {
+    dev->wakeDepth = 0;
+    GPIO_PinOutClear(dev->wakePort, dev->wakePin);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run a prepared transfer and map the result to a driver status code.
+ *
+ * @details
+ *   Every transfer is time bounded. A timeout, bus error or lost
+ *   arbitration means the bus may be held by a confused slave, so it is
+ *   recovered before the transfer is retried. A NACK is retried as is.
+ *   nWAKE is held low across all attempts.
+ ******************************************************************************/
+static uint32_t transfer(CCS811_Handle_TypeDef *dev, I2C_TransferSeq_TypeDef *seq)
+{
+  I2C_TransferReturn_TypeDef ret;
+  int attempt;
+
+  CCS811_WakeBegin(dev);
+  for (attempt = 0; attempt <= CCS811_I2C_RETRIES; attempt++) {
+    ret = I2CINT_Transfer(dev->i2c, seq);
+    if (ret == i2cTransferDone) {
+      break;
+    }
+    if (ret != i2cTransferNack) {
+      I2CINT_BusRecover(dev->i2c);
+    }
+  }
+  CCS811_WakeEnd(dev);
+  return (ret == i2cTransferDone) ? CCS811_OK : CCS811_ERROR_I2C_TRANSACTION_FAILED;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read a register of the given length.
+ ******************************************************************************/
+uint32_t CCS811_ReadMailbox(CCS811_Handle_TypeDef *dev, uint8_t id,
+                            uint8_t length, uint8_t *data)
+{
+  I2C_TransferSeq_TypeDef i2cTransfer;
+
+  I2CINT_SeqWriteRead(&i2cTransfer, dev->addr, &id, 1, data, length);
+  return transfer(dev, &i2cTransfer);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write a register of the given length.
+ *
+ * @details
+ *   The register address and payload go out in a single START...STOP,
+ *   straight from the caller's buffer.
+ ******************************************************************************/
+uint32_t CCS811_WriteMailbox(CCS811_Handle_TypeDef *dev, uint8_t id,
+                             uint8_t length, uint8_t *data)
+{
+  I2C_TransferSeq_TypeDef i2cTransfer;
+
+  I2CINT_SeqWrite(&i2cTransfer, dev->addr, &id, 1, data, length);
+  return transfer(dev, &i2cTransfer);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write a single byte register.
+ ******************************************************************************/
+uint32_t CCS811_WriteRegister(CCS811_Handle_TypeDef *dev, uint8_t id, uint8_t data)
+{
+  return CCS811_WriteMailbox(dev, id, 1, &data);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write a register address without data, used for commands like APP_START.
+ ******************************************************************************/
+uint32_t CCS811_SendCommand(CCS811_Handle_TypeDef *dev, uint8_t id)
+{
+  return CCS811_WriteMailbox(dev, id, 0, NULL);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Poll STATUS with short low energy naps until all bits in mask are set.
+ ******************************************************************************/
+static uint32_t waitStatus(CCS811_Handle_TypeDef *dev, uint8_t mask,
+                           uint32_t napMs, uint32_t timeoutMs)
+{
+  uint32_t start = RTCTIMER_GetTicks();
+  uint32_t timeout = RTCTIMER_MsToTicks(timeoutMs);
+  uint32_t status;
+
+  while (1) {
+    status = CCS811_ReadMailbox(dev, CCS811_ADDR_STATUS, 1, &dev->status);
+    if ((status == CCS811_OK) && ((dev->status & mask) == mask)) {
+      return CCS811_OK;
+    }
+    if (RTCTIMER_GetTicks() - start >= timeout) {
+      return (status == CCS811_OK) ? CCS811_ERROR_INIT_FAILED : status;
+    }
+    RTCTIMER_Delay(napMs);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Wait until the part answers after power-on or reset, check its HW_ID
+ *   and read STATUS.
+ ******************************************************************************/
+static uint32_t waitBoot(CCS811_Handle_TypeDef *dev)
+{
+  uint32_t start = RTCTIMER_GetTicks();
+  uint32_t timeout = RTCTIMER_MsToTicks(CCS811_BOOT_TIMEOUT_MS);
+  uint8_t data;
+
+  while (CCS811_ReadMailbox(dev, CCS811_ADDR_HW_ID, 1, &data) != CCS811_OK) {
+    if (RTCTIMER_GetTicks() - start >= timeout) {
+      return CCS811_ERROR_I2C_TRANSACTION_FAILED;
+    }
+    RTCTIMER_Delay(CCS811_BOOT_POLL_MS);
+  }
+  if (data != CCS811_HW_ID) {
+    return CCS811_ERROR_INIT_FAILED;
+  }
+  return CCS811_ReadMailbox(dev, CCS811_ADDR_STATUS, 1, &dev->status);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Bring the part into application mode, doing only the steps its STATUS
+ *   says are still needed.
+ *
+ * @details
+ *   After a warm MCU reset the sensor is usually still running its
+ *   application, then verify and start are skipped and the current
+ *   MEASURE_MODE is read back into the cache. Otherwise the firmware is
+ *   verified if needed and started, waiting on the STATUS bits with short
+ *   naps instead of worst case delays. A part started here holds the
+ *   power-on MEASURE_MODE and THRESHOLDS, the cache is set to them.
+ ******************************************************************************/
+uint32_t CCS811_Start(CCS811_Handle_TypeDef *dev)
+{
+  uint32_t status;
+
+  forget(dev);
+
+  if (dev->wakeUsed) {
+    // Unpark nWAKE after a power off
+    dev->wakeDepth = 0;
+    GPIO_PinOutSet(dev->wakePort, dev->wakePin);
+    dev->wakeReleased = RTCTIMER_GetTicks();
+  }
+
+  status = waitBoot(dev);
+  if (status != CCS811_OK) {
+    return status;
+  }
+
+  if (dev->status & CCS811_STATUS_FW_MODE) {
+    // Warm start, the application kept running
+    dev->appMode = true;
+    dev->warmStart = true;
+    if (CCS811_ReadMailbox(dev, CCS811_ADDR_MEASURE_MODE, 1, &dev->measureMode)
+        == CCS811_OK) {
+      dev->measureModeValid = true;
+    }
+    return CCS811_OK;
+  }
+
+  if (!(dev->status & CCS811_STATUS_APP_VALID)) {
+    status = CCS811_SendCommand(dev, CCS811_ADDR_FW_VERIFY);
+    if (status == CCS811_OK) {
+      status = waitStatus(dev, CCS811_STATUS_APP_VALID,
+                          CCS811_VERIFY_POLL_MS, CCS811_VERIFY_TIMEOUT_MS);
+    }
+    if (status != CCS811_OK) {
+      return (status == CCS811_ERROR_INIT_FAILED)
+             ? CCS811_ERROR_APPLICATION_NOT_PRESENT : status;
+    }
+  }
+
+  status = CCS811_SendCommand(dev, CCS811_ADDR_APP_START);
+  if (status == CCS811_OK) {
+    status = waitStatus(dev, CCS811_STATUS_FW_MODE,
+                        CCS811_BOOT_POLL_MS, CCS811_APP_START_TIMEOUT_MS);
+  }
+  if (status != CCS811_OK) {
+    return (status == CCS811_ERROR_INIT_FAILED)
+           ? CCS811_ERROR_NOT_IN_APPLICATION_MODE : status;
+  }
+
+  // Freshly started, the registers hold their power-on defaults
+  dev->appMode = true;
+  dev->measureModeValid = true;
+  dev->measureMode = CCS811_MEASURE_MODE_DRIVE_MODE_IDLE;
+  dev->thresholdsValid = true;
+  dev->lowToMed = CCS811_THRESHOLD_LOW_TO_MED_DEFAULT;
+  dev->medToHigh = CCS811_THRESHOLD_MED_TO_HIGH_DEFAULT;
+  dev->hysteresis = CCS811_THRESHOLD_HYSTERESIS_DEFAULT;
+  return CCS811_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set the drive mode and interrupt configuration.
+ *
+ * @details
+ *   The write is skipped when the part already runs with this mode.
+ ******************************************************************************/
+uint32_t CCS811_SetMeasureMode(CCS811_Handle_TypeDef *dev, uint8_t mode)
+{
+  uint32_t status;
+
+  if (!dev->appMode) {
+    return CCS811_ERROR_NOT_IN_APPLICATION_MODE;
+  }
+  if (dev->measureModeValid && (dev->measureMode == mode)) {
+    return CCS811_OK;
+  }
+
+  status = CCS811_WriteRegister(dev, CCS811_ADDR_MEASURE_MODE, mode);
+  dev->measureModeValid = (status == CCS811_OK);
+  dev->measureMode = mode;
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Program the eCO2 band boundaries used in threshold interrupt mode.
+ *
+ * @details
+ *   With CCS811_MEASURE_MODE_THRESH set, nINT is only asserted when a new
+ *   eCO2 result moves into a different band than the previous one. The
+ *   write is skipped when the part already holds these values.
+ *
+ * @param[in] dev
+ *   Device handle
+ *
+ * @param[in] lowToMed
+ *   Boundary between the low and medium band [ppm]
+ *
+ * @param[in] medToHigh
+ *   Boundary between the medium and high band [ppm]
+ *
+ * @param[in] hysteresis
+ *   Amount eCO2 must move past a boundary before the band changes [ppm]
+ ******************************************************************************/
+uint32_t CCS811_SetThresholds(CCS811_Handle_TypeDef *dev, uint16_t lowToMed,
+                              uint16_t medToHigh, uint8_t hysteresis)
+{
+  uint8_t buf[CCS811_THRESHOLDS_LENGTH];
+  uint32_t status;
+
+  if (!dev->appMode) {
+    return CCS811_ERROR_NOT_IN_APPLICATION_MODE;
+  }
+  if (dev->thresholdsValid
+      && (dev->lowToMed == lowToMed)
+      && (dev->medToHigh == medToHigh)
+      && (dev->hysteresis == hysteresis)) {
+    return CCS811_OK;
+  }
+
+  buf[0] = lowToMed >> 8;
+  buf[1] = lowToMed & 0xFF;
+  buf[2] = medToHigh >> 8;
+  buf[3] = medToHigh & 0xFF;
+  buf[4] = hysteresis;
+
+  status = CCS811_WriteMailbox(dev, CCS811_ADDR_THRESHOLDS, sizeof(buf), buf);
+  dev->thresholdsValid = (status == CCS811_OK);
+  dev->lowToMed = lowToMed;
+  dev->medToHigh = medToHigh;
+  dev->hysteresis = hysteresis;
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write the ambient conditions used for compensation.
+ *
+ * @details
+ *   Both values are in the ENV_DATA register format, 1/512 units. The write
+ *   is skipped when the part already holds these values.
+ *
+ * @param[in] dev
+ *   Device handle
+ *
+ * @param[in] humidity
+ *   Relative humidity in 1/512 %RH
+ *
+ * @param[in] temperature
+ *   Temperature plus 25 degC in 1/512 degC
+ ******************************************************************************/
+uint32_t CCS811_SetEnvData(CCS811_Handle_TypeDef *dev, uint16_t humidity,
+                           uint16_t temperature)
+{
+  uint8_t buf[CCS811_ENV_DATA_LENGTH];
+  uint32_t status;
+
+  if (!dev->appMode) {
+    return CCS811_ERROR_NOT_IN_APPLICATION_MODE;
+  }
+  if (dev->envDataValid
+      && (dev->humidity == humidity)
+      && (dev->temperature == temperature)) {
+    return CCS811_OK;
+  }
+
+  buf[0] = humidity >> 8;
+  buf[1] = humidity & 0xFF;
+  buf[2] = temperature >> 8;
+  buf[3] = temperature & 0xFF;
+
+  status = CCS811_WriteMailbox(dev, CCS811_ADDR_ENV_DATA, sizeof(buf), buf);
+  dev->envDataValid = (status == CCS811_OK);
+  dev->humidity = humidity;
+  dev->temperature = temperature;
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reset the part with SW_RESET. It comes back in boot mode with its
+ *   registers at their defaults, CCS811_Start() runs it again.
+ ******************************************************************************/
+uint32_t CCS811_Reset(CCS811_Handle_TypeDef *dev)
+{
+  static const uint8_t resetKey[4] = { 0x11, 0xE5, 0x72, 0x8A };
+  uint8_t key[4];
+
+  forget(dev);
+  memcpy(key, resetKey, sizeof(key));
+  return CCS811_WriteMailbox(dev, CCS811_ADDR_SW_RESET, sizeof(key), key);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read the algorithm baseline. The value is opaque, only meant to be
+ *   written back later with CCS811_SetBaseline().
+ ******************************************************************************/
+uint32_t CCS811_GetBaseline(CCS811_Handle_TypeDef *dev, uint16_t *baseline)
+{
+  uint8_t buf[2];
+  uint32_t status;
+
+  if (!dev->appMode) {
+    return CCS811_ERROR_NOT_IN_APPLICATION_MODE;
+  }
+  status = CCS811_ReadMailbox(dev, CCS811_ADDR_BASELINE, sizeof(buf), buf);
+  if (status == CCS811_OK) {
+    *baseline = (buf[0] << 8) | buf[1];
+  }
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Restore a baseline previously read with CCS811_GetBaseline().
+ ******************************************************************************/
+uint32_t CCS811_SetBaseline(CCS811_Handle_TypeDef *dev, uint16_t baseline)
+{
+  uint8_t buf[2];
+
+  if (!dev->appMode) {
+    return CCS811_ERROR_NOT_IN_APPLICATION_MODE;
+  }
+  buf[0] = baseline >> 8;
+  buf[1] = baseline & 0xFF;
+  return CCS811_WriteMailbox(dev, CCS811_ADDR_BASELINE, sizeof(buf), buf);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read eCO2, TVOC, status, error and raw data in one transaction.
+ ******************************************************************************/
+uint32_t CCS811_ReadAlgResult(CCS811_Handle_TypeDef *dev,
+                              CCS811_AlgResult_TypeDef *result)
+{
+  uint8_t buf[CCS811_ALG_RESULT_DATA_LENGTH];
+
+  if (CCS811_ReadMailbox(dev, CCS811_ADDR_ALG_RESULT_DATA, sizeof(buf), buf)
+      != CCS811_OK) {
+    return CCS811_ERROR_I2C_TRANSACTION_FAILED;
+  }
+
+  result->eco2    = (buf[0] << 8) | buf[1];
+  result->tvoc    = (buf[2] << 8) | buf[3];
+  result->status  = buf[4];
+  result->errorId = buf[5];
+  result->current = buf[6] >> 2;
+  result->rawAdc  = ((buf[6] & 0x03) << 8) | buf[7];
+
+  dev->status = result->status;
+  dev->errorId = result->errorId;
+  return CCS811_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read the RAW_DATA register, the only result updated in raw mode.
+ *
+ * @details
+ *   STATUS is read first and cached in the handle. RAW_DATA is only read
+ *   when DATA_READY is set, so a sensor that shares nINT but has no new
+ *   sample costs a single byte read. current and rawAdc are left untouched
+ *   in that case.
+ *
+ * @param[in] dev
+ *   Device handle
+ *
+ * @param[out] current
+ *   Current through the sensor [uA]
+ *
+ * @param[out] rawAdc
+ *   Voltage across the sensor, 1023 = 1.65 V
+ ******************************************************************************/
+uint32_t CCS811_ReadRawData(CCS811_Handle_TypeDef *dev, uint8_t *current,
+                            uint16_t *rawAdc)
+{
+  uint8_t buf[CCS811_RAW_DATA_LENGTH];
+
+  if (CCS811_ReadMailbox(dev, CCS811_ADDR_STATUS, 1, &dev->status) != CCS811_OK) {
+    return CCS811_ERROR_I2C_TRANSACTION_FAILED;
+  }
+  if (!(dev->status & CCS811_STATUS_DATA_READY)) {
+    return CCS811_OK;
+  }
+  if (CCS811_ReadMailbox(dev, CCS811_ADDR_RAW_DATA, sizeof(buf), buf)
+      != CCS811_OK) {
+    return CCS811_ERROR_I2C_TRANSACTION_FAILED;
+  }
+
+  *current = buf[0] >> 2;
+  *rawAdc  = ((buf[0] & 0x03) << 8) | buf[1];
+  return CCS811_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run a const table of register writes and commands, up to its
+ *   CCS811_STEP_END.
+ *
+ * @details
+ *   Writes to MEASURE_MODE, THRESHOLDS and ENV_DATA go through their
+ *   setters, so the handle cache stays in step with the part and a value
+ *   it already holds is not written again. Tables are meant to be built
+ *   from build time configuration, where steps that would only write a
+ *   power-on default are left out by the preprocessor.
+ *
+ * @return
+ *   CCS811_OK, or the status of the first step that failed. The steps
+ *   after it are not run.
+ ******************************************************************************/
+uint32_t CCS811_RunSequence(CCS811_Handle_TypeDef *dev, const CCS811_Step_TypeDef *steps)
+{
+  const CCS811_Step_TypeDef *step;
+  uint8_t payload[CCS811_STEP_PAYLOAD_MAX];
+  uint32_t status = CCS811_OK;
+
+  for (step = steps; (step->op != ccs811StepEnd) && (status == CCS811_OK); step++) {
+    const uint8_t *p = step->payload;
+
+    EFM_ASSERT(step->length <= CCS811_STEP_PAYLOAD_MAX);
+    if (step->op == ccs811StepCommand) {
+      status = CCS811_SendCommand(dev, step->reg);
+    } else if ((step->reg == CCS811_ADDR_MEASURE_MODE) && (step->length == 1)) {
+      status = CCS811_SetMeasureMode(dev, p[0]);
+    } else if ((step->reg == CCS811_ADDR_THRESHOLDS)
+               && (step->length == CCS811_THRESHOLDS_LENGTH)) {
+      status = CCS811_SetThresholds(dev, (p[0] << 8) | p[1], (p[2] << 8) | p[3], p[4]);
+    } else if ((step->reg == CCS811_ADDR_ENV_DATA)
+               && (step->length == CCS811_ENV_DATA_LENGTH)) {
+      status = CCS811_SetEnvData(dev, (p[0] << 8) | p[1], (p[2] << 8) | p[3]);
+    } else {
+      memcpy(payload, p, step->length);
+      status = CCS811_WriteMailbox(dev, step->reg, step->length, payload);
+    }
+    if ((status == CCS811_OK) && (step->waitMask != 0)) {
+      status = waitStatus(dev, step->waitMask, CCS811_BOOT_POLL_MS, step->waitMs);
+    }
+  }
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read the version of the application firmware, major, minor and trivial
+ *   in 4 bit fields from the top. Works in boot and application mode.
+ ******************************************************************************/
+uint32_t CCS811_GetAppVersion(CCS811_Handle_TypeDef *dev, uint16_t *version)
+{
+  uint8_t buf[2];
+  uint32_t status;
+
+  status = CCS811_ReadMailbox(dev, CCS811_ADDR_FW_APP_VERSION, sizeof(buf), buf);
+  if (status == CCS811_OK) {
+    *version = (buf[0] << 8) | buf[1];
+  }
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Allow the part more time per FW_PROGRAM chunk after it failed to keep up.
+ ******************************************************************************/
+static void widenChunkGap(void)
+{
+  uint32_t max = RTCTIMER_MsToTicks(CCS811_FW_CHUNK_GAP_MAX_MS);
+
+  fwChunkGap = (fwChunkGap * 2 < max) ? fwChunkGap * 2 : max;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get the part into boot mode with an erased application.
+ ******************************************************************************/
+static uint32_t eraseApp(CCS811_Handle_TypeDef *dev)
+{
+  static const uint8_t eraseKey[4] = { 0xE7, 0xA7, 0xE6, 0x09 };
+  uint8_t key[4];
+  uint32_t status;
+
+  status = waitBoot(dev);
+  if ((status == CCS811_OK) && (dev->status & CCS811_STATUS_FW_MODE)) {
+    status = CCS811_Reset(dev);
+    if (status == CCS811_OK) {
+      status = waitBoot(dev);
+    }
+    if ((status == CCS811_OK) && (dev->status & CCS811_STATUS_FW_MODE)) {
+      status = CCS811_ERROR_FIRMWARE_UPDATE_FAILED;
+    }
+  }
+  if (status != CCS811_OK) {
+    return status;
+  }
+
+  memcpy(key, eraseKey, sizeof(key));
+  status = CCS811_WriteMailbox(dev, CCS811_ADDR_FW_ERASE, sizeof(key), key);
+  if (status == CCS811_OK) {
+    status = waitStatus(dev, CCS811_STATUS_APP_ERASE,
+                        CCS811_ERASE_POLL_MS, CCS811_ERASE_TIMEOUT_MS);
+  }
+  return status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write the image in FW_PROGRAM chunks, fwChunkGap apart.
+ *
+ * @details
+ *   The gap runs from the start of one write to the start of the next, so
+ *   the bus time of a chunk and the preparation of the next one overlap
+ *   the time the part takes to program the previous one. The MCU naps in
+ *   the rest of it. A chunk that is not acknowledged is retried after a
+ *   wider gap.
+ ******************************************************************************/
+static uint32_t programApp(CCS811_Handle_TypeDef *dev, const uint8_t *image,
+                           uint32_t length)
+{
+  uint8_t chunk[CCS811_FW_CHUNK_SIZE];
+  uint32_t last = RTCTIMER_GetTicks() - fwChunkGap;
+  uint32_t offset;
+  uint32_t elapsed;
+  uint32_t status;
+  int retry;
+
+  for (offset = 0; offset < length; offset += CCS811_FW_CHUNK_SIZE) {
+    memcpy(chunk, &image[offset], sizeof(chunk));
+    for (retry = 0; ; retry++) {
+      elapsed = RTCTIMER_GetTicks() - last;
+      if (elapsed < fwChunkGap) {
+        RTCTIMER_DelayTicks(fwChunkGap - elapsed);
+      }
+      last = RTCTIMER_GetTicks();
+      status = CCS811_WriteMailbox(dev, CCS811_ADDR_FW_PROGRAM, sizeof(chunk), chunk);
+      if ((status == CCS811_OK) || (retry == CCS811_FW_CHUNK_RETRIES)) {
+        break;
+      }
+      widenChunkGap();
+    }
+    if (status != CCS811_OK) {
+      return status;
+    }
+  }
+
+  // The last chunk is still being programmed
+  elapsed = RTCTIMER_GetTicks() - last;
+  if (elapsed < fwChunkGap) {
+    RTCTIMER_DelayTicks(fwChunkGap - elapsed);
+  }
+  return CCS811_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Replace the application firmware of the part.
+ *
+ * @details
+ *   Erases the application, streams the image in CCS811_FW_CHUNK_SIZE byte
+ *   FW_PROGRAM writes and checks it with FW_VERIFY. The datasheet gives no
+ *   programming time per chunk, so instead of a worst case delay after
+ *   every chunk the writes start CCS811_FW_CHUNK_GAP_TICKS apart. A chunk
+ *   the part does not acknowledge, or an image that fails to verify,
+ *   doubles that gap up to CCS811_FW_CHUNK_GAP_MAX_MS, and a failed verify
+ *   starts over with the erase. The last attempt always runs at
+ *   CCS811_FW_CHUNK_GAP_MAX_MS, so a part that acknowledges chunks it then
+ *   drops is not left without an application after the doubling ran out of
+ *   attempts. The gap that worked is kept for the next update, also of
+ *   other parts.
+ *
+ *   nWAKE is held for the whole update. The part is left in boot mode with
+ *   the new application valid, CCS811_Start() runs it.
+ *
+ * @param[in] dev
+ *   Handle of the part, it need not be started
+ *
+ * @param[in] image
+ *   Application image as released by the vendor, without any header
+ *
+ * @param[in] length
+ *   Bytes in image, a multiple of CCS811_FW_CHUNK_SIZE
+ *
+ * @return
+ *   CCS811_OK or CCS811_ERROR_FIRMWARE_UPDATE_FAILED.
+ ******************************************************************************/
+uint32_t CCS811_UpdateFirmware(CCS811_Handle_TypeDef *dev, const uint8_t *image,
+                               uint32_t length)
+{
+  uint32_t status = CCS811_ERROR_FIRMWARE_UPDATE_FAILED;
+  int attempt;
+
+  if ((length == 0) || (length % CCS811_FW_CHUNK_SIZE)) {
+    return CCS811_ERROR_FIRMWARE_UPDATE_FAILED;
+  }
+
+  forget(dev);
+
+  CCS811_WakeBegin(dev);
+  for (attempt = 0; attempt < CCS811_FW_UPDATE_ATTEMPTS; attempt++) {
+    if (attempt == CCS811_FW_UPDATE_ATTEMPTS - 1) {
+      // The doubling may not have got there, the last erase must not be wasted
+      fwChunkGap = RTCTIMER_MsToTicks(CCS811_FW_CHUNK_GAP_MAX_MS);
+    }
+    status = eraseApp(dev);
+    if (status == CCS811_OK) {
+      status = programApp(dev, image, length);
+    }
+    if (status == CCS811_OK) {
+      status = CCS811_SendCommand(dev, CCS811_ADDR_FW_VERIFY);
+    }
+    if (status == CCS811_OK) {
+      status = waitStatus(dev, CCS811_STATUS_APP_VERIFY,
+                          CCS811_VERIFY_POLL_MS, CCS811_VERIFY_TIMEOUT_MS);
+    }
+    if ((status == CCS811_OK) && (dev->status & CCS811_STATUS_APP_VALID)) {
+      break;
+    }
+    // Chunks written too fast only show up here
+    status = CCS811_ERROR_FIRMWARE_UPDATE_FAILED;
+    widenChunkGap();
+  }
+  CCS811_WakeEnd(dev);
+  return status;
+}
+
+/** @} (end group CCS811) */
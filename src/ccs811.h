@@ -0,0 +1,234 @@
+/***************************************************************************//**
+ * @file ccs811.h
+ * @brief Driver for the CCS811 air quality sensor.
+ ******************************************************************************/
+
+#ifndef CCS811_H
+#define CCS811_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_device.h"
+#include "em_gpio.h"
+#include "em_i2c.h"
+
+/***************************************************************************//**
+ * @addtogroup CCS811
+ * @brief CCS811 driver, one statically allocated handle per device
+ * @{
+ ******************************************************************************/
+
+#define CCS811_I2C_ADDR_LOW                  0xB4  /**< I2C address with ADDR pin low                                        */
+#define CCS811_I2C_ADDR_HIGH                 0xB6  /**< I2C address with ADDR pin high                                       */
+#define CCS811_I2C_RETRIES                   2     /**< Retries after a failed transfer                                      */
+#define CCS811_BOOT_POLL_MS                  2     /**< Nap between STATUS polls during boot [ms]                            */
+#define CCS811_BOOT_TIMEOUT_MS               100   /**< Time allowed for the part to answer after reset [ms]                 */
+#define CCS811_VERIFY_POLL_MS                10    /**< Nap between STATUS polls during FW_VERIFY [ms]                       */
+#define CCS811_VERIFY_TIMEOUT_MS             500   /**< Time allowed for FW_VERIFY [ms]                                      */
+#define CCS811_APP_START_TIMEOUT_MS          50    /**< Time allowed for APP_START [ms]                                      */
+#define CCS811_ERASE_POLL_MS                 10    /**< Nap between STATUS polls during FW_ERASE [ms]                        */
+#define CCS811_ERASE_TIMEOUT_MS              500   /**< Time allowed for FW_ERASE [ms]                                       */
+#define CCS811_FW_CHUNK_SIZE                 8     /**< Bytes per FW_PROGRAM write, the image length is a multiple of it      */
+#define CCS811_FW_CHUNK_RETRIES              3     /**< Retries of one FW_PROGRAM write                                      */
+#define CCS811_FW_UPDATE_ATTEMPTS            3     /**< Erase, program and verify runs before an update fails                */
+#ifndef CCS811_FW_CHUNK_GAP_TICKS
+#define CCS811_FW_CHUNK_GAP_TICKS            33    /**< First guess of the FW_PROGRAM start to start gap, 1 ms [RTC ticks]   */
+#endif
+#define CCS811_FW_CHUNK_GAP_MAX_MS           50    /**< Widest gap, always used by the last update attempt [ms]             */
+#define CCS811_HW_ID                         0x81  /**< Expected HW_ID register value                                         */
+#define CCS811_WAKE_SETUP_TICKS              2     /**< nWAKE low to first I2C bit, tAWAKE is 50 us [RTC ticks]              */
+#define CCS811_WAKE_RELEASE_TICKS            1     /**< nWAKE high before it is asserted again, tDWAKE is 20 us [RTC ticks]  */
+
+/**************************************************************************//**
+* @name Error Codes
+* @{
+******************************************************************************/
+#define CCS811_OK                            0x0000   /**< No errors                            */
+#define CCS811_ERROR_APPLICATION_NOT_PRESENT 0x0001   /**< Application firmware is not present  */
+#define CCS811_ERROR_NOT_IN_APPLICATION_MODE 0x0002   /**< The part is not in application mode  */
+#define CCS811_ERROR_DRIVER_NOT_INITIALIZED  0x0003   /**< The driver is not initialized        */
+#define CCS811_ERROR_I2C_TRANSACTION_FAILED  0x0004   /**< I2C transaction failed               */
+#define CCS811_ERROR_INIT_FAILED             0x0005   /**< The initialization failed            */
+#define CCS811_ERROR_FIRMWARE_UPDATE_FAILED  0x0006   /**< The firmware update was unsuccessful */
+/**@}*/
+
+/**************************************************************************//**
+* @name Register Addresses
+* @{
+******************************************************************************/
+#define CCS811_ADDR_STATUS                   0x00 /**< Status register                                                                           */
+#define CCS811_ADDR_MEASURE_MODE             0x01 /**< Measurement mode and conditions register                                                  */
+#define CCS811_ADDR_ALG_RESULT_DATA          0x02 /**< Algorithm result                                                                          */
+#define CCS811_ADDR_RAW_DATA                 0x03 /**< Raw ADC data values for resistance and current source used                                */
+#define CCS811_ADDR_ENV_DATA                 0x05 /**< Temperature and Humidity data can be written to enable compensation                       */
+#define CCS811_ADDR_NTC                      0x06 /**< Provides the voltage across the reference resistor and the voltage across the NTC resistor */
+#define CCS811_ADDR_THRESHOLDS               0x10 /**< Thresholds for operation when interrupts are only generated when eCO2 ppm crosses a threshold */
+#define CCS811_ADDR_BASELINE                 0x11 /**< Encoded current baseline value, can be read and restored                                  */
+#define CCS811_ADDR_HW_ID                    0x20 /**< Hardware ID                                                                               */
+#define CCS811_ADDR_HW_VERSION               0x21 /**< Hardware Version                                                                          */
+#define CCS811_ADDR_FW_BOOT_VERSION          0x23 /**< Firmware Boot Version                                                                     */
+#define CCS811_ADDR_FW_APP_VERSION           0x24 /**< Firmware Application Version                                                              */
+#define CCS811_ADDR_ERR_ID                   0xE0 /**< Error ID                                                                                  */
+#define CCS811_ADDR_FW_ERASE                 0xF1 /**< Firmware erase                                                                            */
+#define CCS811_ADDR_FW_PROGRAM               0xF2 /**< Firmware programming                                                                      */
+#define CCS811_ADDR_FW_VERIFY                0xF3 /**< Firmware verification                                                                     */
+#define CCS811_ADDR_APP_START                0xF4 /**< Application start                                                                         */
+#define CCS811_ADDR_SW_RESET                 0xFF /**< Software reset                                                                            */
+/**@}*/
+
+/**************************************************************************//**
+* @name Measure mode value definitions
+* @{
+******************************************************************************/
+#define CCS811_MEASURE_MODE_DRIVE_MODE_SHIFT 4     /**< DRIVE_MODE field bit shift value                                                           */
+#define CCS811_MEASURE_MODE_DRIVE_MODE_IDLE  0x00  /**< Idle mode, measurements are disabled                                                       */
+#define CCS811_MEASURE_MODE_DRIVE_MODE_1SEC  0x10  /**< IAQ Mode 1, a measurement is performed every second                                        */
+#define CCS811_MEASURE_MODE_DRIVE_MODE_10SEC 0x20  /**< IAQ Mode 2, a measurement is performed every 10 seconds                                    */
+#define CCS811_MEASURE_MODE_DRIVE_MODE_60SEC 0x30  /**< IAQ Mode 3, a measurement is performed every 60 seconds                                    */
+#define CCS811_MEASURE_MODE_DRIVE_MODE_RAW   0x40  /**< IAQ Mode 4, Raw Data Mode, a measurement is performed every 250ms for external algorithms  */
+#define CCS811_MEASURE_MODE_INTERRUPT        0x08  /**< Interrupt generation enable                                                                */
+#define CCS811_MEASURE_MODE_THRESH           0x04  /**< Enable interrupt when eCO2 level exceeds threshold                   */
+/**@}*/
+
+/**************************************************************************//**
+* @name Status register bit definitions
+* @{
+******************************************************************************/
+#define CCS811_STATUS_ERROR                  0x01  /**< An error occurred, details in ERROR_ID                               */
+#define CCS811_STATUS_DATA_READY             0x08  /**< A new data sample is ready in ALG_RESULT_DATA                         */
+#define CCS811_STATUS_APP_VALID              0x10  /**< Valid application firmware loaded                                     */
+#define CCS811_STATUS_APP_VERIFY             0x20  /**< FW_VERIFY has completed, boot mode only                               */
+#define CCS811_STATUS_APP_ERASE              0x40  /**< FW_ERASE has completed, boot mode only                                */
+#define CCS811_STATUS_FW_MODE                0x80  /**< Firmware is in application mode                                       */
+/**@}*/
+
+/**************************************************************************//**
+* @name Error ID bit definitions
+* @{
+******************************************************************************/
+#define CCS811_ERR_ID_WRITE_REG_INVALID      0x01  /**< Write to an invalid register address                                  */
+#define CCS811_ERR_ID_READ_REG_INVALID       0x02  /**< Read from an invalid register address                                 */
+#define CCS811_ERR_ID_MEASMODE_INVALID       0x04  /**< Unsupported MEASURE_MODE requested                                    */
+#define CCS811_ERR_ID_MAX_RESISTANCE         0x08  /**< Sensor resistance reached or exceeded its maximum range               */
+#define CCS811_ERR_ID_HEATER_FAULT           0x10  /**< Heater current not in range                                           */
+#define CCS811_ERR_ID_HEATER_SUPPLY          0x20  /**< Heater voltage is not being applied correctly                         */
+/**@}*/
+
+#define CCS811_ENV_DATA_LENGTH               4     /**< Humidity and temperature, 2 bytes each                               */
+#define CCS811_THRESHOLDS_LENGTH             5     /**< Low to medium, medium to high and hysteresis                         */
+#define CCS811_THRESHOLD_LOW_TO_MED_DEFAULT  1500  /**< Power-on default low to medium threshold [ppm]                       */
+#define CCS811_THRESHOLD_MED_TO_HIGH_DEFAULT 2500  /**< Power-on default medium to high threshold [ppm]                      */
+#define CCS811_THRESHOLD_HYSTERESIS_DEFAULT  50    /**< Power-on default hysteresis [ppm]                                    */
+
+#define CCS811_ALG_RESULT_DATA_LENGTH        8     /**< eCO2, TVOC, STATUS, ERROR_ID and RAW_DATA                            */
+#define CCS811_RAW_DATA_LENGTH               2     /**< Current in the top 6 bits, ADC reading in the low 10 bits            */
+
+#define CCS811_STEP_PAYLOAD_MAX              5     /**< Longest payload of a sequence step, THRESHOLDS                       */
+
+/** Operation of a sequence step. */
+typedef enum {
+  ccs811StepEnd,            /**< Last entry of a sequence                       */
+  ccs811StepWrite,          /**< Write the payload to the register              */
+  ccs811StepCommand,        /**< Write the register address without data        */
+} CCS811_StepOp_TypeDef;
+
+/** One step of a sequence run by CCS811_RunSequence(). */
+typedef struct {
+  uint8_t  op;              /**< CCS811_StepOp_TypeDef                          */
+  uint8_t  reg;             /**< Register address                               */
+  uint8_t  length;          /**< Bytes of payload                               */
+  uint8_t  waitMask;        /**< STATUS bits to wait for afterwards, 0 for none */
+  uint16_t waitMs;          /**< Time allowed for them [ms]                     */
+  uint8_t  payload[CCS811_STEP_PAYLOAD_MAX]; /**< Register contents             */
+} CCS811_Step_TypeDef;
+
+/** Step writing MEASURE_MODE. */
+#define CCS811_STEP_MEASURE_MODE(mode) \
+  { ccs811StepWrite, CCS811_ADDR_MEASURE_MODE, 1, 0, 0, { (mode) } }
+
+/** Step writing the THRESHOLDS register, limits in ppm. */
+#define CCS811_STEP_THRESHOLDS(lowToMed, medToHigh, hysteresis)               \
+  { ccs811StepWrite, CCS811_ADDR_THRESHOLDS, CCS811_THRESHOLDS_LENGTH, 0, 0,  \
+    { (uint8_t)((lowToMed) >> 8), (uint8_t)(lowToMed),                        \
+      (uint8_t)((medToHigh) >> 8), (uint8_t)(medToHigh), (hysteresis) } }
+
+/** Step writing ENV_DATA, in the register's 1/512 units. */
+#define CCS811_STEP_ENV_DATA(humidity, temperature)                           \
+  { ccs811StepWrite, CCS811_ADDR_ENV_DATA, CCS811_ENV_DATA_LENGTH, 0, 0,      \
+    { (uint8_t)((humidity) >> 8), (uint8_t)(humidity),                        \
+      (uint8_t)((temperature) >> 8), (uint8_t)(temperature) } }
+
+/** Step sending a command and waiting up to ms for the STATUS bits in mask. */
+#define CCS811_STEP_COMMAND(reg, mask, ms) \
+  { ccs811StepCommand, (reg), 0, (mask), (ms), { 0 } }
+
+/** End of a sequence, also makes an otherwise empty table valid C. */
+#define CCS811_STEP_END \
+  { ccs811StepEnd, 0, 0, 0, 0, { 0 } }
+
+/** Decoded contents of the ALG_RESULT_DATA register. */
+typedef struct {
+  uint16_t eco2;        /**< Equivalent CO2 [ppm]                      */
+  uint16_t tvoc;        /**< Total volatile organic compounds [ppb]    */
+  uint16_t rawAdc;      /**< Raw ADC reading, 1023 = 1.65 V            */
+  uint8_t  status;      /**< STATUS register                           */
+  uint8_t  errorId;     /**< ERROR_ID register, see CCS811_ERR_ID_*    */
+  uint8_t  current;     /**< Current through the sensor [uA]           */
+} CCS811_AlgResult_TypeDef;
+
+/** Device handle. Allocated by the caller, one per sensor on the bus. */
+typedef struct {
+  I2C_TypeDef *i2c;         /**< Bus the sensor is attached to              */
+  uint8_t     addr;         /**< I2C address, CCS811_I2C_ADDR_LOW or _HIGH  */
+  bool        appMode;      /**< True once the application has started      */
+  bool        warmStart;    /**< The application was already running at start */
+  bool        measureModeValid; /**< True when measureMode mirrors the part */
+  uint8_t     measureMode;  /**< Cached MEASURE_MODE register               */
+  uint8_t     status;       /**< STATUS from the last result read           */
+  uint8_t     errorId;      /**< ERROR_ID from the last result read         */
+  bool        thresholdsValid; /**< True when the thresholds below are set  */
+  uint16_t    lowToMed;     /**< Cached low to medium threshold [ppm]       */
+  uint16_t    medToHigh;    /**< Cached medium to high threshold [ppm]      */
+  uint8_t     hysteresis;   /**< Cached threshold hysteresis [ppm]          */
+  bool        envDataValid; /**< True when the ENV_DATA values below are set */
+  uint16_t    humidity;     /**< Cached ENV_DATA humidity [1/512 %RH]       */
+  uint16_t    temperature;  /**< Cached ENV_DATA temperature [1/512 degC]   */
+  bool        wakeUsed;     /**< True when nWAKE is driven by the MCU       */
+  GPIO_Port_TypeDef wakePort; /**< nWAKE port                               */
+  uint8_t     wakePin;      /**< nWAKE pin                                  */
+  uint8_t     wakeDepth;    /**< Nesting of CCS811_WakeBegin() calls        */
+  uint32_t    wakeReleased; /**< RTC ticks when nWAKE was last released     */
+} CCS811_Handle_TypeDef;
+
+void CCS811_Init(CCS811_Handle_TypeDef *dev, I2C_TypeDef *i2c, uint8_t addr);
+void CCS811_SetWakePin(CCS811_Handle_TypeDef *dev, GPIO_Port_TypeDef port, uint8_t pin);
+void CCS811_WakeBegin(CCS811_Handle_TypeDef *dev);
+void CCS811_WakeEnd(CCS811_Handle_TypeDef *dev);
+void CCS811_PowerOff(CCS811_Handle_TypeDef *dev);
+uint32_t CCS811_Start(CCS811_Handle_TypeDef *dev);
+uint32_t CCS811_Reset(CCS811_Handle_TypeDef *dev);
+uint32_t CCS811_ReadMailbox(CCS811_Handle_TypeDef *dev, uint8_t id,
+                            uint8_t length, uint8_t *data);
+uint32_t CCS811_WriteMailbox(CCS811_Handle_TypeDef *dev, uint8_t id,
+                             uint8_t length, uint8_t *data);
+uint32_t CCS811_WriteRegister(CCS811_Handle_TypeDef *dev, uint8_t id, uint8_t data);
+uint32_t CCS811_SendCommand(CCS811_Handle_TypeDef *dev, uint8_t id);
+uint32_t CCS811_SetMeasureMode(CCS811_Handle_TypeDef *dev, uint8_t mode);
+uint32_t CCS811_SetThresholds(CCS811_Handle_TypeDef *dev, uint16_t lowToMed,
+                              uint16_t medToHigh, uint8_t hysteresis);
+uint32_t CCS811_SetEnvData(CCS811_Handle_TypeDef *dev, uint16_t humidity,
+                           uint16_t temperature);
+uint32_t CCS811_GetBaseline(CCS811_Handle_TypeDef *dev, uint16_t *baseline);
+uint32_t CCS811_SetBaseline(CCS811_Handle_TypeDef *dev, uint16_t baseline);
+uint32_t CCS811_ReadAlgResult(CCS811_Handle_TypeDef *dev,
+                              CCS811_AlgResult_TypeDef *result);
+uint32_t CCS811_ReadRawData(CCS811_Handle_TypeDef *dev, uint8_t *current,
+                            uint16_t *rawAdc);
+uint32_t CCS811_RunSequence(CCS811_Handle_TypeDef *dev, const CCS811_Step_TypeDef *steps);
+uint32_t CCS811_GetAppVersion(CCS811_Handle_TypeDef *dev, uint16_t *version);
+uint32_t CCS811_UpdateFirmware(CCS811_Handle_TypeDef *dev, const uint8_t *image,
+                               uint32_t length);
+
+/** @} (end group CCS811) */
+
+#endif /* CCS811_H */
@@ -0,0 +1,89 @@
+/***************************************************************************//**
+ * @file clockmgr.c
+ * @brief Core clock policy, a low HFRCO band with a boost for bus bursts.
+ *
+ * @details
+ *   The core runs from the HFRCO at CLOCKMGR_IDLE_BAND for everything that
+ *   only has to decide what to do next. CLOCKMGR_Boost() raises it to
+ *   CLOCKMGR_BOOST_BAND while I2C transfers run, CLOCKMGR_Unboost() drops
+ *   it again once the last user is done. Calls nest, so a burst of
+ *   transfers wrapped in one boost switches the band only twice.
+ *
+ *   The I2C clock divider is computed once, at the boost band. At the idle
+ *   band the same divider gives a slower SCL, never one above
+ *   I2C_FREQ_FAST_MAX, so a transfer that is started unboosted is slow but
+ *   still in spec. Below 7 MHz the fixed part of the active current
+ *   dominates and the slower code costs more charge than the band saves.
+ *
+ *   The band is not touched in EM2, the HFRCO restarts at the band it was
+ *   left at.
+ ******************************************************************************/
+
+#include "em_core.h"
+#include "em_assert.h"
+#include "perf.h"
+#include "clockmgr.h"
+
+/***************************************************************************//**
+ * @addtogroup CLOCKMGR
+ * @{
+ ******************************************************************************/
+
+/* Number of active boost requests. */
+static volatile uint16_t boostCount;
+
+/***************************************************************************//**
+ * @brief
+ *   Drop to the idle band. The HFRCO must be the HFCLK source.
+ ******************************************************************************/
+void CLOCKMGR_Init(void)
+{
+  boostCount = 0;
+  CMU_HFRCOBandSet(CLOCKMGR_IDLE_BAND);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run the core at the boost band until the matching CLOCKMGR_Unboost().
+ *   May be called from interrupt context.
+ ******************************************************************************/
+void CLOCKMGR_Boost(void)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_ATOMIC();
+  EFM_ASSERT(boostCount < UINT16_MAX);
+  if (boostCount++ == 0) {
+    CMU_HFRCOBandSet(CLOCKMGR_BOOST_BAND);
+    PERF_COUNT(clockBoosts);
+  }
+  CORE_EXIT_ATOMIC();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Drop a boost request, the last one returns to the idle band.
+ *   May be called from interrupt context.
+ ******************************************************************************/
+void CLOCKMGR_Unboost(void)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_ATOMIC();
+  EFM_ASSERT(boostCount > 0);
+  if ((boostCount > 0) && (--boostCount == 0)) {
+    CMU_HFRCOBandSet(CLOCKMGR_IDLE_BAND);
+  }
+  CORE_EXIT_ATOMIC();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether the core currently runs at the boost band.
+ ******************************************************************************/
+bool CLOCKMGR_IsBoosted(void)
+{
+  return boostCount > 0;
+}
+
+/** @} (end group CLOCKMGR) */
@@ -0,0 +1,32 @@
+/***************************************************************************//**
+ * @file clockmgr.h
+ * @brief Core clock policy, a low HFRCO band with a boost for bus bursts.
+ ******************************************************************************/
+
+#ifndef CLOCKMGR_H
+#define CLOCKMGR_H
+
+#include <stdbool.h>
+#include "em_cmu.h"
+
+/***************************************************************************//**
+ * @addtogroup CLOCKMGR
+ * @brief Reference counted HFRCO band switching
+ * @{
+ ******************************************************************************/
+
+#ifndef CLOCKMGR_IDLE_BAND
+#define CLOCKMGR_IDLE_BAND    cmuHFRCOBand_7MHz    /**< Band for control logic        */
+#endif
+#ifndef CLOCKMGR_BOOST_BAND
+#define CLOCKMGR_BOOST_BAND   cmuHFRCOBand_14MHz   /**< Band while the I2C bus is used */
+#endif
+
+void CLOCKMGR_Init(void);
+void CLOCKMGR_Boost(void);
+void CLOCKMGR_Unboost(void);
+bool CLOCKMGR_IsBoosted(void);
+
+/** @} (end group CLOCKMGR) */
+
+#endif /* CLOCKMGR_H */
@@ -0,0 +1,51 @@
+/***************************************************************************//**
+ * @file crc16.c
+ * @brief CRC-16/CCITT-FALSE for frames and records.
+ *
+ * @details
+ *   Computed a nibble at a time from a 16 entry table, 32 bytes of flash
+ *   instead of the 512 of a byte table and two table steps per byte instead
+ *   of the eight shift and XOR steps of the bitwise loop.
+ ******************************************************************************/
+
+#include "crc16.h"
+
+/***************************************************************************//**
+ * @addtogroup CRC16
+ * @{
+ ******************************************************************************/
+
+static const uint16_t nibbleTable[16] = {
+  0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+  0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+/***************************************************************************//**
+ * @brief
+ *   Extend a CRC over len bytes.
+ *
+ * @param[in] crc
+ *   CRC16_INIT for a new CRC, otherwise the result of the previous call
+ *
+ * @param[in] data
+ *   Bytes to add
+ *
+ * @param[in] len
+ *   Number of bytes
+ *
+ * @return
+ *   Updated CRC
+ ******************************************************************************/
+uint16_t CRC16_Update(uint16_t crc, const void *data, size_t len)
+{
+  const uint8_t *p = data;
+
+  while (len--) {
+    crc = (uint16_t)((crc << 4) ^ nibbleTable[(crc >> 12) ^ (*p >> 4)]);
+    crc = (uint16_t)((crc << 4) ^ nibbleTable[(crc >> 12) ^ (*p & 0x0F)]);
+    p++;
+  }
+  return crc;
+}
+
+/** @} (end group CRC16) */
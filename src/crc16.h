@@ -0,0 +1,25 @@
+/***************************************************************************//**
+ * @file crc16.h
+ * @brief CRC-16/CCITT-FALSE for frames and records.
+ ******************************************************************************/
+
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup CRC16
+ * @brief Polynomial 0x1021, initial value 0xFFFF, no reflection, no final XOR
+ * @{
+ ******************************************************************************/
+
+#define CRC16_INIT      0xFFFFU   /**< Start value of a new CRC           */
+#define CRC16_CHECK     0x29B1U   /**< CRC of the ASCII string "123456789" */
+
+uint16_t CRC16_Update(uint16_t crc, const void *data, size_t len);
+
+/** @} (end group CRC16) */
+
+#endif /* CRC16_H */
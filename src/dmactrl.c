@@ -0,0 +1,58 @@
+/***************************************************************************//**
+ * @file dmactrl.c
+ * @brief Shared DMA controller setup and channel allocation.
+ *
+ * @details
+ *   The DMA controller has a single descriptor table for all channels, so
+ *   it is set up here once and every driver only configures the channels
+ *   assigned to it in dmactrl.h. DMA_IRQHandler() in emlib dispatches the
+ *   completion callbacks.
+ ******************************************************************************/
+
+#include <stdbool.h>
+#include "em_cmu.h"
+#include "dmactrl.h"
+
+/***************************************************************************//**
+ * @addtogroup DMACTRL
+ * @{
+ ******************************************************************************/
+
+/* The alternate descriptors start after the primary ones of the channel
+   count rounded up to a power of two, and the table is aligned to its
+   size. Only primary descriptors are in use, the table still covers the
+   alternate ones so that ping-pong or scatter-gather transfers fit. */
+#if DMA_CHAN_COUNT <= 4
+#define DMACTRL_CH_SLOTS     4
+#elif DMA_CHAN_COUNT <= 8
+#define DMACTRL_CH_SLOTS     8
+#else
+#error "Descriptor table layout not defined for this channel count"
+#endif
+#define DMACTRL_ALIGNMENT    (DMACTRL_CH_SLOTS * 2 * 16)
+
+static DMA_DESCRIPTOR_TypeDef dmaControlBlock[DMACTRL_CH_SLOTS * 2]
+  __attribute__ ((aligned(DMACTRL_ALIGNMENT)));
+
+static bool initialized;
+
+/***************************************************************************//**
+ * @brief
+ *   Enable the DMA controller. Safe to call from every driver that needs it.
+ ******************************************************************************/
+void DMACTRL_Init(void)
+{
+  DMA_Init_TypeDef dmaInit;
+
+  if (initialized) {
+    return;
+  }
+
+  CMU_ClockEnable(cmuClock_DMA, true);
+  dmaInit.hprot = 0;
+  dmaInit.controlBlock = dmaControlBlock;
+  DMA_Init(&dmaInit);
+  initialized = true;
+}
+
+/** @} (end group DMACTRL) */
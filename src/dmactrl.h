@@ -0,0 +1,31 @@
+/***************************************************************************//**
+ * @file dmactrl.h
+ * @brief Shared DMA controller setup and channel allocation.
+ ******************************************************************************/
+
+#ifndef DMACTRL_H
+#define DMACTRL_H
+
+#include "em_device.h"
+#include "em_dma.h"
+
+/***************************************************************************//**
+ * @addtogroup DMACTRL
+ * @brief One control block for every driver that uses the DMA controller
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+* @name Channel Allocation
+* @{
+******************************************************************************/
+#define DMACTRL_CH_I2C0_RX     0     /**< I2C0 receive, RXDATAV request    */
+#define DMACTRL_CH_I2C0_TX     1     /**< I2C0 transmit, TXBL request      */
+#define DMACTRL_CH_LEUART0_TX  2     /**< LEUART0 transmit, TXBL request   */
+/**@}*/
+
+void DMACTRL_Init(void);
+
+/** @} (end group DMACTRL) */
+
+#endif /* DMACTRL_H */
@@ -0,0 +1,239 @@
+/***************************************************************************//**
+ * @file drivemode.c
+ * @brief Runtime selection of the CCS811 drive mode.
+ *
+ * @details
+ *   The adaptive policy starts in 1 s mode and steps down to 10 s and then
+ *   60 s mode while eCO2 stays in its band and within DRIVEMODE_STABLE_DELTA
+ *   of the previous sample. A band change jumps straight back to 1 s mode,
+ *   a large move within the band goes back one step.
+ *
+ *   The policy only decides on the mode, applying it is up to the caller
+ *   through CCS811_SetMeasureMode(), which skips unchanged modes.
+ *
+ *   The datasheet recommends idling the sensor for ten minutes before it
+ *   moves to a slower mode. The policy switches directly instead and opens
+ *   a settle window of DRIVEMODE_SETTLE_S after each step down, 12 samples
+ *   in 10 s mode and 2 in 60 s mode. The caller drops the samples of the
+ *   window, see DRIVEMODE_Settling(), and the policy does not see them
+ *   either. The first sample after the window only checks for a band
+ *   change, the one before the window is too old to compare eCO2 with. A
+ *   move to a faster mode closes the window.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_assert.h"
+#include "ccs811.h"
+#include "drivemode.h"
+
+/***************************************************************************//**
+ * @addtogroup DRIVEMODE
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @brief
+ *   Stable time needed before leaving the given mode for a slower one.
+ *
+ * @return
+ *   Time in seconds, 0 when there is no slower mode to step down to.
+ ******************************************************************************/
+static uint32_t stepDownTime(uint8_t mode)
+{
+  switch (mode) {
+    case CCS811_MEASURE_MODE_DRIVE_MODE_1SEC:
+      return DRIVEMODE_STEP_DOWN_1SEC;
+    case CCS811_MEASURE_MODE_DRIVE_MODE_10SEC:
+      return DRIVEMODE_STEP_DOWN_10SEC;
+    default:
+      return 0;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Initialize the policy state.
+ *
+ * @param[out] handle
+ *   Policy state
+ *
+ * @param[in] policy
+ *   Fixed or adaptive
+ *
+ * @param[in] mode
+ *   CCS811_MEASURE_MODE_DRIVE_MODE_* used by the fixed policy, and the mode
+ *   the adaptive policy starts from. Start adaptive in 1 s mode unless the
+ *   sensor is known to be conditioned.
+ *
+ * @param[in] now
+ *   Current time in seconds
+ ******************************************************************************/
+void DRIVEMODE_Init(DRIVEMODE_Handle_TypeDef *handle,
+                    DRIVEMODE_Policy_TypeDef policy, uint8_t mode, uint32_t now)
+{
+  EFM_ASSERT(handle != NULL);
+
+  handle->bandValid = false;
+  handle->band = 0;
+  handle->lastEco2 = 0;
+  handle->eco2Valid = false;
+  DRIVEMODE_SetPolicy(handle, policy, mode, now);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Switch policy at runtime.
+ ******************************************************************************/
+void DRIVEMODE_SetPolicy(DRIVEMODE_Handle_TypeDef *handle,
+                         DRIVEMODE_Policy_TypeDef policy, uint8_t mode, uint32_t now)
+{
+  handle->policy = policy;
+  handle->mode = mode;
+  handle->stableSince = now;
+  handle->settling = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Feed a new sample into the policy.
+ *
+ * @param[in] handle
+ *   Policy state
+ *
+ * @param[in] eco2
+ *   eCO2 of the sample [ppm]
+ *
+ * @param[in] band
+ *   Band the sample falls in, as classified by the application
+ *
+ * @param[in] now
+ *   Current time in seconds
+ ******************************************************************************/
+void DRIVEMODE_OnSample(DRIVEMODE_Handle_TypeDef *handle, uint16_t eco2,
+                        uint8_t band, uint32_t now)
+{
+  uint16_t delta;
+
+  if (handle->policy == drivemodePolicyAdaptive && handle->bandValid) {
+    delta = (eco2 > handle->lastEco2) ? eco2 - handle->lastEco2
+                                      : handle->lastEco2 - eco2;
+    if (band != handle->band) {
+      handle->mode = CCS811_MEASURE_MODE_DRIVE_MODE_1SEC;
+      handle->stableSince = now;
+      handle->settling = false;
+    } else if (handle->eco2Valid && (delta > DRIVEMODE_STABLE_DELTA)) {
+      if (handle->mode == CCS811_MEASURE_MODE_DRIVE_MODE_60SEC) {
+        handle->mode = CCS811_MEASURE_MODE_DRIVE_MODE_10SEC;
+      } else {
+        handle->mode = CCS811_MEASURE_MODE_DRIVE_MODE_1SEC;
+      }
+      handle->stableSince = now;
+      handle->settling = false;
+    }
+  }
+
+  handle->bandValid = true;
+  handle->band = band;
+  handle->lastEco2 = eco2;
+  handle->eco2Valid = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Evaluate time based step downs and return the drive mode to use.
+ ******************************************************************************/
+uint8_t DRIVEMODE_Poll(DRIVEMODE_Handle_TypeDef *handle, uint32_t now)
+{
+  uint32_t required;
+
+  if (handle->policy != drivemodePolicyAdaptive) {
+    return handle->mode;
+  }
+
+  required = stepDownTime(handle->mode);
+  if ((required != 0) && (now - handle->stableSince >= required)) {
+    handle->mode = (handle->mode == CCS811_MEASURE_MODE_DRIVE_MODE_1SEC)
+                   ? CCS811_MEASURE_MODE_DRIVE_MODE_10SEC
+                   : CCS811_MEASURE_MODE_DRIVE_MODE_60SEC;
+    handle->stableSince = now;
+    handle->settling = true;
+    handle->settleUntil = now + DRIVEMODE_SETTLE_S;
+    handle->eco2Valid = false;
+  }
+  return handle->mode;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time until the policy could step down if nothing changes.
+ *
+ * @return
+ *   Seconds until the next DRIVEMODE_Poll() may change the mode, 0 when no
+ *   step down is pending.
+ ******************************************************************************/
+uint32_t DRIVEMODE_NextStepDown(const DRIVEMODE_Handle_TypeDef *handle, uint32_t now)
+{
+  uint32_t required;
+  uint32_t elapsed;
+
+  if (handle->policy != drivemodePolicyAdaptive) {
+    return 0;
+  }
+  required = stepDownTime(handle->mode);
+  if (required == 0) {
+    return 0;
+  }
+  elapsed = now - handle->stableSince;
+  return (elapsed >= required) ? 1 : required - elapsed;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether a sample falls into the settle window after a step down.
+ *
+ * @details
+ *   Such a sample should be dropped, also from the policy. Call before
+ *   DRIVEMODE_OnSample().
+ ******************************************************************************/
+bool DRIVEMODE_Settling(const DRIVEMODE_Handle_TypeDef *handle, uint32_t now)
+{
+  return handle->settling && ((int32_t)(now - handle->settleUntil) < 0);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time until the settle window ends.
+ *
+ * @return
+ *   Seconds until DRIVEMODE_SettleDone() turns true, 0 when no window is
+ *   open.
+ ******************************************************************************/
+uint32_t DRIVEMODE_SettleLeft(const DRIVEMODE_Handle_TypeDef *handle, uint32_t now)
+{
+  if (!handle->settling) {
+    return 0;
+  }
+  return DRIVEMODE_Settling(handle, now) ? handle->settleUntil - now : 1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Close a settle window that has ended.
+ *
+ * @details
+ *   In threshold mode the window may have swallowed the only interrupt of
+ *   a band change, so the caller should read the sensor once more.
+ *
+ * @return
+ *   True once per window, on the first call after it ended.
+ ******************************************************************************/
+bool DRIVEMODE_SettleDone(DRIVEMODE_Handle_TypeDef *handle, uint32_t now)
+{
+  if (!handle->settling || DRIVEMODE_Settling(handle, now)) {
+    return false;
+  }
+  handle->settling = false;
+  return true;
+}
+
+/** @} (end group DRIVEMODE) */
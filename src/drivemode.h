@@ -0,0 +1,67 @@
+/***************************************************************************//**
+ * @file drivemode.h
+ * @brief Runtime selection of the CCS811 drive mode.
+ ******************************************************************************/
+
+#ifndef DRIVEMODE_H
+#define DRIVEMODE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup DRIVEMODE
+ * @brief Fixed or adaptive measurement cadence policy
+ * @{
+ ******************************************************************************/
+
+#ifndef DRIVEMODE_STABLE_DELTA
+#define DRIVEMODE_STABLE_DELTA      50    /**< eCO2 change still counted as stable [ppm] */
+#endif
+
+#ifndef DRIVEMODE_STEP_DOWN_1SEC
+#define DRIVEMODE_STEP_DOWN_1SEC    120   /**< Stable time before 1 s -> 10 s [s]   */
+#endif
+
+#ifndef DRIVEMODE_STEP_DOWN_10SEC
+#define DRIVEMODE_STEP_DOWN_10SEC   600   /**< Stable time before 10 s -> 60 s [s]  */
+#endif
+
+#ifndef DRIVEMODE_SETTLE_S
+#define DRIVEMODE_SETTLE_S          120   /**< Samples not used after a step down [s] */
+#endif
+
+/** Cadence policy. */
+typedef enum {
+  drivemodePolicyFixed,       /**< Stay in the configured drive mode       */
+  drivemodePolicyAdaptive,    /**< Slow down when stable, speed up on change */
+} DRIVEMODE_Policy_TypeDef;
+
+/** Policy state, one per sensor. */
+typedef struct {
+  DRIVEMODE_Policy_TypeDef policy;   /**< Active policy                       */
+  uint8_t                  mode;     /**< CCS811_MEASURE_MODE_DRIVE_MODE_*    */
+  bool                     bandValid; /**< True after the first sample        */
+  uint8_t                  band;     /**< eCO2 band of the last sample        */
+  uint16_t                 lastEco2; /**< eCO2 of the last sample [ppm]       */
+  bool                     eco2Valid; /**< lastEco2 was read in this mode    */
+  uint32_t                 stableSince; /**< Start of the stable period [s]   */
+  bool                     settling; /**< A settle window has not been closed */
+  uint32_t                 settleUntil; /**< End of the settle window [s]     */
+} DRIVEMODE_Handle_TypeDef;
+
+void DRIVEMODE_Init(DRIVEMODE_Handle_TypeDef *handle,
+                    DRIVEMODE_Policy_TypeDef policy, uint8_t mode, uint32_t now);
+void DRIVEMODE_SetPolicy(DRIVEMODE_Handle_TypeDef *handle,
+                         DRIVEMODE_Policy_TypeDef policy, uint8_t mode, uint32_t now);
+void DRIVEMODE_OnSample(DRIVEMODE_Handle_TypeDef *handle, uint16_t eco2,
+                        uint8_t band, uint32_t now);
+uint8_t DRIVEMODE_Poll(DRIVEMODE_Handle_TypeDef *handle, uint32_t now);
+uint32_t DRIVEMODE_NextStepDown(const DRIVEMODE_Handle_TypeDef *handle, uint32_t now);
+bool DRIVEMODE_Settling(const DRIVEMODE_Handle_TypeDef *handle, uint32_t now);
+uint32_t DRIVEMODE_SettleLeft(const DRIVEMODE_Handle_TypeDef *handle, uint32_t now);
+bool DRIVEMODE_SettleDone(DRIVEMODE_Handle_TypeDef *handle, uint32_t now);
+
+/** @} (end group DRIVEMODE) */
+
+#endif /* DRIVEMODE_H */
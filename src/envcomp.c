@@ -0,0 +1,167 @@
+/***************************************************************************//**
+ * @file envcomp.c
+ * @brief Humidity and temperature compensation of the CCS811 readings.
+ *
+ * @details
+ *   The ambient conditions change slowly, so the Si7021 is measured only
+ *   every ENVCOMP_INTERVAL_S, by a scheduler task the application runs. A
+ *   measurement is split around the gas sensor reads of the same wakeup:
+ *   ENVCOMP_Begin() starts the conversion, the CCS811s are read while it
+ *   runs and ENVCOMP_Finish() collects the result, so the bus and core are
+ *   powered up once. With ENVCOMP_SLACK_S of slack the measurement mostly
+ *   rides on a sample wakeup instead of causing its own.
+ *
+ *   ENV_DATA is only rewritten when a value moves beyond its deadband, the
+ *   algorithm gains nothing from sub-percent humidity updates.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "rtctimer.h"
+#include "envcomp.h"
+
+/***************************************************************************//**
+ * @addtogroup ENVCOMP
+ * @{
+ ******************************************************************************/
+
+#define HUMIDITY_MAX       (100 * 512)   /* 100 %RH in ENV_DATA units        */
+#define TEMPERATURE_OFFSET 11187         /* (46.85 - 25) degC * 512          */
+#define BUSY_RETRY_MS      5
+
+static SI7021_Handle_TypeDef *si7021;
+static uint32_t convStart;
+static bool converting;
+
+/***************************************************************************//**
+ * @brief
+ *   Absolute difference of two ENV_DATA values.
+ ******************************************************************************/
+static uint16_t distance(uint16_t a, uint16_t b)
+{
+  return (a > b) ? a - b : b - a;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the compensation stage.
+ *
+ * @param[in] sensor
+ *   Initialized Si7021, or NULL to leave the CCS811s uncompensated
+ ******************************************************************************/
+void ENVCOMP_Init(SI7021_Handle_TypeDef *sensor)
+{
+  si7021 = sensor;
+  converting = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start a Si7021 conversion. Call early in a wakeup, before the gas
+ *   sensor reads.
+ ******************************************************************************/
+void ENVCOMP_Begin(void)
+{
+  if ((si7021 == NULL) || converting) {
+    return;
+  }
+
+  if (SI7021_StartMeasurement(si7021) == SI7021_OK) {
+    convStart = RTCTIMER_GetTicks();
+    converting = true;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Collect a conversion started by ENVCOMP_Begin() and update ENV_DATA.
+ *
+ * @details
+ *   Sleeps in EM2 for whatever part of the conversion time the gas sensor
+ *   reads did not cover. Does nothing when no conversion is running.
+ *
+ * @param[in] devs
+ *   Gas sensors to compensate
+ *
+ * @param[in] count
+ *   Number of entries in devs
+ ******************************************************************************/
+void ENVCOMP_Finish(CCS811_Handle_TypeDef *devs, unsigned int count)
+{
+  uint32_t elapsed;
+  uint32_t status;
+  uint16_t rhCode;
+  uint16_t tempCode;
+  uint16_t humidity;
+  uint16_t temperature;
+  unsigned int i;
+
+  if (!converting) {
+    return;
+  }
+  converting = false;
+
+  elapsed = RTCTIMER_TicksToMs(RTCTIMER_GetTicks() - convStart);
+  if (elapsed < SI7021_CONVERSION_MS) {
+    RTCTIMER_Delay(SI7021_CONVERSION_MS - elapsed);
+  }
+  status = SI7021_ReadMeasurement(si7021, &rhCode, &tempCode);
+  if (status == SI7021_ERROR_BUSY) {
+    RTCTIMER_Delay(BUSY_RETRY_MS);
+    status = SI7021_ReadMeasurement(si7021, &rhCode, &tempCode);
+  }
+  if (status != SI7021_OK) {
+    return;
+  }
+
+  humidity = ENVCOMP_Humidity(rhCode);
+  temperature = ENVCOMP_Temperature(tempCode);
+  for (i = 0; i < count; i++) {
+    if (!devs[i].appMode) {
+      continue;
+    }
+    if (devs[i].envDataValid
+        && (distance(devs[i].humidity, humidity) < ENVCOMP_HUMIDITY_DEADBAND)
+        && (distance(devs[i].temperature, temperature) < ENVCOMP_TEMPERATURE_DEADBAND)) {
+      continue;
+    }
+    CCS811_SetEnvData(&devs[i], humidity, temperature);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Convert a Si7021 humidity code to ENV_DATA units.
+ *
+ * @details
+ *   RH = 125 * code / 65536 - 6 %RH, times 512 gives
+ *   64000 * code / 65536 - 3072. Clamped to 0..100 %RH.
+ ******************************************************************************/
+uint16_t ENVCOMP_Humidity(uint16_t rhCode)
+{
+  int32_t value = (int32_t)((64000UL * rhCode) >> 16) - 3072;
+
+  if (value < 0) {
+    return 0;
+  }
+  return (value > HUMIDITY_MAX) ? HUMIDITY_MAX : (uint16_t)value;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Convert a Si7021 temperature code to ENV_DATA units.
+ *
+ * @details
+ *   ENV_DATA holds (T + 25) * 512 with T = 175.72 * code / 65536 - 46.85.
+ *   175.72 * 512 / 65536 is taken as 44984 / 32768, which keeps the product
+ *   in 32 bits and is exact to 0.002 degC. Temperatures below -25 degC are
+ *   not representable and clamp to that limit.
+ ******************************************************************************/
+uint16_t ENVCOMP_Temperature(uint16_t tempCode)
+{
+  int32_t value = (int32_t)((44984UL * tempCode) >> 15) - TEMPERATURE_OFFSET;
+
+  return (value < 0) ? 0 : (uint16_t)value;
+}
+
+/** @} (end group ENVCOMP) */
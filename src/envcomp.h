@@ -0,0 +1,38 @@
+/***************************************************************************//**
+ * @file envcomp.h
+ * @brief Humidity and temperature compensation of the CCS811 readings.
+ ******************************************************************************/
+
+#ifndef ENVCOMP_H
+#define ENVCOMP_H
+
+#include <stdint.h>
+#include "ccs811.h"
+#include "si7021.h"
+
+/***************************************************************************//**
+ * @addtogroup ENVCOMP
+ * @brief Feeds Si7021 readings into the CCS811 ENV_DATA register
+ * @{
+ ******************************************************************************/
+
+#ifndef ENVCOMP_INTERVAL_S
+#define ENVCOMP_INTERVAL_S             60    /**< Time between Si7021 measurements [s]        */
+#endif
+
+#ifndef ENVCOMP_SLACK_S
+#define ENVCOMP_SLACK_S                15    /**< How late a measurement may be to share a wakeup [s] */
+#endif
+
+#define ENVCOMP_HUMIDITY_DEADBAND      512   /**< Change needed to rewrite ENV_DATA, 1 %RH    */
+#define ENVCOMP_TEMPERATURE_DEADBAND   128   /**< Change needed to rewrite ENV_DATA, 0.25 degC */
+
+void ENVCOMP_Init(SI7021_Handle_TypeDef *sensor);
+void ENVCOMP_Begin(void);
+void ENVCOMP_Finish(CCS811_Handle_TypeDef *devs, unsigned int count);
+uint16_t ENVCOMP_Humidity(uint16_t rhCode);
+uint16_t ENVCOMP_Temperature(uint16_t tempCode);
+
+/** @} (end group ENVCOMP) */
+
+#endif /* ENVCOMP_H */
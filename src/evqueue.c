@@ -0,0 +1,122 @@
+/***************************************************************************//**
+ * @file evqueue.c
+ * @brief Lock-free event queue from interrupt handlers to the main loop.
+ *
+ * @details
+ *   The producer only writes the head index and the consumer only the tail,
+ *   so no interrupt masking is needed on either side. Posting is done from
+ *   interrupt handlers of equal priority, which cannot preempt each other
+ *   and so act as a single producer. The indices run free and are masked on
+ *   access, which keeps all EVQUEUE_SIZE slots usable.
+ *
+ *   The consumer must not sleep with a non-empty queue. Test with
+ *   EVQUEUE_IsEmpty() inside a critical section and sleep there, a post
+ *   that races the test then still wakes the core.
+ ******************************************************************************/
+
+#include "em_device.h"
+#include "rtctimer.h"
+#include "evqueue.h"
+
+/***************************************************************************//**
+ * @addtogroup EVQUEUE
+ * @{
+ ******************************************************************************/
+
+#define INDEX_MASK   (EVQUEUE_SIZE - 1)
+
+#if (EVQUEUE_SIZE & INDEX_MASK) != 0
+#error "EVQUEUE_SIZE must be a power of two"
+#endif
+
+static EVQUEUE_Event_TypeDef events[EVQUEUE_SIZE];
+static volatile uint32_t head;      /* Written by the producer only */
+static volatile uint32_t tail;      /* Written by the consumer only */
+static volatile uint32_t dropped;
+
+/***************************************************************************//**
+ * @brief
+ *   Empty the queue. Call before the producers are enabled.
+ ******************************************************************************/
+void EVQUEUE_Init(void)
+{
+  head = 0;
+  tail = 0;
+  dropped = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Post an event, stamped with the current RTC tick count.
+ *
+ * @param[in] type
+ *   Event source
+ *
+ * @param[in] flags
+ *   Source specific detail
+ *
+ * @return
+ *   False when the queue was full and the event was dropped.
+ ******************************************************************************/
+bool EVQUEUE_Post(EVQUEUE_Type_TypeDef type, uint32_t flags)
+{
+  uint32_t h = head;
+  EVQUEUE_Event_TypeDef *event;
+
+  if ((h - tail) >= EVQUEUE_SIZE) {
+    dropped++;
+    return false;
+  }
+
+  event = &events[h & INDEX_MASK];
+  event->ticks = RTCTIMER_GetTicks();
+  event->type = type;
+  event->flags = flags;
+
+  /* Publish the slot only after it is written. */
+  __DMB();
+  head = h + 1;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Take the oldest event.
+ *
+ * @return
+ *   False when the queue is empty.
+ ******************************************************************************/
+bool EVQUEUE_Get(EVQUEUE_Event_TypeDef *event)
+{
+  uint32_t t = tail;
+
+  if (t == head) {
+    return false;
+  }
+
+  __DMB();
+  *event = events[t & INDEX_MASK];
+  __DMB();
+  tail = t + 1;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check for pending events.
+ ******************************************************************************/
+bool EVQUEUE_IsEmpty(void)
+{
+  return tail == head;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Number of events lost to a full queue.
+ ******************************************************************************/
+uint32_t EVQUEUE_Dropped(void)
+{
+  return dropped;
+}
+
+/** @} (end group EVQUEUE) */
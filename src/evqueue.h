@@ -0,0 +1,44 @@
+/***************************************************************************//**
+ * @file evqueue.h
+ * @brief Lock-free event queue from interrupt handlers to the main loop.
+ ******************************************************************************/
+
+#ifndef EVQUEUE_H
+#define EVQUEUE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup EVQUEUE
+ * @brief Single producer, single consumer queue of timestamped events
+ * @{
+ ******************************************************************************/
+
+#ifndef EVQUEUE_SIZE
+#define EVQUEUE_SIZE   8     /**< Queue depth, must be a power of two */
+#endif
+
+/** Event sources. */
+typedef enum {
+  evqueueSensorData,    /**< Falling edge on the shared CCS811 nINT line */
+  evqueueTelemSent,     /**< A telemetry DMA span has gone out           */
+  evqueueCount
+} EVQUEUE_Type_TypeDef;
+
+/** One event. */
+typedef struct {
+  uint32_t             ticks;   /**< RTC ticks when the event was posted */
+  EVQUEUE_Type_TypeDef type;    /**< What happened                       */
+  uint32_t             flags;   /**< Source specific, e.g. GPIO IF bits  */
+} EVQUEUE_Event_TypeDef;
+
+void EVQUEUE_Init(void);
+bool EVQUEUE_Post(EVQUEUE_Type_TypeDef type, uint32_t flags);
+bool EVQUEUE_Get(EVQUEUE_Event_TypeDef *event);
+bool EVQUEUE_IsEmpty(void);
+uint32_t EVQUEUE_Dropped(void);
+
+/** @} (end group EVQUEUE) */
+
+#endif /* EVQUEUE_H */
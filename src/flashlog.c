@@ -0,0 +1,351 @@
+/***************************************************************************//**
+ * @file flashlog.c
+ * @brief Append-only sample log in internal flash that survives resets.
+ *
+ * @details
+ *   The log pages FLASHMAP_LOG_PAGES below the baseline pages are used as a
+ *   ring. Each page starts with a header that holds a sequence number, one
+ *   higher than that of the page written before it, and the boot count of
+ *   the run that wrote it. After the header come slots of one HISTCODEC
+ *   block each.
+ *
+ *   Records are staged in one HISTCODEC block in RAM, so a commit writes a
+ *   block of a few dozen records in one MSC_WriteWord() call. The page is
+ *   only erased when the log moves on to it, one erase per page worth of
+ *   blocks. Pages are taken strictly in turn, which spreads the erases
+ *   evenly over the region. A block older than FLASHLOG_COMMIT_S is
+ *   committed even when it is not full, which bounds what a reset loses.
+ *
+ *   Every block carries a CRC over its contents. A block torn by a power
+ *   failure fails that check and is skipped by the reader, nothing else
+ *   depends on it. A torn page header makes the whole page count as
+ *   unused, it is erased when the ring comes round to it.
+ *
+ *   FLASHLOG_Init() only reads the page headers, so the recovery time at
+ *   boot does not depend on how much is logged. Each boot continues on a
+ *   fresh page. That keeps the slot search out of the startup path and lets
+ *   the reader tell runs apart, record timestamps restart at every boot.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_device.h"
+#include "em_msc.h"
+#include "crc16.h"
+#include "flashmap.h"
+#include "perf.h"
+#include "flashlog.h"
+
+/***************************************************************************//**
+ * @addtogroup FLASHLOG
+ * @{
+ ******************************************************************************/
+
+#if (FLASHMAP_LOG_PAGES < 2) || (FLASHMAP_LOG_PAGES > 255)
+#error "FLASHMAP_LOG_PAGES must be between 2 and 255"
+#endif
+
+#define PAGE_MAGIC        0x474F4C46UL   /* "FLOG" */
+#define PAGE_HEADER_SIZE  16
+#define SLOTS_PER_PAGE    ((FLASH_PAGE_SIZE - PAGE_HEADER_SIZE) / HISTCODEC_BLOCK_SIZE)
+#define SLOT_ERASED       0xFFFFFFFFUL
+
+/* Page header, CRC over the three words before it. */
+typedef struct {
+  uint32_t magic;
+  uint32_t sequence;
+  uint32_t boot;
+  uint32_t check;
+} PageHeader_TypeDef;
+
+static uint8_t * const logBase = (uint8_t *)FLASHMAP_LOG_BASE;
+static HISTCODEC_Block_TypeDef staging;
+static HISTCODEC_State_TypeDef encoder;
+static bool     staged;         /* staging holds records                  */
+static uint8_t  headPage;       /* Page written to                        */
+static uint8_t  headSlot;       /* Next slot of it, a new page if full    */
+static uint32_t headSequence;   /* Sequence number of headPage            */
+static uint32_t bootCount;
+
+/***************************************************************************//**
+ * @brief
+ *   Header of a log page.
+ ******************************************************************************/
+static const PageHeader_TypeDef *pageHeader(uint8_t page)
+{
+  return (const PageHeader_TypeDef *)(logBase + (uint32_t)page * FLASH_PAGE_SIZE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Block slot of a log page.
+ ******************************************************************************/
+static HISTCODEC_Block_TypeDef *slotBlock(uint8_t page, uint8_t slot)
+{
+  return (HISTCODEC_Block_TypeDef *)(logBase + (uint32_t)page * FLASH_PAGE_SIZE
+                                     + PAGE_HEADER_SIZE + (uint32_t)slot * HISTCODEC_BLOCK_SIZE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check the magic and CRC of a page header.
+ ******************************************************************************/
+static bool headerValid(const PageHeader_TypeDef *header)
+{
+  return (header->magic == PAGE_MAGIC)
+         && (header->check == CRC16_Update(CRC16_INIT, header,
+                                           offsetof(PageHeader_TypeDef, check)));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   CRC of a block, everything but the check field itself.
+ ******************************************************************************/
+static uint16_t blockCrc(const HISTCODEC_Block_TypeDef *block)
+{
+  uint16_t crc = CRC16_Update(CRC16_INIT, block, offsetof(HISTCODEC_Block_TypeDef, check));
+
+  return CRC16_Update(crc, block->data, sizeof(block->data));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Erase the next page of the ring and make it the head. MSC must be
+ *   initialized.
+ ******************************************************************************/
+static bool rotate(void)
+{
+  PageHeader_TypeDef header;
+  uint8_t next = (uint8_t)((headPage + 1) % FLASHMAP_LOG_PAGES);
+
+  if (MSC_ErasePage((uint32_t *)pageHeader(next)) != mscReturnOk) {
+    return false;
+  }
+  header.magic = PAGE_MAGIC;
+  header.sequence = headSequence + 1;
+  header.boot = bootCount;
+  header.check = CRC16_Update(CRC16_INIT, &header, offsetof(PageHeader_TypeDef, check));
+  if (MSC_WriteWord((uint32_t *)pageHeader(next), &header, sizeof(header)) != mscReturnOk) {
+    return false;
+  }
+
+  headPage = next;
+  headSequence = header.sequence;
+  headSlot = 0;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Write the staging block to the next free slot.
+ ******************************************************************************/
+static bool commit(void)
+{
+  bool ok = true;
+
+  if (!staged) {
+    return true;
+  }
+
+  MSC_Init();
+  if (headSlot == SLOTS_PER_PAGE) {
+    ok = rotate();
+  }
+  if (ok) {
+    staging.check = blockCrc(&staging);
+    // A failed write may have programmed part of the slot, never reuse it
+    ok = (MSC_WriteWord((uint32_t *)slotBlock(headPage, headSlot), &staging,
+                        sizeof(staging)) == mscReturnOk);
+    headSlot++;
+  }
+  MSC_Deinit();
+
+  staged = false;
+  if (ok) {
+    PERF_COUNT(logCommits);
+  } else {
+    PERF_COUNT(logFailures);
+  }
+  return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Find the head of the log and start a new run on it.
+ *
+ * @details
+ *   Reads FLASHMAP_LOG_PAGES page headers and nothing else. The first
+ *   commit of this run goes to the page after the newest one.
+ ******************************************************************************/
+void FLASHLOG_Init(void)
+{
+  const PageHeader_TypeDef *header;
+  bool found = false;
+  uint8_t page;
+
+  headPage = FLASHMAP_LOG_PAGES - 1;
+  headSequence = 0;
+  bootCount = 0;
+  for (page = 0; page < FLASHMAP_LOG_PAGES; page++) {
+    header = pageHeader(page);
+    if (headerValid(header) && (!found || (header->sequence > headSequence))) {
+      found = true;
+      headPage = page;
+      headSequence = header->sequence;
+      bootCount = header->boot;
+    }
+  }
+  bootCount++;
+  headSlot = SLOTS_PER_PAGE;
+  staged = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add a record to the log.
+ *
+ * @details
+ *   Usually only encodes the record into the staging block. A full block,
+ *   or one that has waited FLASHLOG_COMMIT_S, is committed first.
+ *
+ * @return
+ *   False if a commit failed, the block it held is lost.
+ ******************************************************************************/
+bool FLASHLOG_Append(const SAMPLEBUF_Record_TypeDef *record)
+{
+  bool ok = true;
+
+  if (staged && (record->timestamp - staging.start >= FLASHLOG_COMMIT_S)) {
+    ok = commit();
+  }
+  if (!staged || !HISTCODEC_Append(&staging, &encoder, record)) {
+    if (staged) {
+      ok = commit() && ok;
+    }
+    HISTCODEC_Open(&staging, &encoder, record->timestamp);
+    (void)HISTCODEC_Append(&staging, &encoder, record);
+    staged = true;
+  }
+  return ok;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Commit the staged records now, e.g. before the supply is switched off.
+ *
+ * @return
+ *   False if the commit failed.
+ ******************************************************************************/
+bool FLASHLOG_Sync(void)
+{
+  return commit();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Boot count of this run, stored with every page it writes.
+ ******************************************************************************/
+uint32_t FLASHLOG_Boot(void)
+{
+  return bootCount;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Load the header of the page the reader has moved to.
+ *
+ * @return
+ *   False if the page holds no blocks of the log.
+ ******************************************************************************/
+static bool readerOpenPage(FLASHLOG_Reader_TypeDef *reader)
+{
+  const PageHeader_TypeDef *header = pageHeader(reader->page);
+
+  reader->slot = 0;
+  if (!headerValid(header)) {
+    reader->slot = SLOTS_PER_PAGE;
+    return false;
+  }
+  reader->boot = header->boot;
+  reader->sequence = header->sequence;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start reading at the oldest committed block.
+ *
+ * @details
+ *   Staged records are not committed yet and not read, call FLASHLOG_Sync()
+ *   first to include them. A commit that moves the log onto a page not yet
+ *   read erases the oldest blocks ahead of the reader. The reader notices
+ *   from the page header and goes on with the next page.
+ ******************************************************************************/
+void FLASHLOG_ReaderInit(FLASHLOG_Reader_TypeDef *reader)
+{
+  reader->page = (uint8_t)((headPage + 1) % FLASHMAP_LOG_PAGES);
+  reader->pagesLeft = FLASHMAP_LOG_PAGES - 1;
+  reader->inBlock = false;
+  reader->boot = 0;
+  reader->sequence = 0;
+  (void)readerOpenPage(reader);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Decode the next logged record.
+ *
+ * @param[in,out] reader
+ *   Reader set up by FLASHLOG_ReaderInit()
+ *
+ * @param[out] record
+ *   Next record, timestamps count from the boot it was logged in
+ *
+ * @param[out] boot
+ *   Boot count of that run, may be NULL
+ *
+ * @return
+ *   False after the newest committed record.
+ ******************************************************************************/
+bool FLASHLOG_Next(FLASHLOG_Reader_TypeDef *reader, SAMPLEBUF_Record_TypeDef *record,
+                   uint32_t *boot)
+{
+  const HISTCODEC_Block_TypeDef *block;
+
+  for (;;) {
+    if (pageHeader(reader->page)->sequence != reader->sequence) {
+      // Erased by a commit since the page was opened, the rest is gone
+      reader->inBlock = false;
+      reader->slot = SLOTS_PER_PAGE;
+    }
+    if (reader->inBlock && HISTCODEC_Next(&reader->block, record)) {
+      if (boot != NULL) {
+        *boot = reader->boot;
+      }
+      return true;
+    }
+    reader->inBlock = false;
+
+    // Next block of the page with a good CRC, the first erased slot ends it
+    while (!reader->inBlock && (reader->slot < SLOTS_PER_PAGE)) {
+      block = slotBlock(reader->page, reader->slot++);
+      if (block->start == SLOT_ERASED) {
+        reader->slot = SLOTS_PER_PAGE;
+      } else if (block->check == blockCrc(block)) {
+        HISTCODEC_ReaderInit(&reader->block, block);
+        reader->inBlock = true;
+      }
+    }
+    if (reader->inBlock) {
+      continue;
+    }
+
+    if (reader->pagesLeft == 0) {
+      return false;
+    }
+    reader->page = (uint8_t)((reader->page + 1) % FLASHMAP_LOG_PAGES);
+    reader->pagesLeft--;
+    (void)readerOpenPage(reader);
+  }
+}
+
+/** @} (end group FLASHLOG) */
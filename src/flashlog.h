@@ -0,0 +1,45 @@
+/***************************************************************************//**
+ * @file flashlog.h
+ * @brief Append-only sample log in internal flash that survives resets.
+ ******************************************************************************/
+
+#ifndef FLASHLOG_H
+#define FLASHLOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "histcodec.h"
+#include "samplebuf.h"
+
+/***************************************************************************//**
+ * @addtogroup FLASHLOG
+ * @brief Log structured HISTCODEC blocks in a ring of flash pages
+ * @{
+ ******************************************************************************/
+
+#ifndef FLASHLOG_COMMIT_S
+#define FLASHLOG_COMMIT_S     3600  /**< Oldest staged record before a commit [s] */
+#endif
+
+/** Streaming reader over the committed blocks, oldest first. */
+typedef struct {
+  uint8_t  page;                      /**< Page being read                 */
+  uint8_t  pagesLeft;                 /**< Pages after it                  */
+  uint8_t  slot;                      /**< Next block slot of the page     */
+  uint32_t boot;                      /**< Boot the page was written in    */
+  uint32_t sequence;                  /**< Sequence number of the page     */
+  bool     inBlock;                   /**< block holds a checked block     */
+  HISTCODEC_Reader_TypeDef block;
+} FLASHLOG_Reader_TypeDef;
+
+void FLASHLOG_Init(void);
+bool FLASHLOG_Append(const SAMPLEBUF_Record_TypeDef *record);
+bool FLASHLOG_Sync(void);
+uint32_t FLASHLOG_Boot(void);
+void FLASHLOG_ReaderInit(FLASHLOG_Reader_TypeDef *reader);
+bool FLASHLOG_Next(FLASHLOG_Reader_TypeDef *reader, SAMPLEBUF_Record_TypeDef *record,
+                   uint32_t *boot);
+
+/** @} (end group FLASHLOG) */
+
+#endif /* FLASHLOG_H */
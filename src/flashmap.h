@@ -0,0 +1,50 @@
+/***************************************************************************//**
+ * @file flashmap.h
+ * @brief Internal flash pages reserved for persistent data.
+ *
+ * @details
+ *   Reserved pages are taken from the top of flash, downwards. The linker
+ *   script places the image from FLASH_BASE up, so the image must stay below
+ *   FLASHMAP_RESERVED_BASE. The script asserts that with its own page
+ *   count, FLASHMAP_LINKER_PAGES, change both together.
+ ******************************************************************************/
+
+#ifndef FLASHMAP_H
+#define FLASHMAP_H
+
+#include "em_device.h"
+
+#ifndef FLASHMAP_LOG_PAGES
+#define FLASHMAP_LOG_PAGES       16   /**< Pages of the sample log, 2 to 255 */
+#endif
+
+#ifndef FLASHMAP_SENSORFW_PAGES
+#define FLASHMAP_SENSORFW_PAGES  6    /**< Pages of the CCS811 firmware image with its header */
+#endif
+
+/** Pages of the CCS811 baseline records, used in turn. */
+#define FLASHMAP_BASELINE_PAGES  2
+
+/** Top pages of flash, hold the CCS811 baseline records. */
+#define FLASHMAP_BASELINE_BASE   (FLASH_BASE + FLASH_SIZE - FLASHMAP_BASELINE_PAGES * FLASH_PAGE_SIZE)
+
+/** First page of the sample log, the log runs up to the baseline pages. */
+#define FLASHMAP_LOG_BASE        (FLASHMAP_BASELINE_BASE - FLASHMAP_LOG_PAGES * FLASH_PAGE_SIZE)
+
+/** CCS811 application image, written by the programming tool, below the log. */
+#define FLASHMAP_SENSORFW_BASE   (FLASHMAP_LOG_BASE - FLASHMAP_SENSORFW_PAGES * FLASH_PAGE_SIZE)
+
+/** Lowest reserved address. */
+#define FLASHMAP_RESERVED_BASE   FLASHMAP_SENSORFW_BASE
+
+/** Pages from FLASHMAP_RESERVED_BASE to the end of flash. */
+#define FLASHMAP_RESERVED_PAGES  (FLASHMAP_BASELINE_PAGES + FLASHMAP_LOG_PAGES + FLASHMAP_SENSORFW_PAGES)
+
+/** Pages the linker script keeps the image out of. */
+#define FLASHMAP_LINKER_PAGES    24
+
+#if FLASHMAP_RESERVED_PAGES > FLASHMAP_LINKER_PAGES
+#error "More pages reserved than the linker script keeps free, update both"
+#endif
+
+#endif /* FLASHMAP_H */
@@ -0,0 +1,90 @@
+/***************************************************************************//**
+ * @file fwupdate.c
+ * @brief Update of the CCS811 application from an image in internal flash.
+ *
+ * @details
+ *   The programming tool writes a FWUPDATE_Header_TypeDef and the vendor
+ *   image behind it to FLASHMAP_SENSORFW_BASE, together with or after the
+ *   MCU image. At startup each sensor whose FW_APP_VERSION differs from the
+ *   packaged one, or that has no valid application, is updated with
+ *   CCS811_UpdateFirmware(). A part that already runs the image costs one
+ *   register read, so the check can stay in every boot.
+ ******************************************************************************/
+
+#include "crc16.h"
+#include "flashmap.h"
+#include "fwupdate.h"
+
+/***************************************************************************//**
+ * @addtogroup FWUPDATE
+ * @{
+ ******************************************************************************/
+
+#define IMAGE_MAX   (FLASHMAP_SENSORFW_PAGES * FLASH_PAGE_SIZE - sizeof(FWUPDATE_Header_TypeDef))
+
+static const FWUPDATE_Header_TypeDef * const header =
+  (const FWUPDATE_Header_TypeDef *)FLASHMAP_SENSORFW_BASE;
+
+/***************************************************************************//**
+ * @brief
+ *   Check that a complete image is stored, its CRC included.
+ ******************************************************************************/
+bool FWUPDATE_ImageValid(void)
+{
+  const uint8_t *image = (const uint8_t *)(header + 1);
+
+  return (header->magic == FWUPDATE_MAGIC)
+         && (header->length > 0) && (header->length <= IMAGE_MAX)
+         && ((header->length % CCS811_FW_CHUNK_SIZE) == 0)
+         && (header->check == CRC16_Update(CRC16_INIT, image, header->length));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Application version of the stored image, valid after
+ *   FWUPDATE_ImageValid().
+ ******************************************************************************/
+uint16_t FWUPDATE_ImageVersion(void)
+{
+  return header->version;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the part and install the stored image on it if it runs another
+ *   version or none.
+ *
+ * @details
+ *   An updated part is started again, so either way it is left in
+ *   application mode when this succeeds. The image is not checked here,
+ *   call FWUPDATE_ImageValid() once before updating several parts.
+ *
+ * @return
+ *   CCS811_OK if the part runs the stored version, otherwise the error of
+ *   CCS811_Start() or CCS811_UpdateFirmware().
+ ******************************************************************************/
+uint32_t FWUPDATE_Run(CCS811_Handle_TypeDef *dev)
+{
+  uint16_t version;
+  uint32_t status;
+
+  status = CCS811_Start(dev);
+  if ((status == CCS811_OK)
+      && (CCS811_GetAppVersion(dev, &version) == CCS811_OK)
+      && (version == header->version)) {
+    return CCS811_OK;
+  }
+  if ((status != CCS811_OK) && (status != CCS811_ERROR_APPLICATION_NOT_PRESENT)
+      && (status != CCS811_ERROR_NOT_IN_APPLICATION_MODE)) {
+    // Not answering, leave it to the normal start
+    return status;
+  }
+
+  status = CCS811_UpdateFirmware(dev, (const uint8_t *)(header + 1), header->length);
+  if (status == CCS811_OK) {
+    status = CCS811_Start(dev);
+  }
+  return status;
+}
+
+/** @} (end group FWUPDATE) */
@@ -0,0 +1,35 @@
+/***************************************************************************//**
+ * @file fwupdate.h
+ * @brief Update of the CCS811 application from an image in internal flash.
+ ******************************************************************************/
+
+#ifndef FWUPDATE_H
+#define FWUPDATE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ccs811.h"
+
+/***************************************************************************//**
+ * @addtogroup FWUPDATE
+ * @brief Install the packaged sensor firmware on parts that run another one
+ * @{
+ ******************************************************************************/
+
+#define FWUPDATE_MAGIC        0x31574643UL  /**< "CFW1", first word of a packaged image */
+
+/** Header in front of the image at FLASHMAP_SENSORFW_BASE. */
+typedef struct {
+  uint32_t magic;     /**< FWUPDATE_MAGIC                                  */
+  uint16_t version;   /**< FW_APP_VERSION the image reports once running   */
+  uint16_t check;     /**< CRC16 of the image bytes                        */
+  uint32_t length;    /**< Bytes of the image that follows the header      */
+} FWUPDATE_Header_TypeDef;
+
+bool FWUPDATE_ImageValid(void);
+uint16_t FWUPDATE_ImageVersion(void);
+uint32_t FWUPDATE_Run(CCS811_Handle_TypeDef *dev);
+
+/** @} (end group FWUPDATE) */
+
+#endif /* FWUPDATE_H */
@@ -0,0 +1,346 @@
+/***************************************************************************//**
+ * @file health.c
+ * @brief Fault detection and staged recovery of the CCS811 sensors.
+ *
+ * @details
+ *   Every result read is passed to HEALTH_OnResult(), which decodes
+ *   STATUS.ERROR and ERROR_ID and notices a part that has dropped out of
+ *   application mode. A probe task per sensor is due when no result
+ *   arrived for HEALTH_DEADLINE_PERIODS sample periods. When the part does
+ *   not interrupt on every sample, in threshold mode, it is instead probed
+ *   every HEALTH_PROBE_S. A probe reads STATUS and MEASURE_MODE, which
+ *   also shows a part that silently lost its drive mode. Probes have a
+ *   slack of 1/HEALTH_SLACK_DIVISOR of their deadline, so the probes of all
+ *   sensors share one wakeup with each other and mostly with other work.
+ *
+ *   A fault runs the next action of a ladder, cheapest first: write
+ *   MEASURE_MODE again, then SW_RESET with a restart and the baseline from
+ *   flash, then I2C bus recovery before the restart. The first good result
+ *   drops the ladder back to the bottom. A fault that calls for a restart,
+ *   like a heater error, starts there directly. The last action repeats
+ *   with a doubling wait up to HEALTH_BACKOFF_MAX_S, so a sensor that is
+ *   gone for good costs little. The MCU itself is never reset, that would
+ *   throw away the warm-up of every sensor and the samples in RAM.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "baseline.h"
+#include "i2cint.h"
+#include "perf.h"
+#include "rtctimer.h"
+#include "health.h"
+
+/***************************************************************************//**
+ * @addtogroup HEALTH
+ * @{
+ ******************************************************************************/
+
+#define ERR_ID_HEATER   (CCS811_ERR_ID_HEATER_FAULT | CCS811_ERR_ID_HEATER_SUPPLY)
+#define ERR_ID_CONFIG   (CCS811_ERR_ID_WRITE_REG_INVALID | CCS811_ERR_ID_READ_REG_INVALID \
+                         | CCS811_ERR_ID_MEASMODE_INVALID)
+
+/***************************************************************************//**
+ * @brief
+ *   True when the part raises nINT for every sample, so results are due
+ *   periodically.
+ ******************************************************************************/
+static bool periodic(const CCS811_Handle_TypeDef *dev)
+{
+  return dev->measureModeValid
+         && (dev->measureMode & CCS811_MEASURE_MODE_INTERRUPT)
+         && !(dev->measureMode & CCS811_MEASURE_MODE_THRESH);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Time until the next result is overdue, or the next probe is due [ms].
+ ******************************************************************************/
+static uint32_t deadlineMs(const CCS811_Handle_TypeDef *dev)
+{
+  uint32_t periodMs;
+
+  if (!periodic(dev)) {
+    return HEALTH_PROBE_S * 1000;
+  }
+  switch (dev->measureMode & 0x70) {
+    case CCS811_MEASURE_MODE_DRIVE_MODE_1SEC:
+      periodMs = 1000;
+      break;
+    case CCS811_MEASURE_MODE_DRIVE_MODE_10SEC:
+      periodMs = 10000;
+      break;
+    case CCS811_MEASURE_MODE_DRIVE_MODE_60SEC:
+      periodMs = 60000;
+      break;
+    case CCS811_MEASURE_MODE_DRIVE_MODE_RAW:
+      periodMs = 250;
+      break;
+    default:
+      return HEALTH_PROBE_S * 1000;
+  }
+  return periodMs * HEALTH_DEADLINE_PERIODS + HEALTH_DEADLINE_SLACK_MS;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Arm the probe for a deadline from now.
+ ******************************************************************************/
+static void arm(HEALTH_Handle_TypeDef *h, uint32_t ms)
+{
+  SCHED_Start(&h->probe, ms, 0, ms / HEALTH_SLACK_DIVISOR);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reset the part and bring it back to the configuration it ran. The
+ *   reader task is signalled, the cadence policy that runs after it writes
+ *   MEASURE_MODE again.
+ ******************************************************************************/
+static void restart(HEALTH_Handle_TypeDef *h)
+{
+  CCS811_Handle_TypeDef *dev = h->dev;
+
+  // A part that does not take the reset is still polled by the start
+  (void)CCS811_Reset(dev);
+  if (CCS811_Start(dev) == CCS811_OK) {
+    (void)BASELINE_Restore(dev);
+    (void)CCS811_RunSequence(dev, h->setup);
+  }
+  SCHED_Signal(h->reader, RTCTIMER_GetTicks());
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run the next recovery action, at least the given one, and wait one
+ *   deadline for it to show an effect.
+ ******************************************************************************/
+static void recover(HEALTH_Handle_TypeDef *h, HEALTH_Action_TypeDef least)
+{
+  CCS811_Handle_TypeDef *dev = h->dev;
+  // Taken before the action, a restart leaves the part idle until the
+  // policy writes its mode again
+  uint32_t waitMs = deadlineMs(dev);
+
+  PERF_COUNT(healthFaults);
+  if (h->action < least) {
+    h->action = least;
+  }
+  switch (h->action) {
+    case healthActionRewrite:
+      PERF_COUNT(healthRewrites);
+      dev->measureModeValid = false;
+      (void)CCS811_SetMeasureMode(dev, dev->measureMode);
+      break;
+    case healthActionReset:
+      PERF_COUNT(healthResets);
+      restart(h);
+      break;
+    default:
+      PERF_COUNT(healthBusRecoveries);
+      I2CINT_BusRecover(dev->i2c);
+      restart(h);
+      break;
+  }
+
+  if (h->action + 1 < healthActionCount) {
+    h->action++;
+  } else {
+    if (h->backoff * 1000 > waitMs) {
+      waitMs = h->backoff * 1000;
+    }
+    h->backoff = (h->backoff * 2 < HEALTH_BACKOFF_MAX_S) ? h->backoff * 2
+                                                         : HEALTH_BACKOFF_MAX_S;
+  }
+  arm(h, waitMs);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Decode a STATUS.ERROR. Reading ERROR_ID clears it on the part.
+ *
+ * @param[in] errorId
+ *   ERROR_ID that came with the result, 0 if none
+ *
+ * @return
+ *   True if a recovery was started.
+ ******************************************************************************/
+static bool onError(HEALTH_Handle_TypeDef *h, uint8_t errorId)
+{
+  uint8_t reg = 0;
+
+  if (CCS811_ReadMailbox(h->dev, CCS811_ADDR_ERR_ID, 1, &reg) == CCS811_OK) {
+    errorId |= reg;
+  }
+  h->errorId = errorId;
+  if (errorId & ERR_ID_HEATER) {
+    recover(h, healthActionReset);
+    return true;
+  }
+  if (errorId & ERR_ID_CONFIG) {
+    recover(h, healthActionRewrite);
+    return true;
+  }
+  // MAX_RESISTANCE is the sensing layer out of range, a reset cannot fix it
+  return false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   A good result, the part is healthy again.
+ ******************************************************************************/
+static void healthy(HEALTH_Handle_TypeDef *h)
+{
+  h->lastResult = RTCTIMER_GetTicks();
+  h->action = healthActionRewrite;
+  h->backoff = HEALTH_PROBE_S;
+  arm(h, deadlineMs(h->dev));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Probe task, runs when the deadline of a sensor has passed. A result
+ *   waiting that no interrupt announced is left to the reader task.
+ ******************************************************************************/
+static void runProbe(SCHED_Task_TypeDef *task)
+{
+  HEALTH_Handle_TypeDef *h = task->user;
+  CCS811_Handle_TypeDef *dev = h->dev;
+  uint32_t elapsed;
+  uint32_t status;
+  uint8_t mode = 0;
+
+  if (!h->active) {
+    return;
+  }
+  // Armed by the last result. The cadence may have slowed since, then the
+  // next sample is not due yet.
+  if (h->action == healthActionRewrite) {
+    elapsed = RTCTIMER_TicksToMs(RTCTIMER_GetTicks() - h->lastResult);
+    if (elapsed < deadlineMs(dev)) {
+      arm(h, deadlineMs(dev) - elapsed);
+      return;
+    }
+  }
+  if (!dev->appMode) {
+    recover(h, healthActionReset);
+    return;
+  }
+
+  status = CCS811_ReadMailbox(dev, CCS811_ADDR_STATUS, 1, &dev->status);
+  if (status == CCS811_OK) {
+    status = CCS811_ReadMailbox(dev, CCS811_ADDR_MEASURE_MODE, 1, &mode);
+  }
+  if (status != CCS811_OK) {
+    recover(h, healthActionRewrite);
+  } else if (!(dev->status & CCS811_STATUS_FW_MODE)) {
+    recover(h, healthActionReset);
+  } else if ((dev->status & CCS811_STATUS_ERROR) && onError(h, 0)) {
+    // Recovery started
+  } else if (dev->measureModeValid && (mode != dev->measureMode)) {
+    recover(h, healthActionRewrite);
+  } else if (!periodic(dev)) {
+    healthy(h);
+  } else if (dev->status & CCS811_STATUS_DATA_READY) {
+    // Measuring, but the edge for it was missed
+    PERF_COUNT(healthFaults);
+    SCHED_Signal(h->reader, RTCTIMER_GetTicks());
+    arm(h, deadlineMs(dev));
+  } else {
+    recover(h, healthActionRewrite);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Prepare a monitor, it is idle until HEALTH_Start(). Adds its probe task
+ *   behind the existing ones, call after SCHED_Init().
+ *
+ * @param[out] h
+ *   Monitor to initialize
+ *
+ * @param[in] dev
+ *   Sensor to watch
+ *
+ * @param[in] setup
+ *   Sequence to write after a restart, the one written after every start
+ *
+ * @param[in] reader
+ *   Task that reads the results and applies the cadence policy, signalled
+ *   for a result no interrupt announced and after a restart
+ ******************************************************************************/
+void HEALTH_Init(HEALTH_Handle_TypeDef *h, CCS811_Handle_TypeDef *dev,
+                 const CCS811_Step_TypeDef *setup, SCHED_Task_TypeDef *reader)
+{
+  h->dev = dev;
+  h->setup = setup;
+  h->reader = reader;
+  SCHED_Add(&h->probe, runProbe, h);
+  h->active = false;
+  h->action = healthActionRewrite;
+  h->errorId = 0;
+  h->backoff = HEALTH_PROBE_S;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start watching once the sensor has been started and configured.
+ ******************************************************************************/
+void HEALTH_Start(HEALTH_Handle_TypeDef *h)
+{
+  h->active = true;
+  healthy(h);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Stop watching, e.g. before the sensor supply is cut.
+ ******************************************************************************/
+void HEALTH_Stop(HEALTH_Handle_TypeDef *h)
+{
+  h->active = false;
+  SCHED_Stop(&h->probe);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check the outcome of a result read, ALG_RESULT_DATA or RAW_DATA.
+ *
+ * @param[in] h
+ *   Monitor of the sensor read
+ *
+ * @param[in] status
+ *   Driver status of the read, the handle holds the STATUS and ERROR_ID
+ *   it returned
+ ******************************************************************************/
+void HEALTH_OnResult(HEALTH_Handle_TypeDef *h, uint32_t status)
+{
+  CCS811_Handle_TypeDef *dev = h->dev;
+
+  if (!h->active) {
+    return;
+  }
+  if (status != CCS811_OK) {
+    recover(h, healthActionRewrite);
+  } else if (!(dev->status & CCS811_STATUS_FW_MODE)) {
+    // Reset by itself, e.g. a supply dip
+    recover(h, healthActionReset);
+  } else if ((dev->status & CCS811_STATUS_ERROR) && onError(h, dev->errorId)) {
+    // Recovery started
+  } else if (dev->status & CCS811_STATUS_DATA_READY) {
+    healthy(h);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   nINT stayed low for HEALTH_NINT_STUCK_PASSES reads without data. The
+ *   line is shared, so this is reported for every sensor on it.
+ ******************************************************************************/
+void HEALTH_OnStuckInt(HEALTH_Handle_TypeDef *h)
+{
+  if (h->active) {
+    recover(h, healthActionRewrite);
+  }
+}
+
+/** @} (end group HEALTH) */
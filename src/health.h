@@ -0,0 +1,72 @@
+/***************************************************************************//**
+ * @file health.h
+ * @brief Fault detection and staged recovery of the CCS811 sensors.
+ ******************************************************************************/
+
+#ifndef HEALTH_H
+#define HEALTH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "ccs811.h"
+#include "sched.h"
+
+/***************************************************************************//**
+ * @addtogroup HEALTH
+ * @brief Watch each sensor and recover it with the cheapest action that works
+ * @{
+ ******************************************************************************/
+
+#ifndef HEALTH_DEADLINE_PERIODS
+#define HEALTH_DEADLINE_PERIODS   3     /**< Sample periods without a result before a probe   */
+#endif
+
+#ifndef HEALTH_DEADLINE_SLACK_MS
+#define HEALTH_DEADLINE_SLACK_MS  500   /**< Added to every result deadline [ms]              */
+#endif
+
+#ifndef HEALTH_PROBE_S
+#define HEALTH_PROBE_S            900   /**< Probe interval without periodic results [s]      */
+#endif
+
+#ifndef HEALTH_BACKOFF_MAX_S
+#define HEALTH_BACKOFF_MAX_S      3600  /**< Longest wait between failed last resort tries [s] */
+#endif
+
+#ifndef HEALTH_SLACK_DIVISOR
+#define HEALTH_SLACK_DIVISOR      8     /**< A probe may run this fraction of its deadline late */
+#endif
+
+#define HEALTH_NINT_STUCK_PASSES  3     /**< Passes with nINT low and no data before it counts as stuck */
+
+/** Recovery actions, cheapest first. */
+typedef enum {
+  healthActionRewrite,      /**< Write MEASURE_MODE again                   */
+  healthActionReset,        /**< SW_RESET, start and restore the baseline   */
+  healthActionBusRecover,   /**< I2C bus recovery, then as healthActionReset */
+  healthActionCount
+} HEALTH_Action_TypeDef;
+
+/** Monitor state, one per sensor. */
+typedef struct {
+  CCS811_Handle_TypeDef     *dev;       /**< Sensor watched                      */
+  const CCS811_Step_TypeDef *setup;     /**< Sequence written after a restart    */
+  SCHED_Task_TypeDef        *reader;    /**< Task that reads the results         */
+  SCHED_Task_TypeDef        probe;      /**< Runs when a result is overdue       */
+  bool                      active;     /**< Watching, false while unpowered     */
+  uint8_t                   action;     /**< Next action on a fault              */
+  uint8_t                   errorId;    /**< ERROR_ID of the last error seen     */
+  uint32_t                  lastResult; /**< RTC ticks of the last good result   */
+  uint32_t                  backoff;    /**< Wait after a failed last resort [s] */
+} HEALTH_Handle_TypeDef;
+
+void HEALTH_Init(HEALTH_Handle_TypeDef *h, CCS811_Handle_TypeDef *dev,
+                 const CCS811_Step_TypeDef *setup, SCHED_Task_TypeDef *reader);
+void HEALTH_Start(HEALTH_Handle_TypeDef *h);
+void HEALTH_Stop(HEALTH_Handle_TypeDef *h);
+void HEALTH_OnResult(HEALTH_Handle_TypeDef *h, uint32_t status);
+void HEALTH_OnStuckInt(HEALTH_Handle_TypeDef *h);
+
+/** @} (end group HEALTH) */
+
+#endif /* HEALTH_H */
@@ -0,0 +1,301 @@
+/***************************************************************************//**
+ * @file histcodec.c
+ * @brief Compact block format for sample history: deltas in zig-zag varints.
+ *
+ * @details
+ *   A record is stored as the difference to the previous record of the same
+ *   sensor in the block. For the timestamp that is the change of the
+ *   sampling interval, which is zero while a sensor keeps its drive mode.
+ *   Differences are zig-zag numbers, so small steps in either direction
+ *   stay small. Each record starts with a tag byte:
+ *
+ *   - bit 7: sensor index
+ *   - bit 6: status and errorId follow, they changed for this sensor
+ *   - bit 5: both value deltas are packed into one byte
+ *   - bits 4..0: interval change, 31 means a varint of it minus 31 follows
+ *
+ *   The eco2 and tvoc deltas follow. When both are below 16 they share one
+ *   byte, eco2 in the low nibble, otherwise each is a varint of 7 bits per
+ *   byte, least significant first, bit 7 set on all but the last byte.
+ *   Status and errorId bytes are last when flagged.
+ *
+ *   Steady readings every few seconds cost two bytes per record instead of
+ *   the twelve of SAMPLEBUF_Record_TypeDef. An append encodes one record
+ *   against the kept state, so it takes constant time whatever the block
+ *   holds, and the reader decodes records one by one in the same order.
+ ******************************************************************************/
+
+#include <string.h>
+#include "em_assert.h"
+#include "histcodec.h"
+
+/***************************************************************************//**
+ * @addtogroup HISTCODEC
+ * @{
+ ******************************************************************************/
+
+#if (HISTCODEC_DATA_SIZE < HISTCODEC_RECORD_MAX) || (HISTCODEC_DATA_SIZE > 255)
+#error "HISTCODEC_BLOCK_SIZE must leave 14 to 255 bytes of data"
+#endif
+
+#define TAG_SENSOR        0x80
+#define TAG_FLAGS         0x40
+#define TAG_PACKED        0x20
+#define TAG_DT_MASK       0x1F
+#define TAG_DT_ESCAPE     31
+
+static uint32_t zigzag(int32_t value)
+{
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+static int32_t unzigzag(uint32_t value)
+{
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+static uint8_t *putVarint(uint8_t *p, uint32_t value)
+{
+  while (value >= 0x80) {
+    *p++ = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  *p++ = (uint8_t)value;
+  return p;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read one byte from the unread part of the block.
+ *
+ * @return
+ *   False past the used data.
+ ******************************************************************************/
+static bool getByte(HISTCODEC_Reader_TypeDef *reader, uint8_t *byte)
+{
+  if (reader->offset >= reader->block->length) {
+    *byte = 0;
+    return false;
+  }
+  *byte = reader->block->data[reader->offset++];
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Read a varint from the unread part of the block.
+ *
+ * @return
+ *   False if it runs past the used data or over 32 bits.
+ ******************************************************************************/
+static bool getVarint(HISTCODEC_Reader_TypeDef *reader, uint32_t *value)
+{
+  uint8_t shift = 0;
+  uint8_t byte;
+
+  *value = 0;
+  do {
+    if ((shift > 28) || !getByte(reader, &byte)) {
+      return false;
+    }
+    *value |= (uint32_t)(byte & 0x7F) << shift;
+    shift += 7;
+  } while (byte & 0x80);
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start an empty block.
+ *
+ * @param[out] block
+ *   Block to reset
+ *
+ * @param[out] state
+ *   Encoder state of the block, kept by the caller between appends
+ *
+ * @param[in] start
+ *   Timestamp of the first record that will be appended [s]
+ ******************************************************************************/
+void HISTCODEC_Open(HISTCODEC_Block_TypeDef *block, HISTCODEC_State_TypeDef *state,
+                    uint32_t start)
+{
+  block->start = start;
+  block->count = 0;
+  block->length = 0;
+  block->check = 0;
+  memset(state, 0, sizeof(*state));
+  state->timestamp[0] = start;
+  state->timestamp[1] = start;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Append a record to a block.
+ *
+ * @param[in,out] block
+ *   Block opened with HISTCODEC_Open()
+ *
+ * @param[in,out] state
+ *   Its encoder state
+ *
+ * @param[in] record
+ *   Record to add, from a sensor below HISTCODEC_SENSORS and not older
+ *   than the block or the last record of that sensor. The reserved field
+ *   is not stored.
+ *
+ * @return
+ *   False if the block is full, it is left unchanged.
+ ******************************************************************************/
+bool HISTCODEC_Append(HISTCODEC_Block_TypeDef *block, HISTCODEC_State_TypeDef *state,
+                      const SAMPLEBUF_Record_TypeDef *record)
+{
+  uint8_t encoded[HISTCODEC_RECORD_MAX];
+  uint8_t *p = encoded + 1;
+  uint8_t s = record->sensor;
+  uint32_t interval;
+  uint32_t dt;
+  uint32_t eco2Delta;
+  uint32_t tvocDelta;
+  uint8_t tag;
+  uint8_t length;
+
+  EFM_ASSERT(s < HISTCODEC_SENSORS);
+  EFM_ASSERT(record->timestamp >= state->timestamp[s]);
+
+  if (block->count == UINT8_MAX) {
+    return false;
+  }
+
+  interval = record->timestamp - state->timestamp[s];
+  dt = zigzag((int32_t)(interval - state->interval[s]));
+  eco2Delta = zigzag((int32_t)record->eco2 - (int32_t)state->eco2[s]);
+  tvocDelta = zigzag((int32_t)record->tvoc - (int32_t)state->tvoc[s]);
+
+  tag = s ? TAG_SENSOR : 0;
+  if (dt < TAG_DT_ESCAPE) {
+    tag |= (uint8_t)dt;
+  } else {
+    tag |= TAG_DT_ESCAPE;
+    p = putVarint(p, dt - TAG_DT_ESCAPE);
+  }
+  if ((eco2Delta < 16) && (tvocDelta < 16)) {
+    tag |= TAG_PACKED;
+    *p++ = (uint8_t)(eco2Delta | (tvocDelta << 4));
+  } else {
+    p = putVarint(p, eco2Delta);
+    p = putVarint(p, tvocDelta);
+  }
+  if ((record->status != state->status[s]) || (record->errorId != state->errorId[s])) {
+    tag |= TAG_FLAGS;
+    *p++ = record->status;
+    *p++ = record->errorId;
+  }
+  encoded[0] = tag;
+
+  length = (uint8_t)(p - encoded);
+  if (length > HISTCODEC_DATA_SIZE - block->length) {
+    return false;
+  }
+  memcpy(&block->data[block->length], encoded, length);
+  block->length += length;
+  block->count++;
+
+  state->timestamp[s] = record->timestamp;
+  state->interval[s]  = interval;
+  state->eco2[s]    = record->eco2;
+  state->tvoc[s]    = record->tvoc;
+  state->status[s]  = record->status;
+  state->errorId[s] = record->errorId;
+  return true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Prepare to decode a block from its first record.
+ ******************************************************************************/
+void HISTCODEC_ReaderInit(HISTCODEC_Reader_TypeDef *reader,
+                          const HISTCODEC_Block_TypeDef *block)
+{
+  reader->block = block;
+  reader->offset = 0;
+  reader->remaining = block->count;
+  memset(&reader->state, 0, sizeof(reader->state));
+  reader->state.timestamp[0] = block->start;
+  reader->state.timestamp[1] = block->start;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Decode the next record of the block.
+ *
+ * @param[in,out] reader
+ *   Reader set up by HISTCODEC_ReaderInit()
+ *
+ * @param[out] record
+ *   Decoded record, reserved is 0
+ *
+ * @return
+ *   False at the end of the block or on data that does not decode, which
+ *   also ends the block.
+ ******************************************************************************/
+bool HISTCODEC_Next(HISTCODEC_Reader_TypeDef *reader, SAMPLEBUF_Record_TypeDef *record)
+{
+  HISTCODEC_State_TypeDef *state = &reader->state;
+  uint32_t dt;
+  uint32_t eco2Delta;
+  uint32_t tvocDelta;
+  uint8_t packed;
+  uint8_t status;
+  uint8_t errorId;
+  uint8_t tag;
+  uint8_t s;
+  bool ok;
+
+  if (reader->remaining == 0) {
+    return false;
+  }
+  ok = getByte(reader, &tag);
+  s = (tag & TAG_SENSOR) ? 1 : 0;
+  status = state->status[s];
+  errorId = state->errorId[s];
+
+  dt = tag & TAG_DT_MASK;
+  if (ok && (dt == TAG_DT_ESCAPE)) {
+    ok = getVarint(reader, &dt);
+    dt += TAG_DT_ESCAPE;
+  }
+  if (ok && (tag & TAG_PACKED)) {
+    ok = getByte(reader, &packed);
+    eco2Delta = packed & 0x0F;
+    tvocDelta = packed >> 4;
+  } else if (ok) {
+    ok = getVarint(reader, &eco2Delta) && getVarint(reader, &tvocDelta);
+  }
+  if (ok && (tag & TAG_FLAGS)) {
+    ok = getByte(reader, &status) && getByte(reader, &errorId);
+  }
+  if (!ok) {
+    reader->remaining = 0;
+    return false;
+  }
+
+  state->interval[s] += (uint32_t)unzigzag(dt);
+  state->timestamp[s] += state->interval[s];
+  state->eco2[s] = (uint16_t)(state->eco2[s] + unzigzag(eco2Delta));
+  state->tvoc[s] = (uint16_t)(state->tvoc[s] + unzigzag(tvocDelta));
+  state->status[s] = status;
+  state->errorId[s] = errorId;
+  reader->remaining--;
+
+  record->timestamp = state->timestamp[s];
+  record->eco2      = state->eco2[s];
+  record->tvoc      = state->tvoc[s];
+  record->sensor    = s;
+  record->status    = status;
+  record->errorId   = errorId;
+  record->reserved  = 0;
+  return true;
+}
+
+/** @} (end group HISTCODEC) */
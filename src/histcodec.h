@@ -0,0 +1,68 @@
+/***************************************************************************//**
+ * @file histcodec.h
+ * @brief Compact block format for sample history: deltas in zig-zag varints.
+ ******************************************************************************/
+
+#ifndef HISTCODEC_H
+#define HISTCODEC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "samplebuf.h"
+
+/***************************************************************************//**
+ * @addtogroup HISTCODEC
+ * @brief Self contained blocks of delta encoded sample records
+ * @{
+ ******************************************************************************/
+
+#ifndef HISTCODEC_BLOCK_SIZE
+#define HISTCODEC_BLOCK_SIZE    128   /**< Bytes per block with header, divides a flash page */
+#endif
+
+#define HISTCODEC_HEADER_SIZE   8     /**< Bytes of HISTCODEC_Block_TypeDef before data      */
+#define HISTCODEC_DATA_SIZE     (HISTCODEC_BLOCK_SIZE - HISTCODEC_HEADER_SIZE)
+#define HISTCODEC_RECORD_MAX    14    /**< Longest encoding of one record                    */
+#define HISTCODEC_SENSORS       2     /**< Sensor indexes the format can store               */
+
+/**
+ * One block. Every block starts from zero state, so it can be decoded
+ * without any other block and blocks can be found by their start time.
+ */
+typedef struct {
+  uint32_t start;                       /**< Timestamp of the first record [s] */
+  uint8_t  count;                       /**< Records in the block              */
+  uint8_t  length;                      /**< Used bytes of data                */
+  uint16_t check;                       /**< 0, FLASHLOG stores a CRC here     */
+  uint8_t  data[HISTCODEC_DATA_SIZE];   /**< Encoded records                   */
+} HISTCODEC_Block_TypeDef;
+
+/** Values the next record is encoded against. */
+typedef struct {
+  uint32_t timestamp[HISTCODEC_SENSORS]; /**< Last timestamp per sensor [s] */
+  uint32_t interval[HISTCODEC_SENSORS];  /**< Last interval per sensor [s]  */
+  uint16_t eco2[HISTCODEC_SENSORS];      /**< Last eco2 per sensor          */
+  uint16_t tvoc[HISTCODEC_SENSORS];      /**< Last tvoc per sensor          */
+  uint8_t  status[HISTCODEC_SENSORS];    /**< Last status per sensor        */
+  uint8_t  errorId[HISTCODEC_SENSORS];   /**< Last errorId per sensor       */
+} HISTCODEC_State_TypeDef;
+
+/** Streaming decoder of one block. */
+typedef struct {
+  const HISTCODEC_Block_TypeDef *block;
+  uint8_t                 offset;       /**< Next byte of data                 */
+  uint8_t                 remaining;    /**< Records not yet decoded           */
+  HISTCODEC_State_TypeDef state;
+} HISTCODEC_Reader_TypeDef;
+
+void HISTCODEC_Open(HISTCODEC_Block_TypeDef *block, HISTCODEC_State_TypeDef *state,
+                    uint32_t start);
+bool HISTCODEC_Append(HISTCODEC_Block_TypeDef *block, HISTCODEC_State_TypeDef *state,
+                      const SAMPLEBUF_Record_TypeDef *record);
+void HISTCODEC_ReaderInit(HISTCODEC_Reader_TypeDef *reader,
+                          const HISTCODEC_Block_TypeDef *block);
+bool HISTCODEC_Next(HISTCODEC_Reader_TypeDef *reader, SAMPLEBUF_Record_TypeDef *record);
+
+/** @} (end group HISTCODEC) */
+
+#endif /* HISTCODEC_H */
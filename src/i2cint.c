@@ -0,0 +1,692 @@
+/***************************************************************************//**
+ * @file i2cint.c
+ * @brief Interrupt driven I2C master driver.
+ *
+ * @details
+ *   The emlib I2C_Transfer() state machine is advanced from the I2C0
+ *   interrupt instead of being polled in EM0. Transfers can be started
+ *   asynchronously with a completion callback, or run blocking with the
+ *   core sleeping in EM1 while the bytes move on the bus. Blocking
+ *   transfers are bounded by an RTC timeout. The core clock is held at the
+ *   CLOCKMGR boost band from the start of a transfer to its end.
+ *
+ *   With I2CINT_DMA_ENABLE, the payload of a write-write or write-read
+ *   transfer is moved by the DMA controller instead. The interrupt handler
+ *   then only runs for the address and header bytes and once at the end,
+ *   not for every data byte. emlib has no DMA support for I2C, so these
+ *   transfers run on a small state machine of their own:
+ *
+ *   - Writes: the header bytes are sent from the interrupt, then the TXBL
+ *     request feeds the payload into TXDATA. TXC ends the transfer. A NACK
+ *     on any payload byte fails it, also one that comes before TXC.
+ *   - Reads: after the repeated START the receiver runs with AUTOACK and
+ *     the RXDATAV request moves all but the last two bytes. The interrupt
+ *     handler reads those two itself. It clears AUTOACK before it reads
+ *     the second to last byte, and the receiver takes in no byte while
+ *     RXDATA is full, so the last byte is never ACKed however late the
+ *     handler runs. It is NACKed when it has arrived.
+ *
+ *   The DMA path is off by default, see I2CINT_DMA_ENABLE.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_cmu.h"
+#include "em_core.h"
+#include "em_gpio.h"
+#include "em_assert.h"
+#include "dmactrl.h"
+#include "rtctimer.h"
+#include "perf.h"
+#include "powermgr.h"
+#include "clockmgr.h"
+#include "i2cint.h"
+
+/***************************************************************************//**
+ * @addtogroup I2CINT
+ * @{
+ ******************************************************************************/
+
+/** Steps of a DMA transfer. */
+typedef enum {
+  dmaStateAddrWrite,    /**< Waiting for the write address to be ACKed  */
+  dmaStateHeader,       /**< Sending the header bytes                   */
+  dmaStateAddrRead,     /**< Waiting for the read address to be ACKed   */
+  dmaStateTx,           /**< DMA feeding the payload                    */
+  dmaStateRx,           /**< DMA collecting all but the last two bytes  */
+  dmaStateRxTail,       /**< Waiting for the second to last byte        */
+  dmaStateRxLast,       /**< Waiting for the byte to NACK               */
+  dmaStateStop          /**< Waiting for the STOP condition             */
+} I2CINT_DmaState_TypeDef;
+
+/** State of the transfer currently owned by the driver. */
+typedef struct {
+  volatile bool                       busy;
+  volatile I2C_TransferReturn_TypeDef result;
+  I2CINT_Callback_t                   callback;
+  void                                *user;
+  I2CINT_Init_TypeDef                 config;
+#if I2CINT_DMA_ENABLE
+  bool                                dma;         /**< Runs on the DMA path */
+  volatile I2CINT_DmaState_TypeDef    dmaState;
+  I2C_TransferSeq_TypeDef             *seq;
+  uint16_t                            headerIndex;
+  I2C_TransferReturn_TypeDef          dmaResult;   /**< Result once stopped  */
+#endif
+} I2CINT_State_TypeDef;
+
+static I2CINT_State_TypeDef i2c0State;
+
+#if I2CINT_DMA_ENABLE
+static void dmaDone(unsigned int channel, bool primary, void *user);
+static DMA_CB_TypeDef dmaCallback = { dmaDone, NULL, 0 };
+
+#define DMA_IEN_ERRORS  (I2C_IEN_NACK | I2C_IEN_ARBLOST | I2C_IEN_BUSERR)
+#endif
+
+/***************************************************************************//**
+ * @brief
+ *   Completion callback used by the blocking transfer.
+ ******************************************************************************/
+static void blockingDone(I2C_TransferReturn_TypeDef result, void *user)
+{
+  (void)result;
+  (void)user;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Build a write transfer from a header and a payload segment.
+ *
+ * @details
+ *   Both segments are sent back to back within one START...STOP, straight
+ *   from the caller's buffers. Typically the header is a register address
+ *   and the payload its new contents. A zero length payload gives a plain
+ *   write of the header only.
+ *
+ * @param[out] seq
+ *   Sequence structure to fill in
+ *
+ * @param[in] addr
+ *   I2C slave address
+ *
+ * @param[in] header
+ *   First segment, must not be empty
+ *
+ * @param[in] headerLen
+ *   Number of bytes in the first segment
+ *
+ * @param[in] data
+ *   Second segment, may be NULL when len is 0
+ *
+ * @param[in] len
+ *   Number of bytes in the second segment
+ ******************************************************************************/
+void I2CINT_SeqWrite(I2C_TransferSeq_TypeDef *seq, uint16_t addr,
+                     uint8_t *header, uint16_t headerLen,
+                     uint8_t *data, uint16_t len)
+{
+  EFM_ASSERT((header != NULL) && (headerLen > 0));
+
+  seq->addr = addr;
+  seq->flags = (len > 0) ? I2C_FLAG_WRITE_WRITE : I2C_FLAG_WRITE;
+  seq->buf[0].data = header;
+  seq->buf[0].len = headerLen;
+  seq->buf[1].data = data;
+  seq->buf[1].len = len;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Build a write followed by a repeated START and a read.
+ *
+ * @param[out] seq
+ *   Sequence structure to fill in
+ *
+ * @param[in] addr
+ *   I2C slave address
+ *
+ * @param[in] header
+ *   Bytes written before the repeated START, must not be empty
+ *
+ * @param[in] headerLen
+ *   Number of bytes to write
+ *
+ * @param[out] data
+ *   Receive buffer
+ *
+ * @param[in] len
+ *   Number of bytes to read, must not be 0
+ ******************************************************************************/
+void I2CINT_SeqWriteRead(I2C_TransferSeq_TypeDef *seq, uint16_t addr,
+                         uint8_t *header, uint16_t headerLen,
+                         uint8_t *data, uint16_t len)
+{
+  EFM_ASSERT((header != NULL) && (headerLen > 0));
+  EFM_ASSERT((data != NULL) && (len > 0));
+
+  seq->addr = addr;
+  seq->flags = I2C_FLAG_WRITE_READ;
+  seq->buf[0].data = header;
+  seq->buf[0].len = headerLen;
+  seq->buf[1].data = data;
+  seq->buf[1].len = len;
+}
+
+#if I2CINT_DMA_ENABLE
+/***************************************************************************//**
+ * @brief
+ *   Configure the receive and transmit channels.
+ ******************************************************************************/
+static void dmaInit(void)
+{
+  DMA_CfgChannel_TypeDef chCfg;
+  DMA_CfgDescr_TypeDef descrCfg;
+
+  DMACTRL_Init();
+
+  chCfg.highPri = false;
+  chCfg.enableInt = true;
+  chCfg.cb = &dmaCallback;
+  descrCfg.size = dmaDataSize1;
+  descrCfg.arbRate = dmaArbitrate1;
+  descrCfg.hprot = 0;
+
+  chCfg.select = DMAREQ_I2C0_RXDATAV;
+  DMA_CfgChannel(DMACTRL_CH_I2C0_RX, &chCfg);
+  descrCfg.dstInc = dmaDataInc1;
+  descrCfg.srcInc = dmaDataIncNone;
+  DMA_CfgDescr(DMACTRL_CH_I2C0_RX, true, &descrCfg);
+
+  chCfg.select = DMAREQ_I2C0_TXBL;
+  DMA_CfgChannel(DMACTRL_CH_I2C0_TX, &chCfg);
+  descrCfg.dstInc = dmaDataIncNone;
+  descrCfg.srcInc = dmaDataInc1;
+  DMA_CfgDescr(DMACTRL_CH_I2C0_TX, true, &descrCfg);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether a transfer should use the DMA path.
+ ******************************************************************************/
+static bool dmaEligible(const I2C_TransferSeq_TypeDef *seq)
+{
+  return ((seq->flags == I2C_FLAG_WRITE_WRITE) || (seq->flags == I2C_FLAG_WRITE_READ))
+         && (seq->buf[0].len > 0)
+         && (seq->buf[1].len >= I2CINT_DMA_MIN_LENGTH);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start a DMA transfer with a START and the write address.
+ ******************************************************************************/
+static void dmaStart(I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq)
+{
+  i2c0State.seq = seq;
+  i2c0State.headerIndex = 0;
+  i2c0State.dmaResult = i2cTransferDone;
+  i2c0State.dmaState = dmaStateAddrWrite;
+
+  /* Same preparation as I2C_TransferInit(). */
+  i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+  i2c->CMD = I2C_CMD_CLEARPC | I2C_CMD_CLEARTX;
+  if (i2c->IF & I2C_IF_RXDATAV) {
+    (void)i2c->RXDATA;
+  }
+  I2C_IntClear(i2c, _I2C_IF_MASK);
+  I2C_IntEnable(i2c, I2C_IEN_ACK | I2C_IEN_MSTOP | DMA_IEN_ERRORS);
+
+  i2c->CMD = I2C_CMD_START;
+  i2c->TXDATA = seq->addr & 0xFE;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Stop both channels and leave the receiver in its default mode.
+ ******************************************************************************/
+static void dmaHalt(I2C_TypeDef *i2c)
+{
+  DMA_ChannelEnable(DMACTRL_CH_I2C0_RX, false);
+  DMA_ChannelEnable(DMACTRL_CH_I2C0_TX, false);
+  i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   DMA completion, called from DMA_IRQHandler() when a payload has moved.
+ ******************************************************************************/
+static void dmaDone(unsigned int channel, bool primary, void *user)
+{
+  (void)primary;
+  (void)user;
+
+  if (!i2c0State.busy || !i2c0State.dma) {
+    return;
+  }
+  if ((channel == DMACTRL_CH_I2C0_RX) && (i2c0State.dmaState == dmaStateRx)) {
+    /* The last two bytes are read by the interrupt handler. */
+    i2c0State.dmaState = dmaStateRxTail;
+    I2C_IntEnable(I2C0, I2C_IEN_RXDATAV);
+  } else if ((channel == DMACTRL_CH_I2C0_TX) && (i2c0State.dmaState == dmaStateTx)) {
+    i2c0State.dmaState = dmaStateStop;
+    I2C_IntClear(I2C0, I2C_IF_TXC);
+    I2C_IntEnable(I2C0, I2C_IEN_TXC);
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Advance a DMA transfer from the I2C interrupt.
+ *
+ * @return
+ *   i2cTransferInProgress until the transfer has ended.
+ ******************************************************************************/
+static I2C_TransferReturn_TypeDef dmaIrq(I2C_TypeDef *i2c)
+{
+  I2C_TransferSeq_TypeDef *seq = i2c0State.seq;
+  uint32_t flags = I2C_IntGet(i2c) & I2C_IntGetEnabled(i2c);
+
+  I2C_IntClear(i2c, flags);
+
+  if (flags & (I2C_IF_ARBLOST | I2C_IF_BUSERR)) {
+    /* The bus is not ours anymore, no STOP can be sent. */
+    dmaHalt(i2c);
+    I2C_IntDisable(i2c, _I2C_IF_MASK);
+    return (flags & I2C_IF_ARBLOST) ? i2cTransferArbLost : i2cTransferBusErr;
+  }
+
+  if (flags & I2C_IF_MSTOP) {
+    I2C_IntDisable(i2c, _I2C_IF_MASK);
+    return i2c0State.dmaResult;
+  }
+
+  if ((flags & I2C_IF_NACK) && (i2c0State.dmaState != dmaStateStop)) {
+    dmaHalt(i2c);
+    I2C_IntDisable(i2c, I2C_IEN_ACK | I2C_IEN_RXDATAV | I2C_IEN_TXC);
+    i2c0State.dmaResult = i2cTransferNack;
+    i2c0State.dmaState = dmaStateStop;
+    i2c->CMD = I2C_CMD_STOP;
+    return i2cTransferInProgress;
+  }
+
+  switch (i2c0State.dmaState) {
+    case dmaStateAddrWrite:
+    case dmaStateHeader:
+      if (!(flags & I2C_IF_ACK)) {
+        break;
+      }
+      if (i2c0State.headerIndex < seq->buf[0].len) {
+        i2c0State.dmaState = dmaStateHeader;
+        i2c->TXDATA = seq->buf[0].data[i2c0State.headerIndex++];
+      } else if (seq->flags == I2C_FLAG_WRITE_WRITE) {
+        /* TXBL is already pending, the first byte goes out right away. */
+        I2C_IntDisable(i2c, I2C_IEN_ACK);
+        i2c0State.dmaState = dmaStateTx;
+        DMA_ActivateBasic(DMACTRL_CH_I2C0_TX, true, false, (void *)&i2c->TXDATA,
+                          seq->buf[1].data, seq->buf[1].len - 1);
+      } else {
+        i2c0State.dmaState = dmaStateAddrRead;
+        i2c->CMD = I2C_CMD_START;
+        i2c->TXDATA = seq->addr | 0x01;
+      }
+      break;
+
+    case dmaStateAddrRead:
+      if (!(flags & I2C_IF_ACK)) {
+        break;
+      }
+      I2C_IntDisable(i2c, I2C_IEN_ACK);
+      i2c0State.dmaState = dmaStateRx;
+      i2c->CTRL |= I2C_CTRL_AUTOACK;
+      DMA_ActivateBasic(DMACTRL_CH_I2C0_RX, true, false,
+                        seq->buf[1].data, (void *)&i2c->RXDATA,
+                        seq->buf[1].len - 3);
+      break;
+
+    case dmaStateRxTail:
+      if (!(flags & I2C_IF_RXDATAV)) {
+        break;
+      }
+      /* The last byte only comes in once RXDATA is read, it must not be ACKed. */
+      i2c->CTRL &= ~I2C_CTRL_AUTOACK;
+      seq->buf[1].data[seq->buf[1].len - 2] = i2c->RXDATA;
+      i2c0State.dmaState = dmaStateRxLast;
+      break;
+
+    case dmaStateRxLast:
+      if (!(flags & I2C_IF_RXDATAV)) {
+        break;
+      }
+      I2C_IntDisable(i2c, I2C_IEN_RXDATAV);
+      seq->buf[1].data[seq->buf[1].len - 1] = i2c->RXDATA;
+      i2c0State.dmaState = dmaStateStop;
+      i2c->CMD = I2C_CMD_NACK;
+      i2c->CMD = I2C_CMD_STOP;
+      break;
+
+    case dmaStateStop:
+      if (flags & I2C_IF_NACK) {
+        /* Any payload byte still on the wire may be NACKed, not only the last. */
+        i2c0State.dmaResult = i2cTransferNack;
+      }
+      if ((flags & (I2C_IF_TXC | I2C_IF_NACK)) && (I2C_IntGetEnabled(i2c) & I2C_IEN_TXC)) {
+        /* Last payload byte shifted out, or the slave takes no more. */
+        I2C_IntDisable(i2c, I2C_IEN_TXC);
+        i2c->CMD = I2C_CMD_STOP;
+      }
+      break;
+
+    default:
+      break;
+  }
+  return i2cTransferInProgress;
+}
+#endif /* I2CINT_DMA_ENABLE */
+
+/***************************************************************************//**
+ * @brief
+ *   Initialize the I2C peripheral and enable its interrupt.
+ *
+ * @param[in] init
+ *   Pointer to I2C initialization structure
+ ******************************************************************************/
+void I2CINT_Init(const I2CINT_Init_TypeDef *init)
+{
+  I2C_Init_TypeDef i2cInit;
+
+  EFM_ASSERT(init != NULL);
+  EFM_ASSERT(init->port == I2C0);
+
+  CMU_ClockEnable(cmuClock_HFPER, true);
+  CMU_ClockEnable(cmuClock_I2C0, true);
+
+  /* Output value must be set to 1 to not drive lines low. */
+  GPIO_PinModeSet(init->sclPort, init->sclPin, gpioModeWiredAndPullUpFilter, 1);
+  GPIO_PinModeSet(init->sdaPort, init->sdaPin, gpioModeWiredAndPullUpFilter, 1);
+
+  /* Enable pins and set location */
+  init->port->ROUTE = I2C_ROUTE_SDAPEN
+                      | I2C_ROUTE_SCLPEN
+                      | (init->portLocation << _I2C_ROUTE_LOCATION_SHIFT);
+
+  i2cInit.enable = true;
+  i2cInit.master = true; /* master mode only */
+  i2cInit.freq = init->i2cMaxFreq;
+  i2cInit.refFreq = init->i2cRefFreq;
+  i2cInit.clhr = init->i2cClhr;
+  /* The divider is set for the boost band, every transfer runs boosted. */
+  CLOCKMGR_Boost();
+  I2C_Init(init->port, &i2cInit);
+  CLOCKMGR_Unboost();
+
+  i2c0State.busy = false;
+  i2c0State.config = *init;
+#if I2CINT_DMA_ENABLE
+  dmaInit();
+#endif
+  NVIC_ClearPendingIRQ(I2C0_IRQn);
+  NVIC_EnableIRQ(I2C0_IRQn);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start an I2C transfer and return immediately.
+ *
+ * @param[in] i2c
+ *   Pointer to the peripheral port
+ *
+ * @param[in] seq
+ *   Pointer to sequence structure defining the I2C transfer to take place. The
+ *   referenced structure and its buffers must exist until the callback fires.
+ *
+ * @param[in] callback
+ *   Called from interrupt context with the transfer result. Must not be NULL.
+ *
+ * @param[in] user
+ *   Opaque pointer handed back to the callback.
+ *
+ * @return
+ *   i2cTransferInProgress when the transfer has been started,
+ *   i2cTransferUsageFault when a transfer is already active, otherwise the
+ *   error reported by I2C_TransferInit().
+ ******************************************************************************/
+I2C_TransferReturn_TypeDef I2CINT_TransferStart(I2C_TypeDef *i2c,
+                                                I2C_TransferSeq_TypeDef *seq,
+                                                I2CINT_Callback_t callback,
+                                                void *user)
+{
+  I2C_TransferReturn_TypeDef ret;
+  CORE_DECLARE_IRQ_STATE;
+
+  EFM_ASSERT(i2c == I2C0);
+  EFM_ASSERT(callback != NULL);
+
+  CORE_ENTER_CRITICAL();
+  if (i2c0State.busy) {
+    CORE_EXIT_CRITICAL();
+    return i2cTransferUsageFault;
+  }
+  i2c0State.busy = true;
+  i2c0State.result = i2cTransferInProgress;
+  i2c0State.callback = callback;
+  i2c0State.user = user;
+
+#if I2CINT_DMA_ENABLE
+  i2c0State.dma = dmaEligible(seq);
+  if (i2c0State.dma) {
+    CLOCKMGR_Boost();
+    dmaStart(i2c, seq);
+    POWERMGR_Require(powermgrEM1);
+    PERF_COUNT(i2cTransfers);
+    CORE_EXIT_CRITICAL();
+    return i2cTransferInProgress;
+  }
+#endif
+
+  /* I2C_TransferInit() enables the peripheral interrupt sources, the rest
+     of the transfer is driven from I2C0_IRQHandler(). */
+  CLOCKMGR_Boost();
+  ret = I2C_TransferInit(i2c, seq);
+  if (ret != i2cTransferInProgress) {
+    CLOCKMGR_Unboost();
+    i2c0State.busy = false;
+    i2c0State.result = ret;
+  } else {
+    // The peripheral runs on HFPERCLK, which stops in EM2
+    POWERMGR_Require(powermgrEM1);
+    PERF_COUNT(i2cTransfers);
+  }
+  CORE_EXIT_CRITICAL();
+
+  return ret;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether a transfer is in progress.
+ ******************************************************************************/
+bool I2CINT_IsBusy(I2C_TypeDef *i2c)
+{
+  EFM_ASSERT(i2c == I2C0);
+  (void)i2c;
+  return i2c0State.busy;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Abort the active transfer without calling its completion callback.
+ ******************************************************************************/
+void I2CINT_Abort(I2C_TypeDef *i2c)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  EFM_ASSERT(i2c == I2C0);
+
+  CORE_ENTER_CRITICAL();
+  if (i2c0State.busy) {
+#if I2CINT_DMA_ENABLE
+    if (i2c0State.dma) {
+      dmaHalt(i2c);
+    }
+#endif
+    I2C_IntDisable(i2c, _I2C_IF_MASK);
+    i2c->CMD = I2C_CMD_ABORT;
+    I2C_IntClear(i2c, _I2C_IF_MASK);
+    NVIC_ClearPendingIRQ(I2C0_IRQn);
+    i2c0State.result = i2cTransferSwFault;
+    i2c0State.busy = false;
+    POWERMGR_Release(powermgrEM1);
+    CLOCKMGR_Unboost();
+  }
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Perform an I2C transfer, sleeping in EM1 until it has completed or the
+ *   timeout has expired.
+ *
+ * @param[in] i2c
+ *   Pointer to the peripheral port
+ *
+ * @param[in] seq
+ *   Pointer to sequence structure defining the I2C transfer to take place.
+ *
+ * @param[in] timeoutMs
+ *   Maximum transfer time, including slave clock stretching
+ *
+ * @return
+ *   Result of the transfer, i2cTransferSwFault when it timed out.
+ ******************************************************************************/
+I2C_TransferReturn_TypeDef I2CINT_TransferTimeout(I2C_TypeDef *i2c,
+                                                  I2C_TransferSeq_TypeDef *seq,
+                                                  uint32_t timeoutMs)
+{
+  I2C_TransferReturn_TypeDef ret;
+  RTCTIMER_Timer_TypeDef timeout;
+  uint32_t cycles = PERF_CycleStart();
+  CORE_DECLARE_IRQ_STATE;
+
+  timeout.running = false;
+  ret = I2CINT_TransferStart(i2c, seq, blockingDone, NULL);
+  if (ret != i2cTransferInProgress) {
+    return ret;
+  }
+  PERF_MARK_SET(perfMarkerI2C);
+  RTCTIMER_Start(&timeout, timeoutMs, NULL, NULL);
+
+  /* Check and sleep with interrupts masked, a pending interrupt still wakes
+     the core so the completion cannot slip in between the test and WFI. */
+  CORE_ENTER_CRITICAL();
+  while (i2c0State.busy && timeout.running) {
+    POWERMGR_Sleep();
+    CORE_YIELD_CRITICAL();
+  }
+  CORE_EXIT_CRITICAL();
+
+  RTCTIMER_Stop(&timeout);
+  if (i2c0State.busy) {
+    PERF_COUNT(i2cTimeouts);
+    I2CINT_Abort(i2c);
+  }
+
+  PERF_MARK_CLEAR(perfMarkerI2C);
+  PERF_CycleEnd(perfPhaseI2C, cycles);
+  return i2c0State.result;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Perform an I2C transfer with the default timeout.
+ *
+ * @param[in] i2c
+ *   Pointer to the peripheral port
+ *
+ * @param[in] seq
+ *   Pointer to sequence structure defining the I2C transfer to take place.
+ ******************************************************************************/
+I2C_TransferReturn_TypeDef I2CINT_Transfer(I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq)
+{
+  return I2CINT_TransferTimeout(i2c, seq, I2CINT_TRANSFER_TIMEOUT_MS);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Free a bus held by a slave that has lost track of the transfer.
+ *
+ * @details
+ *   The pins are taken over as GPIO and SCL is clocked 9 times, the same
+ *   sequence I2CSPM_Init() sends after reset. A slave still driving SDA
+ *   shifts out its remaining bits and releases the line. A STOP condition
+ *   then returns the bus to idle and the peripheral is re-synchronized.
+ ******************************************************************************/
+void I2CINT_BusRecover(I2C_TypeDef *i2c)
+{
+  const I2CINT_Init_TypeDef *cfg = &i2c0State.config;
+  int i;
+
+  EFM_ASSERT(i2c == I2C0);
+
+  PERF_COUNT(i2cRecoveries);
+  I2CINT_Abort(i2c);
+
+  /* Disconnect the pins from the peripheral and drive them as GPIO. */
+  i2c->ROUTE &= ~(I2C_ROUTE_SDAPEN | I2C_ROUTE_SCLPEN);
+  GPIO_PinModeSet(cfg->sclPort, cfg->sclPin, gpioModeWiredAndPullUp, 1);
+  GPIO_PinModeSet(cfg->sdaPort, cfg->sdaPin, gpioModeWiredAndPullUp, 1);
+
+  /* Send 9 clock pulses to set slave in a defined state. */
+  for (i = 0; i < 9; i++) {
+    GPIO_PinOutSet(cfg->sclPort, cfg->sclPin);
+    GPIO_PinOutClear(cfg->sclPort, cfg->sclPin);
+  }
+
+  /* STOP condition, SDA rising while SCL is high. */
+  GPIO_PinOutClear(cfg->sdaPort, cfg->sdaPin);
+  GPIO_PinOutSet(cfg->sclPort, cfg->sclPin);
+  GPIO_PinOutSet(cfg->sdaPort, cfg->sdaPin);
+
+  GPIO_PinModeSet(cfg->sclPort, cfg->sclPin, gpioModeWiredAndPullUpFilter, 1);
+  GPIO_PinModeSet(cfg->sdaPort, cfg->sdaPin, gpioModeWiredAndPullUpFilter, 1);
+  i2c->ROUTE |= I2C_ROUTE_SDAPEN | I2C_ROUTE_SCLPEN;
+
+  /* The peripheral did not see the STOP, tell it the bus is idle. */
+  i2c->CMD = I2C_CMD_ABORT;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   I2C0 interrupt handler, advances the emlib or the DMA transfer state
+ *   machine.
+ ******************************************************************************/
+void I2C0_IRQHandler(void)
+{
+  I2C_TransferReturn_TypeDef ret;
+  I2CINT_Callback_t callback;
+  void *user;
+
+  PERF_COUNT(i2cIrqs);
+  if (!i2c0State.busy) {
+    I2C_IntClear(I2C0, _I2C_IF_MASK);
+    return;
+  }
+
+#if I2CINT_DMA_ENABLE
+  ret = i2c0State.dma ? dmaIrq(I2C0) : I2C_Transfer(I2C0);
+#else
+  ret = I2C_Transfer(I2C0);
+#endif
+  if (ret == i2cTransferInProgress) {
+    return;
+  }
+
+  /* Release the driver before the callback so it may chain a new transfer. */
+  callback = i2c0State.callback;
+  user = i2c0State.user;
+  i2c0State.result = ret;
+  i2c0State.busy = false;
+  POWERMGR_Release(powermgrEM1);
+  CLOCKMGR_Unboost();
+  callback(ret, user);
+}
+
+/** @} (end group I2CINT) */
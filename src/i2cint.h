@@ -0,0 +1,83 @@
+/***************************************************************************//**
+ * @file i2cint.h
+ * @brief Interrupt driven I2C master driver.
+ ******************************************************************************/
+
+#ifndef I2CINT_H
+#define I2CINT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_device.h"
+#include "em_gpio.h"
+#include "em_i2c.h"
+
+/***************************************************************************//**
+ * @addtogroup I2CINT
+ * @brief I2C interrupt driven master driver
+ * @{
+ ******************************************************************************/
+
+#define I2CINT_TRANSFER_TIMEOUT_MS  20   /**< Upper bound for one blocking transfer */
+
+/* The DMA path is not covered by the simulator, which has no I2C peripheral
+   below I2C_Transfer(). It stays off until it has been checked on hardware. */
+#ifndef I2CINT_DMA_ENABLE
+#define I2CINT_DMA_ENABLE           0    /**< Move payloads with the DMA controller */
+#endif
+
+#define I2CINT_DMA_MIN_LENGTH       3    /**< Shortest payload moved by DMA [bytes] */
+
+/** Completion callback, called from interrupt context when a transfer ends. */
+typedef void (*I2CINT_Callback_t)(I2C_TransferReturn_TypeDef result, void *user);
+
+/** I2C driver instance initialization structure. */
+typedef struct {
+  I2C_TypeDef          *port;          /**< Peripheral port                  */
+  GPIO_Port_TypeDef    sclPort;        /**< SCL pin port number              */
+  uint8_t              sclPin;         /**< SCL pin number                   */
+  GPIO_Port_TypeDef    sdaPort;        /**< SDA pin port number              */
+  uint8_t              sdaPin;         /**< SDA pin number                   */
+  uint8_t              portLocation;   /**< Port location                    */
+  uint32_t             i2cRefFreq;     /**< I2C reference clock, 0 = current */
+  uint32_t             i2cMaxFreq;     /**< I2C max bus frequency to use     */
+  I2C_ClockHLR_TypeDef i2cClhr;        /**< Clock low/high ratio control     */
+} I2CINT_Init_TypeDef;
+
+/** Default config for the CCS811 bus, PD6 (SDA) and PD7 (SCL) at location 1. */
+#define I2CINT_INIT_DEFAULT                                                 \
+  {                                                                         \
+    I2C0,                 /* Use I2C instance 0 */                          \
+    gpioPortD,            /* SCL port */                                    \
+    7,                    /* SCL pin */                                     \
+    gpioPortD,            /* SDA port */                                    \
+    6,                    /* SDA pin */                                     \
+    1,                    /* Location */                                    \
+    0,                    /* Use currently configured reference clock */    \
+    I2C_FREQ_FAST_MAX,    /* Set to fast rate */                            \
+    i2cClockHLRStandard,  /* Set to use 4:4 low/high duty cycle */          \
+  }
+
+void I2CINT_SeqWrite(I2C_TransferSeq_TypeDef *seq, uint16_t addr,
+                     uint8_t *header, uint16_t headerLen,
+                     uint8_t *data, uint16_t len);
+void I2CINT_SeqWriteRead(I2C_TransferSeq_TypeDef *seq, uint16_t addr,
+                         uint8_t *header, uint16_t headerLen,
+                         uint8_t *data, uint16_t len);
+
+void I2CINT_Init(const I2CINT_Init_TypeDef *init);
+I2C_TransferReturn_TypeDef I2CINT_TransferStart(I2C_TypeDef *i2c,
+                                                I2C_TransferSeq_TypeDef *seq,
+                                                I2CINT_Callback_t callback,
+                                                void *user);
+bool I2CINT_IsBusy(I2C_TypeDef *i2c);
+void I2CINT_Abort(I2C_TypeDef *i2c);
+I2C_TransferReturn_TypeDef I2CINT_Transfer(I2C_TypeDef *i2c, I2C_TransferSeq_TypeDef *seq);
+I2C_TransferReturn_TypeDef I2CINT_TransferTimeout(I2C_TypeDef *i2c,
+                                                  I2C_TransferSeq_TypeDef *seq,
+                                                  uint32_t timeoutMs);
+void I2CINT_BusRecover(I2C_TypeDef *i2c);
+
+/** @} (end group I2CINT) */
+
+#endif /* I2CINT_H */
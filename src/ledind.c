@@ -0,0 +1,213 @@
+/***************************************************************************//**
+ * @file ledind.c
+ * @brief Low duty LED indication, short blinks timed by the LETIMER.
+ *
+ * @details
+ *   A pattern is a number of short blinks at the start of every period. The
+ *   LETIMER counts down from COMP0: its underflow starts a blink and COMP1,
+ *   armed LEDIND_ON_MS below the top of the count, ends it LEDIND_ON_MS
+ *   after the underflow. COMP0 is rewritten on every COMP1 for the length
+ *   of the next cycle, the gap to the next blink of the pattern or the rest
+ *   of the period after the last one. The core wakes from EM2 twice per
+ *   blink and sleeps in between.
+ *
+ *   This board's LEDs are on PF4 and PF5, which are not among the LETIMER
+ *   output locations, so the handler drives them through the BSP instead of
+ *   the underflow output actions. That costs two short wakeups per blink
+ *   over a hardware pulse and keeps the LEDs where they are.
+ *
+ *   The LETIMER runs from the LFA clock, which RTCTIMER_Init() selects from
+ *   the LFXO, prescaled to LEDIND_FREQ. The LFA clock stops in EM3, so an
+ *   active pattern holds an EM2 requirement.
+ ******************************************************************************/
+
+#include "em_device.h"
+#include "em_cmu.h"
+#include "em_core.h"
+#include "em_letimer.h"
+#include "bsp.h"
+#include "rtctimer.h"
+#include "powermgr.h"
+#include "ledind.h"
+
+/***************************************************************************//**
+ * @addtogroup LEDIND
+ * @{
+ ******************************************************************************/
+
+/* LETIMER tick rate, the LFXO divided by 4, 16 bits span 8 s. */
+#define LEDIND_FREQ      (RTCTIMER_FREQ / 4)
+#define LEDIND_TICKS(ms) ((uint32_t)(ms) * LEDIND_FREQ / 1000)
+
+#if LEDIND_PERIOD_MS > 7900
+#error "LEDIND_PERIOD_MS exceeds the LETIMER range"
+#endif
+#if LEDIND_ON_MS >= LEDIND_GAP_MS
+#error "LEDIND_ON_MS must be shorter than LEDIND_GAP_MS"
+#endif
+#if LEDIND_GAP_MS * (LEDIND_PULSES_MAX - 1) + LEDIND_ON_MS >= LEDIND_PERIOD_MS
+#error "LEDIND_PULSES_MAX blinks do not fit in LEDIND_PERIOD_MS"
+#endif
+
+static volatile uint32_t shownLeds;
+static volatile uint8_t shownPulses;
+static volatile uint32_t shownSince;
+static volatile bool active;
+static uint8_t pulse;          /* Blink the current cycle started with */
+static uint32_t cycleTop;      /* COMP0 loaded at the next underflow   */
+
+/***************************************************************************//**
+ * @brief
+ *   COMP0 value for the cycle that starts with blink index of the pattern.
+ ******************************************************************************/
+static uint32_t cycleTicks(uint8_t index)
+{
+  uint8_t pulses = shownPulses;
+
+  if (index + 1 < pulses) {
+    return LEDIND_TICKS(LEDIND_GAP_MS) - 1;
+  }
+  return LEDIND_TICKS(LEDIND_PERIOD_MS - (pulses - 1) * LEDIND_GAP_MS) - 1;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the LETIMER, the first blink follows on the next tick. Expects
+ *   IRQs disabled.
+ ******************************************************************************/
+static void start(void)
+{
+  LETIMER_Init_TypeDef init = LETIMER_INIT_DEFAULT;
+
+  POWERMGR_Require(powermgrEM2);
+  active = true;
+  pulse = 0;
+  cycleTop = cycleTicks(0);
+
+  /* The counter is cleared, so it underflows and loads COMP0 right away. */
+  init.enable   = false;
+  init.comp0Top = true;
+  LETIMER_Init(LETIMER0, &init);
+  LETIMER_CompareSet(LETIMER0, 0, cycleTop);
+  LETIMER_IntClear(LETIMER0, LETIMER_IF_UF | LETIMER_IF_COMP1);
+  LETIMER_IntEnable(LETIMER0, LETIMER_IEN_UF | LETIMER_IEN_COMP1);
+  LETIMER_Enable(LETIMER0, true);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Stop the LETIMER with the LEDs off. Expects IRQs disabled.
+ ******************************************************************************/
+static void stop(void)
+{
+  LETIMER_Reset(LETIMER0);
+  BSP_LedsSet(0);
+  active = false;
+  POWERMGR_Release(powermgrEM2);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Clock the LETIMER and enable its interrupt. Call after RTCTIMER_Init()
+ *   and BSP_LedsInit().
+ ******************************************************************************/
+void LEDIND_Init(void)
+{
+  shownLeds = 0;
+  shownPulses = 0;
+  active = false;
+
+  CMU_ClockDivSet(cmuClock_LETIMER0, cmuClkDiv_4);
+  CMU_ClockEnable(cmuClock_LETIMER0, true);
+  LETIMER_Reset(LETIMER0);
+
+  NVIC_ClearPendingIRQ(LETIMER0_IRQn);
+  NVIC_EnableIRQ(LETIMER0_IRQn);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Blink leds pulses times per period.
+ *
+ * @details
+ *   Showing the pattern that is already shown changes nothing, and in
+ *   particular does not restart the timeout, so a pattern that stays the
+ *   same goes dark after LEDIND_TIMEOUT_S. A new pattern starts blinking
+ *   again and takes over at the next blink of the current one.
+ *
+ * @param[in] leds
+ *   BSP LED mask lit by each blink, 0 for dark.
+ *
+ * @param[in] pulses
+ *   Blinks per period, at most LEDIND_PULSES_MAX, 0 for dark.
+ ******************************************************************************/
+void LEDIND_Show(uint32_t leds, uint8_t pulses)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  if (pulses > LEDIND_PULSES_MAX) {
+    pulses = LEDIND_PULSES_MAX;
+  }
+  if ((leds == 0) || (pulses == 0)) {
+    leds = 0;
+    pulses = 0;
+  }
+
+  CORE_ENTER_ATOMIC();
+  if ((leds != shownLeds) || (pulses != shownPulses)) {
+    shownLeds = leds;
+    shownPulses = pulses;
+    shownSince = RTCTIMER_GetSeconds();
+    if (pulses == 0) {
+      if (active) {
+        stop();
+      }
+    } else if (!active) {
+      start();
+    }
+  }
+  CORE_EXIT_ATOMIC();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether a pattern is blinking.
+ ******************************************************************************/
+bool LEDIND_IsActive(void)
+{
+  return active;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   LETIMER interrupt handler, ends a blink on COMP1 and starts the next
+ *   one on underflow.
+ ******************************************************************************/
+void LETIMER0_IRQHandler(void)
+{
+  uint32_t flags = LETIMER_IntGet(LETIMER0);
+
+  LETIMER_IntClear(LETIMER0, flags);
+
+  /* Within one cycle COMP1 comes first, handle it first if both are set. */
+  if (flags & LETIMER_IF_COMP1) {
+    BSP_LedsSet(0);
+    if (++pulse >= shownPulses) {
+      pulse = 0;
+    }
+    cycleTop = cycleTicks(pulse);
+    LETIMER_CompareSet(LETIMER0, 0, cycleTop);
+  }
+
+  if (flags & LETIMER_IF_UF) {
+    if ((pulse == 0) && (LEDIND_TIMEOUT_S != 0)
+        && (RTCTIMER_GetSeconds() - shownSince >= LEDIND_TIMEOUT_S)) {
+      stop();
+      return;
+    }
+    BSP_LedsSet(shownLeds);
+    LETIMER_CompareSet(LETIMER0, 1, cycleTop - LEDIND_TICKS(LEDIND_ON_MS));
+  }
+}
+
+/** @} (end group LEDIND) */
@@ -0,0 +1,47 @@
+/***************************************************************************//**
+ * @file ledind.h
+ * @brief Low duty LED indication, short blinks timed by the LETIMER.
+ ******************************************************************************/
+
+#ifndef LEDIND_H
+#define LEDIND_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup LEDIND
+ * @brief Blink patterns that keep the core in EM2 between edges
+ * @{
+ ******************************************************************************/
+
+/** Time from the start of one pattern to the next [ms], at most 7900. */
+#ifndef LEDIND_PERIOD_MS
+#define LEDIND_PERIOD_MS        2000
+#endif
+
+/** On time of one blink [ms]. */
+#ifndef LEDIND_ON_MS
+#define LEDIND_ON_MS            10
+#endif
+
+/** Start to start distance of the blinks within a pattern [ms]. */
+#ifndef LEDIND_GAP_MS
+#define LEDIND_GAP_MS           250
+#endif
+
+/** Unchanged pattern shown this long goes dark [s], 0 blinks forever. */
+#ifndef LEDIND_TIMEOUT_S
+#define LEDIND_TIMEOUT_S        600
+#endif
+
+/** Blinks per pattern, all of them must fit in one period. */
+#define LEDIND_PULSES_MAX       4
+
+void LEDIND_Init(void);
+void LEDIND_Show(uint32_t leds, uint8_t pulses);
+bool LEDIND_IsActive(void);
+
+/** @} (end group LEDIND) */
+
+#endif /* LEDIND_H */
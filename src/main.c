@@ -36,76 +36,238 @@
  * at the sole discretion of Silicon Labs.
  ******************************************************************************/
  
-#include <stdio.h>
 #include "em_device.h"
 #include "em_chip.h"
 #include "em_i2c.h"
 #include "em_cmu.h"
 #include "em_emu.h"
 #include "em_gpio.h"
+#include "em_core.h"
 #include "bsp.h"
-#include "i2cspm.h"
+#include "i2cint.h"
+#include "rtctimer.h"
+#include "ccs811.h"
+#include "samplebuf.h"
+#include "drivemode.h"
+#include "perf.h"
+#include "baseline.h"
+#include "si7021.h"
+#include "envcomp.h"
+#include "rawiaq.h"
+#include "evqueue.h"
+#include "powermgr.h"
+#include "clockmgr.h"
+#include "ledind.h"
+#include "telem.h"
+#include "winstat.h"
+#include "flashlog.h"
+#include "fwupdate.h"
+#include "health.h"
+#include "sched.h"
+#include "bench.h"
 
 
 // Defines
-#define CORE_FREQUENCY                100000
-#define RTC_MIN_TIMEOUT                32000
-#define I2C_ADDRESS                     0xB6
-#define I2C_RXBUFFER_SIZE                 1
-
-
-#define CCS811_OK                            0x0000   /**< No errors                            */
-#define CCS811_ERROR_APPLICATION_NOT_PRESENT 0x0001   /**< Application firmware is not present  */
-#define CCS811_ERROR_NOT_IN_APPLICATION_MODE 0x0002   /**< The part is not in application mode  */
-#define CCS811_ERROR_DRIVER_NOT_INITIALIZED  0x0003   /**< The driver is not initialized        */
-#define CCS811_ERROR_I2C_TRANSACTION_FAILED  0x0004   /**< I2C transaction failed               */
-#define CCS811_ERROR_INIT_FAILED             0x0005   /**< The initialization failed            */
-#define CCS811_ERROR_FIRMWARE_UPDATE_FAILED  0x0006   /**< The firmware update was unsuccessful */
-/**@}*/
-
-/**************************************************************************//**
-* @name Register Addresses
-* @{
-******************************************************************************/
-#define CCS811_ADDR_STATUS                   0x00 /**< Status register                                                                           */
-#define CCS811_ADDR_MEASURE_MODE             0x01 /**< Measurement mode and conditions register                                                  */
-#define CCS811_ADDR_ALG_RESULT_DATA          0x02 /**< Algorithm result                                                                          */
-#define CCS811_ADDR_RAW_DATA                 0x03 /**< Raw ADC data values for resistance and current source used                                */
-#define CCS811_ADDR_ENV_DATA                 0x05 /**< Temperature and Humidity data can be written to enable compensation                       */
-#define CCS811_ADDR_NTC                      0x06 /**< Provides the voltage across the reference resistor and the voltage across the NTC resistor */
-#define CCS811_ADDR_THRESHOLDS               0x10 /**< Thresholds for operation when interrupts are only generated when eCO2 ppm crosses a threshold */
-#define CCS811_ADDR_HW_ID                    0x20 /**< Hardware ID                                                                               */
-#define CCS811_ADDR_HW_VERSION               0x21 /**< Hardware Version                                                                          */
-#define CCS811_ADDR_FW_BOOT_VERSION          0x23 /**< Firmware Boot Version                                                                     */
-#define CCS811_ADDR_FW_APP_VERSION           0x24 /**< Firmware Application Version                                                              */
-#define CCS811_ADDR_ERR_ID                   0xE0 /**< Error ID                                                                                  */
-#define CCS811_ADDR_FW_ERASE                 0xF1 /**< Firmware erase                                                                            */
-#define CCS811_ADDR_FW_PROGRAM               0xF2 /**< Firmware programming                                                                      */
-#define CCS811_ADDR_FW_VERIFY                0xF3 /**< Firmware verification                                                                     */
-#define CCS811_ADDR_APP_START                0xF4 /**< Application start                                                                         */
-#define CCS811_ADDR_SW_RESET                 0xFF /**< Software reset                                                                            */
-/**@}*/
-
-/**************************************************************************//**
-* @name Measure mode value definitions
-* @{
-******************************************************************************/
-#define CCS811_MEASURE_MODE_DRIVE_MODE_SHIFT 4     /**< DRIVE_MODE field bit shift value                                                           */
-#define CCS811_MEASURE_MODE_DRIVE_MODE_IDLE  0x00  /**< Idle mode, measurements are disabled                                                       */
-#define CCS811_MEASURE_MODE_DRIVE_MODE_1SEC  0x10  /**< IAQ Mode 1, a measurement is performed every second                                        */
-#define CCS811_MEASURE_MODE_DRIVE_MODE_10SEC 0x20  /**< IAQ Mode 2, a measurement is performed every 10 seconds                                    */
-#define CCS811_MEASURE_MODE_DRIVE_MODE_60SEC 0x30  /**< IAQ Mode 3, a measurement is performed every 60 seconds                                    */
-#define CCS811_MEASURE_MODE_DRIVE_MODE_RAW   0x40  /**< IAQ Mode 4, Raw Data Mode, a measurement is performed every 250ms for external algorithms  */
-#define CCS811_MEASURE_MODE_INTERRUPT        0x08  /**< Interrupt generation enable                                                                */
-#define CCS811_MEASURE_MODE_THRESH           0x04  /**< Enable interrupt when eCO2 level exceeds threshold
-/**@}*/
-
-
-
-bool dataAvailable = false;
-uint8_t treshData[] = {0x03,0x84, 0x05, 0xDC}; //low to med / med to high
-
-static volatile uint32_t msTicks; /* counts 1ms timeTicks */
+#define SENSOR_COUNT                      2
+
+// Build profile, sets the defaults of the options below. Low power wakes
+// on band changes and slows the cadence while readings are stable, high
+// resolution samples every second and streams every record. The benchmark
+// runs the scripted scenarios of benchScript and reports on the telemetry
+// line. It is selected by building every file with BENCH_ENABLE=1, which
+// the "GNU ARM v7.2.1 - bench" configuration does on top of the release
+// settings, together with PERF_MARKERS=1 for the scope and profiler pins.
+#define SENSOR_PROFILE_LOWPOWER           0
+#define SENSOR_PROFILE_HIGHRES            1
+#define SENSOR_PROFILE_BENCH              2
+#ifndef SENSOR_PROFILE
+#if BENCH_ENABLE
+#define SENSOR_PROFILE                    SENSOR_PROFILE_BENCH
+#else
+#define SENSOR_PROFILE                    SENSOR_PROFILE_LOWPOWER
+#endif
+#endif
+#if SENSOR_PROFILE == SENSOR_PROFILE_HIGHRES
+#ifndef SENSOR_THRESHOLD_MODE
+#define SENSOR_THRESHOLD_MODE             0
+#endif
+#ifndef SENSOR_DRIVE_POLICY
+#define SENSOR_DRIVE_POLICY               drivemodePolicyFixed
+#endif
+#ifndef TELEMETRY_AGGREGATES
+#define TELEMETRY_AGGREGATES              0
+#endif
+#elif SENSOR_PROFILE == SENSOR_PROFILE_BENCH
+// Every sample interrupts, each one is a latency measurement
+#ifndef SENSOR_THRESHOLD_MODE
+#define SENSOR_THRESHOLD_MODE             0
+#endif
+#ifndef SENSOR_DRIVE_POLICY
+#define SENSOR_DRIVE_POLICY               drivemodePolicyFixed
+#endif
+#if !BENCH_ENABLE
+#error "The benchmark profile runs bench.c, BENCH_ENABLE must be set"
+#endif
+#endif
+
+// Run the on-MCU algorithm on 250 ms RAW_DATA instead of the on-chip one
+#ifndef SENSOR_RAW_MODE
+#define SENSOR_RAW_MODE                   0
+#endif
+
+#if SENSOR_RAW_MODE
+// Index bands shown on the LEDs
+#define BAND_LOW_TO_MED                 100
+#define BAND_MED_TO_HIGH                200
+#else
+// eCO2 bands shown on the LEDs [ppm]
+#define BAND_LOW_TO_MED                 900
+#define BAND_MED_TO_HIGH               1200
+#endif
+// Only wake on band transitions instead of on every sample, not in raw mode
+#ifndef SENSOR_THRESHOLD_MODE
+#define SENSOR_THRESHOLD_MODE             (!SENSOR_RAW_MODE)
+#endif
+// Margin around each band limit for the LEDs. In threshold mode every
+// sample is a crossing the sensor has already debounced with its own
+// hysteresis, otherwise the LEDs follow the EWMA with this margin.
+#if SENSOR_THRESHOLD_MODE
+#define BAND_HYSTERESIS                   0
+#elif SENSOR_RAW_MODE
+#define BAND_HYSTERESIS                  10
+#else
+#define BAND_HYSTERESIS                  50
+#endif
+// Cadence policy, the adaptive policy starts from SENSOR_DRIVE_MODE
+#ifndef SENSOR_DRIVE_POLICY
+#define SENSOR_DRIVE_POLICY               drivemodePolicyAdaptive
+#endif
+#ifndef SENSOR_DRIVE_MODE
+#define SENSOR_DRIVE_MODE                 CCS811_MEASURE_MODE_DRIVE_MODE_1SEC
+#endif
+// Start mode of the adaptive policy when the baseline was restored
+#define SENSOR_RESTORED_MODE              CCS811_MEASURE_MODE_DRIVE_MODE_60SEC
+// nWAKE of each sensor, the interfaces sleep between transactions
+#define SENSOR_WAKE_PORT                  gpioPortC
+// Load switch for both sensors, cuts their supply in long quiet periods
+#ifndef SENSOR_POWER_GATE
+#define SENSOR_POWER_GATE                 0
+#endif
+#define SENSOR_POWER_PORT                 gpioPortC
+#define SENSOR_POWER_PIN                 13
+// Short LETIMER timed blinks per band instead of LEDs lit for the whole band
+#ifndef LED_BLINK_MODE
+#define LED_BLINK_MODE                    1
+#endif
+// Flushed sample batches go out as framed records on the LEUART
+#ifndef TELEMETRY_ENABLE
+#define TELEMETRY_ENABLE                  1
+#endif
+// Send per-period aggregates of every sensor instead of the raw batches
+#ifndef TELEMETRY_AGGREGATES
+#define TELEMETRY_AGGREGATES              1
+#endif
+// Keep the samples in a flash log that survives resets. Off in raw mode,
+// two records a second would cycle the log pages about 30 times a day.
+#ifndef FLASHLOG_ENABLE
+#define FLASHLOG_ENABLE                   (!SENSOR_RAW_MODE)
+#endif
+// After a reset, send the records logged by earlier boots on the telemetry
+// line, behind the live samples
+#ifndef FLASHLOG_REPLAY
+#define FLASHLOG_REPLAY                   (FLASHLOG_ENABLE && TELEMETRY_ENABLE)
+#endif
+#if FLASHLOG_REPLAY && !(FLASHLOG_ENABLE && TELEMETRY_ENABLE)
+#error "The log replay needs FLASHLOG_ENABLE and TELEMETRY_ENABLE"
+#endif
+// Install the CCS811 image stored at FLASHMAP_SENSORFW_BASE on sensors that
+// run another version, before they are started
+#ifndef SENSOR_FW_UPDATE
+#define SENSOR_FW_UPDATE                  0
+#endif
+#if BENCH_ENABLE && !TELEMETRY_ENABLE
+#error "The benchmark reports on the telemetry line, TELEMETRY_ENABLE must be set"
+#endif
+// Quiet time at the 60 s cadence before the supply is cut [s]
+#define SENSOR_GATE_IDLE_S             7200
+// Time the sensors stay unpowered [s]
+#define SENSOR_GATE_OFF_S              3600
+// How late a cadence step down or a power gate check may run to share a
+// wakeup with other work [ms]. A step down cuts the sensor current, any
+// delay costs more than the wakeup it would save.
+#define SENSOR_CADENCE_SLACK_MS           0
+#define SENSOR_GATE_SLACK_MS              SCHED_SLACK_DEFAULT_MS
+
+// Both sensors share the open-drain nINT line on PC10
+static const uint8_t sensorAddr[SENSOR_COUNT] = { CCS811_I2C_ADDR_HIGH, CCS811_I2C_ADDR_LOW };
+static const uint8_t sensorWakePin[SENSOR_COUNT] = { 0, 1 };
+// Configuration written after every start, the cadence policy then sets
+// MEASURE_MODE. Steps that match the power-on state are left out.
+static const CCS811_Step_TypeDef sensorSetup[] = {
+#if SENSOR_THRESHOLD_MODE && ((BAND_LOW_TO_MED != CCS811_THRESHOLD_LOW_TO_MED_DEFAULT) \
+    || (BAND_MED_TO_HIGH != CCS811_THRESHOLD_MED_TO_HIGH_DEFAULT))
+  CCS811_STEP_THRESHOLDS(BAND_LOW_TO_MED, BAND_MED_TO_HIGH,
+                         CCS811_THRESHOLD_HYSTERESIS_DEFAULT),
+#endif
+#if SENSOR_RAW_MODE
+  // Fixed at build time, the policy only confirms it from the cache
+  CCS811_STEP_MEASURE_MODE(CCS811_MEASURE_MODE_DRIVE_MODE_RAW | CCS811_MEASURE_MODE_INTERRUPT),
+#endif
+  CCS811_STEP_END
+};
+#if BENCH_ENABLE
+// Benchmark scenarios, a window of about 60 samples per drive mode
+static const BENCH_Scenario_TypeDef benchScript[] = {
+#if SENSOR_RAW_MODE
+  BENCH_SCENARIO(CCS811_MEASURE_MODE_DRIVE_MODE_RAW, 15),
+#else
+  BENCH_SCENARIO(CCS811_MEASURE_MODE_DRIVE_MODE_1SEC, 60),
+  BENCH_SCENARIO(CCS811_MEASURE_MODE_DRIVE_MODE_10SEC, 600),
+  BENCH_SCENARIO(CCS811_MEASURE_MODE_DRIVE_MODE_60SEC, 3600),
+#endif
+  BENCH_SCENARIO_END
+};
+#endif
+static CCS811_Handle_TypeDef sensors[SENSOR_COUNT];
+static HEALTH_Handle_TypeDef health[SENSOR_COUNT];
+static DRIVEMODE_Handle_TypeDef cadence[SENSOR_COUNT];
+// Tasks in run order, a Si7021 conversion started by envTask runs while
+// sensorTask reads the gas sensors. The health probes follow envDoneTask.
+static SCHED_Task_TypeDef envTask;
+static SCHED_Task_TypeDef sensorTask;
+static SCHED_Task_TypeDef envDoneTask;
+static SCHED_Task_TypeDef cadenceTask;
+#if SENSOR_POWER_GATE
+static SCHED_Task_TypeDef gateTask;
+#endif
+static SCHED_Task_TypeDef flushTask;
+#if !SENSOR_RAW_MODE
+static SCHED_Task_TypeDef baselineTask;
+#endif
+#if SENSOR_RAW_MODE
+static RAWIAQ_State_TypeDef iaq[SENSOR_COUNT];
+static uint32_t rawPushed[SENSOR_COUNT];
+#endif
+// Rolling statistics and per-period aggregates of every sensor
+static WINSTAT_Stream_TypeDef eco2Stats[SENSOR_COUNT];
+static WINSTAT_Stream_TypeDef tvocStats[SENSOR_COUNT];
+static const uint16_t bandLimits[2] = { BAND_LOW_TO_MED, BAND_MED_TO_HIGH };
+static uint8_t ledBand = 0;
+// Humidity and temperature for compensation, on the same bus
+static SI7021_Handle_TypeDef envSensor;
+#if SENSOR_POWER_GATE
+static bool sensorsGated = false;
+#endif
+// Service passes in a row that found nINT low without data
+static uint8_t stuckPasses = 0;
+#if FLASHLOG_REPLAY
+// Replay position in the flash log, logNext is read but not yet sent
+static FLASHLOG_Reader_TypeDef logReader;
+static SAMPLEBUF_Record_TypeDef logNext;
+static uint32_t logNextBoot;
+static bool logHeld = false;
+static bool logReplaying = false;
+#endif
 
 /**************************************************************************//**
  * @brief  Starting oscillators and enabling clocks
@@ -128,16 +290,9 @@ void initGPIO(void)
 {
   GPIO_PinModeSet(gpioPortC, 10, gpioModeInput, 0);
   GPIO_IntConfig(gpioPortC, 10, false, true, true);
-}
-
-
-/**************************************************************************//**
- * @brief  disables Sensor interrupts
- *****************************************************************************/
-void disableSensorInterrupts(void)
-{
-	  NVIC_DisableIRQ(GPIO_EVEN_IRQn);
-	  NVIC_DisableIRQ(GPIO_ODD_IRQn);
+#if SENSOR_POWER_GATE
+  GPIO_PinModeSet(SENSOR_POWER_PORT, SENSOR_POWER_PIN, gpioModePushPull, 1);
+#endif
 }
 
 
@@ -157,131 +312,474 @@ void enableSensorInterrupts(void)
  *****************************************************************************/
 void initI2C(void)
 {
-  // Using default settings
-  I2C_Init_TypeDef i2cInit = I2C_INIT_DEFAULT;
-  i2cInit.freq = I2C_FREQ_FAST_MAX;
+  // Using PD6 (SDA) and PD7 (SCL) at location 1, interrupt driven
+  I2CINT_Init_TypeDef i2cInit = I2CINT_INIT_DEFAULT;
 
-  // Using PD6 (SDA) and PD7 (SCL)
-  GPIO_PinModeSet(gpioPortD, 6, gpioModeWiredAndPullUpFilter, 1);
-  GPIO_PinModeSet(gpioPortD, 7, gpioModeWiredAndPullUpFilter, 1);
+  I2CINT_Init(&i2cInit);
+}
 
-  // Enable pins at location 1 as specified in datasheet
-  I2C0->ROUTE = I2C_ROUTE_SDAPEN | I2C_ROUTE_SCLPEN;
-  I2C0->ROUTE = (I2C0->ROUTE & (~_I2C_ROUTE_LOCATION_MASK)) | I2C_ROUTE_LOCATION_LOC1;
+#if !SENSOR_RAW_MODE
+/**************************************************************************//**
+ * @brief  Classifies an eCO2 value into the low (0), medium (1) or high (2)
+ *         band for the cadence policy, the LEDs use the hysteresis bands
+ *****************************************************************************/
+static uint8_t eco2Band(uint16_t eco2)
+{
+  if(eco2 > BAND_MED_TO_HIGH){
+    return 2;
+  }
+  if(eco2 > BAND_LOW_TO_MED){
+    return 1;
+  }
+  return 0;
+}
+#endif
 
-  // Initializing the I2C
-  I2C_Init(I2C0, &i2cInit);
+/**************************************************************************//**
+ * @brief  Adds a sample to the statistics of its sensor and sends the
+ *         aggregates of the period it closes
+ *****************************************************************************/
+static void trackSample(int sensor, uint16_t eco2, uint16_t tvoc, uint32_t now)
+{
+  WINSTAT_Summary_TypeDef eco2Period;
+  WINSTAT_Summary_TypeDef tvocPeriod;
+
+  // Both streams get the same timestamps, so they close periods together
+  bool closed = WINSTAT_Push(&eco2Stats[sensor], eco2, now, &eco2Period);
+  (void)WINSTAT_Push(&tvocStats[sensor], tvoc, now, &tvocPeriod);
+#if TELEMETRY_ENABLE && TELEMETRY_AGGREGATES
+  if(closed){
+    (void)TELEM_SendAggregate((uint8_t)sensor, &eco2Period, &tvocPeriod);
+  }
+#else
+  (void)closed;
+#endif
 }
 
 /**************************************************************************//**
- * @brief  Transmitting I2C data. Will busy-wait until the transfer is complete.
+ * @brief  Cadence task, applies the policy to every sensor and runs again
+ *         at the next possible step down
  *****************************************************************************/
-uint8_t writeRegister(uint8_t id, uint8_t data)
+static void updateDriveModes(SCHED_Task_TypeDef *task)
 {
-  // Transfer structure
-  I2C_TransferSeq_TypeDef i2cTransfer;
-  I2C_TransferReturn_TypeDef result;
-
-  uint8_t i2c_write_data[1];
-  i2c_write_data[0] = id;
-
-  // Initializing I2C transfer
-  i2cTransfer.addr          = I2C_ADDRESS;
-  i2cTransfer.flags         = I2C_FLAG_WRITE_WRITE;
-  i2cTransfer.buf[0].data   = i2c_write_data;
-  i2cTransfer.buf[0].len    = 1;
-  i2cTransfer.buf[1].data   = &data;
-  i2cTransfer.buf[1].len    = 1;
-
-  result = I2CSPM_Transfer(I2C0, &i2cTransfer);
-
-  // Sending data
-  if(result != i2cTransferDone)
-   {
-	  return 1;
-   }
-  return 0;
+  uint32_t now = RTCTIMER_GetSeconds();
+  uint32_t next = 0;
+
+  for(int i = 0; i < SENSOR_COUNT; i++){
+#if SENSOR_RAW_MODE
+    // Raw mode has a fixed 250 ms cadence, the policy does not apply
+    uint8_t mode = CCS811_MEASURE_MODE_DRIVE_MODE_RAW | CCS811_MEASURE_MODE_INTERRUPT;
+#else
+    uint8_t mode = DRIVEMODE_Poll(&cadence[i], now) | CCS811_MEASURE_MODE_INTERRUPT;
+#endif
+#if SENSOR_THRESHOLD_MODE
+    mode |= CCS811_MEASURE_MODE_THRESH;
+#endif
+    // Cached in the handle, unchanged modes cost no bus traffic
+    CCS811_SetMeasureMode(&sensors[i], mode);
+
+    uint32_t wait = DRIVEMODE_NextStepDown(&cadence[i], now);
+    if((wait != 0) && ((next == 0) || (wait < next))){
+      next = wait;
+    }
+    // A band change during the settle window only shows on a new read
+    if(DRIVEMODE_SettleDone(&cadence[i], now)){
+      SCHED_Signal(&sensorTask, RTCTIMER_GetTicks());
+    }
+    wait = DRIVEMODE_SettleLeft(&cadence[i], now);
+    if((wait != 0) && ((next == 0) || (wait < next))){
+      next = wait;
+    }
+  }
+
+  // In threshold mode no sample may arrive to wake us for the step down
+  if(next != 0){
+    SCHED_Start(task, next * 1000, 0, SENSOR_CADENCE_SLACK_MS);
+  }
+  else{
+    SCHED_Stop(task);
+  }
+#if SENSOR_POWER_GATE
+  SCHED_Signal(&gateTask, RTCTIMER_GetTicks());
+#endif
 }
 
+/**************************************************************************//**
+ * @brief  Boots the sensors, restores their baselines, sets up the cadence
+ *         policy and writes the sensorSetup sequence
+ *****************************************************************************/
+static void startSensors(void)
+{
+  // CCS811_Start() polls the sensor, no fixed boot delay needed
+  for(int i = 0; i < SENSOR_COUNT; i++){
+    uint8_t startMode = SENSOR_DRIVE_MODE;
+    CCS811_Start(&sensors[i]);
+    // A restored baseline skips re-conditioning at the full 1 s cadence
+    if(sensors[i].appMode && BASELINE_Restore(&sensors[i])
+       && (SENSOR_DRIVE_POLICY == drivemodePolicyAdaptive)){
+      startMode = SENSOR_RESTORED_MODE;
+    }
+    DRIVEMODE_Init(&cadence[i], SENSOR_DRIVE_POLICY, startMode, RTCTIMER_GetSeconds());
+#if SENSOR_RAW_MODE
+    RAWIAQ_Init(&iaq[i]);
+#endif
+  }
+  // Back to back once all have booted, so sensors that start sampling
+  // here stay in phase and share their nINT edges
+  for(int i = 0; i < SENSOR_COUNT; i++){
+    if(sensors[i].appMode){
+      CCS811_RunSequence(&sensors[i], sensorSetup);
+    }
+    // Also for a sensor that did not start, its first probe retries it
+    HEALTH_Start(&health[i]);
+  }
+}
 
-uint8_t writeMailbox(uint8_t id, uint8_t* data)
+#if SENSOR_POWER_GATE
+/**************************************************************************//**
+ * @brief  Power gate task, signalled by the cadence task. Cuts the sensor
+ *         supply once every sensor has been quiet at the slowest cadence
+ *         for SENSOR_GATE_IDLE_S, and restores it after SENSOR_GATE_OFF_S.
+ *****************************************************************************/
+static void updatePowerGate(SCHED_Task_TypeDef *task)
 {
-  // Transfer structure
-  I2C_TransferSeq_TypeDef i2cTransfer;
-  I2C_TransferReturn_TypeDef result;
-
-  uint8_t i2c_write_data[1];
-  i2c_write_data[0] = id;
-
-  // Initializing I2C transfer
-  i2cTransfer.addr          = I2C_ADDRESS;
-  i2cTransfer.flags         = I2C_FLAG_WRITE_WRITE;
-  i2cTransfer.buf[0].data   = i2c_write_data;
-  i2cTransfer.buf[0].len    = 1;
-  i2cTransfer.buf[1].data   = data;
-  i2cTransfer.buf[1].len    = sizeof(data);
-
-  result = I2CSPM_Transfer(I2C0, &i2cTransfer);
-
-  // Sending data
-  if(result != i2cTransferDone)
-   {
-	  return 1;
-   }
-  return 0;
+  uint32_t now = RTCTIMER_GetSeconds();
+  uint32_t wait = 0;
+
+  if(sensorsGated){
+    // Signalled while the off time still runs
+    if(SCHED_IsTimed(task)){
+      return;
+    }
+    GPIO_PinOutSet(SENSOR_POWER_PORT, SENSOR_POWER_PIN);
+    startSensors();
+    updateDriveModes(&cadenceTask);
+    GPIO_IntClear(1 << 10);
+    GPIO_IntEnable(1 << 10);
+    sensorsGated = false;
+    return;
+  }
+
+  for(int i = 0; i < SENSOR_COUNT; i++){
+    if(!sensors[i].appMode
+       || (cadence[i].mode != CCS811_MEASURE_MODE_DRIVE_MODE_60SEC)){
+      // The cadence task signals again when the mode changes
+      SCHED_Stop(task);
+      return;
+    }
+    if((now - cadence[i].stableSince < SENSOR_GATE_IDLE_S)
+       && (SENSOR_GATE_IDLE_S - (now - cadence[i].stableSince) > wait)){
+      wait = SENSOR_GATE_IDLE_S - (now - cadence[i].stableSince);
+    }
+  }
+  if(wait != 0){
+    SCHED_Start(task, wait * 1000, 0, SENSOR_GATE_SLACK_MS);
+    return;
+  }
+
+  // The baseline comes back from flash when the sensors are restarted
+  for(int i = 0; i < SENSOR_COUNT; i++){
+    HEALTH_Stop(&health[i]);
+    BASELINE_Save(&sensors[i]);
+    CCS811_PowerOff(&sensors[i]);
+  }
+#if FLASHLOG_ENABLE
+  // No samples while the supply is off, commit the staged ones now
+  (void)FLASHLOG_Sync();
+#endif
+  // nINT floats without the sensor supply
+  GPIO_IntDisable(1 << 10);
+  GPIO_PinOutClear(SENSOR_POWER_PORT, SENSOR_POWER_PIN);
+  sensorsGated = true;
+  SCHED_Start(task, SENSOR_GATE_OFF_S * 1000, 0, SENSOR_GATE_SLACK_MS);
 }
+#endif
 
+/**************************************************************************//**
+ * @brief  Keep a sample in the RAM history and, if enabled, the flash log
+ *****************************************************************************/
+static void keepSample(const SAMPLEBUF_Record_TypeDef *sample)
+{
+  uint32_t storeCycles = PERF_CycleStart();
+  SAMPLEBUF_Push(sample);
+#if FLASHLOG_ENABLE
+  // A failed commit is counted in PERF_Stats.logFailures
+  (void)FLASHLOG_Append(sample);
+#endif
+  PERF_CycleEnd(perfPhaseStore, storeCycles);
+}
 
-void writeNoData(uint8_t id)
+/**************************************************************************//**
+ * @brief  Uplink hook, receives the sample history one chunk at a time
+ *****************************************************************************/
+static bool flushSamples(const SAMPLEBUF_Record_TypeDef *records, uint16_t count)
 {
-  // Transfer structure
-  I2C_TransferSeq_TypeDef i2cTransfer;
-  I2C_TransferReturn_TypeDef result;
-
-  uint8_t i2c_write_data[1];
-  i2c_write_data[0] = id;
-
-  // Initializing I2C transfer
-  i2cTransfer.addr          = I2C_ADDRESS;
-  i2cTransfer.flags         = I2C_FLAG_WRITE;
-  i2cTransfer.buf[0].data   = i2c_write_data;
-  i2cTransfer.buf[0].len    = 1;
-  result = I2C_TransferInit(I2C0, &i2cTransfer);
-
-  // Sending data
-  while (result == i2cTransferInProgress)
-  {
-    result = I2C_Transfer(I2C0);
+#if TELEMETRY_ENABLE && !TELEMETRY_AGGREGATES
+  // Only queued here, the DMA sends it while the core sleeps. A chunk is
+  // one frame and waits in the history until the previous ones have gone.
+  if(!TELEM_HasRoom((count + TELEM_RECORDS_PER_FRAME - 1) / TELEM_RECORDS_PER_FRAME)){
+    return false;
   }
+  (void)TELEM_SendSamples(records, count);
+#else
+  (void)records;
+  (void)count;
+#endif
+  return true;
 }
 
+#if FLASHLOG_REPLAY
+/**************************************************************************//**
+ * @brief  Sends the records of earlier boots from the flash log, one frame
+ *         per boot and TELEM_RECORDS_PER_FRAME records while there is room
+ *****************************************************************************/
+static void replayLog(void)
+{
+  SAMPLEBUF_Record_TypeDef chunk[TELEM_RECORDS_PER_FRAME];
+  uint32_t boot = 0;
+  uint16_t n;
+
+  while(logReplaying && TELEM_HasRoom(1)){
+    n = 0;
+    while(n < TELEM_RECORDS_PER_FRAME){
+      if(!logHeld){
+        // Blocks this run commits are new, the replay ends at them
+        if(!FLASHLOG_Next(&logReader, &logNext, &logNextBoot)
+           || (logNextBoot == FLASHLOG_Boot())){
+          logReplaying = false;
+          break;
+        }
+        logHeld = true;
+      }
+      if((n > 0) && (logNextBoot != boot)){
+        break;
+      }
+      boot = logNextBoot;
+      chunk[n++] = logNext;
+      logHeld = false;
+    }
+    if(n > 0){
+      (void)TELEM_SendLog(boot, chunk, n);
+    }
+  }
+}
+#endif
+
+/**************************************************************************//**
+ * @brief  Retries a flush the uplink held back, signalled by the sensor task
+ *         and as the telemetry DMA makes room. The log replay gets what room
+ *         the live samples leave.
+ *****************************************************************************/
+static void retryFlush(SCHED_Task_TypeDef *task)
+{
+  (void)task;
+  if(SAMPLEBUF_FlushPending()){
+    SAMPLEBUF_Flush();
+  }
+#if FLASHLOG_REPLAY
+  if(!SAMPLEBUF_FlushPending()){
+    replayLog();
+  }
+#endif
+}
 
+/**************************************************************************//**
+ * @brief  Starts a Si7021 conversion every ENVCOMP_INTERVAL_S, collected by
+ *         envDoneTask after the gas sensors of the same pass
+ *****************************************************************************/
+static void beginEnvMeasurement(SCHED_Task_TypeDef *task)
+{
+  (void)task;
+  ENVCOMP_Begin();
+  SCHED_Signal(&envDoneTask, RTCTIMER_GetTicks());
+}
 
-uint8_t readMailbox(uint8_t id, uint8_t length, uint8_t *data)
+/**************************************************************************//**
+ * @brief  Collects the conversion and updates ENV_DATA where it moved
+ *****************************************************************************/
+static void finishEnvMeasurement(SCHED_Task_TypeDef *task)
 {
-  // Transfer structure
-  I2C_TransferSeq_TypeDef i2cTransfer;
-  I2C_TransferReturn_TypeDef result;
-
-  uint8_t i2c_write_data[1];
-  i2c_write_data[0] = id;
-
-  // Initializing I2C transfer
-  i2cTransfer.addr          = I2C_ADDRESS;
-  i2cTransfer.flags         = I2C_FLAG_WRITE_READ;
-  i2cTransfer.buf[0].data   = i2c_write_data;
-  i2cTransfer.buf[0].len    = 1;
-  i2cTransfer.buf[1].data   = data;
-  i2cTransfer.buf[1].len    = length;
-
-  result = I2CSPM_Transfer(I2C0, &i2cTransfer);
-
-    // Sending data
-    if(result != i2cTransferDone)
-     {
-    	return 1;
-     }
-    return 0;
+  (void)task;
+  ENVCOMP_Finish(sensors, SENSOR_COUNT);
+}
+
+#if !SENSOR_RAW_MODE
+/**************************************************************************//**
+ * @brief  Saves the baselines, the on-chip baseline only exists while its
+ *         algorithm runs
+ *****************************************************************************/
+static void saveBaselines(SCHED_Task_TypeDef *task)
+{
+  (void)task;
+  for(int i = 0; i < SENSOR_COUNT; i++){
+    if(sensors[i].appMode){
+      BASELINE_Service(&sensors[i], RTCTIMER_GetSeconds());
+    }
+  }
+}
+#endif
+
+/**************************************************************************//**
+ * @brief  Marks the first result of a wakeup, the end of its nINT latency
+ *****************************************************************************/
+static void firstResult(const SCHED_Task_TypeDef *task)
+{
+  PERF_ResultLatency(task->signalTicks);
+  PERF_MARK_SET(perfMarkerResult);
+}
+
+/**************************************************************************//**
+ * @brief  Sensor task, bound to the nINT events. Several edges since the
+ *         last run are covered by one read of each sensor.
+ *****************************************************************************/
+static void readSensors(SCHED_Task_TypeDef *task)
+{
+#if !SENSOR_RAW_MODE
+  CCS811_AlgResult_TypeDef algResult;
+#endif
+  SAMPLEBUF_Record_TypeDef sample;
+  uint32_t sampleCycles = PERF_CycleStart();
+  uint16_t eco2 = 0;
+  bool valid = false;
+  bool settling = false;
+
+  PERF_MARK_SET(perfMarkerSample);
+  PERF_WakeLatency(task->signalTicks);
+  // One boost for the reads of all sensors, not one per transfer
+  CLOCKMGR_Boost();
+  // One burst read per sensor returns both gases plus STATUS and ERROR_ID
+  for(int i = 0; i < SENSOR_COUNT; i++){
+    if(!sensors[i].appMode){
+      continue;
+    }
+#if SENSOR_RAW_MODE
+    uint8_t current;
+    uint16_t rawAdc;
+    uint32_t stepCycles = PERF_CycleStart();
+    uint32_t readStatus = CCS811_ReadRawData(&sensors[i], &current, &rawAdc);
+    PERF_CycleEnd(perfPhaseRead, stepCycles);
+    HEALTH_OnResult(&health[i], readStatus);
+    if(readStatus != CCS811_OK){
+      continue;
+    }
+    if(!(sensors[i].status & CCS811_STATUS_DATA_READY)){
+      continue;
+    }
+    stepCycles = PERF_CycleStart();
+    uint16_t index = RAWIAQ_Process(&iaq[i], current, rawAdc);
+    PERF_CycleEnd(perfPhaseIaq, stepCycles);
+    if(!valid){
+      firstResult(task);
+    }
+    stepCycles = PERF_CycleStart();
+    trackSample(i, index, rawAdc, RTCTIMER_GetSeconds());
+    PERF_CycleEnd(perfPhaseTrack, stepCycles);
+    // LEDs follow the smoothed index of the worse sensor
+    if(WINSTAT_Ewma(&eco2Stats[i]) > eco2){
+      eco2 = WINSTAT_Ewma(&eco2Stats[i]);
+    }
+    valid = true;
+    // Keep one record per second, the index in eco2 and RAW_DATA in tvoc
+    sample.timestamp = RTCTIMER_GetSeconds();
+    if(sample.timestamp == rawPushed[i]){
+      continue;
+    }
+    rawPushed[i]     = sample.timestamp;
+    sample.eco2      = index;
+    sample.tvoc      = ((uint16_t)current << 10) | rawAdc;
+    sample.sensor    = i;
+    sample.status    = sensors[i].status;
+    sample.errorId   = 0;
+    sample.reserved  = 0;
+    keepSample(&sample);
+#else
+    // Decodes STATUS.ERROR and ERROR_ID, recovers the sensor if needed
+    uint32_t stepCycles = PERF_CycleStart();
+    uint32_t readStatus = CCS811_ReadAlgResult(&sensors[i], &algResult);
+    PERF_CycleEnd(perfPhaseRead, stepCycles);
+    HEALTH_OnResult(&health[i], readStatus);
+    if(readStatus != CCS811_OK){
+      continue;
+    }
+    if(!(algResult.status & CCS811_STATUS_DATA_READY)){
+      continue;
+    }
+    if(!valid && !settling){
+      firstResult(task);
+    }
+    // Readings are off for a while after a step to a slower mode, they
+    // are kept out of the statistics, the log and the LEDs
+    if(DRIVEMODE_Settling(&cadence[i], RTCTIMER_GetSeconds())){
+      settling = true;
+      continue;
+    }
+    sample.timestamp = RTCTIMER_GetSeconds();
+    sample.eco2      = algResult.eco2;
+    sample.tvoc      = algResult.tvoc;
+    sample.sensor    = i;
+    sample.status    = algResult.status;
+    sample.errorId   = algResult.errorId;
+    sample.reserved  = 0;
+    keepSample(&sample);
+    stepCycles = PERF_CycleStart();
+    DRIVEMODE_OnSample(&cadence[i], algResult.eco2, eco2Band(algResult.eco2),
+                       sample.timestamp);
+    trackSample(i, algResult.eco2, algResult.tvoc, sample.timestamp);
+    PERF_CycleEnd(perfPhaseTrack, stepCycles);
+    // LEDs follow the worse sensor, smoothed unless each sample is a crossing
+#if SENSOR_THRESHOLD_MODE
+    uint16_t level = algResult.eco2;
+#else
+    uint16_t level = WINSTAT_Ewma(&eco2Stats[i]);
+#endif
+    if(level > eco2){
+      eco2 = level;
+    }
+    valid = true;
+#endif
+  }
+  CLOCKMGR_Unboost();
+  // Line still low: a sensor raised nINT after its read, no new edge
+  // will come, so run again right away. Low over several reads without
+  // data means a sensor holds it, then the deadlines take over.
+  if(GPIO_PinInGet(gpioPortC, 10) == 0){
+    stuckPasses = (valid || settling) ? 0 : stuckPasses + 1;
+    if(stuckPasses < HEALTH_NINT_STUCK_PASSES){
+      SCHED_Signal(task, RTCTIMER_GetTicks());
+    }
+    else{
+      for(int i = 0; i < SENSOR_COUNT; i++){
+        HEALTH_OnStuckInt(&health[i]);
+      }
+      stuckPasses = 0;
+    }
+  }
+  else{
+    stuckPasses = 0;
+  }
+  if(valid){
+    uint32_t ledCycles = PERF_CycleStart();
+    ledBand = WINSTAT_Band(ledBand, eco2, bandLimits, 2, BAND_HYSTERESIS);
+    uint8_t band = ledBand;
+#if LED_BLINK_MODE
+    // Medium blinks one LED once, high both LEDs twice per period
+    LEDIND_Show(band == 2 ? 3 : band, band);
+#else
+    BSP_LedsSet(band == 2 ? 3 : band);
+#endif
+    PERF_CycleEnd(perfPhaseLed, ledCycles);
+    PERF_BootDone();
+  }
+  PERF_CycleEnd(perfPhaseSample, sampleCycles);
+  PERF_MARK_CLEAR(perfMarkerResult);
+  PERF_MARK_CLEAR(perfMarkerSample);
+
+  // The samples may have changed the cadence, and a flush held back by
+  // the uplink gets another try
+  SCHED_Signal(&cadenceTask, RTCTIMER_GetTicks());
+  if(SAMPLEBUF_FlushPending()){
+    SCHED_Signal(&flushTask, RTCTIMER_GetTicks());
+  }
 }
 
 /***************************************************************************//**
@@ -291,29 +789,16 @@ void GPIO_EVEN_IRQHandler(void)
 {
 	  uint32_t interruptMask = GPIO_IntGet();
 	  GPIO_IntClear(interruptMask);
-	  dataAvailable = true;
+	  EVQUEUE_Post(evqueueSensorData, interruptMask);
 	}
 
 void GPIO_ODD_IRQHandler(void)
 {
 	  uint32_t interruptMask = GPIO_IntGet();
 	  GPIO_IntClear(interruptMask);
-	  dataAvailable = true;
+	  EVQUEUE_Post(evqueueSensorData, interruptMask);
 	}
 
-void SysTick_Handler(void)
-{
-  msTicks++;       /* increment counter necessary in Delay()*/
-}
-
-static void Delay(uint32_t dlyTicks)
-{
-  uint32_t curTicks;
-
-  curTicks = msTicks;
-  while ((msTicks - curTicks) < dlyTicks) ;
-}
-
 
 int main(void)
 {
@@ -322,6 +807,13 @@ int main(void)
 
   // Configuring clocks in the Clock Management Unit (CMU)
   initCMU();
+
+  // Control logic runs at the idle band, I2C transfers boost the core
+  CLOCKMGR_Init();
+
+  // Low energy timebase on the RTC, needs the LFXO started in initCMU()
+  RTCTIMER_Init();
+  PERF_Init();
   
   // Initializations
   initGPIO();
@@ -330,57 +822,85 @@ int main(void)
   initI2C();
 
   BSP_LedsInit();
+#if LED_BLINK_MODE
+  LEDIND_Init();
+#endif
+
+#if TELEMETRY_ENABLE
+  TELEM_Init();
+#endif
+#if FLASHLOG_ENABLE
+  // Only reads the log page headers, the time does not grow with the log
+  FLASHLOG_Init();
+#endif
+#if FLASHLOG_REPLAY
+  FLASHLOG_ReaderInit(&logReader);
+  logReplaying = true;
+#endif
+  SAMPLEBUF_Init(SAMPLEBUF_WATERMARK, flushSamples);
+  EVQUEUE_Init();
+  SCHED_Init();
+  SCHED_Add(&envTask, beginEnvMeasurement, NULL);
+  SCHED_Add(&sensorTask, readSensors, NULL);
+  SCHED_Add(&envDoneTask, finishEnvMeasurement, NULL);
+  SCHED_Bind(evqueueSensorData, &sensorTask);
+
+  BASELINE_Init(RTCTIMER_GetSeconds());
+  for(int i = 0; i < SENSOR_COUNT; i++){
+    WINSTAT_Init(&eco2Stats[i]);
+    WINSTAT_Init(&tvocStats[i]);
+  }
 
-  if (SysTick_Config(CMU_ClockFreqGet(cmuClock_CORE) / 1000)) {
-     while (1) ;
+   for(int i = 0; i < SENSOR_COUNT; i++){
+     CCS811_Init(&sensors[i], I2C0, sensorAddr[i]);
+     CCS811_SetWakePin(&sensors[i], SENSOR_WAKE_PORT, sensorWakePin[i]);
+     HEALTH_Init(&health[i], &sensors[i], sensorSetup, &sensorTask);
    }
-
-
-   Delay(1000);
-   uint8_t data[1];
-   Delay(10);
-   readMailbox(CCS811_ADDR_HW_ID,1,data);
-   Delay(10);
-   readMailbox(CCS811_ADDR_STATUS,1,data);
-   Delay(10);
-   writeNoData(CCS811_ADDR_FW_VERIFY);
-   Delay(100);
-   writeNoData(CCS811_ADDR_APP_START);
-   Delay(1000);
-   //writeMailbox(CCS811_ADDR_THRESHOLDS,treshData);
-   //Delay(10);
-   writeRegister(CCS811_ADDR_MEASURE_MODE,CCS811_MEASURE_MODE_DRIVE_MODE_1SEC + CCS811_MEASURE_MODE_INTERRUPT);
-   Delay(10);
-   readMailbox(CCS811_ADDR_ERR_ID,1,data);
-   Delay(10);
-   readMailbox(CCS811_ADDR_MEASURE_MODE,1,data);
+   SCHED_Add(&cadenceTask, updateDriveModes, NULL);
+#if SENSOR_POWER_GATE
+   SCHED_Add(&gateTask, updatePowerGate, NULL);
+#endif
+   SCHED_Add(&flushTask, retryFlush, NULL);
+   SCHED_Bind(evqueueTelemSent, &flushTask);
+#if FLASHLOG_REPLAY
+   // Starts the log replay on the first pass
+   SCHED_Signal(&flushTask, RTCTIMER_GetTicks());
+#endif
+#if !SENSOR_RAW_MODE
+   SCHED_Add(&baselineTask, saveBaselines, NULL);
+   SCHED_Start(&baselineTask, BASELINE_WARMUP_S * 1000, BASELINE_SAVE_INTERVAL_S * 1000,
+               BASELINE_SAVE_SLACK_S * 1000);
+#endif
+#if BENCH_ENABLE
+   BENCH_Init(benchScript, sensors, cadence, SENSOR_COUNT, &cadenceTask);
+#endif
+#if SENSOR_FW_UPDATE
+   if(FWUPDATE_ImageValid()){
+     for(int i = 0; i < SENSOR_COUNT; i++){
+       FWUPDATE_Run(&sensors[i]);
+     }
+   }
+#endif
+   startSensors();
+   if(SI7021_Init(&envSensor, I2C0, SI7021_I2C_ADDR) == SI7021_OK){
+     // The first measurement runs on the first pass
+     ENVCOMP_Init(&envSensor);
+     SCHED_Start(&envTask, 0, ENVCOMP_INTERVAL_S * 1000, ENVCOMP_SLACK_S * 1000);
+   }
+   else{
+     ENVCOMP_Init(NULL);
+   }
+#if BENCH_ENABLE
+   // Sets the mode of the first scenario before the policy writes it
+   BENCH_Start();
+#endif
+   updateDriveModes(&cadenceTask);
    enableSensorInterrupts();
-   EMU_EnterEM3(false);
-   uint8_t algresultData[2];
 
+  // Everything from here on runs as tasks, the idle step sleeps in the
+  // deepest mode every active subsystem allows
   while (1)
   {
-	disableSensorInterrupts();
-    if(dataAvailable)
-    {
-
-    	readMailbox(CCS811_ADDR_ALG_RESULT_DATA,2,algresultData);
-    	uint32_t concatData = (algresultData[0] << 8) | algresultData[1];
-    	dataAvailable = false;
-    	if(concatData > 1200){
-    		BSP_LedsSet(3);
-
-    	}
-    	else if(concatData > 900){
-    		BSP_LedsSet(1);
-    	}
-    	else{
-    		BSP_LedsSet(0);
-    	}
-
-    }
-    enableSensorInterrupts();
-    EMU_EnterEM3(false);
+    SCHED_Run();
   }
-
 }
@@ -0,0 +1,258 @@
+/***************************************************************************//**
+ * @file perf.c
+ * @brief Energy and latency instrumentation.
+ *
+ * @details
+ *   The Cortex-M0+ has no DWT cycle counter, so SysTick runs free at the
+ *   core clock as a 24-bit down counter and phases are timed by
+ *   differencing it. SysTick keeps counting in EM1 but stops in EM2, so
+ *   sleep residency is measured on the RTC instead. All sleeps go through
+ *   POWERMGR_Sleep() and from there the PERF_Enter functions, time not
+ *   spent in them is EM0. The RTC stops in EM3, so time spent there is not
+ *   visible in the residency.
+ *
+ *   The statistics live in PERF_Stats where a debugger can read them, and
+ *   PERF_Snapshot() gives a consistent copy for a UART dump.
+ *
+ *   RTC latencies resolve one tick, about 31 us. With PERF_MARKERS the
+ *   PERF_MARK macros also drive one pin per PERF_Marker_TypeDef, so a
+ *   logic analyser or the energy profiler shows each event exactly against
+ *   the nINT line on PC10 and the supply current.
+ ******************************************************************************/
+
+#include <string.h>
+#include "em_device.h"
+#include "em_core.h"
+#include "em_emu.h"
+#include "em_gpio.h"
+#include "rtctimer.h"
+#include "perf.h"
+
+#if PERF_ENABLE
+
+/***************************************************************************//**
+ * @addtogroup PERF
+ * @{
+ ******************************************************************************/
+
+#define SYSTICK_MASK    0x00FFFFFFUL
+#define SECONDS_PER_HOUR 3600
+
+PERF_Stats_TypeDef PERF_Stats;
+
+static uint32_t startTicks;     /* Start of the measurement window      */
+static uint32_t bootOrigin;     /* Origin of the boot time, never moved */
+static uint32_t hourIndex;
+static uint32_t hourWakeups;
+
+/***************************************************************************//**
+ * @brief
+ *   Account a sleep period and return.
+ ******************************************************************************/
+static void sleepDone(PERF_Mode_TypeDef mode, uint32_t entered)
+{
+  uint32_t hour;
+
+  PERF_Stats.modeTicks[mode] += RTCTIMER_GetTicks() - entered;
+  if (mode < perfModeEM2) {
+    return;
+  }
+
+  PERF_Stats.wakeups++;
+  hour = RTCTIMER_GetSeconds() / SECONDS_PER_HOUR;
+  if (hour != hourIndex) {
+    // Only a complete hour is reported, a skipped hour means no wakeups
+    PERF_Stats.wakeupsLastHour = (hour == hourIndex + 1) ? hourWakeups : 0;
+    hourIndex = hour;
+    hourWakeups = 0;
+  }
+  hourWakeups++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Clear the statistics and start SysTick as a free running cycle counter.
+ *   The RTC timer service must be initialized.
+ ******************************************************************************/
+void PERF_Init(void)
+{
+#if PERF_MARKERS
+  unsigned int i;
+#endif
+
+  memset(&PERF_Stats, 0, sizeof(PERF_Stats));
+  startTicks = RTCTIMER_GetTicks();
+  bootOrigin = startTicks;
+  hourIndex = 0;
+  hourWakeups = 0;
+
+  SysTick->LOAD = SYSTICK_MASK;
+  SysTick->VAL = 0;
+  SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+
+#if PERF_MARKERS
+  // The GPIO clock is on from initCMU()
+  for (i = 0; i < perfMarkerCount; i++) {
+    GPIO_PinModeSet(PERF_MARKER_PORT, PERF_MARKER_PIN_FIRST + i, gpioModePushPull, 0);
+  }
+#endif
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Clear the statistics for a new measurement window. The boot time and
+ *   the hourly wakeup count are kept, latencies of events posted before
+ *   the call are left out.
+ ******************************************************************************/
+void PERF_Restart(void)
+{
+  uint32_t bootTicks = PERF_Stats.bootTicks;
+  uint32_t wakeupsLastHour = PERF_Stats.wakeupsLastHour;
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_ATOMIC();
+  memset(&PERF_Stats, 0, sizeof(PERF_Stats));
+  PERF_Stats.bootTicks = bootTicks;
+  PERF_Stats.wakeupsLastHour = wakeupsLastHour;
+  startTicks = RTCTIMER_GetTicks();
+  CORE_EXIT_ATOMIC();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Take the start stamp of a timed phase.
+ ******************************************************************************/
+uint32_t PERF_CycleStart(void)
+{
+  return SysTick->VAL;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Account the cycles since start to a phase. Phases must be shorter than
+ *   2^24 core cycles, about 1.2 s at 14 MHz.
+ ******************************************************************************/
+void PERF_CycleEnd(PERF_Phase_TypeDef phase, uint32_t start)
+{
+  uint32_t cycles = (start - SysTick->VAL) & SYSTICK_MASK;
+  PERF_Phase_Stats_TypeDef *stats = &PERF_Stats.phase[phase];
+
+  stats->count++;
+  stats->totalCycles += cycles;
+  if (cycles > stats->maxCycles) {
+    stats->maxCycles = cycles;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Mark the first sample, latching the boot time.
+ ******************************************************************************/
+void PERF_BootDone(void)
+{
+  if (PERF_Stats.bootTicks == 0) {
+    PERF_Stats.bootTicks = RTCTIMER_GetTicks() - bootOrigin;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Account the delay between an event being posted and its handling.
+ *
+ * @param[in] postedTicks
+ *   RTC tick count stamped on the event
+ ******************************************************************************/
+void PERF_WakeLatency(uint32_t postedTicks)
+{
+  uint32_t latency = RTCTIMER_GetTicks() - postedTicks;
+
+  // Posted in a previous window, e.g. while its report was taken
+  if ((int32_t)(postedTicks - startTicks) < 0) {
+    return;
+  }
+  if (latency > PERF_Stats.wakeLatencyMax) {
+    PERF_Stats.wakeLatencyMax = latency;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Account the delay between an nINT event and the first result decoded
+ *   for it.
+ *
+ * @param[in] postedTicks
+ *   RTC tick count stamped on the event
+ ******************************************************************************/
+void PERF_ResultLatency(uint32_t postedTicks)
+{
+  uint32_t latency = RTCTIMER_GetTicks() - postedTicks;
+
+  if ((int32_t)(postedTicks - startTicks) < 0) {
+    return;
+  }
+  PERF_Stats.results++;
+  PERF_Stats.resultLatencyTotal += latency;
+  if (latency > PERF_Stats.resultLatencyMax) {
+    PERF_Stats.resultLatencyMax = latency;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Enter EM1 and account the time spent there.
+ ******************************************************************************/
+void PERF_EnterEM1(void)
+{
+  uint32_t entered = RTCTIMER_GetTicks();
+
+  EMU_EnterEM1();
+  sleepDone(perfModeEM1, entered);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Enter EM2 and account the time spent there.
+ ******************************************************************************/
+void PERF_EnterEM2(void)
+{
+  uint32_t entered = RTCTIMER_GetTicks();
+
+  EMU_EnterEM2(false);
+  sleepDone(perfModeEM2, entered);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Enter EM3 and account the time spent there.
+ ******************************************************************************/
+void PERF_EnterEM3(void)
+{
+  uint32_t entered = RTCTIMER_GetTicks();
+
+  EMU_EnterEM3(false);
+  sleepDone(perfModeEM3, entered);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Copy the statistics, filling in the EM0 residency.
+ ******************************************************************************/
+void PERF_Snapshot(PERF_Stats_TypeDef *stats)
+{
+  uint32_t total;
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_ATOMIC();
+  *stats = PERF_Stats;
+  total = RTCTIMER_GetTicks() - startTicks;
+  CORE_EXIT_ATOMIC();
+
+  stats->modeTicks[perfModeEM0] = total
+                                  - stats->modeTicks[perfModeEM1]
+                                  - stats->modeTicks[perfModeEM2]
+                                  - stats->modeTicks[perfModeEM3];
+}
+
+/** @} (end group PERF) */
+
+#endif /* PERF_ENABLE */
@@ -0,0 +1,154 @@
+/***************************************************************************//**
+ * @file perf.h
+ * @brief Energy and latency instrumentation.
+ ******************************************************************************/
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup PERF
+ * @brief Cycle counters per phase and energy mode residency
+ * @{
+ ******************************************************************************/
+
+#ifndef PERF_ENABLE
+#define PERF_ENABLE  1    /**< Set to 0 to compile the instrumentation out */
+#endif
+
+#ifndef PERF_MARKERS
+#define PERF_MARKERS 0    /**< Drive the PERF_Marker_TypeDef pins for a scope or profiler */
+#endif
+
+#ifndef PERF_MARKER_PORT
+#define PERF_MARKER_PORT      gpioPortE   /**< Port of the marker pins, on the expansion header */
+#endif
+
+#ifndef PERF_MARKER_PIN_FIRST
+#define PERF_MARKER_PIN_FIRST 10          /**< Pin of the first marker, the others follow      */
+#endif
+
+/** Code phases timed in core cycles. */
+typedef enum {
+  perfPhaseI2C,         /**< One blocking I2C transfer, bus time included */
+  perfPhaseSample,      /**< Servicing one nINT wakeup                    */
+  perfPhaseLed,         /**< Updating the band indication                 */
+  perfPhaseRead,        /**< Reading the result of one sensor             */
+  perfPhaseIaq,         /**< Raw mode index of one reading                */
+  perfPhaseTrack,       /**< Statistics and cadence policy of one sample  */
+  perfPhaseStore,       /**< History and flash log of one sample          */
+  perfPhaseCount
+} PERF_Phase_TypeDef;
+
+/** GPIO markers, high while the event lasts. */
+typedef enum {
+  perfMarkerResult,     /**< From the first result of a wakeup to its end */
+  perfMarkerSample,     /**< Servicing one nINT wakeup                    */
+  perfMarkerI2C,        /**< One blocking I2C transfer                    */
+  perfMarkerCount
+} PERF_Marker_TypeDef;
+
+/** Energy modes tracked for residency. */
+typedef enum {
+  perfModeEM0,
+  perfModeEM1,
+  perfModeEM2,
+  perfModeEM3,
+  perfModeCount
+} PERF_Mode_TypeDef;
+
+/** Accumulated timing of one phase. */
+typedef struct {
+  uint32_t count;          /**< Number of times the phase ran             */
+  uint32_t totalCycles;    /**< Sum of core cycles                        */
+  uint32_t maxCycles;      /**< Longest single run in core cycles         */
+} PERF_Phase_Stats_TypeDef;
+
+/** Statistics snapshot, laid out for a binary dump. */
+typedef struct {
+  PERF_Phase_Stats_TypeDef phase[perfPhaseCount];   /**< Per phase timing  */
+  uint32_t modeTicks[perfModeCount]; /**< RTC ticks spent in each mode     */
+  uint32_t bootTicks;           /**< RTC ticks from reset to first sample  */
+  uint32_t i2cTransfers;        /**< Transfers started                     */
+  uint32_t i2cIrqs;             /**< I2C interrupts, one per state step    */
+  uint32_t i2cTimeouts;         /**< Transfers aborted on timeout          */
+  uint32_t i2cRecoveries;       /**< Bus recovery sequences sent           */
+  uint32_t wakeups;             /**< Wakeups from EM2                      */
+  uint32_t wakeupsLastHour;     /**< Wakeups in the last complete hour     */
+  uint32_t wakeLatencyMax;      /**< RTC ticks from nINT to the first read */
+  uint32_t results;             /**< Wakeups that produced a result        */
+  uint32_t resultLatencyTotal;  /**< RTC ticks from nINT to the result, sum */
+  uint32_t resultLatencyMax;    /**< Longest of them in RTC ticks          */
+  uint32_t clockBoosts;         /**< Switches to the boost band            */
+  uint32_t telemFrames;         /**< Telemetry frames queued               */
+  uint32_t telemDropped;        /**< Telemetry frames dropped              */
+  uint32_t logCommits;          /**< Blocks committed to the flash log     */
+  uint32_t logFailures;         /**< Failed flash log erases or writes     */
+  uint32_t healthFaults;        /**< Sensor faults and missed results      */
+  uint32_t healthRewrites;      /**< MEASURE_MODE rewritten to recover     */
+  uint32_t healthResets;        /**< Sensors reset and restarted           */
+  uint32_t healthBusRecoveries; /**< Bus recoveries before a restart       */
+  uint32_t schedCoalesced;      /**< Timed tasks run on another's wakeup   */
+} PERF_Stats_TypeDef;
+
+#if PERF_ENABLE
+
+extern PERF_Stats_TypeDef PERF_Stats;
+
+/** Increment one of the event counters in PERF_Stats. */
+#define PERF_COUNT(field)   (PERF_Stats.field++)
+
+void PERF_Init(void);
+uint32_t PERF_CycleStart(void);
+void PERF_CycleEnd(PERF_Phase_TypeDef phase, uint32_t start);
+void PERF_BootDone(void);
+void PERF_WakeLatency(uint32_t postedTicks);
+void PERF_ResultLatency(uint32_t postedTicks);
+void PERF_Restart(void);
+void PERF_EnterEM1(void);
+void PERF_EnterEM2(void);
+void PERF_EnterEM3(void);
+void PERF_Snapshot(PERF_Stats_TypeDef *stats);
+
+#else
+
+#define PERF_COUNT(field)   ((void)0)
+
+#include "em_emu.h"
+
+__STATIC_INLINE void PERF_Init(void) {}
+__STATIC_INLINE uint32_t PERF_CycleStart(void) { return 0; }
+__STATIC_INLINE void PERF_CycleEnd(PERF_Phase_TypeDef phase, uint32_t start) { (void)phase; (void)start; }
+__STATIC_INLINE void PERF_BootDone(void) {}
+__STATIC_INLINE void PERF_WakeLatency(uint32_t postedTicks) { (void)postedTicks; }
+__STATIC_INLINE void PERF_ResultLatency(uint32_t postedTicks) { (void)postedTicks; }
+__STATIC_INLINE void PERF_Restart(void) {}
+__STATIC_INLINE void PERF_EnterEM1(void) { EMU_EnterEM1(); }
+__STATIC_INLINE void PERF_EnterEM2(void) { EMU_EnterEM2(false); }
+__STATIC_INLINE void PERF_EnterEM3(void) { EMU_EnterEM3(false); }
+__STATIC_INLINE void PERF_Snapshot(PERF_Stats_TypeDef *stats) { *stats = (PERF_Stats_TypeDef){ 0 }; }
+
+#endif /* PERF_ENABLE */
+
+#if PERF_ENABLE && PERF_MARKERS
+
+#include "em_gpio.h"
+
+/** Raise a marker pin, a single register write. */
+#define PERF_MARK_SET(marker)    GPIO_PinOutSet(PERF_MARKER_PORT, PERF_MARKER_PIN_FIRST + (marker))
+/** Drop a marker pin. */
+#define PERF_MARK_CLEAR(marker)  GPIO_PinOutClear(PERF_MARKER_PORT, PERF_MARKER_PIN_FIRST + (marker))
+
+#else
+
+#define PERF_MARK_SET(marker)    ((void)0)
+#define PERF_MARK_CLEAR(marker)  ((void)0)
+
+#endif /* PERF_MARKERS */
+
+/** @} (end group PERF) */
+
+#endif /* PERF_H */
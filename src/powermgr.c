@@ -0,0 +1,108 @@
+/***************************************************************************//**
+ * @file powermgr.c
+ * @brief Energy mode manager, sleeps in the deepest mode all users allow.
+ *
+ * @details
+ *   A subsystem calls POWERMGR_Require() with the deepest mode it still
+ *   works in while it is active, and POWERMGR_Release() with the same mode
+ *   when it is done. Requirements are counted, so independent users never
+ *   have to know about each other and every sleep call simply goes through
+ *   POWERMGR_Sleep(). With no requirements the core sleeps in EM3.
+ *
+ *   The counters start at zero in .bss, so drivers may register before
+ *   main() has done anything else.
+ ******************************************************************************/
+
+#include "em_device.h"
+#include "em_core.h"
+#include "em_assert.h"
+#include "perf.h"
+#include "powermgr.h"
+
+/***************************************************************************//**
+ * @addtogroup POWERMGR
+ * @{
+ ******************************************************************************/
+
+/* Number of active users limited to EM1 and to EM2. */
+static volatile uint16_t limit[powermgrEM2 + 1];
+
+/***************************************************************************//**
+ * @brief
+ *   Register that a subsystem needs the core to stay at deepest or above.
+ *   May be called from interrupt context.
+ ******************************************************************************/
+void POWERMGR_Require(POWERMGR_Mode_TypeDef deepest)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  if (deepest >= powermgrEM3) {
+    return;
+  }
+  CORE_ENTER_ATOMIC();
+  EFM_ASSERT(limit[deepest] < UINT16_MAX);
+  limit[deepest]++;
+  CORE_EXIT_ATOMIC();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Drop a requirement registered with POWERMGR_Require().
+ *   May be called from interrupt context.
+ ******************************************************************************/
+void POWERMGR_Release(POWERMGR_Mode_TypeDef deepest)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  if (deepest >= powermgrEM3) {
+    return;
+  }
+  CORE_ENTER_ATOMIC();
+  EFM_ASSERT(limit[deepest] > 0);
+  if (limit[deepest] > 0) {
+    limit[deepest]--;
+  }
+  CORE_EXIT_ATOMIC();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Deepest mode that every active user tolerates.
+ ******************************************************************************/
+POWERMGR_Mode_TypeDef POWERMGR_DeepestAllowed(void)
+{
+  if (limit[powermgrEM1] > 0) {
+    return powermgrEM1;
+  }
+  if (limit[powermgrEM2] > 0) {
+    return powermgrEM2;
+  }
+  return powermgrEM3;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Sleep in the deepest allowed mode until the next interrupt.
+ *
+ * @details
+ *   Meant to be called with interrupts masked after checking for pending
+ *   work, like every other sleep in this project. The mode is picked at the
+ *   last moment so a requirement registered by an interrupt handler that
+ *   ran before the mask is honored.
+ ******************************************************************************/
+void POWERMGR_Sleep(void)
+{
+  switch (POWERMGR_DeepestAllowed()) {
+    case powermgrEM1:
+      PERF_EnterEM1();
+      break;
+    case powermgrEM2:
+      PERF_EnterEM2();
+      break;
+    default:
+      PERF_EnterEM3();
+      break;
+  }
+}
+
+/** @} (end group POWERMGR) */
@@ -0,0 +1,31 @@
+/***************************************************************************//**
+ * @file powermgr.h
+ * @brief Energy mode manager, sleeps in the deepest mode all users allow.
+ ******************************************************************************/
+
+#ifndef POWERMGR_H
+#define POWERMGR_H
+
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup POWERMGR
+ * @brief Reference counted energy mode limits
+ * @{
+ ******************************************************************************/
+
+/** Sleep modes, ordered from shallow to deep. */
+typedef enum {
+  powermgrEM1 = 1,     /**< Core stopped, HF peripherals and DMA running  */
+  powermgrEM2 = 2,     /**< HF clocks stopped, LF peripherals running     */
+  powermgrEM3 = 3,     /**< LF clocks stopped, only async wakeups         */
+} POWERMGR_Mode_TypeDef;
+
+void POWERMGR_Require(POWERMGR_Mode_TypeDef deepest);
+void POWERMGR_Release(POWERMGR_Mode_TypeDef deepest);
+POWERMGR_Mode_TypeDef POWERMGR_DeepestAllowed(void);
+void POWERMGR_Sleep(void);
+
+/** @} (end group POWERMGR) */
+
+#endif /* POWERMGR_H */
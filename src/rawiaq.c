@@ -0,0 +1,217 @@
+/***************************************************************************//**
+ * @file rawiaq.c
+ * @brief Fixed-point air quality index computed from CCS811 raw data.
+ *
+ * @details
+ *   In raw mode the CCS811 delivers the current through the sensing layer
+ *   and the voltage across it every 250 ms. The sensor resistance falls as
+ *   VOCs rise, so the index is derived from how far the resistance has
+ *   dropped below its clean air baseline. Working on log2 of the
+ *   resistance turns that ratio into a subtraction.
+ *
+ *   The Cortex-M0+ has no FPU, no divider and no CLZ instruction. The hot
+ *   path therefore uses tables for the reciprocal of the drive current and
+ *   for the log2 mantissa, a shift search for the log2 exponent, shift
+ *   weighted filters and a precomputed piecewise linear index curve. It has
+ *   no loops and costs a bounded number of cycles each sample.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_assert.h"
+#include "rawiaq.h"
+
+/***************************************************************************//**
+ * @addtogroup RAWIAQ
+ * @{
+ ******************************************************************************/
+
+#define LOG2_FRAC_BITS   8     /* RAWIAQ_Log2() result is Q8               */
+#define STATE_SHIFT      12    /* Extra state bits, Q20, for the slow filters */
+
+/*
+ * Ohms per ADC count for each drive current, Q8:
+ * 1.65 V / 1023 / (current * 1 uA) * 256, 0 for the invalid 0 uA.
+ */
+static const uint32_t ohmsPerCount[64] = {
+       0, 412903, 206452, 137634, 103226,  82581,  68817,  58986,
+   51613,  45878,  41290,  37537,  34409,  31762,  29493,  27527,
+   25806,  24288,  22939,  21732,  20645,  19662,  18768,  17952,
+   17204,  16516,  15881,  15293,  14747,  14238,  13763,  13319,
+   12903,  12512,  12144,  11797,  11470,  11160,  10866,  10587,
+   10323,  10071,   9831,   9602,   9384,   9176,   8976,   8785,
+    8602,   8427,   8258,   8096,   7940,   7791,   7646,   7507,
+    7373,   7244,   7119,   6998,   6882,   6769,   6660,   6554,
+};
+
+/* log2(1 + i / 32) in Q8 */
+static const uint16_t log2Mantissa[33] = {
+    0,  11,  22,  33,  44,  54,  63,  73,  82,  92, 100,
+  109, 118, 126, 134, 142, 150, 157, 165, 172, 179, 186,
+  193, 200, 207, 213, 220, 226, 232, 238, 244, 250, 256,
+};
+
+/** One segment of the index curve, starting at a log2 drop of x (Q8). */
+typedef struct {
+  int32_t  x;        /* Segment start, log2 drop below baseline, Q8       */
+  uint16_t y;        /* Index at the segment start                        */
+  int32_t  slope;    /* Index per Q8 log2 unit, Q8                        */
+} Segment_TypeDef;
+
+#define SEGMENT(x0, y0, x1, y1)  { (x0), (y0), (((y1) - (y0)) << 8) / ((x1) - (x0)) }
+
+/* Half an octave below baseline is still fair, three octaves is the worst */
+static const Segment_TypeDef indexCurve[] = {
+  SEGMENT(  0,   0,  64,  50),
+  SEGMENT( 64,  50, 128, 100),
+  SEGMENT(128, 100, 256, 200),
+  SEGMENT(256, 200, 512, 350),
+  SEGMENT(512, 350, 768, RAWIAQ_INDEX_MAX),
+};
+
+#define CURVE_END      768
+
+/***************************************************************************//**
+ * @brief
+ *   Map a log2 resistance drop to the index with the piecewise curve.
+ ******************************************************************************/
+static uint16_t toIndex(int32_t drop)
+{
+  const Segment_TypeDef *seg;
+
+  if (drop <= 0) {
+    return 0;
+  }
+  if (drop >= CURVE_END) {
+    return RAWIAQ_INDEX_MAX;
+  }
+  // Unrolled search over the fixed five segments
+  seg = &indexCurve[(drop < indexCurve[2].x)
+                    ? ((drop < indexCurve[1].x) ? 0 : 1)
+                    : ((drop < indexCurve[3].x) ? 2
+                       : ((drop < indexCurve[4].x) ? 3 : 4))];
+  return seg->y + (uint16_t)(((drop - seg->x) * seg->slope) >> 8);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reset the algorithm. The first sample seeds the baseline.
+ ******************************************************************************/
+void RAWIAQ_Init(RAWIAQ_State_TypeDef *state)
+{
+  EFM_ASSERT(state != NULL);
+
+  state->filtered = 0;
+  state->baseline = 0;
+  state->samples = 0;
+  state->index = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Sensor resistance from a RAW_DATA reading.
+ *
+ * @param[in] current
+ *   Drive current [uA], 0 to 63
+ *
+ * @param[in] rawAdc
+ *   Voltage across the sensor, 1023 = 1.65 V
+ *
+ * @return
+ *   Resistance [ohm], 0 for a zero drive current.
+ ******************************************************************************/
+uint32_t RAWIAQ_Resistance(uint8_t current, uint16_t rawAdc)
+{
+  return ((rawAdc & 0x3FF) * ohmsPerCount[current & 0x3F]) >> 8;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Base 2 logarithm in Q8.
+ *
+ * @details
+ *   The exponent is found with a fixed five step shift search, the
+ *   mantissa from 32 table entries with linear interpolation between them,
+ *   accurate to 0.011.
+ *
+ * @param[in] x
+ *   Argument, must not be 0
+ ******************************************************************************/
+int32_t RAWIAQ_Log2(uint32_t x)
+{
+  uint32_t v = x;
+  uint32_t frac;
+  int32_t e = 0;
+  uint32_t i;
+
+  EFM_ASSERT(x != 0);
+
+  if (v >> 16) { v >>= 16; e += 16; }
+  if (v >> 8)  { v >>= 8;  e += 8;  }
+  if (v >> 4)  { v >>= 4;  e += 4;  }
+  if (v >> 2)  { v >>= 2;  e += 2;  }
+  if (v >> 1)  { e += 1; }
+
+  // Normalize to 1.8 fixed point, [256, 512)
+  frac = (e >= LOG2_FRAC_BITS) ? (x >> (e - LOG2_FRAC_BITS))
+                               : (x << (LOG2_FRAC_BITS - e));
+  frac -= 1U << LOG2_FRAC_BITS;
+  i = frac >> 3;
+
+  return (e << LOG2_FRAC_BITS) + log2Mantissa[i]
+         + (int32_t)(((log2Mantissa[i + 1] - log2Mantissa[i]) * (frac & 7)) >> 3);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Feed one raw sample and update the index.
+ *
+ * @details
+ *   The log resistance is low pass filtered, then compared to a baseline
+ *   that quickly follows rises in resistance (cleaner air) and only slowly
+ *   decays, so a lasting change is eventually accepted as the new clean air
+ *   level.
+ *
+ * @return
+ *   Index, 0 (clean) to RAWIAQ_INDEX_MAX. Samples with a zero drive current
+ *   or voltage are ignored and return the previous index.
+ ******************************************************************************/
+uint16_t RAWIAQ_Process(RAWIAQ_State_TypeDef *state, uint8_t current, uint16_t rawAdc)
+{
+  uint32_t ohms = RAWIAQ_Resistance(current, rawAdc);
+  int32_t level;
+
+  if (ohms == 0) {
+    return state->index;
+  }
+  level = RAWIAQ_Log2(ohms) << STATE_SHIFT;
+
+  if (state->samples == 0) {
+    state->filtered = level;
+    state->baseline = level;
+  } else {
+    state->filtered += (level - state->filtered) >> RAWIAQ_FILTER_SHIFT;
+  }
+  if (state->samples < RAWIAQ_WARMUP_SAMPLES) {
+    state->samples++;
+  }
+
+  if (state->filtered > state->baseline) {
+    state->baseline += (state->filtered - state->baseline) >> RAWIAQ_RISE_SHIFT;
+  } else {
+    state->baseline -= (state->baseline - state->filtered) >> RAWIAQ_DECAY_SHIFT;
+  }
+
+  state->index = toIndex((state->baseline - state->filtered) >> STATE_SHIFT);
+  return state->index;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   True once the baseline has had the warm-up period to settle.
+ ******************************************************************************/
+bool RAWIAQ_IsSettled(const RAWIAQ_State_TypeDef *state)
+{
+  return state->samples >= RAWIAQ_WARMUP_SAMPLES;
+}
+
+/** @} (end group RAWIAQ) */
@@ -0,0 +1,40 @@
+/***************************************************************************//**
+ * @file rawiaq.h
+ * @brief Fixed-point air quality index computed from CCS811 raw data.
+ ******************************************************************************/
+
+#ifndef RAWIAQ_H
+#define RAWIAQ_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup RAWIAQ
+ * @brief Baseline tracking and filtering on the sensor resistance
+ * @{
+ ******************************************************************************/
+
+#define RAWIAQ_INDEX_MAX        500   /**< Worst air quality index                     */
+#define RAWIAQ_FILTER_SHIFT     3     /**< Filter weight 1/8, about 2 s at 250 ms      */
+#define RAWIAQ_RISE_SHIFT       2     /**< Baseline follows cleaner air with weight 1/4 */
+#define RAWIAQ_DECAY_SHIFT      12    /**< Baseline decay weight 1/4096, tau 17 min     */
+#define RAWIAQ_WARMUP_SAMPLES   240   /**< Samples before the index is settled, 1 min  */
+
+/** Algorithm state, one per sensor. */
+typedef struct {
+  int32_t  filtered;    /**< Filtered log2 resistance, Q20                 */
+  int32_t  baseline;    /**< Clean air log2 resistance, Q20                */
+  uint16_t samples;     /**< Samples seen, saturates at the warm-up count  */
+  uint16_t index;       /**< Last index, 0 (clean) to RAWIAQ_INDEX_MAX      */
+} RAWIAQ_State_TypeDef;
+
+void RAWIAQ_Init(RAWIAQ_State_TypeDef *state);
+uint32_t RAWIAQ_Resistance(uint8_t current, uint16_t rawAdc);
+int32_t RAWIAQ_Log2(uint32_t x);
+uint16_t RAWIAQ_Process(RAWIAQ_State_TypeDef *state, uint8_t current, uint16_t rawAdc);
+bool RAWIAQ_IsSettled(const RAWIAQ_State_TypeDef *state);
+
+/** @} (end group RAWIAQ) */
+
+#endif /* RAWIAQ_H */
@@ -0,0 +1,338 @@
+/***************************************************************************//**
+ * @file rtctimer.c
+ * @brief RTC based low energy timer service.
+ *
+ * @details
+ *   The RTC runs undivided from the LFXO and keeps counting in EM2. The
+ *   24-bit counter is extended to 32 bits with the overflow interrupt, which
+ *   gives a wrap time of about 36 hours. Any number of caller allocated
+ *   timers can be armed at once; they are kept in a list sorted by expiry
+ *   and COMP0 is always programmed for the earliest one.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_device.h"
+#include "em_cmu.h"
+#include "em_core.h"
+#include "em_rtc.h"
+#include "rtctimer.h"
+#include "powermgr.h"
+
+/***************************************************************************//**
+ * @addtogroup RTCTIMER
+ * @{
+ ******************************************************************************/
+
+#define RTC_CNT_BITS     24
+#define RTC_CNT_MASK     ((1UL << RTC_CNT_BITS) - 1)
+
+static volatile uint32_t overflowCount;
+static RTCTIMER_Timer_TypeDef *timerList;
+
+/***************************************************************************//**
+ * @brief
+ *   Program COMP0 for the first timer in the list. Expects IRQs disabled.
+ ******************************************************************************/
+static void scheduleNext(uint32_t now)
+{
+  uint32_t delta;
+
+  if (timerList == NULL) {
+    RTC_IntDisable(RTC_IEN_COMP0);
+    return;
+  }
+
+  delta = timerList->expire - now;
+  if ((int32_t)delta < (int32_t)RTCTIMER_MIN_TICKS) {
+    delta = RTCTIMER_MIN_TICKS;
+  }
+
+  /* Deadlines beyond one counter period are re-evaluated on overflow. */
+  if (delta >= RTC_CNT_MASK) {
+    RTC_IntDisable(RTC_IEN_COMP0);
+    return;
+  }
+
+  RTC_CompareSet(0, (now + delta) & RTC_CNT_MASK);
+  RTC_IntClear(RTC_IF_COMP0);
+  RTC_IntEnable(RTC_IEN_COMP0);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Unlink a timer from the list. Expects IRQs disabled.
+ ******************************************************************************/
+static void unlink(RTCTIMER_Timer_TypeDef *timer)
+{
+  RTCTIMER_Timer_TypeDef **link = &timerList;
+
+  while (*link != NULL) {
+    if (*link == timer) {
+      *link = timer->next;
+      break;
+    }
+    link = &(*link)->next;
+  }
+  timer->next = NULL;
+  timer->running = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run the callbacks of all expired timers and re-arm COMP0.
+ ******************************************************************************/
+static void processTimers(void)
+{
+  RTCTIMER_Timer_TypeDef *timer;
+  uint32_t now = RTCTIMER_GetTicks();
+
+  while ((timerList != NULL) && ((int32_t)(timerList->expire - now) <= 0)) {
+    timer = timerList;
+    timerList = timer->next;
+    timer->next = NULL;
+    timer->running = false;
+    if (timer->callback != NULL) {
+      timer->callback(timer->user);
+    }
+    now = RTCTIMER_GetTicks();
+  }
+  scheduleNext(now);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start the RTC from the LFXO. The LFXO must already be running.
+ ******************************************************************************/
+void RTCTIMER_Init(void)
+{
+  RTC_Init_TypeDef rtcInit = RTC_INIT_DEFAULT;
+
+  CMU_ClockEnable(cmuClock_CORELE, true);
+  CMU_ClockSelectSet(cmuClock_LFA, cmuSelect_LFXO);
+  CMU_ClockDivSet(cmuClock_RTC, cmuClkDiv_1);
+  CMU_ClockEnable(cmuClock_RTC, true);
+
+  overflowCount = 0;
+  timerList = NULL;
+
+  // Free running over the full 24-bit range, COMP0 is used for deadlines
+  rtcInit.comp0Top = false;
+  RTC_Init(&rtcInit);
+
+  RTC_IntClear(RTC_IF_OF | RTC_IF_COMP0);
+  RTC_IntEnable(RTC_IEN_OF);
+  NVIC_ClearPendingIRQ(RTC_IRQn);
+  NVIC_EnableIRQ(RTC_IRQn);
+
+  // The RTC stops in EM3 and all timestamps are taken from it
+  POWERMGR_Require(powermgrEM2);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Take a consistent snapshot of the overflow count and the counter.
+ ******************************************************************************/
+static void readCounter(uint32_t *overflows, uint32_t *cnt)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_ATOMIC();
+  *cnt = RTC_CounterGet();
+  *overflows = overflowCount;
+  // An overflow that has not been serviced yet belongs to this reading
+  if (RTC_IntGet() & RTC_IF_OF) {
+    *cnt = RTC_CounterGet();
+    (*overflows)++;
+  }
+  CORE_EXIT_ATOMIC();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get the 32-bit extended RTC tick count.
+ ******************************************************************************/
+uint32_t RTCTIMER_GetTicks(void)
+{
+  uint32_t cnt;
+  uint32_t overflows;
+
+  readCounter(&overflows, &cnt);
+  return (overflows << RTC_CNT_BITS) | cnt;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Get the number of seconds since RTCTIMER_Init().
+ *
+ * @details
+ *   Unlike the tick count this does not wrap after 36 hours, it is meant
+ *   for timestamping samples.
+ ******************************************************************************/
+uint32_t RTCTIMER_GetSeconds(void)
+{
+  uint32_t cnt;
+  uint32_t overflows;
+
+  readCounter(&overflows, &cnt);
+  return overflows * ((RTC_CNT_MASK + 1) / RTCTIMER_FREQ) + cnt / RTCTIMER_FREQ;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Convert milliseconds to RTC ticks, rounding up.
+ ******************************************************************************/
+uint32_t RTCTIMER_MsToTicks(uint32_t ms)
+{
+  return (ms / 1000) * RTCTIMER_FREQ
+         + ((ms % 1000) * RTCTIMER_FREQ + 999) / 1000;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Convert RTC ticks to milliseconds, rounding down.
+ ******************************************************************************/
+uint32_t RTCTIMER_TicksToMs(uint32_t ticks)
+{
+  return (ticks / RTCTIMER_FREQ) * 1000
+         + ((ticks % RTCTIMER_FREQ) * 1000) / RTCTIMER_FREQ;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Arm a timer to expire a number of ticks from now.
+ *
+ * @details
+ *   Re-arming a running timer restarts it with the new timeout.
+ *
+ * @param[in] timer
+ *   Caller allocated timer object
+ *
+ * @param[in] ticks
+ *   Timeout in RTC ticks, must be below 2^31
+ *
+ * @param[in] callback
+ *   Called from interrupt context on expiry, may be NULL for polled use
+ *
+ * @param[in] user
+ *   Opaque pointer handed to the callback
+ ******************************************************************************/
+void RTCTIMER_StartTicks(RTCTIMER_Timer_TypeDef *timer, uint32_t ticks,
+                         RTCTIMER_Callback_t callback, void *user)
+{
+  RTCTIMER_Timer_TypeDef **link;
+  uint32_t now;
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_CRITICAL();
+  if (timer->running) {
+    unlink(timer);
+  }
+
+  now = RTCTIMER_GetTicks();
+  timer->expire = now + ticks;
+  timer->callback = callback;
+  timer->user = user;
+  timer->running = true;
+
+  // Insert sorted on remaining time, equal deadlines keep arming order
+  link = &timerList;
+  while ((*link != NULL)
+         && ((int32_t)((*link)->expire - now) <= (int32_t)ticks)) {
+    link = &(*link)->next;
+  }
+  timer->next = *link;
+  *link = timer;
+
+  if (timerList == timer) {
+    scheduleNext(now);
+  }
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Arm a timer to expire a number of milliseconds from now.
+ ******************************************************************************/
+void RTCTIMER_Start(RTCTIMER_Timer_TypeDef *timer, uint32_t ms,
+                    RTCTIMER_Callback_t callback, void *user)
+{
+  RTCTIMER_StartTicks(timer, RTCTIMER_MsToTicks(ms), callback, user);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Disarm a timer. Stopping a timer that is not running is harmless.
+ ******************************************************************************/
+void RTCTIMER_Stop(RTCTIMER_Timer_TypeDef *timer)
+{
+  CORE_DECLARE_IRQ_STATE;
+
+  CORE_ENTER_CRITICAL();
+  if (timer->running) {
+    unlink(timer);
+    scheduleNext(RTCTIMER_GetTicks());
+  }
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether a timer is armed.
+ ******************************************************************************/
+bool RTCTIMER_IsRunning(const RTCTIMER_Timer_TypeDef *timer)
+{
+  return timer->running;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Sleep for at least the given number of milliseconds, in the deepest
+ *   mode the active subsystems allow.
+ ******************************************************************************/
+void RTCTIMER_Delay(uint32_t ms)
+{
+  RTCTIMER_DelayTicks(RTCTIMER_MsToTicks(ms));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Sleep for at least the given number of RTC ticks, for waits shorter
+ *   than a millisecond allows to express.
+ ******************************************************************************/
+void RTCTIMER_DelayTicks(uint32_t ticks)
+{
+  RTCTIMER_Timer_TypeDef timer;
+  CORE_DECLARE_IRQ_STATE;
+
+  if (ticks == 0) {
+    return;
+  }
+
+  timer.running = false;
+  RTCTIMER_StartTicks(&timer, ticks, NULL, NULL);
+
+  CORE_ENTER_CRITICAL();
+  while (timer.running) {
+    POWERMGR_Sleep();
+    CORE_YIELD_CRITICAL();
+  }
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   RTC interrupt handler, extends the counter and expires timers.
+ ******************************************************************************/
+void RTC_IRQHandler(void)
+{
+  uint32_t flags = RTC_IntGet();
+
+  // Clear OF before counting it so RTCTIMER_GetTicks() never counts it twice
+  RTC_IntClear(flags);
+  if (flags & RTC_IF_OF) {
+    overflowCount++;
+  }
+  processTimers();
+}
+
+/** @} (end group RTCTIMER) */
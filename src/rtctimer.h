@@ -0,0 +1,49 @@
+/***************************************************************************//**
+ * @file rtctimer.h
+ * @brief RTC based low energy timer service.
+ ******************************************************************************/
+
+#ifndef RTCTIMER_H
+#define RTCTIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup RTCTIMER
+ * @brief Low energy timers on the RTC, clocked from the LFXO
+ * @{
+ ******************************************************************************/
+
+#define RTCTIMER_FREQ           32768U  /**< RTC tick rate, LFXO undivided      */
+#define RTCTIMER_MIN_TICKS      3U      /**< Minimum compare distance from CNT  */
+
+/** Timer expiry callback, called from interrupt context. */
+typedef void (*RTCTIMER_Callback_t)(void *user);
+
+/** Timer object. Storage is owned by the caller and must outlive the timer. */
+typedef struct RTCTIMER_Timer {
+  struct RTCTIMER_Timer *next;       /**< Next timer in the expiry list       */
+  uint32_t              expire;      /**< Absolute expiry tick                */
+  RTCTIMER_Callback_t   callback;    /**< Expiry callback, may be NULL        */
+  void                  *user;       /**< Opaque pointer for the callback     */
+  volatile bool         running;     /**< True while the timer is armed       */
+} RTCTIMER_Timer_TypeDef;
+
+void RTCTIMER_Init(void);
+uint32_t RTCTIMER_GetTicks(void);
+uint32_t RTCTIMER_GetSeconds(void);
+uint32_t RTCTIMER_MsToTicks(uint32_t ms);
+uint32_t RTCTIMER_TicksToMs(uint32_t ticks);
+void RTCTIMER_Start(RTCTIMER_Timer_TypeDef *timer, uint32_t ms,
+                    RTCTIMER_Callback_t callback, void *user);
+void RTCTIMER_StartTicks(RTCTIMER_Timer_TypeDef *timer, uint32_t ticks,
+                         RTCTIMER_Callback_t callback, void *user);
+void RTCTIMER_Stop(RTCTIMER_Timer_TypeDef *timer);
+bool RTCTIMER_IsRunning(const RTCTIMER_Timer_TypeDef *timer);
+void RTCTIMER_Delay(uint32_t ms);
+void RTCTIMER_DelayTicks(uint32_t ticks);
+
+/** @} (end group RTCTIMER) */
+
+#endif /* RTCTIMER_H */
@@ -0,0 +1,213 @@
+/***************************************************************************//**
+ * @file samplebuf.c
+ * @brief RAM ring buffer of timestamped air quality samples.
+ *
+ * @details
+ *   Samples are collected in a ring of HISTCODEC blocks and handed to the
+ *   flush callback in one batch once the watermark is reached, so an uplink
+ *   only has to be powered up once per batch. The delta encoding keeps four
+ *   to five times as many records as plain records would in the same RAM.
+ *
+ *   The flush decodes one chunk at a time and the callback may refuse a
+ *   chunk, for example while the uplink is still busy with the previous
+ *   one. The flush then stops at that chunk and SAMPLEBUF_Flush() picks it
+ *   up again later, so a large batch streams out as fast as the uplink
+ *   takes it. A block that is being read takes no more records.
+ *
+ *   A full ring is flushed before a block is overwritten. If that does not
+ *   free a block the oldest one is overwritten and its unsent records are
+ *   counted as dropped. The buffer is meant to be used from the main loop
+ *   only, it is not interrupt safe.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_assert.h"
+#include "histcodec.h"
+#include "samplebuf.h"
+
+/***************************************************************************//**
+ * @addtogroup SAMPLEBUF
+ * @{
+ ******************************************************************************/
+
+static HISTCODEC_Block_TypeDef blocks[SAMPLEBUF_BLOCKS];
+static HISTCODEC_State_TypeDef encoder;    /* State of the newest block      */
+static HISTCODEC_Reader_TypeDef reader;    /* Flush position in the oldest   */
+static uint8_t  head;       /* Index of the oldest block                      */
+static uint8_t  used;       /* Blocks holding records                         */
+static bool     reading;    /* reader is set up on the oldest block           */
+static bool     sealed;     /* The newest block is being read, append no more */
+static bool     pending;    /* The callback refused a chunk                   */
+static uint16_t count;
+static uint16_t flushLevel;
+static uint32_t dropped;
+static SAMPLEBUF_FlushCallback_t flushCallback;
+
+/***************************************************************************//**
+ * @brief
+ *   Index of a block counted from the oldest one.
+ ******************************************************************************/
+static uint8_t blockAt(uint8_t age)
+{
+  return (uint8_t)((head + age) % SAMPLEBUF_BLOCKS);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Empty the buffer and set the flush policy.
+ *
+ * @param[in] watermark
+ *   Number of records that triggers a flush. A full buffer is flushed
+ *   earlier, how many records fit depends on how well they compress.
+ *
+ * @param[in] callback
+ *   Batch consumer, NULL keeps the buffer as a rolling history only
+ ******************************************************************************/
+void SAMPLEBUF_Init(uint16_t watermark, SAMPLEBUF_FlushCallback_t callback)
+{
+  EFM_ASSERT(watermark > 0);
+
+  head = 0;
+  used = 0;
+  reading = false;
+  sealed = false;
+  pending = false;
+  count = 0;
+  dropped = 0;
+  flushLevel = watermark;
+  flushCallback = callback;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Append a record, flushing the buffer when the watermark is reached.
+ ******************************************************************************/
+void SAMPLEBUF_Push(const SAMPLEBUF_Record_TypeDef *record)
+{
+  HISTCODEC_Block_TypeDef *block;
+
+  if ((used > 0) && !sealed
+      && HISTCODEC_Append(&blocks[blockAt(used - 1)], &encoder, record)) {
+    count++;
+  } else {
+    if ((used == SAMPLEBUF_BLOCKS) && (flushCallback != NULL)) {
+      SAMPLEBUF_Flush();
+    }
+    if (used == SAMPLEBUF_BLOCKS) {
+      // Overwrite the oldest block
+      uint8_t unsent = reading ? reader.remaining : blocks[head].count;
+      count -= unsent;
+      dropped += unsent;
+      head = blockAt(1);
+      used--;
+      reading = false;
+    }
+
+    // A record always fits into an empty block
+    block = &blocks[blockAt(used)];
+    used++;
+    sealed = false;
+    HISTCODEC_Open(block, &encoder, record->timestamp);
+    (void)HISTCODEC_Append(block, &encoder, record);
+    count++;
+  }
+
+  if ((count >= flushLevel) && (flushCallback != NULL)) {
+    SAMPLEBUF_Flush();
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Hand buffered records to the flush callback, oldest first, until the
+ *   buffer is empty or the callback refuses a chunk.
+ *
+ * @details
+ *   Blocks are decoded into a chunk on the stack, so the records never
+ *   exist in plain form all at once. The position only advances past a
+ *   chunk once the callback has taken it.
+ ******************************************************************************/
+void SAMPLEBUF_Flush(void)
+{
+  SAMPLEBUF_Record_TypeDef chunk[SAMPLEBUF_FLUSH_CHUNK];
+  HISTCODEC_Reader_TypeDef next;
+  uint8_t finished;
+  uint16_t n;
+
+  if (flushCallback == NULL) {
+    return;
+  }
+  pending = false;
+
+  while (used > 0) {
+    if (!reading) {
+      HISTCODEC_ReaderInit(&reader, &blocks[head]);
+      reading = true;
+      if (used == 1) {
+        // Reading the newest block, the reader copied its count
+        sealed = true;
+      }
+    }
+    // Decode ahead on a copy, chunks run across block boundaries
+    next = reader;
+    finished = 0;
+    n = 0;
+    while (n < SAMPLEBUF_FLUSH_CHUNK) {
+      if (HISTCODEC_Next(&next, &chunk[n])) {
+        n++;
+      } else if (++finished < used) {
+        HISTCODEC_ReaderInit(&next, &blocks[blockAt(finished)]);
+      } else {
+        break;
+      }
+    }
+
+    if ((n > 0) && !flushCallback(chunk, n)) {
+      pending = true;
+      return;
+    }
+
+    count -= n;
+    head = blockAt(finished);
+    used -= finished;
+    reader = next;
+    if (used == 1) {
+      // The reader is on the newest block now
+      sealed = true;
+    }
+  }
+
+  head = 0;
+  count = 0;
+  reading = false;
+  sealed = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   True if a flush stopped at a chunk the callback refused.
+ ******************************************************************************/
+bool SAMPLEBUF_FlushPending(void)
+{
+  return pending;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Number of records currently buffered.
+ ******************************************************************************/
+uint16_t SAMPLEBUF_Count(void)
+{
+  return count;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Number of records overwritten before they could be flushed.
+ ******************************************************************************/
+uint32_t SAMPLEBUF_Dropped(void)
+{
+  return dropped;
+}
+
+/** @} (end group SAMPLEBUF) */
@@ -0,0 +1,57 @@
+/***************************************************************************//**
+ * @file samplebuf.h
+ * @brief RAM ring buffer of timestamped air quality samples.
+ ******************************************************************************/
+
+#ifndef SAMPLEBUF_H
+#define SAMPLEBUF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup SAMPLEBUF
+ * @brief Statically allocated sample history with batched flush
+ * @{
+ ******************************************************************************/
+
+#ifndef SAMPLEBUF_BLOCKS
+#define SAMPLEBUF_BLOCKS      6     /**< HISTCODEC blocks held in RAM         */
+#endif
+
+#ifndef SAMPLEBUF_WATERMARK
+#define SAMPLEBUF_WATERMARK   240   /**< Records that trigger a flush         */
+#endif
+
+#define SAMPLEBUF_FLUSH_CHUNK 16    /**< Most records per flush callback      */
+
+/** One sample. */
+typedef struct {
+  uint32_t timestamp;   /**< Seconds since boot                        */
+  uint16_t eco2;        /**< Equivalent CO2 [ppm], raw mode: the index */
+  uint16_t tvoc;        /**< Total VOCs [ppb], raw mode: RAW_DATA      */
+  uint8_t  sensor;      /**< Index of the sensor that produced it      */
+  uint8_t  status;      /**< CCS811 STATUS register                    */
+  uint8_t  errorId;     /**< CCS811 ERROR_ID register                  */
+  uint8_t  reserved;    /**< Keeps the record at 12 bytes              */
+} SAMPLEBUF_Record_TypeDef;
+
+/**
+ * Flush callback. Receives the buffered records oldest first, decoded in
+ * chunks of at most SAMPLEBUF_FLUSH_CHUNK records per call. The records are
+ * only valid for the duration of the call. Returns false to refuse the
+ * chunk, the next SAMPLEBUF_Flush() offers it again.
+ */
+typedef bool (*SAMPLEBUF_FlushCallback_t)(const SAMPLEBUF_Record_TypeDef *records,
+                                          uint16_t count);
+
+void SAMPLEBUF_Init(uint16_t watermark, SAMPLEBUF_FlushCallback_t callback);
+void SAMPLEBUF_Push(const SAMPLEBUF_Record_TypeDef *record);
+void SAMPLEBUF_Flush(void);
+bool SAMPLEBUF_FlushPending(void);
+uint16_t SAMPLEBUF_Count(void);
+uint32_t SAMPLEBUF_Dropped(void);
+
+/** @} (end group SAMPLEBUF) */
+
+#endif /* SAMPLEBUF_H */
@@ -0,0 +1,258 @@
+/***************************************************************************//**
+ * @file sched.c
+ * @brief Cooperative run-to-completion scheduler with coalesced wakeups.
+ *
+ * @details
+ *   The main loop calls SCHED_Run() forever. Tasks run in the order they
+ *   were added. A task is ready when it has been signalled, by
+ *   SCHED_Signal() or an EVQUEUE event bound to it, or when its due time
+ *   has passed. Each pass runs every ready task once, passes repeat until
+ *   none is ready.
+ *
+ *   A timed task may run up to its slack after it is due. The scheduler
+ *   keeps one RTC timer, armed for the earliest due + slack, and every
+ *   wakeup also runs each other task that is already due. Work that falls
+ *   within the slack of another wakeup, an nINT edge or a timer, so costs
+ *   no wakeup of its own. A periodic task stays on the grid of its first
+ *   due time, a late run does not delay the next one. Runs missed by more
+ *   than a period are skipped, not caught up.
+ *
+ *   With nothing ready the idle step sleeps through POWERMGR_Sleep() in the
+ *   deepest mode the active subsystems allow.
+ *
+ *   Due times are RTC ticks and compared as signed differences, periods and
+ *   delays must stay below 2^31 ticks, about 18 hours.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_device.h"
+#include "em_core.h"
+#include "rtctimer.h"
+#include "powermgr.h"
+#include "perf.h"
+#include "sched.h"
+
+/***************************************************************************//**
+ * @addtogroup SCHED
+ * @{
+ ******************************************************************************/
+
+static SCHED_Task_TypeDef *taskList;
+static SCHED_Task_TypeDef *eventTask[evqueueCount];
+static RTCTIMER_Timer_TypeDef wakeTimer;
+
+/***************************************************************************//**
+ * @brief
+ *   Remove all tasks. Call before any other SCHED function.
+ ******************************************************************************/
+void SCHED_Init(void)
+{
+  unsigned int i;
+
+  taskList = NULL;
+  for (i = 0; i < evqueueCount; i++) {
+    eventTask[i] = NULL;
+  }
+  wakeTimer.running = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add a task behind the existing ones. It is idle until started or
+ *   signalled.
+ *
+ * @param[out] task
+ *   Caller allocated task object
+ *
+ * @param[in] handler
+ *   Work of the task
+ *
+ * @param[in] user
+ *   Opaque pointer for the handler, in task->user
+ ******************************************************************************/
+void SCHED_Add(SCHED_Task_TypeDef *task, SCHED_Handler_t handler, void *user)
+{
+  SCHED_Task_TypeDef **link = &taskList;
+
+  task->next = NULL;
+  task->handler = handler;
+  task->user = user;
+  task->timed = false;
+  task->signalled = false;
+  while (*link != NULL) {
+    link = &(*link)->next;
+  }
+  *link = task;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Signal a task for every event of a type taken from the EVQUEUE.
+ ******************************************************************************/
+void SCHED_Bind(EVQUEUE_Type_TypeDef type, SCHED_Task_TypeDef *task)
+{
+  eventTask[type] = task;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Arm the run time of a task. Re-arming replaces the previous one.
+ *
+ * @param[in] task
+ *   Added task
+ *
+ * @param[in] ms
+ *   Time until the first run, 0 for the next pass
+ *
+ * @param[in] periodMs
+ *   Time between runs, 0 to run once
+ *
+ * @param[in] slackMs
+ *   How late each run may be to share a wakeup with other work
+ ******************************************************************************/
+void SCHED_Start(SCHED_Task_TypeDef *task, uint32_t ms, uint32_t periodMs,
+                 uint32_t slackMs)
+{
+  task->due = RTCTIMER_GetTicks() + RTCTIMER_MsToTicks(ms);
+  task->period = RTCTIMER_MsToTicks(periodMs);
+  task->slack = RTCTIMER_MsToTicks(slackMs);
+  task->timed = true;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Disarm the run time of a task. A pending signal still runs it.
+ ******************************************************************************/
+void SCHED_Stop(SCHED_Task_TypeDef *task)
+{
+  task->timed = false;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether a task has a run time armed. In the handler of a task
+ *   run once this tells a signal from the expiry.
+ ******************************************************************************/
+bool SCHED_IsTimed(const SCHED_Task_TypeDef *task)
+{
+  return task->timed;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Make a task ready for the current or next pass. Main context only,
+ *   interrupt handlers post to the EVQUEUE.
+ *
+ * @param[in] task
+ *   Added task
+ *
+ * @param[in] ticks
+ *   RTC ticks of the cause, kept in task->signalTicks for the first signal
+ *   since the last run
+ ******************************************************************************/
+void SCHED_Signal(SCHED_Task_TypeDef *task, uint32_t ticks)
+{
+  if (!task->signalled) {
+    task->signalled = true;
+    task->signalTicks = ticks;
+  }
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run every ready task once.
+ *
+ * @return
+ *   True if any task ran, a handler may have made another one ready.
+ ******************************************************************************/
+static bool runPass(void)
+{
+  EVQUEUE_Event_TypeDef event;
+  SCHED_Task_TypeDef *task;
+  uint32_t now;
+  bool expired;
+  bool ran = false;
+
+  while (EVQUEUE_Get(&event)) {
+    if (eventTask[event.type] != NULL) {
+      SCHED_Signal(eventTask[event.type], event.ticks);
+    }
+  }
+
+  now = RTCTIMER_GetTicks();
+  for (task = taskList; task != NULL; task = task->next) {
+    expired = task->timed && ((int32_t)(now - task->due) >= 0);
+    if (!expired && !task->signalled) {
+      continue;
+    }
+    if (expired) {
+      // Inside its window and not the reason for this wakeup
+      if ((int32_t)(now - (task->due + task->slack)) < 0) {
+        PERF_COUNT(schedCoalesced);
+      }
+      task->due += task->period;
+      task->timed = (task->period != 0);
+      if (task->timed && ((int32_t)(now - task->due) >= 0)) {
+        task->due += ((now - task->due) / task->period + 1) * task->period;
+      }
+    }
+    // Cleared first, the handler may signal itself again
+    task->signalled = false;
+    task->handler(task);
+    ran = true;
+  }
+  return ran;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Arm the wakeup for the end of the earliest window and sleep until an
+ *   interrupt.
+ ******************************************************************************/
+static void idle(void)
+{
+  SCHED_Task_TypeDef *task;
+  uint32_t now = RTCTIMER_GetTicks();
+  uint32_t latest = 0;
+  bool timed = false;
+  CORE_DECLARE_IRQ_STATE;
+
+  for (task = taskList; task != NULL; task = task->next) {
+    if (task->timed && (!timed || ((int32_t)(task->due + task->slack - latest) < 0))) {
+      latest = task->due + task->slack;
+      timed = true;
+    }
+  }
+  if (timed) {
+    if ((int32_t)(latest - now) <= 0) {
+      return;
+    }
+    // Most passes leave the earliest window where it was
+    if (!RTCTIMER_IsRunning(&wakeTimer) || (wakeTimer.expire != latest)) {
+      RTCTIMER_StartTicks(&wakeTimer, latest - now, NULL, NULL);
+    }
+  } else {
+    RTCTIMER_Stop(&wakeTimer);
+  }
+
+  // Tested with interrupts masked, so an event racing the test still
+  // wakes the core
+  CORE_ENTER_CRITICAL();
+  if (EVQUEUE_IsEmpty()) {
+    POWERMGR_Sleep();
+  }
+  CORE_EXIT_CRITICAL();
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Run every ready task once, or sleep if none is. Call from the main loop.
+ ******************************************************************************/
+void SCHED_Run(void)
+{
+  if (!runPass()) {
+    idle();
+  }
+}
+
+/** @} (end group SCHED) */
@@ -0,0 +1,57 @@
+/***************************************************************************//**
+ * @file sched.h
+ * @brief Cooperative run-to-completion scheduler with coalesced wakeups.
+ ******************************************************************************/
+
+#ifndef SCHED_H
+#define SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "evqueue.h"
+
+/***************************************************************************//**
+ * @addtogroup SCHED
+ * @brief Periodic and event triggered tasks, one RTC wakeup for all of them
+ * @{
+ ******************************************************************************/
+
+#ifndef SCHED_SLACK_DEFAULT_MS
+#define SCHED_SLACK_DEFAULT_MS  1000  /**< Slack for work without a reason for more [ms] */
+#endif
+
+typedef struct SCHED_Task SCHED_Task_TypeDef;
+
+/** Task body, runs to completion in the main context. */
+typedef void (*SCHED_Handler_t)(SCHED_Task_TypeDef *task);
+
+/**
+ * Task object. Storage is owned by the caller and must outlive the
+ * scheduler. A timed task runs between due and due + slack, whichever
+ * wakeup comes first in that window.
+ */
+struct SCHED_Task {
+  SCHED_Task_TypeDef *next;        /**< Next task in run order             */
+  SCHED_Handler_t    handler;      /**< Work of the task                   */
+  void               *user;        /**< Opaque pointer for the handler     */
+  uint32_t           due;          /**< Earliest run, absolute RTC tick    */
+  uint32_t           slack;        /**< Allowed delay after due [ticks]    */
+  uint32_t           period;       /**< Repeat interval [ticks], 0 if once */
+  uint32_t           signalTicks;  /**< RTC ticks of the first signal since the last run */
+  bool               timed;        /**< due is armed                       */
+  bool               signalled;    /**< An event is waiting for the task   */
+};
+
+void SCHED_Init(void);
+void SCHED_Add(SCHED_Task_TypeDef *task, SCHED_Handler_t handler, void *user);
+void SCHED_Bind(EVQUEUE_Type_TypeDef type, SCHED_Task_TypeDef *task);
+void SCHED_Start(SCHED_Task_TypeDef *task, uint32_t ms, uint32_t periodMs,
+                 uint32_t slackMs);
+void SCHED_Stop(SCHED_Task_TypeDef *task);
+bool SCHED_IsTimed(const SCHED_Task_TypeDef *task);
+void SCHED_Signal(SCHED_Task_TypeDef *task, uint32_t ticks);
+void SCHED_Run(void);
+
+/** @} (end group SCHED) */
+
+#endif /* SCHED_H */
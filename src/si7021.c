@@ -0,0 +1,145 @@
+/***************************************************************************//**
+ * @file si7021.c
+ * @brief Driver for the Si7021 relative humidity and temperature sensor.
+ *
+ * @details
+ *   Measurements use the no hold master commands: the conversion is started
+ *   with one short write and the bus is free while it runs, so the CCS811s
+ *   on the same bus can be serviced in the meantime. The result read is
+ *   NACKed until the conversion is done.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_assert.h"
+#include "i2cint.h"
+#include "si7021.h"
+
+/***************************************************************************//**
+ * @addtogroup SI7021
+ * @{
+ ******************************************************************************/
+
+/***************************************************************************//**
+ * @brief
+ *   Run a prepared transfer and map the result to a driver status code.
+ *
+ * @details
+ *   Recovers the bus like the CCS811 driver does. A NACK is not retried,
+ *   it is how the part reports a conversion in progress.
+ ******************************************************************************/
+static uint32_t transfer(SI7021_Handle_TypeDef *dev, I2C_TransferSeq_TypeDef *seq)
+{
+  I2C_TransferReturn_TypeDef ret;
+  int attempt;
+
+  for (attempt = 0; attempt <= SI7021_I2C_RETRIES; attempt++) {
+    ret = I2CINT_Transfer(dev->i2c, seq);
+    if (ret == i2cTransferDone) {
+      return SI7021_OK;
+    }
+    if (ret == i2cTransferNack) {
+      return SI7021_ERROR_BUSY;
+    }
+    I2CINT_BusRecover(dev->i2c);
+  }
+  return SI7021_ERROR_I2C_TRANSACTION_FAILED;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Prepare a device handle and check that the part answers.
+ *
+ * @param[out] dev
+ *   Handle to initialize
+ *
+ * @param[in] i2c
+ *   Bus the sensor is attached to
+ *
+ * @param[in] addr
+ *   I2C address, normally SI7021_I2C_ADDR
+ *
+ * @return
+ *   SI7021_OK, or SI7021_ERROR_NOT_PRESENT when the ID read failed.
+ ******************************************************************************/
+uint32_t SI7021_Init(SI7021_Handle_TypeDef *dev, I2C_TypeDef *i2c, uint8_t addr)
+{
+  I2C_TransferSeq_TypeDef seq;
+  uint8_t cmd[2] = { SI7021_CMD_READ_ID2_1, SI7021_CMD_READ_ID2_2 };
+  uint8_t id[4];
+
+  EFM_ASSERT(dev != NULL);
+
+  dev->i2c = i2c;
+  dev->addr = addr;
+  dev->deviceId = 0;
+
+  I2CINT_SeqWriteRead(&seq, addr, cmd, sizeof(cmd), id, sizeof(id));
+  if (transfer(dev, &seq) != SI7021_OK) {
+    return SI7021_ERROR_NOT_PRESENT;
+  }
+  dev->deviceId = id[0];
+  return SI7021_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Start a humidity conversion. The part measures the temperature along
+ *   with it, the result is ready after SI7021_CONVERSION_MS.
+ ******************************************************************************/
+uint32_t SI7021_StartMeasurement(SI7021_Handle_TypeDef *dev)
+{
+  I2C_TransferSeq_TypeDef seq;
+  uint8_t cmd = SI7021_CMD_MEASURE_RH_NO_HOLD;
+  uint32_t status;
+
+  I2CINT_SeqWrite(&seq, dev->addr, &cmd, 1, NULL, 0);
+  status = transfer(dev, &seq);
+  // The part is not converting yet, a NACK here is a real failure
+  return (status == SI7021_ERROR_BUSY) ? SI7021_ERROR_I2C_TRANSACTION_FAILED : status;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Fetch the result of SI7021_StartMeasurement().
+ *
+ * @param[in] dev
+ *   Device handle
+ *
+ * @param[out] rhCode
+ *   Raw humidity code, RH = 125 * code / 65536 - 6 %RH
+ *
+ * @param[out] tempCode
+ *   Raw temperature code, T = 175.72 * code / 65536 - 46.85 degC
+ *
+ * @return
+ *   SI7021_ERROR_BUSY while the conversion is still running.
+ ******************************************************************************/
+uint32_t SI7021_ReadMeasurement(SI7021_Handle_TypeDef *dev, uint16_t *rhCode,
+                                uint16_t *tempCode)
+{
+  I2C_TransferSeq_TypeDef seq;
+  uint8_t cmd = SI7021_CMD_READ_TEMP_FROM_RH;
+  uint8_t buf[2];
+  uint32_t status;
+
+  // A bare read returns the humidity once the conversion is done
+  seq.addr = dev->addr;
+  seq.flags = I2C_FLAG_READ;
+  seq.buf[0].data = buf;
+  seq.buf[0].len = sizeof(buf);
+  status = transfer(dev, &seq);
+  if (status != SI7021_OK) {
+    return status;
+  }
+  *rhCode = ((uint16_t)buf[0] << 8) | buf[1];
+
+  I2CINT_SeqWriteRead(&seq, dev->addr, &cmd, 1, buf, sizeof(buf));
+  status = transfer(dev, &seq);
+  if (status != SI7021_OK) {
+    return SI7021_ERROR_I2C_TRANSACTION_FAILED;
+  }
+  *tempCode = ((uint16_t)buf[0] << 8) | buf[1];
+  return SI7021_OK;
+}
+
+/** @} (end group SI7021) */
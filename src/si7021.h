@@ -0,0 +1,59 @@
+/***************************************************************************//**
+ * @file si7021.h
+ * @brief Driver for the Si7021 relative humidity and temperature sensor.
+ ******************************************************************************/
+
+#ifndef SI7021_H
+#define SI7021_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "em_device.h"
+#include "em_i2c.h"
+
+/***************************************************************************//**
+ * @addtogroup SI7021
+ * @brief Si7021 driver, conversions run without holding the bus
+ * @{
+ ******************************************************************************/
+
+#define SI7021_I2C_ADDR                0x80  /**< Fixed I2C address                                  */
+#define SI7021_I2C_RETRIES             2     /**< Retries after a failed transfer                    */
+#define SI7021_CONVERSION_MS           25    /**< Worst case RH plus temperature conversion time [ms] */
+
+/**************************************************************************//**
+* @name Error Codes
+* @{
+******************************************************************************/
+#define SI7021_OK                           0x0000   /**< No errors                               */
+#define SI7021_ERROR_I2C_TRANSACTION_FAILED 0x0001   /**< I2C transaction failed                  */
+#define SI7021_ERROR_BUSY                   0x0002   /**< Conversion still running, result NACKed */
+#define SI7021_ERROR_NOT_PRESENT            0x0003   /**< No Si70xx answered on the bus           */
+/**@}*/
+
+/**************************************************************************//**
+* @name Commands
+* @{
+******************************************************************************/
+#define SI7021_CMD_MEASURE_RH_NO_HOLD  0xF5  /**< Measure humidity, followed by temperature, no clock stretching */
+#define SI7021_CMD_READ_TEMP_FROM_RH   0xE0  /**< Read the temperature measured with the last humidity          */
+#define SI7021_CMD_RESET               0xFE  /**< Software reset                                                */
+#define SI7021_CMD_READ_ID2_1          0xFC  /**< Read electronic ID 2nd word, first command byte              */
+#define SI7021_CMD_READ_ID2_2          0xC9  /**< Read electronic ID 2nd word, second command byte             */
+/**@}*/
+
+/** Device handle. Allocated by the caller. */
+typedef struct {
+  I2C_TypeDef *i2c;         /**< Bus the sensor is attached to             */
+  uint8_t     addr;         /**< I2C address                               */
+  uint8_t     deviceId;     /**< SNB_3 of the electronic ID, 0x15 = Si7021 */
+} SI7021_Handle_TypeDef;
+
+uint32_t SI7021_Init(SI7021_Handle_TypeDef *dev, I2C_TypeDef *i2c, uint8_t addr);
+uint32_t SI7021_StartMeasurement(SI7021_Handle_TypeDef *dev);
+uint32_t SI7021_ReadMeasurement(SI7021_Handle_TypeDef *dev, uint16_t *rhCode,
+                                uint16_t *tempCode);
+
+/** @} (end group SI7021) */
+
+#endif /* SI7021_H */
@@ -0,0 +1,474 @@
+/***************************************************************************//**
+ * @file telem.c
+ * @brief Framed binary telemetry on LEUART0, sent by DMA in EM2.
+ *
+ * @details
+ *   Every frame is the type byte, a sequence number, the payload and a
+ *   CRC-16/CCITT-FALSE over all of them, little endian. The frame is COBS
+ *   encoded and terminated by a zero byte, so a receiver that starts in
+ *   the middle of the stream resynchronizes on the next zero and a missing
+ *   sequence number shows a lost frame.
+ *
+ *   Encoded frames are appended to a ring buffer that a DMA channel feeds
+ *   into LEUART0 TXDATA, one contiguous span at a time. With TXDMAWU the
+ *   LEUART wakes the DMA controller in EM2 for each byte, so the core only
+ *   wakes for the completion of a span and once more for TX complete, when
+ *   the last byte has left the shift register. Between the first frame and
+ *   that point transmission holds an EM2 requirement, the LFB clock stops
+ *   in EM3.
+ *
+ *   TX is on PD4, LEUART0 location 0, at TELEM_BAUDRATE from the LFXO.
+ *   9600 baud is the fastest rate the 32768 Hz clock divides to within the
+ *   receiver tolerance.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_device.h"
+#include "em_cmu.h"
+#include "em_core.h"
+#include "em_gpio.h"
+#include "em_leuart.h"
+#include "dmactrl.h"
+#include "crc16.h"
+#include "evqueue.h"
+#include "perf.h"
+#include "powermgr.h"
+#include "telem.h"
+
+/***************************************************************************//**
+ * @addtogroup TELEM
+ * @{
+ ******************************************************************************/
+
+#define TELEM_TX_PORT        gpioPortD
+#define TELEM_TX_PIN         4
+
+/* Type, sequence number and CRC around the payload. */
+#define TELEM_OVERHEAD       4
+/* Largest encoded frame, one COBS code byte per 254 bytes and the zero. */
+#define TELEM_ENCODED_MAX    (TELEM_OVERHEAD + TELEM_PAYLOAD_MAX \
+                              + (TELEM_OVERHEAD + TELEM_PAYLOAD_MAX) / 254 + 2)
+
+/* Samples payload: base timestamp and count, then one entry per record. */
+#define SAMPLES_HEADER_SIZE  5
+#define SAMPLES_ENTRY_SIZE   9
+
+/* Log payload: the boot count, then a samples payload. */
+#define LOG_HEADER_SIZE      4
+
+/* Aggregate payload: start, sensor and count, then two summaries. */
+#define AGGREGATE_SIZE       (7 + 2 * 8)
+
+#if LOG_HEADER_SIZE + SAMPLES_HEADER_SIZE + TELEM_RECORDS_PER_FRAME * SAMPLES_ENTRY_SIZE \
+    > TELEM_PAYLOAD_MAX
+#error "TELEM_RECORDS_PER_FRAME records do not fit in TELEM_PAYLOAD_MAX"
+#endif
+
+static void dmaDone(unsigned int channel, bool primary, void *user);
+static DMA_CB_TypeDef dmaCallback = { dmaDone, NULL, 0 };
+
+static uint8_t txBuffer[TELEM_BUFFER_SIZE];
+static volatile uint16_t txHead;       /* Next byte written by TELEM_SendFrame() */
+static volatile uint16_t txTail;       /* Next byte the DMA sends                */
+static volatile uint16_t dmaLength;    /* Bytes of the span in flight, 0 if idle */
+static volatile bool powered;          /* EM2 requirement held                   */
+static uint8_t sequence;
+static uint8_t frame[TELEM_OVERHEAD + TELEM_PAYLOAD_MAX];
+
+/***************************************************************************//**
+ * @brief
+ *   Bytes queued and not yet handed to the DMA.
+ ******************************************************************************/
+static uint16_t used(void)
+{
+  return (uint16_t)((txHead + TELEM_BUFFER_SIZE - txTail) % TELEM_BUFFER_SIZE);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   COBS encode len bytes of src into the ring at txHead, with the trailing
+ *   zero. The caller has checked that TELEM_ENCODED_MAX bytes are free.
+ ******************************************************************************/
+static void cobsEncode(const uint8_t *src, uint16_t len)
+{
+  uint16_t codeIndex = txHead;
+  uint16_t index = (codeIndex + 1) % TELEM_BUFFER_SIZE;
+  uint8_t code = 1;
+
+  while (len--) {
+    uint8_t byte = *src++;
+
+    if (byte != 0) {
+      txBuffer[index] = byte;
+      index = (index + 1) % TELEM_BUFFER_SIZE;
+      code++;
+    }
+    if ((byte == 0) || (code == 0xFF)) {
+      txBuffer[codeIndex] = code;
+      codeIndex = index;
+      index = (index + 1) % TELEM_BUFFER_SIZE;
+      code = 1;
+    }
+  }
+  txBuffer[codeIndex] = code;
+  txBuffer[index] = 0;
+  txHead = (index + 1) % TELEM_BUFFER_SIZE;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Hand the next contiguous span to the DMA, or wait for TX complete when
+ *   there is none. Expects IRQs disabled and no span in flight.
+ ******************************************************************************/
+static void startSpan(void)
+{
+  uint16_t tail = txTail;
+  uint16_t length = (txHead >= tail) ? (txHead - tail) : (TELEM_BUFFER_SIZE - tail);
+
+  if (length == 0) {
+    LEUART_IntClear(LEUART0, LEUART_IF_TXC);
+    LEUART_IntEnable(LEUART0, LEUART_IEN_TXC);
+    return;
+  }
+  LEUART_IntDisable(LEUART0, LEUART_IEN_TXC);
+  dmaLength = length;
+  DMA_ActivateBasic(DMACTRL_CH_LEUART0_TX, true, false, (void *)&LEUART0->TXDATA,
+                    &txBuffer[tail], length - 1);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   DMA completion, called from DMA_IRQHandler() when a span has moved.
+ ******************************************************************************/
+static void dmaDone(unsigned int channel, bool primary, void *user)
+{
+  (void)channel;
+  (void)primary;
+  (void)user;
+
+  txTail = (txTail + dmaLength) % TELEM_BUFFER_SIZE;
+  dmaLength = 0;
+  startSpan();
+  // A producer held back by a full buffer can go on now
+  (void)EVQUEUE_Post(evqueueTelemSent, 0);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Set up LEUART0 on the LFXO and its DMA channel. Call after
+ *   RTCTIMER_Init(), which starts the LFXO.
+ ******************************************************************************/
+void TELEM_Init(void)
+{
+  LEUART_Init_TypeDef init = LEUART_INIT_DEFAULT;
+  DMA_CfgChannel_TypeDef chCfg;
+  DMA_CfgDescr_TypeDef descrCfg;
+
+  txHead = 0;
+  txTail = 0;
+  dmaLength = 0;
+  powered = false;
+  sequence = 0;
+
+  CMU_ClockSelectSet(cmuClock_LFB, cmuSelect_LFXO);
+  CMU_ClockEnable(cmuClock_LEUART0, true);
+
+  init.enable = leuartEnableTx;
+  init.baudrate = TELEM_BAUDRATE;
+  LEUART_Init(LEUART0, &init);
+
+  GPIO_PinModeSet(TELEM_TX_PORT, TELEM_TX_PIN, gpioModePushPull, 1);
+  LEUART0->ROUTE = LEUART_ROUTE_TXPEN | LEUART_ROUTE_LOCATION_LOC0;
+  LEUART_TxDmaInEM2Enable(LEUART0, true);
+
+  DMACTRL_Init();
+  chCfg.highPri = false;
+  chCfg.enableInt = true;
+  chCfg.select = DMAREQ_LEUART0_TXBL;
+  chCfg.cb = &dmaCallback;
+  DMA_CfgChannel(DMACTRL_CH_LEUART0_TX, &chCfg);
+  descrCfg.dstInc = dmaDataIncNone;
+  descrCfg.srcInc = dmaDataInc1;
+  descrCfg.size = dmaDataSize1;
+  descrCfg.arbRate = dmaArbitrate1;
+  descrCfg.hprot = 0;
+  DMA_CfgDescr(DMACTRL_CH_LEUART0_TX, true, &descrCfg);
+
+  NVIC_ClearPendingIRQ(LEUART0_IRQn);
+  NVIC_EnableIRQ(LEUART0_IRQn);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Queue one frame. Returns at once, the DMA sends it in the background.
+ *
+ * @param[in] type
+ *   Frame type
+ *
+ * @param[in] payload
+ *   Frame payload, copied before the call returns
+ *
+ * @param[in] len
+ *   Payload length, at most TELEM_PAYLOAD_MAX
+ *
+ * @return
+ *   TELEM_OK or the reason the frame was dropped
+ ******************************************************************************/
+uint32_t TELEM_SendFrame(TELEM_FrameType_TypeDef type, const uint8_t *payload,
+                         uint16_t len)
+{
+  uint16_t crc;
+  uint16_t i;
+  CORE_DECLARE_IRQ_STATE;
+
+  if (len > TELEM_PAYLOAD_MAX) {
+    PERF_COUNT(telemDropped);
+    return TELEM_ERROR_FRAME_TOO_LONG;
+  }
+  /* One byte stays free so a full ring is not mistaken for an empty one. */
+  if (TELEM_BUFFER_SIZE - 1 - used() < TELEM_ENCODED_MAX) {
+    PERF_COUNT(telemDropped);
+    return TELEM_ERROR_BUFFER_FULL;
+  }
+
+  frame[0] = (uint8_t)type;
+  frame[1] = sequence++;
+  for (i = 0; i < len; i++) {
+    frame[2 + i] = payload[i];
+  }
+  crc = CRC16_Update(CRC16_INIT, frame, 2 + len);
+  frame[2 + len] = (uint8_t)crc;
+  frame[3 + len] = (uint8_t)(crc >> 8);
+
+  /* Only txHead moves, the DMA callback reads it. */
+  cobsEncode(frame, len + TELEM_OVERHEAD);
+  PERF_COUNT(telemFrames);
+
+  CORE_ENTER_ATOMIC();
+  if (!powered) {
+    POWERMGR_Require(powermgrEM2);
+    powered = true;
+  }
+  if (dmaLength == 0) {
+    startSpan();
+  }
+  CORE_EXIT_ATOMIC();
+  return TELEM_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Append the samples payload of up to TELEM_RECORDS_PER_FRAME records,
+ *   see TELEM_SendSamples().
+ ******************************************************************************/
+static uint8_t *putRecords(uint8_t *p, const SAMPLEBUF_Record_TypeDef *records, uint16_t n)
+{
+  uint32_t base = records[0].timestamp;
+  uint16_t i;
+
+  *p++ = (uint8_t)base;
+  *p++ = (uint8_t)(base >> 8);
+  *p++ = (uint8_t)(base >> 16);
+  *p++ = (uint8_t)(base >> 24);
+  *p++ = (uint8_t)n;
+  for (i = 0; i < n; i++) {
+    const SAMPLEBUF_Record_TypeDef *r = &records[i];
+    uint32_t dt = r->timestamp - base;
+
+    if (dt > UINT16_MAX) {
+      dt = UINT16_MAX;
+    }
+    *p++ = (uint8_t)dt;
+    *p++ = (uint8_t)(dt >> 8);
+    *p++ = (uint8_t)r->eco2;
+    *p++ = (uint8_t)(r->eco2 >> 8);
+    *p++ = (uint8_t)r->tvoc;
+    *p++ = (uint8_t)(r->tvoc >> 8);
+    *p++ = r->sensor;
+    *p++ = r->status;
+    *p++ = r->errorId;
+  }
+  return p;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Queue sample records, TELEM_RECORDS_PER_FRAME per frame.
+ *
+ * @details
+ *   The payload is the timestamp of the first record (u32) and the record
+ *   count (u8), then per record the seconds since the first one (u16,
+ *   saturated), eCO2 (u16), TVOC (u16), sensor, STATUS and ERROR_ID (u8).
+ *
+ * @param[in] records
+ *   Records, copied before the call returns
+ *
+ * @param[in] count
+ *   Number of records
+ *
+ * @return
+ *   TELEM_OK, or the reason the first dropped frame was dropped. Records
+ *   after it are dropped as well.
+ ******************************************************************************/
+uint32_t TELEM_SendSamples(const SAMPLEBUF_Record_TypeDef *records, uint16_t count)
+{
+  uint8_t payload[SAMPLES_HEADER_SIZE + TELEM_RECORDS_PER_FRAME * SAMPLES_ENTRY_SIZE];
+
+  while (count > 0) {
+    uint16_t n = (count < TELEM_RECORDS_PER_FRAME) ? count : TELEM_RECORDS_PER_FRAME;
+    uint8_t *p = putRecords(payload, records, n);
+    uint32_t status;
+
+    status = TELEM_SendFrame(telemFrameSamples, payload, (uint16_t)(p - payload));
+    if (status != TELEM_OK) {
+      return status;
+    }
+    records += n;
+    count -= n;
+  }
+  return TELEM_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Queue records read back from the flash log, TELEM_RECORDS_PER_FRAME
+ *   per frame.
+ *
+ * @details
+ *   The payload is the boot count of the run that logged the records
+ *   (u32), then a samples payload as in TELEM_SendSamples(). Timestamps
+ *   count from that boot.
+ *
+ * @param[in] boot
+ *   Boot count the records were logged in, see FLASHLOG_Boot()
+ *
+ * @param[in] records
+ *   Records of that boot, copied before the call returns
+ *
+ * @param[in] count
+ *   Number of records
+ *
+ * @return
+ *   TELEM_OK, or the reason the first dropped frame was dropped. Records
+ *   after it are dropped as well.
+ ******************************************************************************/
+uint32_t TELEM_SendLog(uint32_t boot, const SAMPLEBUF_Record_TypeDef *records, uint16_t count)
+{
+  uint8_t payload[LOG_HEADER_SIZE + SAMPLES_HEADER_SIZE
+                  + TELEM_RECORDS_PER_FRAME * SAMPLES_ENTRY_SIZE];
+
+  payload[0] = (uint8_t)boot;
+  payload[1] = (uint8_t)(boot >> 8);
+  payload[2] = (uint8_t)(boot >> 16);
+  payload[3] = (uint8_t)(boot >> 24);
+  while (count > 0) {
+    uint16_t n = (count < TELEM_RECORDS_PER_FRAME) ? count : TELEM_RECORDS_PER_FRAME;
+    uint8_t *p = putRecords(payload + LOG_HEADER_SIZE, records, n);
+    uint32_t status;
+
+    status = TELEM_SendFrame(telemFrameLog, payload, (uint16_t)(p - payload));
+    if (status != TELEM_OK) {
+      return status;
+    }
+    records += n;
+    count -= n;
+  }
+  return TELEM_OK;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Append a period summary to a payload, little endian.
+ ******************************************************************************/
+static uint8_t *putSummary(uint8_t *p, const WINSTAT_Summary_TypeDef *summary)
+{
+  *p++ = (uint8_t)summary->min;
+  *p++ = (uint8_t)(summary->min >> 8);
+  *p++ = (uint8_t)summary->max;
+  *p++ = (uint8_t)(summary->max >> 8);
+  *p++ = (uint8_t)summary->mean;
+  *p++ = (uint8_t)(summary->mean >> 8);
+  *p++ = (uint8_t)summary->ewma;
+  *p++ = (uint8_t)(summary->ewma >> 8);
+  return p;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Queue the aggregates of one closed period of a sensor.
+ *
+ * @details
+ *   The payload is the period start (u32), the sensor (u8) and the sample
+ *   count (u16), then min, max, mean and EWMA (u16 each) for eCO2 and for
+ *   TVOC. 23 bytes stand in for every sample of the period.
+ *
+ * @param[in] sensor
+ *   Index of the sensor
+ *
+ * @param[in] eco2
+ *   eCO2 summary, raw mode: the index
+ *
+ * @param[in] tvoc
+ *   TVOC summary of the same period, raw mode: the ADC reading
+ *
+ * @return
+ *   TELEM_OK or the reason the frame was dropped
+ ******************************************************************************/
+uint32_t TELEM_SendAggregate(uint8_t sensor, const WINSTAT_Summary_TypeDef *eco2,
+                             const WINSTAT_Summary_TypeDef *tvoc)
+{
+  uint8_t payload[AGGREGATE_SIZE];
+  uint8_t *p = payload;
+
+  *p++ = (uint8_t)eco2->start;
+  *p++ = (uint8_t)(eco2->start >> 8);
+  *p++ = (uint8_t)(eco2->start >> 16);
+  *p++ = (uint8_t)(eco2->start >> 24);
+  *p++ = sensor;
+  *p++ = (uint8_t)eco2->count;
+  *p++ = (uint8_t)(eco2->count >> 8);
+  p = putSummary(p, eco2);
+  p = putSummary(p, tvoc);
+
+  return TELEM_SendFrame(telemFrameAggregate, payload, (uint16_t)(p - payload));
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether a number of frames of any length fits the transmit
+ *   buffer now, so a caller can hold data back instead of losing it.
+ ******************************************************************************/
+bool TELEM_HasRoom(uint16_t frames)
+{
+  return (uint32_t)frames * TELEM_ENCODED_MAX <= (uint32_t)(TELEM_BUFFER_SIZE - 1 - used());
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Check whether bytes are still queued or on the wire.
+ ******************************************************************************/
+bool TELEM_IsBusy(void)
+{
+  return powered;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   LEUART0 interrupt handler, TX complete after the last span.
+ ******************************************************************************/
+void LEUART0_IRQHandler(void)
+{
+  uint32_t flags = LEUART_IntGet(LEUART0);
+
+  LEUART_IntClear(LEUART0, flags);
+  if (!(flags & LEUART_IF_TXC)) {
+    return;
+  }
+  LEUART_IntDisable(LEUART0, LEUART_IEN_TXC);
+  if ((dmaLength == 0) && (txHead == txTail) && powered) {
+    powered = false;
+    POWERMGR_Release(powermgrEM2);
+  }
+}
+
+/** @} (end group TELEM) */
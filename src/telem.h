@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ * @file telem.h
+ * @brief Framed binary telemetry on LEUART0, sent by DMA in EM2.
+ ******************************************************************************/
+
+#ifndef TELEM_H
+#define TELEM_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "samplebuf.h"
+#include "winstat.h"
+
+/***************************************************************************//**
+ * @addtogroup TELEM
+ * @brief COBS framed, CRC protected records on a 9600 baud LEUART
+ * @{
+ ******************************************************************************/
+
+/**************************************************************************//**
+* @name Error Codes
+* @{
+******************************************************************************/
+#define TELEM_OK                     0x0000   /**< Frame queued                        */
+#define TELEM_ERROR_BUFFER_FULL      0x0001   /**< No room in the transmit buffer      */
+#define TELEM_ERROR_FRAME_TOO_LONG   0x0002   /**< Payload above TELEM_PAYLOAD_MAX     */
+/**@}*/
+
+#ifndef TELEM_BAUDRATE
+#define TELEM_BAUDRATE          9600    /**< LEUART rate, at most 9600 on the LFXO */
+#endif
+
+#ifndef TELEM_BUFFER_SIZE
+#define TELEM_BUFFER_SIZE       512     /**< Encoded bytes queued for the DMA      */
+#endif
+
+#define TELEM_PAYLOAD_MAX       160     /**< Largest payload of one frame          */
+#define TELEM_RECORDS_PER_FRAME 16      /**< Sample records in one samples frame   */
+
+/** Frame types, the first byte of every frame. */
+typedef enum {
+  telemFrameSamples   = 0x01, /**< Sample records, see TELEM_SendSamples()     */
+  telemFrameAggregate = 0x02, /**< Period aggregate, see TELEM_SendAggregate() */
+  telemFrameBench     = 0x03, /**< Benchmark records, see BENCH                */
+  telemFrameLog       = 0x04, /**< Logged records, see TELEM_SendLog()         */
+} TELEM_FrameType_TypeDef;
+
+void TELEM_Init(void);
+uint32_t TELEM_SendFrame(TELEM_FrameType_TypeDef type, const uint8_t *payload,
+                         uint16_t len);
+uint32_t TELEM_SendSamples(const SAMPLEBUF_Record_TypeDef *records, uint16_t count);
+uint32_t TELEM_SendLog(uint32_t boot, const SAMPLEBUF_Record_TypeDef *records, uint16_t count);
+uint32_t TELEM_SendAggregate(uint8_t sensor, const WINSTAT_Summary_TypeDef *eco2,
+                             const WINSTAT_Summary_TypeDef *tvoc);
+bool TELEM_HasRoom(uint16_t frames);
+bool TELEM_IsBusy(void);
+
+/** @} (end group TELEM) */
+
+#endif /* TELEM_H */
@@ -0,0 +1,278 @@
+/***************************************************************************//**
+ * @file winstat.c
+ * @brief Incremental sample statistics: sliding window, EWMA and periods.
+ *
+ * @details
+ *   Three views of one stream, all updated by WINSTAT_Push() with integer
+ *   arithmetic and without looping over the window:
+ *
+ *   - Min, max and mean of the last WINSTAT_WINDOW samples. The mean comes
+ *     from a running sum. Min and max come from monotonic queues of sample
+ *     sequence numbers: a new sample first drops every queued sample it
+ *     dominates from the back, then goes to the back itself, and the front
+ *     leaves once it falls out of the window. Every sample enters and leaves
+ *     each queue once, so a push costs amortized constant time and the
+ *     front is always the extreme of the window.
+ *   - An EWMA with weight 2^-WINSTAT_EWMA_SHIFT, kept with four fractional
+ *     bits so small steps are not lost to truncation.
+ *   - Min, max and mean per WINSTAT_PERIOD_S, aligned to multiples of the
+ *     period. A period is closed by the first sample of a later one, so a
+ *     stream without samples does not produce empty periods.
+ *
+ *   WINSTAT_Band() adds hysteresis to band decisions on any of them.
+ ******************************************************************************/
+
+#include <stddef.h>
+#include "em_assert.h"
+#include "winstat.h"
+
+/***************************************************************************//**
+ * @addtogroup WINSTAT
+ * @{
+ ******************************************************************************/
+
+#if (WINSTAT_WINDOW & (WINSTAT_WINDOW - 1)) || (WINSTAT_WINDOW > 256)
+#error "WINSTAT_WINDOW must be a power of two of at most 256"
+#endif
+
+#define WINDOW_MASK       (WINSTAT_WINDOW - 1)
+#define EWMA_FRACTION     4
+
+/***************************************************************************//**
+ * @brief
+ *   Value of the sample with a sequence number still in the window.
+ ******************************************************************************/
+static uint16_t valueOf(const WINSTAT_Stream_TypeDef *stream, uint16_t sequence)
+{
+  return stream->values[sequence & WINDOW_MASK];
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add sequence to a monotonic queue.
+ *
+ * @param[in] keepMax
+ *   True for the maximum queue, which drops smaller or equal samples from
+ *   the back, false for the minimum queue, which drops larger or equal ones.
+ ******************************************************************************/
+static void queuePush(WINSTAT_Stream_TypeDef *stream, uint16_t *queue, uint8_t head,
+                      uint8_t *length, uint16_t sequence, bool keepMax)
+{
+  uint16_t value = valueOf(stream, sequence);
+
+  while (*length > 0) {
+    uint16_t back = valueOf(stream, queue[(head + *length - 1) & WINDOW_MASK]);
+    if (keepMax ? (back > value) : (back < value)) {
+      break;
+    }
+    (*length)--;
+  }
+  queue[(head + *length) & WINDOW_MASK] = sequence;
+  (*length)++;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Reset a stream to no samples.
+ ******************************************************************************/
+void WINSTAT_Init(WINSTAT_Stream_TypeDef *stream)
+{
+  stream->sequence = 0;
+  stream->filled = 0;
+  stream->minHead = 0;
+  stream->minLength = 0;
+  stream->maxHead = 0;
+  stream->maxLength = 0;
+  stream->sum = 0;
+  stream->ewma = 0;
+  stream->periodCount = 0;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Add a sample to all statistics.
+ *
+ * @param[in] stream
+ *   Stream to update
+ *
+ * @param[in] value
+ *   New sample
+ *
+ * @param[in] now
+ *   Time of the sample [s]
+ *
+ * @param[out] closed
+ *   Receives the period this sample closed, may be NULL
+ *
+ * @return
+ *   True if the sample is the first of a new period and closed was filled.
+ ******************************************************************************/
+bool WINSTAT_Push(WINSTAT_Stream_TypeDef *stream, uint16_t value, uint32_t now,
+                  WINSTAT_Summary_TypeDef *closed)
+{
+  uint16_t sequence = stream->sequence++;
+  uint32_t periodStart = now - (now % WINSTAT_PERIOD_S);
+  bool periodClosed = false;
+
+  /* Period first, its summary reports the EWMA before this sample. */
+  if ((stream->periodCount > 0) && (periodStart != stream->periodStart)) {
+    if (closed != NULL) {
+      closed->start = stream->periodStart;
+      closed->count = stream->periodCount;
+      closed->min   = stream->periodMin;
+      closed->max   = stream->periodMax;
+      closed->mean  = (uint16_t)((stream->periodSum + stream->periodCount / 2)
+                                 / stream->periodCount);
+      closed->ewma  = WINSTAT_Ewma(stream);
+    }
+    stream->periodCount = 0;
+    periodClosed = true;
+  }
+  if (stream->periodCount == 0) {
+    stream->periodStart = periodStart;
+    stream->periodSum = 0;
+    stream->periodMin = UINT16_MAX;
+    stream->periodMax = 0;
+  }
+  if (stream->periodCount < UINT16_MAX) {
+    stream->periodCount++;
+    stream->periodSum += value;
+  }
+  if (value < stream->periodMin) {
+    stream->periodMin = value;
+  }
+  if (value > stream->periodMax) {
+    stream->periodMax = value;
+  }
+
+  /* The sample leaving the window can only be at the front of a queue. */
+  if (stream->filled == WINSTAT_WINDOW) {
+    uint16_t leaving = (uint16_t)(sequence - WINSTAT_WINDOW);
+
+    stream->sum -= valueOf(stream, leaving);
+    if ((stream->minLength > 0) && (stream->minQueue[stream->minHead] == leaving)) {
+      stream->minHead = (stream->minHead + 1) & WINDOW_MASK;
+      stream->minLength--;
+    }
+    if ((stream->maxLength > 0) && (stream->maxQueue[stream->maxHead] == leaving)) {
+      stream->maxHead = (stream->maxHead + 1) & WINDOW_MASK;
+      stream->maxLength--;
+    }
+  } else {
+    stream->filled++;
+  }
+  stream->values[sequence & WINDOW_MASK] = value;
+  stream->sum += value;
+  queuePush(stream, stream->minQueue, stream->minHead, &stream->minLength,
+            sequence, false);
+  queuePush(stream, stream->maxQueue, stream->maxHead, &stream->maxLength,
+            sequence, true);
+
+  if (stream->filled == 1) {
+    stream->ewma = (uint32_t)value << EWMA_FRACTION;
+  } else {
+    int32_t delta = (int32_t)((uint32_t)value << EWMA_FRACTION) - (int32_t)stream->ewma;
+    /* Arithmetic shift, rounds towards minus infinity for falling input. */
+    stream->ewma = (uint32_t)((int32_t)stream->ewma + (delta >> WINSTAT_EWMA_SHIFT));
+  }
+
+  return periodClosed && (closed != NULL);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Smallest sample in the window, 0 without samples.
+ ******************************************************************************/
+uint16_t WINSTAT_Min(const WINSTAT_Stream_TypeDef *stream)
+{
+  if (stream->minLength == 0) {
+    return 0;
+  }
+  return valueOf(stream, stream->minQueue[stream->minHead]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Largest sample in the window, 0 without samples.
+ ******************************************************************************/
+uint16_t WINSTAT_Max(const WINSTAT_Stream_TypeDef *stream)
+{
+  if (stream->maxLength == 0) {
+    return 0;
+  }
+  return valueOf(stream, stream->maxQueue[stream->maxHead]);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Rounded mean of the window, 0 without samples.
+ ******************************************************************************/
+uint16_t WINSTAT_Mean(const WINSTAT_Stream_TypeDef *stream)
+{
+  if (stream->filled == 0) {
+    return 0;
+  }
+  return (uint16_t)((stream->sum + stream->filled / 2) / stream->filled);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Rounded EWMA, 0 without samples.
+ ******************************************************************************/
+uint16_t WINSTAT_Ewma(const WINSTAT_Stream_TypeDef *stream)
+{
+  return (uint16_t)((stream->ewma + (1U << (EWMA_FRACTION - 1))) >> EWMA_FRACTION);
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Number of samples in the window.
+ ******************************************************************************/
+uint16_t WINSTAT_Count(const WINSTAT_Stream_TypeDef *stream)
+{
+  return stream->filled;
+}
+
+/***************************************************************************//**
+ * @brief
+ *   Band of a value with hysteresis around each threshold.
+ *
+ * @details
+ *   Band n lies above thresholds[n - 1]. The band only moves up once value
+ *   exceeds a threshold by more than hysteresis and only moves down once it
+ *   is more than hysteresis below it, so a value hovering around a
+ *   threshold keeps the band it has.
+ *
+ * @param[in] band
+ *   Current band, 0 to count
+ *
+ * @param[in] value
+ *   New value
+ *
+ * @param[in] thresholds
+ *   Ascending band limits
+ *
+ * @param[in] count
+ *   Number of thresholds
+ *
+ * @param[in] hysteresis
+ *   Margin on either side of each threshold
+ *
+ * @return
+ *   New band
+ ******************************************************************************/
+uint8_t WINSTAT_Band(uint8_t band, uint16_t value, const uint16_t *thresholds,
+                     uint8_t count, uint16_t hysteresis)
+{
+  EFM_ASSERT(band <= count);
+
+  while ((band < count) && ((uint32_t)value > (uint32_t)thresholds[band] + hysteresis)) {
+    band++;
+  }
+  while ((band > 0) && ((uint32_t)value + hysteresis < thresholds[band - 1])) {
+    band--;
+  }
+  return band;
+}
+
+/** @} (end group WINSTAT) */
@@ -0,0 +1,73 @@
+/***************************************************************************//**
+ * @file winstat.h
+ * @brief Incremental sample statistics: sliding window, EWMA and periods.
+ ******************************************************************************/
+
+#ifndef WINSTAT_H
+#define WINSTAT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/***************************************************************************//**
+ * @addtogroup WINSTAT
+ * @brief Constant time integer statistics of one sample stream
+ * @{
+ ******************************************************************************/
+
+#ifndef WINSTAT_WINDOW
+#define WINSTAT_WINDOW        16    /**< Sliding window [samples], power of two, <= 256 */
+#endif
+
+#ifndef WINSTAT_EWMA_SHIFT
+#define WINSTAT_EWMA_SHIFT    3     /**< EWMA weight of a new sample is 2^-shift        */
+#endif
+
+#ifndef WINSTAT_PERIOD_S
+#define WINSTAT_PERIOD_S      60    /**< Aggregation period, aligned to its length [s]  */
+#endif
+
+/** Aggregate of one closed period. */
+typedef struct {
+  uint32_t start;       /**< Start of the period [s]              */
+  uint16_t count;       /**< Samples in the period                */
+  uint16_t min;         /**< Smallest sample                      */
+  uint16_t max;         /**< Largest sample                       */
+  uint16_t mean;        /**< Rounded mean                         */
+  uint16_t ewma;        /**< EWMA after the last sample of it     */
+} WINSTAT_Summary_TypeDef;
+
+/** Statistics of one stream. Storage is owned by the caller. */
+typedef struct {
+  uint16_t values[WINSTAT_WINDOW];   /**< Window, indexed by sequence        */
+  uint16_t minQueue[WINSTAT_WINDOW]; /**< Sequences of ascending minima      */
+  uint16_t maxQueue[WINSTAT_WINDOW]; /**< Sequences of descending maxima     */
+  uint16_t sequence;                 /**< Sequence of the next sample        */
+  uint16_t filled;                   /**< Samples in the window              */
+  uint8_t  minHead;                  /**< Oldest entry of minQueue           */
+  uint8_t  minLength;
+  uint8_t  maxHead;                  /**< Oldest entry of maxQueue           */
+  uint8_t  maxLength;
+  uint32_t sum;                      /**< Sum of the window                  */
+  uint32_t ewma;                     /**< EWMA, 4 fractional bits            */
+  uint32_t periodStart;              /**< Start of the open period [s]       */
+  uint32_t periodSum;
+  uint16_t periodCount;
+  uint16_t periodMin;
+  uint16_t periodMax;
+} WINSTAT_Stream_TypeDef;
+
+void WINSTAT_Init(WINSTAT_Stream_TypeDef *stream);
+bool WINSTAT_Push(WINSTAT_Stream_TypeDef *stream, uint16_t value, uint32_t now,
+                  WINSTAT_Summary_TypeDef *closed);
+uint16_t WINSTAT_Min(const WINSTAT_Stream_TypeDef *stream);
+uint16_t WINSTAT_Max(const WINSTAT_Stream_TypeDef *stream);
+uint16_t WINSTAT_Mean(const WINSTAT_Stream_TypeDef *stream);
+uint16_t WINSTAT_Ewma(const WINSTAT_Stream_TypeDef *stream);
+uint16_t WINSTAT_Count(const WINSTAT_Stream_TypeDef *stream);
+uint8_t WINSTAT_Band(uint8_t band, uint16_t value, const uint16_t *thresholds,
+                     uint8_t count, uint16_t hysteresis);
+
+/** @} (end group WINSTAT) */
+
+#endif /* WINSTAT_H */